@@ -52,6 +52,11 @@ class AppInterface : public QObject
 
     void loadProjectStarted( const QString &path );
 
+    void projectLayersReady();
+
+    //! Emitted while the layers of a project loaded in the background are resolved
+    void loadProjectProgress( int resolvedCount, int layerCount );
+
     void loadProjectEnded();
 
   private:
@@ -14,6 +14,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "badlayerhandler.h"
+#include <qgsmaplayer.h>
 #include <qgsproject.h>
 
 BadLayerHandler::BadLayerHandler( QObject *parent )
@@ -63,6 +64,24 @@ void BadLayerHandler::handleBadLayers( const QList<QDomNode> &layers )
   emit badLayersFound();
 }
 
+void BadLayerHandler::handleInvalidLayers( const QList<QgsMapLayer *> &layers )
+{
+  if ( layers.isEmpty() )
+    return;
+
+  clear();
+
+  for ( const QgsMapLayer *layer : layers )
+  {
+    QStandardItem *item = new QStandardItem();
+    item->setData( layer->publicSource(), DataSourceRole );
+    item->setData( layer->name(), LayerNameRole );
+    appendRow( item );
+  }
+
+  emit badLayersFound();
+}
+
 QString BadLayerHandler::layerName( const QDomNode &layerNode ) const
 {
   return layerNode.namedItem( "layername" ).toElement().text();
@@ -19,6 +19,7 @@
 #include <QStandardItemModel>
 #include <qgsprojectbadlayerhandler.h>
 
+class QgsMapLayer;
 class QgsProject;
 
 class BadLayerHandler : public QStandardItemModel, public QgsProjectBadLayerHandler
@@ -43,6 +44,12 @@ class BadLayerHandler : public QStandardItemModel, public QgsProjectBadLayerHand
 
     void handleBadLayers( const QList<QDomNode> &layers ) override;
 
+    /**
+     * Reports the invalid \a layers, e.g. the layers of a project read without resolving them
+     * which could not be resolved afterwards. The project does not report those itself.
+     */
+    void handleInvalidLayers( const QList<QgsMapLayer *> &layers );
+
   signals:
     void projectChanged();
     void badLayersFound();
@@ -0,0 +1,96 @@
+/***************************************************************************
+  coordinatetransformcache.cpp - CoordinateTransformCache
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "coordinatetransformcache.h"
+
+#include <qgsproject.h>
+
+CoordinateTransformCache::CoordinateTransformCache()
+{
+  // the cached transforms were created with the previous context
+  QObject::connect( QgsProject::instance(), &QgsProject::transformContextChanged, QgsProject::instance(), [this] { clear(); } );
+}
+
+CoordinateTransformCache *CoordinateTransformCache::instance()
+{
+  // thread safe initialization, the render thread may be the first to ask for a transform
+  static CoordinateTransformCache sInstance;
+  return &sInstance;
+}
+
+QgsCoordinateTransform CoordinateTransformCache::transform( const QgsCoordinateReferenceSystem &source, const QgsCoordinateReferenceSystem &destination, const QgsCoordinateTransformContext &context )
+{
+  if ( !mThreadCaches.hasLocalData() )
+    mThreadCaches.setLocalData( new ThreadCache() );
+
+  ThreadCache *cache = mThreadCaches.localData();
+  const int generation = mGeneration.loadAcquire();
+  if ( cache->generation != generation )
+  {
+    cache->entries.clear();
+    cache->generation = generation;
+  }
+
+  QList<Entry> &entries = cache->entries[qMakePair( crsKey( source ), crsKey( destination ) )];
+  for ( const Entry &entry : qgis::as_const( entries ) )
+  {
+    if ( entry.context == context )
+    {
+      mHits.ref();
+      return entry.transform;
+    }
+  }
+
+  mMisses.ref();
+  const QgsCoordinateTransform transform( source, destination, context );
+  entries << Entry { context, transform };
+  return transform;
+}
+
+QgsCoordinateTransform CoordinateTransformCache::transform( const QgsCoordinateReferenceSystem &source, const QgsCoordinateReferenceSystem &destination )
+{
+  return transform( source, destination, QgsProject::instance()->transformContext() );
+}
+
+void CoordinateTransformCache::clear()
+{
+  mGeneration.ref();
+}
+
+int CoordinateTransformCache::hits() const
+{
+  return mHits.loadAcquire();
+}
+
+int CoordinateTransformCache::misses() const
+{
+  return mMisses.loadAcquire();
+}
+
+void CoordinateTransformCache::resetStatistics()
+{
+  mHits.storeRelease( 0 );
+  mMisses.storeRelease( 0 );
+}
+
+QString CoordinateTransformCache::crsKey( const QgsCoordinateReferenceSystem &crs )
+{
+  if ( !crs.isValid() )
+    return QString();
+
+  // custom crs have no authority id
+  const QString authid = crs.authid();
+  return authid.isEmpty() ? crs.toWkt() : authid;
+}
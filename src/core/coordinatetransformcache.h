@@ -0,0 +1,88 @@
+/***************************************************************************
+  coordinatetransformcache.h - CoordinateTransformCache
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef COORDINATETRANSFORMCACHE_H
+#define COORDINATETRANSFORMCACHE_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QThreadStorage>
+
+#include <qgscoordinatetransform.h>
+#include <qgscoordinatetransformcontext.h>
+
+/**
+ * A cache of coordinate transforms shared by the whole application.
+ *
+ * Creating a QgsCoordinateTransform looks up a coordinate operation pipeline, which is
+ * expensive compared to transforming a few coordinates. The transforms are kept per
+ * source crs, destination crs and transform context, and per thread, so that the
+ * transforms handed out on the render and worker threads are not shared with the UI thread.
+ *
+ * The cache is cleared whenever the transform context of the project changes.
+ */
+class CoordinateTransformCache
+{
+  public:
+    //! Returns the application wide instance of the cache
+    static CoordinateTransformCache *instance();
+
+    /**
+     * Returns a transform from \a source to \a destination with \a context, created
+     * on the first request from the calling thread and cached afterwards.
+     */
+    QgsCoordinateTransform transform( const QgsCoordinateReferenceSystem &source, const QgsCoordinateReferenceSystem &destination, const QgsCoordinateTransformContext &context );
+
+    //! Returns a transform from \a source to \a destination with the transform context of the project
+    QgsCoordinateTransform transform( const QgsCoordinateReferenceSystem &source, const QgsCoordinateReferenceSystem &destination );
+
+    //! Drops the cached transforms of all the threads
+    void clear();
+
+    //! Returns the number of requests served from the cache
+    int hits() const;
+
+    //! Returns the number of requests which needed a new transform
+    int misses() const;
+
+    //! Resets the hit and miss counters
+    void resetStatistics();
+
+  private:
+    CoordinateTransformCache();
+
+    struct Entry
+    {
+      QgsCoordinateTransformContext context;
+      QgsCoordinateTransform transform;
+    };
+
+    //! The transforms of one thread, keyed by source and destination crs
+    struct ThreadCache
+    {
+      int generation = 0;
+      QHash<QPair<QString, QString>, QList<Entry>> entries;
+    };
+
+    static QString crsKey( const QgsCoordinateReferenceSystem &crs );
+
+    QThreadStorage<ThreadCache *> mThreadCaches;
+    //! incremented on clear(), thread caches of an older generation are outdated
+    QAtomicInt mGeneration = 0;
+    QAtomicInt mHits = 0;
+    QAtomicInt mMisses = 0;
+};
+
+#endif // COORDINATETRANSFORMCACHE_H
@@ -18,6 +18,13 @@
 #include "rubberband.h"
 #include "qgsvectorlayer.h"
 #include "qgsproject.h"
+#include "qgslogger.h"
+#include "qgsexception.h"
+#include "qgsmessagelog.h"
+#include "geometryutils.h"
+#include "coordinatetransformcache.h"
+
+#include <cmath>
 
 DistanceArea::DistanceArea( QObject *parent )
   : QObject( parent )
@@ -38,6 +45,34 @@ void DistanceArea::init()
     mDistanceArea.setEllipsoid( geoNone() );
   }
 
+  mUseEllipsoid = mDistanceArea.willUseEllipsoid();
+  if ( mUseEllipsoid )
+  {
+    // the same constants as QgsDistanceArea::computeAreaInit()
+    const double a2 = mDistanceArea.ellipsoidSemiMajor() * mDistanceArea.ellipsoidSemiMajor();
+    const double e2 = 1 - ( mDistanceArea.ellipsoidSemiMinor() * mDistanceArea.ellipsoidSemiMinor() ) / a2;
+    const double e4 = e2 * e2;
+    const double e6 = e4 * e2;
+
+    mAE = a2 * ( 1 - e2 );
+
+    mQA = ( 2.0 / 3.0 ) * e2;
+    mQB = ( 3.0 / 5.0 ) * e4;
+    mQC = ( 4.0 / 7.0 ) * e6;
+
+    mQbarA = -1.0 - ( 2.0 / 3.0 ) * e2 - ( 3.0 / 5.0 ) * e4 - ( 4.0 / 7.0 ) * e6;
+    mQbarB = ( 2.0 / 9.0 ) * e2 + ( 2.0 / 5.0 ) * e4 + ( 4.0 / 7.0 ) * e6;
+    mQbarC = - ( 3.0 / 25.0 ) * e4 - ( 12.0 / 35.0 ) * e6;
+    mQbarD = ( 4.0 / 49.0 ) * e6;
+
+    mQp = getQ( M_PI_2 );
+    mE = std::fabs( 4 * M_PI * mQp * mAE );
+
+    mEllipsoidTransform = CoordinateTransformCache::instance()->transform( mCrs, mDistanceArea.ellipsoidCrs(), mProject->transformContext() );
+  }
+
+  rebuild();
+
   emit lengthUnitsChanged();
   emit areaUnitsChanged();
 }
@@ -77,9 +112,10 @@ void DistanceArea::setRubberbandModel( RubberbandModel *rubberbandModel )
 
   if ( mRubberbandModel )
   {
-    disconnect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::lengthChanged );
-    disconnect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::areaChanged );
-    disconnect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::segmentLengthChanged );
+    disconnect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::onVertexChanged );
+    disconnect( mRubberbandModel, &RubberbandModel::verticesInserted, this, &DistanceArea::onVerticesInserted );
+    disconnect( mRubberbandModel, &RubberbandModel::verticesRemoved, this, &DistanceArea::onVerticesRemoved );
+    disconnect( mRubberbandModel, &RubberbandModel::crsChanged, this, &DistanceArea::rebuild );
     disconnect( mRubberbandModel, &RubberbandModel::vertexCountChanged, this, &DistanceArea::areaValidChanged );
     disconnect( mRubberbandModel, &RubberbandModel::vertexCountChanged, this, &DistanceArea::lengthValidChanged );
   }
@@ -88,13 +124,16 @@ void DistanceArea::setRubberbandModel( RubberbandModel *rubberbandModel )
 
   if ( mRubberbandModel )
   {
-    connect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::lengthChanged );
-    connect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::areaChanged );
-    connect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::segmentLengthChanged );
+    connect( mRubberbandModel, &RubberbandModel::vertexChanged, this, &DistanceArea::onVertexChanged );
+    connect( mRubberbandModel, &RubberbandModel::verticesInserted, this, &DistanceArea::onVerticesInserted );
+    connect( mRubberbandModel, &RubberbandModel::verticesRemoved, this, &DistanceArea::onVerticesRemoved );
+    connect( mRubberbandModel, &RubberbandModel::crsChanged, this, &DistanceArea::rebuild );
     connect( mRubberbandModel, &RubberbandModel::vertexCountChanged, this, &DistanceArea::areaValidChanged );
     connect( mRubberbandModel, &RubberbandModel::vertexCountChanged, this, &DistanceArea::lengthValidChanged );
   }
 
+  rebuild();
+
   emit rubberbandModelChanged();
 }
 
@@ -135,8 +174,8 @@ void DistanceArea::setGeometry( Geometry *geometry )
 
 qreal DistanceArea::length() const
 {
-  if ( mRubberbandModel )
-    return mDistanceArea.measureLine( mRubberbandModel->flatPointSequence( mCrs ) );
+  if ( mRubberbandModel && mInvalidVertexCount == 0 )
+    return mLength;
 
   return qQNaN();
 }
@@ -154,7 +193,7 @@ bool DistanceArea::lengthValid() const
     case QgsWkbTypes::LineGeometry:
       FALLTHROUGH
     case QgsWkbTypes::PolygonGeometry:
-      return mRubberbandModel->vertexCount() >= 2;
+      return mRubberbandModel->vertexCount() >= 2 && mInvalidVertexCount == 0;
 
     default:
       return false;
@@ -163,10 +202,29 @@ bool DistanceArea::lengthValid() const
 
 qreal DistanceArea::area() const
 {
-  if ( mRubberbandModel )
-    return mDistanceArea.measurePolygon( mRubberbandModel->flatPointSequence( mCrs ) );
+  if ( !mRubberbandModel || mInvalidVertexCount > 0 )
+    return qQNaN();
 
-  return qQNaN();
+  if ( mVertices.count() < 3 )
+    return 0.0;
+
+  // the closing segment is the only one not cached
+  double area = mAreaTermsSum + areaTerm( mVertices.last().areaPoint, mVertices.first().areaPoint );
+
+  if ( !mUseEllipsoid )
+    return std::fabs( area / 2.0 );
+
+  // see QgsDistanceArea::computePolygonArea()
+  if ( ( area *= mAE ) < 0.0 )
+    area = -area;
+
+  // if the polygon circles the south pole its area is computed as if it circled the north pole
+  if ( area > mE )
+    area = mE;
+  if ( area > mE / 2 )
+    area = mE - area;
+
+  return area;
 }
 
 bool DistanceArea::areaValid() const
@@ -183,7 +241,7 @@ bool DistanceArea::areaValid() const
       return false;
 
     case QgsWkbTypes::PolygonGeometry:
-      return mRubberbandModel->vertexCount() >= 3;
+      return mRubberbandModel->vertexCount() >= 3 && mInvalidVertexCount == 0;
 
     default:
       return false;
@@ -195,20 +253,13 @@ qreal DistanceArea::segmentLength() const
   if ( !mRubberbandModel )
     return qQNaN();
 
-  if ( mRubberbandModel->vertexCount() < 2 )
+  if ( mSegmentLengths.isEmpty() )
     return qQNaN();
 
-  QVector<QgsPointXY> points = mRubberbandModel->flatPointSequence( mCrs );
-
-  auto pointIt = points.constEnd() - 1;
-
-  QVector<QgsPointXY> flatPoints;
-
-  flatPoints << *pointIt;
-  pointIt--;
-  flatPoints << *pointIt;
+  if ( !mVertices.at( mVertices.count() - 2 ).valid || !mVertices.last().valid )
+    return qQNaN();
 
-  return mDistanceArea.measureLine( flatPoints );
+  return mSegmentLengths.last();
 }
 
 QgsUnitTypes::DistanceUnit DistanceArea::lengthUnits() const
@@ -220,3 +271,243 @@ QgsUnitTypes::AreaUnit DistanceArea::areaUnits() const
 {
   return mDistanceArea.areaUnits();
 }
+
+void DistanceArea::rebuild()
+{
+  mVertices.clear();
+  mSegmentLengths.clear();
+  mAreaTerms.clear();
+  mLength = 0.0;
+  mAreaTermsSum = 0.0;
+  mInvalidVertexCount = 0;
+
+  if ( mRubberbandModel )
+  {
+    mTransform = CoordinateTransformCache::instance()->transform( mRubberbandModel->crs(), mCrs );
+
+    // all the vertices are transformed at once
+    QVector<double> x = mRubberbandModel->xValues();
+    QVector<double> y = mRubberbandModel->yValues();
+    QVector<double> areaX;
+    QVector<double> areaY;
+    bool transformed = GeometryUtils::transformCoordinates( mTransform, x, y );
+    if ( transformed )
+    {
+      areaX = x;
+      areaY = y;
+      if ( mUseEllipsoid )
+        transformed = GeometryUtils::transformCoordinates( mEllipsoidTransform, areaX, areaY );
+    }
+
+    const int vertexCount = mRubberbandModel->vertexCount();
+    mVertices.reserve( vertexCount );
+    for ( int i = 0; i < vertexCount; ++i )
+    {
+      if ( !transformed )
+      {
+        // the vertices are transformed one by one to find out which ones cannot be transformed
+        mVertices << vertex( i );
+        if ( !mVertices.last().valid )
+          mInvalidVertexCount++;
+        continue;
+      }
+
+      Vertex vertex;
+      vertex.point = QgsPointXY( x.at( i ), y.at( i ) );
+      vertex.areaPoint = mUseEllipsoid ? QgsPointXY( areaX.at( i ) * M_PI / 180.0, areaY.at( i ) * M_PI / 180.0 ) : vertex.point;
+      vertex.valid = true;
+      mVertices << vertex;
+    }
+
+    const int segmentCount = std::max( 0, vertexCount - 1 );
+    mSegmentLengths.fill( 0.0, segmentCount );
+    mAreaTerms.fill( 0.0, segmentCount );
+    for ( int i = 0; i < segmentCount; ++i )
+      updateSegment( i );
+  }
+
+  emitChanged();
+}
+
+void DistanceArea::onVertexChanged( int index )
+{
+  if ( mVertices.count() != mRubberbandModel->vertexCount() || index < 0 || index >= mVertices.count() )
+  {
+    rebuild();
+    return;
+  }
+
+  const Vertex changedVertex = vertex( index );
+  mInvalidVertexCount += ( changedVertex.valid ? 0 : 1 ) - ( mVertices.at( index ).valid ? 0 : 1 );
+  mVertices[index] = changedVertex;
+
+  // only the segments ending and starting at the vertex change
+  if ( index > 0 )
+    updateSegment( index - 1 );
+  if ( index < mSegmentLengths.count() )
+    updateSegment( index );
+
+  emitChanged();
+}
+
+void DistanceArea::onVerticesInserted( int index, int count )
+{
+  // e.g. a geometry set on the model, which does not notify about the removed vertices
+  if ( mVertices.isEmpty() || mVertices.count() + count != mRubberbandModel->vertexCount() )
+  {
+    rebuild();
+    return;
+  }
+
+  for ( int i = 0; i < count; ++i )
+  {
+    mVertices.insert( index + i, vertex( index + i ) );
+    if ( !mVertices.at( index + i ).valid )
+      mInvalidVertexCount++;
+  }
+
+  // the segment leading to the inserted vertices is measured again, new ones are added after it
+  const int segmentIndex = std::min( index, mSegmentLengths.count() );
+  mSegmentLengths.insert( segmentIndex, count, 0.0 );
+  mAreaTerms.insert( segmentIndex, count, 0.0 );
+
+  const int lastSegment = std::min( index + count - 1, mSegmentLengths.count() - 1 );
+  for ( int i = std::max( 0, index - 1 ); i <= lastSegment; ++i )
+    updateSegment( i );
+
+  emitChanged();
+}
+
+void DistanceArea::onVerticesRemoved( int index, int count )
+{
+  if ( mVertices.count() - count != mRubberbandModel->vertexCount() || mRubberbandModel->vertexCount() < 2 )
+  {
+    rebuild();
+    return;
+  }
+
+  // the segments connected to the removed vertices no longer count
+  const int firstSegment = std::max( 0, index - 1 );
+  const int lastSegment = std::min( index + count - 1, mSegmentLengths.count() - 1 );
+  for ( int i = firstSegment; i <= lastSegment; ++i )
+  {
+    mLength -= mSegmentLengths.at( i );
+    mAreaTermsSum -= mAreaTerms.at( i );
+    mSegmentLengths[i] = 0.0;
+    mAreaTerms[i] = 0.0;
+  }
+
+  for ( int i = index; i < index + count; ++i )
+  {
+    if ( !mVertices.at( i ).valid )
+      mInvalidVertexCount--;
+  }
+
+  mVertices.remove( index, count );
+  mSegmentLengths.remove( firstSegment, count );
+  mAreaTerms.remove( firstSegment, count );
+
+  // the vertices before and after the removed ones are connected by a new segment
+  if ( index > 0 && index - 1 < mSegmentLengths.count() )
+    updateSegment( index - 1 );
+
+  emitChanged();
+}
+
+DistanceArea::Vertex DistanceArea::vertex( int index ) const
+{
+  Vertex vertex;
+  try
+  {
+    vertex.point = mTransform.transform( mRubberbandModel->xValues().at( index ), mRubberbandModel->yValues().at( index ) );
+    if ( mUseEllipsoid )
+    {
+      const QgsPointXY ellipsoidPoint = mEllipsoidTransform.transform( vertex.point );
+      vertex.areaPoint = QgsPointXY( ellipsoidPoint.x() * M_PI / 180.0, ellipsoidPoint.y() * M_PI / 180.0 );
+    }
+    else
+    {
+      vertex.areaPoint = vertex.point;
+    }
+    vertex.valid = true;
+  }
+  catch ( const QgsCsException &exp )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Transformation error occurred: %1" ).arg( exp.what() ), QStringLiteral( "QField" ) );
+  }
+
+  return vertex;
+}
+
+void DistanceArea::updateSegment( int index )
+{
+  const Vertex &from = mVertices.at( index );
+  const Vertex &to = mVertices.at( index + 1 );
+
+  // a segment with a vertex which could not be transformed is not measured, the totals are not valid anyway
+  const bool valid = from.valid && to.valid;
+  const double length = valid ? mDistanceArea.measureLine( from.point, to.point ) : 0.0;
+  const double term = valid ? areaTerm( from.areaPoint, to.areaPoint ) : 0.0;
+
+  mLength += length - mSegmentLengths.at( index );
+  mAreaTermsSum += term - mAreaTerms.at( index );
+  mSegmentLengths[index] = length;
+  mAreaTerms[index] = term;
+}
+
+double DistanceArea::areaTerm( const QgsPointXY &from, const QgsPointXY &to ) const
+{
+  if ( !mUseEllipsoid )
+    return from.x() * to.y() - from.y() * to.x();
+
+  // the contribution of one segment in QgsDistanceArea::computePolygonArea()
+  double x1 = from.x();
+  double x2 = to.x();
+  const double y1 = from.y();
+  const double y2 = to.y();
+
+  if ( x1 > x2 )
+  {
+    while ( x1 - x2 > M_PI )
+      x2 += 2 * M_PI;
+  }
+  else if ( x2 > x1 )
+  {
+    while ( x2 - x1 > M_PI )
+      x1 += 2 * M_PI;
+  }
+
+  const double dx = x2 - x1;
+  const double dy = y2 - y1;
+
+  // threshold for dy, see https://trac.osgeo.org/grass/ticket/3369
+  if ( std::fabs( dy ) > 1e-6 )
+    return dx * ( mQp - ( getQbar( y2 ) - getQbar( y1 ) ) / dy );
+  else
+    return dx * ( mQp - getQ( ( y1 + y2 ) / 2.0 ) );
+}
+
+double DistanceArea::getQ( double x ) const
+{
+  const double sinx = std::sin( x );
+  const double sinx2 = sinx * sinx;
+
+  return sinx * ( 1 + sinx2 * ( mQA + sinx2 * ( mQB + sinx2 * mQC ) ) );
+}
+
+double DistanceArea::getQbar( double x ) const
+{
+  const double cosx = std::cos( x );
+  const double cosx2 = cosx * cosx;
+
+  return cosx * ( mQbarA + cosx2 * ( mQbarB + cosx2 * ( mQbarC + cosx2 * mQbarD ) ) );
+}
+
+void DistanceArea::emitChanged()
+{
+  emit lengthChanged();
+  emit lengthValidChanged();
+  emit areaChanged();
+  emit areaValidChanged();
+  emit segmentLengthChanged();
+}
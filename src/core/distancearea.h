@@ -17,13 +17,25 @@
 #define DISTANCEAREA_H
 
 #include <QObject>
+#include <QVector>
 
+#include <qgscoordinatetransform.h>
 #include <qgsdistancearea.h>
 
 class Geometry;
 class RubberbandModel;
 class QgsProject;
 
+/**
+ * Measures the length and the area of the vertices of a rubberband model.
+ *
+ * The ellipsoidal length of every segment and its contribution to the area are cached and
+ * only the segments adjacent to a changed vertex are measured again, so moving the current
+ * coordinate does not reproject and measure the whole geometry.
+ *
+ * If a vertex cannot be transformed, the length and the area are not valid until it is moved
+ * or removed.
+ */
 class DistanceArea : public QObject
 {
     Q_OBJECT
@@ -81,12 +93,60 @@ class DistanceArea : public QObject
   private slots:
     void init();
 
+    //! Measures all the segments of the rubberband model again
+    void rebuild();
+    void onVertexChanged( int index );
+    void onVerticesInserted( int index, int count );
+    void onVerticesRemoved( int index, int count );
+
   private:
+    //! A vertex in the crs the lengths are measured in and in the crs the area is computed in
+    struct Vertex
+    {
+      QgsPointXY point;
+      QgsPointXY areaPoint;
+      //! if the vertex could be transformed
+      bool valid = false;
+    };
+
+    //! Returns the rubberband vertex at \a index prepared for measurement, not valid if it cannot be transformed
+    Vertex vertex( int index ) const;
+    //! Returns the contribution of the segment from \a from to \a to to the area
+    double areaTerm( const QgsPointXY &from, const QgsPointXY &to ) const;
+    double getQ( double x ) const;
+    double getQbar( double x ) const;
+    //! Measures the segment starting at vertex \a index again and updates the totals
+    void updateSegment( int index );
+    void emitChanged();
+
     RubberbandModel *mRubberbandModel = nullptr;
     QgsCoordinateReferenceSystem mCrs;
     QgsProject *mProject = nullptr;
 
     QgsDistanceArea mDistanceArea;
+
+    //! transforms the rubberband vertices into the crs
+    QgsCoordinateTransform mTransform;
+    //! transforms the vertices in the crs into the geographic crs of the ellipsoid
+    QgsCoordinateTransform mEllipsoidTransform;
+    bool mUseEllipsoid = false;
+
+    //! constants of the ellipsoidal area computation, see QgsDistanceArea::computePolygonArea
+    double mAE = 0.0;
+    double mE = 0.0;
+    double mQp = 0.0;
+    double mQA = 0.0, mQB = 0.0, mQC = 0.0;
+    double mQbarA = 0.0, mQbarB = 0.0, mQbarC = 0.0, mQbarD = 0.0;
+
+    QVector<Vertex> mVertices;
+    //! the length of the segment from vertex i to i + 1
+    QVector<double> mSegmentLengths;
+    //! the area contribution of the segment from vertex i to i + 1
+    QVector<double> mAreaTerms;
+    double mLength = 0.0;
+    double mAreaTermsSum = 0.0;
+    //! the number of vertices which could not be transformed
+    int mInvalidVertexCount = 0;
 };
 
 #endif // DISTANCEAREA_H
@@ -0,0 +1,741 @@
+/***************************************************************************
+  earcuttriangulator.cpp - EarcutTriangulator
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "earcuttriangulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <vector>
+
+//! the number of points above which the ears are checked along a z-order curve
+static const int Z_ORDER_THRESHOLD = 80;
+
+namespace
+{
+  //! A point of one of the circular doubly linked rings
+  struct Node
+  {
+    Node( int index, double x, double y )
+      : i( index )
+      , x( x )
+      , y( y )
+    {}
+
+    //! the index of the point in the input
+    int i;
+    double x;
+    double y;
+
+    Node *prev = nullptr;
+    Node *next = nullptr;
+
+    //! the z-order curve value and the neighbours sorted by it
+    qint32 z = 0;
+    Node *prevZ = nullptr;
+    Node *nextZ = nullptr;
+
+    //! an isolated point of a degenerate hole
+    bool steiner = false;
+  };
+
+  class Earcut
+  {
+    public:
+      Earcut( const QVector<double> &coordinates, QVector<int> &triangles )
+        : mCoordinates( coordinates )
+        , mTriangles( triangles )
+      {}
+
+      void run( const QVector<int> &holeStarts )
+      {
+        const int pointCount = mCoordinates.size() / 2;
+        const int outerEnd = holeStarts.isEmpty() ? pointCount : holeStarts.first();
+
+        Node *outerNode = linkedList( 0, outerEnd, true );
+        if ( !outerNode || outerNode->next == outerNode->prev )
+          return;
+
+        if ( !holeStarts.isEmpty() )
+          outerNode = eliminateHoles( holeStarts, outerNode );
+
+        if ( pointCount > Z_ORDER_THRESHOLD )
+        {
+          mMinX = mMaxX = mCoordinates.at( 0 );
+          mMinY = mMaxY = mCoordinates.at( 1 );
+          for ( int i = 1; i < outerEnd; ++i )
+          {
+            const double x = mCoordinates.at( i * 2 );
+            const double y = mCoordinates.at( i * 2 + 1 );
+            mMinX = std::min( mMinX, x );
+            mMinY = std::min( mMinY, y );
+            mMaxX = std::max( mMaxX, x );
+            mMaxY = std::max( mMaxY, y );
+          }
+
+          // the z-order curve is computed on 15 bits integer coordinates
+          const double size = std::max( mMaxX - mMinX, mMaxY - mMinY );
+          mInvSize = size != 0.0 ? 32767.0 / size : 0.0;
+        }
+
+        earcutLinked( outerNode, 0 );
+      }
+
+    private:
+      Node *insertNode( int i, Node *last )
+      {
+        mNodes.emplace_back( i, mCoordinates.at( i * 2 ), mCoordinates.at( i * 2 + 1 ) );
+        Node *p = &mNodes.back();
+
+        if ( !last )
+        {
+          p->prev = p;
+          p->next = p;
+        }
+        else
+        {
+          p->next = last->next;
+          p->prev = last;
+          last->next->prev = p;
+          last->next = p;
+        }
+        return p;
+      }
+
+      static void removeNode( Node *p )
+      {
+        p->next->prev = p->prev;
+        p->prev->next = p->next;
+
+        if ( p->prevZ )
+          p->prevZ->nextZ = p->nextZ;
+        if ( p->nextZ )
+          p->nextZ->prevZ = p->prevZ;
+      }
+
+      double signedArea( int start, int end ) const
+      {
+        double sum = 0;
+        for ( int i = start, j = end - 1; i < end; j = i++ )
+        {
+          sum += ( mCoordinates.at( j * 2 ) - mCoordinates.at( i * 2 ) ) * ( mCoordinates.at( i * 2 + 1 ) + mCoordinates.at( j * 2 + 1 ) );
+        }
+        return sum;
+      }
+
+      //! Creates a ring from the points \a start to \a end with the given winding order
+      Node *linkedList( int start, int end, bool clockwise )
+      {
+        Node *last = nullptr;
+
+        if ( clockwise == ( signedArea( start, end ) > 0 ) )
+        {
+          for ( int i = start; i < end; ++i )
+            last = insertNode( i, last );
+        }
+        else
+        {
+          for ( int i = end - 1; i >= start; --i )
+            last = insertNode( i, last );
+        }
+
+        // closed ring
+        if ( last && equals( last, last->next ) )
+        {
+          removeNode( last );
+          last = last->next;
+        }
+
+        return last;
+      }
+
+      //! Removes duplicate and collinear points
+      static Node *filterPoints( Node *start, Node *end = nullptr )
+      {
+        if ( !start )
+          return start;
+        if ( !end )
+          end = start;
+
+        Node *p = start;
+        bool again;
+        do
+        {
+          again = false;
+
+          if ( !p->steiner && ( equals( p, p->next ) || area( p->prev, p, p->next ) == 0.0 ) )
+          {
+            removeNode( p );
+            p = end = p->prev;
+            if ( p == p->next )
+              break;
+            again = true;
+          }
+          else
+          {
+            p = p->next;
+          }
+        }
+        while ( again || p != end );
+
+        return end;
+      }
+
+      //! Clips the ears of the ring, with further attempts to cure a ring once no ear is left
+      void earcutLinked( Node *ear, int pass )
+      {
+        if ( !ear )
+          return;
+
+        if ( !pass && mInvSize != 0.0 )
+          indexCurve( ear );
+
+        Node *stop = ear;
+        while ( ear->prev != ear->next )
+        {
+          Node *prev = ear->prev;
+          Node *next = ear->next;
+
+          if ( mInvSize != 0.0 ? isEarHashed( ear ) : isEar( ear ) )
+          {
+            mTriangles << prev->i << ear->i << next->i;
+
+            removeNode( ear );
+
+            // skipping the next vertex leads to less sliver triangles
+            ear = next->next;
+            stop = next->next;
+            continue;
+          }
+
+          ear = next;
+
+          if ( ear == stop )
+          {
+            if ( pass == 0 )
+            {
+              earcutLinked( filterPoints( ear ), 1 );
+            }
+            else if ( pass == 1 )
+            {
+              ear = cureLocalIntersections( filterPoints( ear ) );
+              earcutLinked( ear, 2 );
+            }
+            else if ( pass == 2 )
+            {
+              splitEarcut( ear );
+            }
+            break;
+          }
+        }
+      }
+
+      static bool isEar( Node *ear )
+      {
+        const Node *a = ear->prev;
+        const Node *b = ear;
+        const Node *c = ear->next;
+
+        // reflex
+        if ( area( a, b, c ) >= 0 )
+          return false;
+
+        for ( const Node *p = ear->next->next; p != ear->prev; p = p->next )
+        {
+          if ( pointInTriangle( a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y ) && area( p->prev, p, p->next ) >= 0 )
+            return false;
+        }
+
+        return true;
+      }
+
+      bool isEarHashed( Node *ear ) const
+      {
+        const Node *a = ear->prev;
+        const Node *b = ear;
+        const Node *c = ear->next;
+
+        if ( area( a, b, c ) >= 0 )
+          return false;
+
+        const double minTX = std::min( { a->x, b->x, c->x } );
+        const double minTY = std::min( { a->y, b->y, c->y } );
+        const double maxTX = std::max( { a->x, b->x, c->x } );
+        const double maxTY = std::max( { a->y, b->y, c->y } );
+
+        // only the points within the bounding box of the triangle are candidates
+        const qint32 minZ = zOrder( minTX, minTY );
+        const qint32 maxZ = zOrder( maxTX, maxTY );
+
+        auto inside = [ = ]( const Node * p ) {
+          return p != ear->prev && p != ear->next
+                 && pointInTriangle( a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y )
+                 && area( p->prev, p, p->next ) >= 0;
+        };
+
+        const Node *p = ear->prevZ;
+        const Node *n = ear->nextZ;
+
+        while ( p && p->z >= minZ && n && n->z <= maxZ )
+        {
+          if ( inside( p ) )
+            return false;
+          p = p->prevZ;
+
+          if ( inside( n ) )
+            return false;
+          n = n->nextZ;
+        }
+
+        while ( p && p->z >= minZ )
+        {
+          if ( inside( p ) )
+            return false;
+          p = p->prevZ;
+        }
+
+        while ( n && n->z <= maxZ )
+        {
+          if ( inside( n ) )
+            return false;
+          n = n->nextZ;
+        }
+
+        return true;
+      }
+
+      //! Clips the triangles of the local self-intersections
+      Node *cureLocalIntersections( Node *start )
+      {
+        Node *p = start;
+        do
+        {
+          Node *a = p->prev;
+          Node *b = p->next->next;
+
+          if ( !equals( a, b ) && intersects( a, p, p->next, b ) && locallyInside( a, b ) && locallyInside( b, a ) )
+          {
+            mTriangles << a->i << p->i << b->i;
+
+            removeNode( p );
+            removeNode( p->next );
+
+            p = start = b;
+          }
+          p = p->next;
+        }
+        while ( p != start );
+
+        return filterPoints( p );
+      }
+
+      //! Splits the ring along a valid diagonal and triangulates both halves
+      void splitEarcut( Node *start )
+      {
+        Node *a = start;
+        do
+        {
+          Node *b = a->next->next;
+          while ( b != a->prev )
+          {
+            if ( a->i != b->i && isValidDiagonal( a, b ) )
+            {
+              Node *c = splitPolygon( a, b );
+
+              a = filterPoints( a, a->next );
+              c = filterPoints( c, c->next );
+
+              earcutLinked( a, 0 );
+              earcutLinked( c, 0 );
+              return;
+            }
+            b = b->next;
+          }
+          a = a->next;
+        }
+        while ( a != start );
+      }
+
+      //! Links every hole into the exterior ring
+      Node *eliminateHoles( const QVector<int> &holeStarts, Node *outerNode )
+      {
+        const int pointCount = mCoordinates.size() / 2;
+
+        std::vector<Node *> queue;
+        queue.reserve( holeStarts.size() );
+        for ( int i = 0; i < holeStarts.size(); ++i )
+        {
+          const int start = holeStarts.at( i );
+          const int end = i < holeStarts.size() - 1 ? holeStarts.at( i + 1 ) : pointCount;
+          Node *list = linkedList( start, end, false );
+          if ( !list )
+            continue;
+          if ( list == list->next )
+            list->steiner = true;
+          queue.push_back( leftmost( list ) );
+        }
+
+        std::sort( queue.begin(), queue.end(), []( const Node * a, const Node * b ) { return a->x < b->x; } );
+
+        // from left to right
+        for ( Node *hole : queue )
+          outerNode = eliminateHole( hole, outerNode );
+
+        return outerNode;
+      }
+
+      Node *eliminateHole( Node *hole, Node *outerNode )
+      {
+        Node *bridge = findHoleBridge( hole, outerNode );
+        if ( !bridge )
+          return outerNode;
+
+        Node *bridgeReverse = splitPolygon( bridge, hole );
+
+        // filter the collinear points around the cuts
+        filterPoints( bridgeReverse, bridgeReverse->next );
+        return filterPoints( bridge, bridge->next );
+      }
+
+      //! Finds a point of the exterior ring which can be connected to the leftmost point of the hole
+      static Node *findHoleBridge( Node *hole, Node *outerNode )
+      {
+        Node *p = outerNode;
+        const double hx = hole->x;
+        const double hy = hole->y;
+        double qx = -std::numeric_limits<double>::infinity();
+        Node *m = nullptr;
+
+        // the segment intersected by a ray from the hole to the left, as close as possible
+        do
+        {
+          if ( hy <= p->y && hy >= p->next->y && p->next->y != p->y )
+          {
+            const double x = p->x + ( hy - p->y ) * ( p->next->x - p->x ) / ( p->next->y - p->y );
+            if ( x <= hx && x > qx )
+            {
+              qx = x;
+              m = p->x < p->next->x ? p : p->next;
+              // the hole touches the segment
+              if ( x == hx )
+                return m;
+            }
+          }
+          p = p->next;
+        }
+        while ( p != outerNode );
+
+        if ( !m )
+          return nullptr;
+
+        // look for the points inside the triangle of the hole point, the segment intersection and the
+        // segment endpoint, the one with the minimum angle to the ray is the connection point
+        const Node *stop = m;
+        const double mx = m->x;
+        const double my = m->y;
+        double tanMin = std::numeric_limits<double>::infinity();
+
+        p = m;
+        do
+        {
+          if ( hx >= p->x && p->x >= mx && hx != p->x &&
+               pointInTriangle( hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y ) )
+          {
+            const double tan = std::fabs( hy - p->y ) / ( hx - p->x );
+
+            if ( locallyInside( p, hole ) &&
+                 ( tan < tanMin || ( tan == tanMin && ( p->x > m->x || ( p->x == m->x && sectorContainsSector( m, p ) ) ) ) ) )
+            {
+              m = p;
+              tanMin = tan;
+            }
+          }
+
+          p = p->next;
+        }
+        while ( p != stop );
+
+        return m;
+      }
+
+      static bool sectorContainsSector( const Node *m, const Node *p )
+      {
+        return area( m->prev, m, p->prev ) < 0 && area( p->next, m, m->next ) < 0;
+      }
+
+      //! Sorts the points of the ring along the z-order curve
+      void indexCurve( Node *start ) const
+      {
+        Node *p = start;
+        do
+        {
+          p->z = zOrder( p->x, p->y );
+          p->prevZ = p->prev;
+          p->nextZ = p->next;
+          p = p->next;
+        }
+        while ( p != start );
+
+        p->prevZ->nextZ = nullptr;
+        p->prevZ = nullptr;
+
+        sortLinked( p );
+      }
+
+      //! Merge sort of the z-order list, see https://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.html
+      static Node *sortLinked( Node *list )
+      {
+        int inSize = 1;
+        int numMerges;
+
+        do
+        {
+          Node *p = list;
+          list = nullptr;
+          Node *tail = nullptr;
+          numMerges = 0;
+
+          while ( p )
+          {
+            numMerges++;
+            Node *q = p;
+            int pSize = 0;
+            for ( int i = 0; i < inSize; i++ )
+            {
+              pSize++;
+              q = q->nextZ;
+              if ( !q )
+                break;
+            }
+
+            int qSize = inSize;
+
+            while ( pSize > 0 || ( qSize > 0 && q ) )
+            {
+              Node *e;
+              if ( pSize != 0 && ( qSize == 0 || !q || p->z <= q->z ) )
+              {
+                e = p;
+                p = p->nextZ;
+                pSize--;
+              }
+              else
+              {
+                e = q;
+                q = q->nextZ;
+                qSize--;
+              }
+
+              if ( tail )
+                tail->nextZ = e;
+              else
+                list = e;
+
+              e->prevZ = tail;
+              tail = e;
+            }
+
+            p = q;
+          }
+
+          tail->nextZ = nullptr;
+          inSize *= 2;
+        }
+        while ( numMerges > 1 );
+
+        return list;
+      }
+
+      //! Returns the z-order curve value of a point, from its coordinates relative to the bounding box
+      qint32 zOrder( double x, double y ) const
+      {
+        qint32 ix = static_cast<qint32>( ( x - mMinX ) * mInvSize );
+        qint32 iy = static_cast<qint32>( ( y - mMinY ) * mInvSize );
+
+        ix = ( ix | ( ix << 8 ) ) & 0x00FF00FF;
+        ix = ( ix | ( ix << 4 ) ) & 0x0F0F0F0F;
+        ix = ( ix | ( ix << 2 ) ) & 0x33333333;
+        ix = ( ix | ( ix << 1 ) ) & 0x55555555;
+
+        iy = ( iy | ( iy << 8 ) ) & 0x00FF00FF;
+        iy = ( iy | ( iy << 4 ) ) & 0x0F0F0F0F;
+        iy = ( iy | ( iy << 2 ) ) & 0x33333333;
+        iy = ( iy | ( iy << 1 ) ) & 0x55555555;
+
+        return ix | ( iy << 1 );
+      }
+
+      static Node *leftmost( Node *start )
+      {
+        Node *p = start;
+        Node *leftmost = start;
+        do
+        {
+          if ( p->x < leftmost->x || ( p->x == leftmost->x && p->y < leftmost->y ) )
+            leftmost = p;
+          p = p->next;
+        }
+        while ( p != start );
+
+        return leftmost;
+      }
+
+      static bool pointInTriangle( double ax, double ay, double bx, double by, double cx, double cy, double px, double py )
+      {
+        return ( cx - px ) * ( ay - py ) - ( ax - px ) * ( cy - py ) >= 0 &&
+               ( ax - px ) * ( by - py ) - ( bx - px ) * ( ay - py ) >= 0 &&
+               ( bx - px ) * ( cy - py ) - ( cx - px ) * ( by - py ) >= 0;
+      }
+
+      //! Returns if a diagonal between \a a and \a b can be used to split the ring
+      static bool isValidDiagonal( const Node *a, const Node *b )
+      {
+        return a->next->i != b->i && a->prev->i != b->i && !intersectsPolygon( a, b ) &&
+               ( ( locallyInside( a, b ) && locallyInside( b, a ) && middleInside( a, b ) &&
+                   ( area( a->prev, a, b->prev ) != 0.0 || area( a, b->prev, b ) != 0.0 ) ) ||
+                 ( equals( a, b ) && area( a->prev, a, a->next ) > 0 && area( b->prev, b, b->next ) > 0 ) );
+      }
+
+      //! Returns the signed area of the triangle \a p, \a q, \a r
+      static double area( const Node *p, const Node *q, const Node *r )
+      {
+        return ( q->y - p->y ) * ( r->x - q->x ) - ( q->x - p->x ) * ( r->y - q->y );
+      }
+
+      static bool equals( const Node *p1, const Node *p2 )
+      {
+        return p1->x == p2->x && p1->y == p2->y;
+      }
+
+      static int sign( double value )
+      {
+        return ( value > 0 ) - ( value < 0 );
+      }
+
+      //! Returns if \a q lies on the segment \a p, \a r, given the three points are collinear
+      static bool onSegment( const Node *p, const Node *q, const Node *r )
+      {
+        return q->x <= std::max( p->x, r->x ) && q->x >= std::min( p->x, r->x ) &&
+               q->y <= std::max( p->y, r->y ) && q->y >= std::min( p->y, r->y );
+      }
+
+      static bool intersects( const Node *p1, const Node *q1, const Node *p2, const Node *q2 )
+      {
+        const int o1 = sign( area( p1, q1, p2 ) );
+        const int o2 = sign( area( p1, q1, q2 ) );
+        const int o3 = sign( area( p2, q2, p1 ) );
+        const int o4 = sign( area( p2, q2, q1 ) );
+
+        if ( o1 != o2 && o3 != o4 )
+          return true;
+
+        return ( o1 == 0 && onSegment( p1, p2, q1 ) )
+               || ( o2 == 0 && onSegment( p1, q2, q1 ) )
+               || ( o3 == 0 && onSegment( p2, p1, q2 ) )
+               || ( o4 == 0 && onSegment( p2, q1, q2 ) );
+      }
+
+      static bool intersectsPolygon( const Node *a, const Node *b )
+      {
+        const Node *p = a;
+        do
+        {
+          if ( p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i && intersects( p, p->next, a, b ) )
+            return true;
+          p = p->next;
+        }
+        while ( p != a );
+
+        return false;
+      }
+
+      static bool locallyInside( const Node *a, const Node *b )
+      {
+        return area( a->prev, a, a->next ) < 0
+               ? area( a, b, a->next ) >= 0 && area( a, a->prev, b ) >= 0
+               : area( a, b, a->prev ) < 0 || area( a, a->next, b ) < 0;
+      }
+
+      //! Returns if the middle of the diagonal \a a, \a b is inside the ring
+      static bool middleInside( const Node *a, const Node *b )
+      {
+        const Node *p = a;
+        bool inside = false;
+        const double px = ( a->x + b->x ) / 2;
+        const double py = ( a->y + b->y ) / 2;
+        do
+        {
+          if ( ( ( p->y > py ) != ( p->next->y > py ) ) && p->next->y != p->y &&
+               ( px < ( p->next->x - p->x ) * ( py - p->y ) / ( p->next->y - p->y ) + p->x ) )
+            inside = !inside;
+          p = p->next;
+        }
+        while ( p != a );
+
+        return inside;
+      }
+
+      //! Splits the ring along the diagonal \a a, \a b, returns a point of the second ring
+      Node *splitPolygon( Node *a, Node *b )
+      {
+        mNodes.emplace_back( a->i, a->x, a->y );
+        Node *a2 = &mNodes.back();
+        mNodes.emplace_back( b->i, b->x, b->y );
+        Node *b2 = &mNodes.back();
+        Node *an = a->next;
+        Node *bp = b->prev;
+
+        a->next = b;
+        b->prev = a;
+
+        a2->next = an;
+        an->prev = a2;
+
+        b2->next = a2;
+        a2->prev = b2;
+
+        bp->next = b2;
+        b2->prev = bp;
+
+        return b2;
+      }
+
+      const QVector<double> &mCoordinates;
+      QVector<int> &mTriangles;
+      //! the nodes, a deque keeps their addresses stable
+      std::deque<Node> mNodes;
+
+      double mMinX = 0;
+      double mMinY = 0;
+      double mMaxX = 0;
+      double mMaxY = 0;
+      double mInvSize = 0;
+  };
+}
+
+QVector<int> EarcutTriangulator::triangulate( const QVector<double> &coordinates, const QVector<int> &holeStarts )
+{
+  QVector<int> triangles;
+  if ( coordinates.size() < 6 )
+    return triangles;
+
+  triangles.reserve( ( coordinates.size() / 2 + 2 * holeStarts.size() ) * 3 );
+
+  Earcut earcut( coordinates, triangles );
+  earcut.run( holeStarts );
+
+  return triangles;
+}
@@ -0,0 +1,45 @@
+/***************************************************************************
+  earcuttriangulator.h - EarcutTriangulator
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef EARCUTTRIANGULATOR_H
+#define EARCUTTRIANGULATOR_H
+
+#include <QVector>
+
+/**
+ * An ear clipping triangulator for simple polygons with holes, following the earcut
+ * algorithm of mapbox (https://github.com/mapbox/earcut, ISC license).
+ *
+ * The holes are bridged into the exterior ring before the ears are clipped. For large
+ * rings the candidate points of an ear are looked up along a z-order curve. Unlike the
+ * general purpose tessellator, it neither handles self-intersecting rings exactly nor
+ * creates new vertices, which makes it considerably cheaper on the polygons of typical
+ * vector layers.
+ */
+class EarcutTriangulator
+{
+  public:
+
+    /**
+     * Triangulates the polygon with the interleaved x, y \a coordinates.
+     * The exterior ring starts at the first point and each hole at the point index in \a holeStarts.
+     * The rings may be closed or not.
+     *
+     * Returns the indices of the points of the triangles, three per triangle.
+     */
+    static QVector<int> triangulate( const QVector<double> &coordinates, const QVector<int> &holeStarts = QVector<int>() );
+};
+
+#endif // EARCUTTRIANGULATOR_H
@@ -0,0 +1,161 @@
+/***************************************************************************
+  featurecommitqueue.cpp - FeatureCommitQueue
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "featurecommitqueue.h"
+
+#include <qgsmessagelog.h>
+#include <qgsvectorlayer.h>
+
+#include <numeric>
+
+FeatureCommitQueue::FeatureCommitQueue( QObject *parent )
+  : QObject( parent )
+{
+  mTimer.setSingleShot( true );
+  connect( &mTimer, &QTimer::timeout, this, qOverload<>( &FeatureCommitQueue::flush ) );
+}
+
+FeatureCommitQueue::~FeatureCommitQueue()
+{
+  flush();
+}
+
+void FeatureCommitQueue::setEnabled( bool enabled )
+{
+  if ( mEnabled == enabled )
+    return;
+
+  mEnabled = enabled;
+
+  if ( !mEnabled )
+    flush();
+
+  emit enabledChanged();
+}
+
+void FeatureCommitQueue::setInterval( int interval )
+{
+  if ( mInterval == interval )
+    return;
+
+  mInterval = interval;
+  emit intervalChanged();
+}
+
+void FeatureCommitQueue::setMaximumPendingEdits( int maximumPendingEdits )
+{
+  if ( mMaximumPendingEdits == maximumPendingEdits )
+    return;
+
+  mMaximumPendingEdits = maximumPendingEdits;
+  emit maximumPendingEditsChanged();
+}
+
+int FeatureCommitQueue::pendingEdits() const
+{
+  return std::accumulate( mPendingEdits.constBegin(), mPendingEdits.constEnd(), 0 );
+}
+
+bool FeatureCommitQueue::enqueue( QgsVectorLayer *layer )
+{
+  if ( !layer )
+    return false;
+
+  if ( !mEnabled )
+    return commitLayer( layer );
+
+  if ( !mPendingEdits.contains( layer ) )
+  {
+    // edits might get committed or discarded from elsewhere (e.g. when deleting a feature)
+    connect( layer, &QgsVectorLayer::afterCommitChanges, this, &FeatureCommitQueue::onLayerEditsEnded, Qt::UniqueConnection );
+    connect( layer, &QgsVectorLayer::afterRollBack, this, &FeatureCommitQueue::onLayerEditsEnded, Qt::UniqueConnection );
+    connect( layer, &QgsVectorLayer::willBeDeleted, this, &FeatureCommitQueue::onLayerWillBeDeleted, Qt::UniqueConnection );
+  }
+
+  mPendingEdits[layer] += 1;
+  emit pendingEditsChanged();
+
+  if ( pendingEdits() >= mMaximumPendingEdits )
+    return flush();
+
+  if ( !mTimer.isActive() )
+    mTimer.start( mInterval );
+
+  return true;
+}
+
+bool FeatureCommitQueue::flush( QgsVectorLayer *layer )
+{
+  if ( !mPendingEdits.contains( layer ) )
+    return true;
+
+  return commitLayer( layer );
+}
+
+bool FeatureCommitQueue::flush()
+{
+  mTimer.stop();
+
+  bool isSuccess = true;
+  const QList<QgsVectorLayer *> layers = mPendingEdits.keys();
+  for ( QgsVectorLayer *layer : layers )
+  {
+    isSuccess &= commitLayer( layer );
+  }
+
+  return isSuccess;
+}
+
+bool FeatureCommitQueue::commitLayer( QgsVectorLayer *layer )
+{
+  if ( mPendingEdits.remove( layer ) )
+    emit pendingEditsChanged();
+
+  if ( mPendingEdits.isEmpty() )
+    mTimer.stop();
+
+  if ( !layer->isEditable() )
+    return true;
+
+  if ( !layer->commitChanges() )
+  {
+    const QString msgs = layer->commitErrors().join( QStringLiteral( "\n" ) );
+    QgsMessageLog::logMessage( tr( "Could not save changes in layer \"%1\". Rolling back. Reason:\n%2" ).arg( layer->name(), msgs ), QStringLiteral( "QField" ), Qgis::Critical );
+    layer->rollBack();
+    emit commitFailed( layer, msgs );
+    return false;
+  }
+
+  return true;
+}
+
+void FeatureCommitQueue::onLayerEditsEnded()
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  if ( mPendingEdits.remove( layer ) )
+  {
+    if ( mPendingEdits.isEmpty() )
+      mTimer.stop();
+
+    emit pendingEditsChanged();
+  }
+}
+
+void FeatureCommitQueue::onLayerWillBeDeleted()
+{
+  QgsVectorLayer *layer = qobject_cast<QgsVectorLayer *>( sender() );
+  flush( layer );
+}
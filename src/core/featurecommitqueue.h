@@ -0,0 +1,121 @@
+/***************************************************************************
+  featurecommitqueue.h - FeatureCommitQueue
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef FEATURECOMMITQUEUE_H
+#define FEATURECOMMITQUEUE_H
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+class QgsVectorLayer;
+
+/**
+ * The FeatureCommitQueue groups the commits of feature edits.
+ *
+ * Edits are written to the edit buffer of the layer right away, which makes them
+ * visible on the map and in the forms immediately. The edit buffer is only committed
+ * to the data provider once the configured \a interval has elapsed or once
+ * \a maximumPendingEdits edits have been queued, so that rapid captures (e.g. tracking)
+ * share a single transaction instead of paying one per feature.
+ *
+ * \note Commits happen on the thread owning the layers, QgsVectorLayer edit buffers
+ * are not thread safe. The expensive WAL checkpointing is done by QgsGpkgFlusher.
+ */
+class FeatureCommitQueue : public QObject
+{
+    Q_OBJECT
+
+    //! if disabled, every enqueued edit is committed right away
+    Q_PROPERTY( bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged )
+    //! the maximum time in milliseconds an edit stays uncommitted
+    Q_PROPERTY( int interval READ interval WRITE setInterval NOTIFY intervalChanged )
+    //! the number of pending edits which triggers a commit regardless of the interval
+    Q_PROPERTY( int maximumPendingEdits READ maximumPendingEdits WRITE setMaximumPendingEdits NOTIFY maximumPendingEditsChanged )
+    //! the number of edits waiting to be committed
+    Q_PROPERTY( int pendingEdits READ pendingEdits NOTIFY pendingEditsChanged )
+
+  public:
+    explicit FeatureCommitQueue( QObject *parent = nullptr );
+    ~FeatureCommitQueue() override;
+
+    //! \copydoc enabled
+    bool enabled() const { return mEnabled; }
+    //! \copydoc enabled
+    void setEnabled( bool enabled );
+
+    //! \copydoc interval
+    int interval() const { return mInterval; }
+    //! \copydoc interval
+    void setInterval( int interval );
+
+    //! \copydoc maximumPendingEdits
+    int maximumPendingEdits() const { return mMaximumPendingEdits; }
+    //! \copydoc maximumPendingEdits
+    void setMaximumPendingEdits( int maximumPendingEdits );
+
+    //! \copydoc pendingEdits
+    int pendingEdits() const;
+
+    /**
+     * Registers an edit which has been written to the edit buffer of \a layer.
+     * The layer will be committed with the next batch.
+     * \returns FALSE if the edit had to be committed right away and the commit failed
+     */
+    bool enqueue( QgsVectorLayer *layer );
+
+    /**
+     * Commits the pending edits of \a layer.
+     * Has to be called before rolling back an edit session on \a layer, which would
+     * otherwise discard the edits waiting in the queue.
+     * \returns TRUE if there was nothing to commit or the commit succeeded
+     */
+    Q_INVOKABLE bool flush( QgsVectorLayer *layer );
+
+  public slots:
+
+    /**
+     * Commits the pending edits of all layers.
+     * Called on a timer, when the application gets suspended and before a project is unloaded.
+     * \returns TRUE if all commits succeeded
+     */
+    bool flush();
+
+  signals:
+    void enabledChanged();
+    void intervalChanged();
+    void maximumPendingEditsChanged();
+    void pendingEditsChanged();
+
+    //! Emitted when the batched edits of \a layer could not be committed and have been rolled back
+    void commitFailed( QgsVectorLayer *layer, const QString &errors );
+
+  private slots:
+    void onLayerEditsEnded();
+    void onLayerWillBeDeleted();
+
+  private:
+    bool commitLayer( QgsVectorLayer *layer );
+
+    bool mEnabled = true;
+    int mInterval = 2000;
+    int mMaximumPendingEdits = 25;
+
+    QHash<QgsVectorLayer *, int> mPendingEdits;
+    QTimer mTimer;
+};
+
+#endif // FEATURECOMMITQUEUE_H
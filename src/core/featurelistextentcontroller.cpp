@@ -18,6 +18,9 @@
 #include <qgsvectorlayer.h>
 #include <qgsgeometry.h>
 
+#include "geometryutils.h"
+#include "coordinatetransformcache.h"
+
 FeatureListExtentController::FeatureListExtentController( QObject *parent )
   : QObject( parent )
 {
@@ -52,17 +55,31 @@ void FeatureListExtentController::zoomToSelected( bool skipIfIntersects ) const
     QgsFeature feat = mSelection->focusedFeature();
     QgsVectorLayer *layer = mSelection->focusedLayer();
 
-    QgsCoordinateTransform transf( layer->crs(), mMapSettings->destinationCrs(), mMapSettings->mapSettings().transformContext() );
+    const QgsCoordinateTransform transf = CoordinateTransformCache::instance()->transform( layer->crs(), mMapSettings->destinationCrs(), mMapSettings->mapSettings().transformContext() );
     QgsGeometry geom( feat.geometry() );
-    geom.transform( transf );
 
-    if ( geom.type() == QgsWkbTypes::PointGeometry )
+    if ( geom.type() == QgsWkbTypes::PointGeometry && !geom.isMultipart() )
     {
+      // only the point itself is transformed
+      QVector<double> x { geom.asPoint().x() };
+      QVector<double> y { geom.asPoint().y() };
+      GeometryUtils::transformCoordinates( transf, x, y );
+      const QgsPointXY point( x.at( 0 ), y.at( 0 ) );
+
+      if ( !skipIfIntersects || !mMapSettings->extent().contains( point ) )
+        mMapSettings->setCenter( QgsPoint( point ) );
+    }
+    else if ( geom.type() == QgsWkbTypes::PointGeometry )
+    {
+      geom.transform( transf );
       if ( !skipIfIntersects || !mMapSettings->extent().intersects( geom.boundingBox() ) )
-        mMapSettings->setCenter( QgsPoint( geom.asPoint() ) );
+        mMapSettings->setCenter( QgsPoint( geom.centroid().asPoint() ) );
     }
     else
     {
+      // the parts and rings are transformed as whole coordinate arrays
+      geom.transform( transf );
+
       QgsRectangle featureExtent = geom.boundingBox();
       QgsRectangle bufferedExtent = featureExtent.buffered( std::max( featureExtent.width(), featureExtent.height() ) );
 
@@ -17,6 +17,7 @@
 
 #include "featuremodel.h"
 #include "expressioncontextutils.h"
+#include "featurecommitqueue.h"
 #include "vertexmodel.h"
 
 #include <qgsproject.h>
@@ -152,6 +153,20 @@ void FeatureModel::setVertexModel( VertexModel *model )
   emit vertexModelChanged();
 }
 
+FeatureCommitQueue *FeatureModel::commitQueue() const
+{
+  return mCommitQueue;
+}
+
+void FeatureModel::setCommitQueue( FeatureCommitQueue *commitQueue )
+{
+  if ( commitQueue == mCommitQueue )
+    return;
+
+  mCommitQueue = commitQueue;
+  emit commitQueueChanged();
+}
+
 QgsFeature FeatureModel::feature() const
 {
   return mFeature;
@@ -335,7 +350,7 @@ bool FeatureModel::save()
         mLayer->addTopologicalPoints( feat.geometry() );
       }
 
-      rv &= commit();
+      rv &= mCommitQueue ? mCommitQueue->enqueue( mLayer ) : commit();
 
       if ( rv )
       {
@@ -376,7 +391,7 @@ bool FeatureModel::save()
           QgsMessageLog::logMessage( tr( "Cannot update feature" ), QStringLiteral( "QField" ), Qgis::Warning );
         }
       }
-      rv &= commit();
+      rv &= mCommitQueue ? mCommitQueue->enqueue( mLayer ) : commit();
     }
   }
 
@@ -388,6 +403,10 @@ void FeatureModel::reset()
   if ( !mLayer )
     return;
 
+  // do not discard edits which have already been saved but not yet committed
+  if ( mCommitQueue )
+    mCommitQueue->flush( mLayer );
+
   mLayer->rollBack();
 }
 
@@ -493,6 +512,16 @@ bool FeatureModel::create()
     return false;
   }
 
+  // the children of a relation reference the primary key, which is only known once the feature has been committed
+  const bool commitNow = !mCommitQueue || !QgsProject::instance()->relationManager()->referencedRelations( mLayer ).isEmpty();
+  // a failed commit rolls back the layer, the edits waiting in the queue are committed on their own first
+  if ( commitNow && mCommitQueue )
+  {
+    mCommitQueue->flush( mLayer );
+    if ( !startEditing() )
+      return false;
+  }
+
   bool isSuccess = true;
   connect( mLayer, &QgsVectorLayer::featureAdded, this, &FeatureModel::featureAdded );
 
@@ -501,7 +530,17 @@ bool FeatureModel::create()
     if ( QgsProject::instance()->topologicalEditing() )
       mLayer->addTopologicalPoints( mFeature.geometry() );
 
-    if ( commit() )
+    if ( !commitNow )
+    {
+      // the temporary id is replaced once the queue commits the layer, which might happen right away
+      trackQueuedFeature();
+      if ( !mCommitQueue->enqueue( mLayer ) )
+      {
+        QgsMessageLog::logMessage( tr( "Layer \"%1\" cannot be commited with the newly created feature %2" ).arg( mLayer->name() ).arg( mFeature.id() ), QStringLiteral( "QField" ), Qgis::Critical );
+        isSuccess = false;
+      }
+    }
+    else if ( commit() )
     {
       QgsFeature feat;
       if ( mLayer->getFeatures( QgsFeatureRequest().setFilterFid( mFeature.id() ) ).nextFeature( feat ) )
@@ -533,6 +572,10 @@ bool FeatureModel::create()
 
 bool FeatureModel::deleteFeature()
 {
+  // a failed deletion rolls back the layer, make sure previously saved edits are not lost
+  if ( mCommitQueue )
+    mCommitQueue->flush( mLayer );
+
   if ( ! startEditing() )
   {
     QgsMessageLog::logMessage( tr( "Cannot start editing on layer \"%1\" to delete feature %2" ).arg( mLayer->name() ).arg( mFeature.id() ), QStringLiteral( "QField" ), Qgis::Critical );
@@ -630,6 +673,14 @@ bool FeatureModel::deleteFeature()
 
 bool FeatureModel::commit()
 {
+  // the edits waiting in the queue are committed, or reported by the queue as lost, before they could be rolled back here
+  if ( mCommitQueue && !mCommitQueue->flush( mLayer ) )
+    return false;
+
+  // the queue has committed the edit buffer, including the edits of this model
+  if ( !mLayer->isEditable() )
+    return true;
+
   if ( !mLayer->commitChanges() )
   {
     QgsMessageLog::logMessage( tr( "Could not save changes. Rolling back." ), QStringLiteral( "QField" ), Qgis::Critical );
@@ -642,6 +693,50 @@ bool FeatureModel::commit()
   }
 }
 
+void FeatureModel::trackQueuedFeature()
+{
+  stopTrackingQueuedFeature();
+
+  mQueuedLayer = mLayer;
+  mQueuedFeatureId = mFeature.id();
+
+  // on commit, the temporary id is deleted and the permanent id added right after the features have been written
+  mQueuedFeatureConnections << connect( mLayer, &QgsVectorLayer::committedFeaturesAdded, this, [this]
+  {
+    mQueuedFeatureReplaced = false;
+  } );
+  mQueuedFeatureConnections << connect( mLayer, &QgsVectorLayer::featureDeleted, this, [this]( QgsFeatureId fid )
+  {
+    mQueuedFeatureReplaced = fid == mQueuedFeatureId;
+  } );
+  mQueuedFeatureConnections << connect( mLayer, &QgsVectorLayer::featureAdded, this, [this]( QgsFeatureId fid )
+  {
+    if ( !mQueuedFeatureReplaced )
+      return;
+
+    mQueuedFeatureReplaced = false;
+    if ( mLayer == mQueuedLayer && mFeature.id() == mQueuedFeatureId )
+    {
+      mFeature.setId( fid );
+      emit featureChanged();
+    }
+    stopTrackingQueuedFeature();
+  } );
+  mQueuedFeatureConnections << connect( mLayer, &QgsVectorLayer::afterCommitChanges, this, &FeatureModel::stopTrackingQueuedFeature );
+  mQueuedFeatureConnections << connect( mLayer, &QgsVectorLayer::afterRollBack, this, &FeatureModel::stopTrackingQueuedFeature );
+}
+
+void FeatureModel::stopTrackingQueuedFeature()
+{
+  for ( const QMetaObject::Connection &connection : qgis::as_const( mQueuedFeatureConnections ) )
+    disconnect( connection );
+  mQueuedFeatureConnections.clear();
+
+  mQueuedLayer.clear();
+  mQueuedFeatureId = FID_NULL;
+  mQueuedFeatureReplaced = false;
+}
+
 bool FeatureModel::startEditing()
 {
   // Already an edit session active
@@ -19,6 +19,7 @@
 #define FEATUREMODEL_H
 
 #include <QAbstractListModel>
+#include <QPointer>
 #include <QtPositioning/QGeoPositionInfoSource>
 #include <qgsrelationmanager.h>
 #include <memory>
@@ -28,6 +29,7 @@
 #include "geometry.h"
 
 class VertexModel;
+class FeatureCommitQueue;
 
 class FeatureModel : public QAbstractListModel
 {
@@ -43,6 +45,8 @@ class FeatureModel : public QAbstractListModel
     Q_PROPERTY( QgsVectorLayer *currentLayer READ layer WRITE setCurrentLayer NOTIFY currentLayerChanged )
     Q_PROPERTY( QString positionSourceName READ positionSourceName WRITE setPositionSourceName NOTIFY positionSourceChanged )
     Q_PROPERTY( SnappingResult topSnappingResult READ topSnappingResult WRITE setTopSnappingResult NOTIFY topSnappingResultChanged )
+    //! if set, saved edits are kept in the edit buffer and committed in batches by the queue
+    Q_PROPERTY( FeatureCommitQueue *commitQueue READ commitQueue WRITE setCommitQueue NOTIFY commitQueueChanged )
 
     //! keeping the information what attributes are remembered and the last edited feature
     struct RememberValues
@@ -127,6 +131,11 @@ class FeatureModel : public QAbstractListModel
     //! \copydoc vertexModel
     void setVertexModel( VertexModel *model );
 
+    //! \copydoc commitQueue
+    FeatureCommitQueue *commitQueue() const;
+    //! \copydoc commitQueue
+    void setCommitQueue( FeatureCommitQueue *commitQueue );
+
     QHash<int, QByteArray> roleNames() const override;
     int rowCount( const QModelIndex &parent ) const override;
     QVariant data( const QModelIndex &index, int role ) const override;
@@ -135,8 +144,10 @@ class FeatureModel : public QAbstractListModel
     /**
      * Will commit the edit buffer of this layer.
      * May change in the future to only commit the changes buffered in this model.
+     * If a commit queue is set, the edit buffer is committed with the next batch of the queue.
+     * A failure of that deferred commit is reported by FeatureCommitQueue::commitFailed().
      *
-     * @return Success of the operation
+     * @return Success of the operation, or of enqueuing the edits if a commit queue is set
      */
     Q_INVOKABLE bool save();
 
@@ -147,6 +158,11 @@ class FeatureModel : public QAbstractListModel
 
     /**
      * Will create this feature as a new feature on the data source
+     * If a commit queue is set, the new feature is committed with the next batch of the queue and
+     * keeps its temporary id until then. Features of layers referenced by relations are committed
+     * right away, their children need the primary key assigned by the data source.
+     *
+     * @return Success of the operation, or of enqueuing the new feature if a commit queue is used
      */
     Q_INVOKABLE bool create();
 
@@ -210,6 +226,7 @@ class FeatureModel : public QAbstractListModel
     void linkedParentFeatureChanged();
     void linkedRelationChanged();
     void vertexModelChanged();
+    void commitQueueChanged();
     void geometryChanged();
     void currentLayerChanged();
     void positionSourceChanged();
@@ -225,6 +242,10 @@ class FeatureModel : public QAbstractListModel
     bool startEditing();
     void setLinkedFeatureValues();
 
+    //! Follows the created feature waiting in the commit queue to update its id once it is committed
+    void trackQueuedFeature();
+    void stopTrackingQueuedFeature();
+
     ModelModes mModelMode = SingleFeatureModel;
     QgsVectorLayer *mLayer = nullptr;
     QgsFeature mFeature;
@@ -234,11 +255,20 @@ class FeatureModel : public QAbstractListModel
     QgsRelation mLinkedRelation;
     QList<int> mLinkedAttributeIndexes;
     VertexModel *mVertexModel = nullptr;
+    QPointer<FeatureCommitQueue> mCommitQueue;
     Geometry *mGeometry = nullptr;
     std::unique_ptr<QGeoPositionInfoSource> mPositionSource;
     SnappingResult mTopSnappingResult;
     QString mTempName;
     QMap<QgsVectorLayer *, RememberValues> mRememberings;
+
+    //! the layer of the created feature waiting in the commit queue
+    QPointer<QgsVectorLayer> mQueuedLayer;
+    //! the temporary id of the created feature waiting in the commit queue
+    QgsFeatureId mQueuedFeatureId = FID_NULL;
+    //! if the temporary id has just been replaced during a commit
+    bool mQueuedFeatureReplaced = false;
+    QList<QMetaObject::Connection> mQueuedFeatureConnections;
 };
 
 #endif // FEATUREMODEL_H
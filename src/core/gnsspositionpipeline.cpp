@@ -0,0 +1,470 @@
+/***************************************************************************
+  gnsspositionpipeline.cpp - GnssPositionPipeline
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "gnsspositionpipeline.h"
+#include "nmeareplaypositionsource.h"
+#include "coordinatetransformcache.h"
+
+#include <QTimer>
+#include <qgsexception.h>
+#include <qgslogger.h>
+#include <qgsunittypes.h>
+
+#include <memory>
+
+/**
+ * Owns the position source on the worker thread, transforms the received positions and
+ * hands them over to the pipeline in batches.
+ */
+class PositionWorker : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit PositionWorker( GnssPositionPipeline *pipeline )
+      : mPipeline( pipeline )
+    {
+      mDeliveryTimer.setSingleShot( true );
+      connect( &mDeliveryTimer, &QTimer::timeout, this, &PositionWorker::deliver );
+    }
+
+    ~PositionWorker() override
+    {
+      mSource.reset();
+    }
+
+    void createSource( const QString &name, const QString &replayFile, double replaySpeed, int preferredPositioningMethods, bool active )
+    {
+      mSource.reset();
+
+      if ( !replayFile.isEmpty() )
+      {
+        NmeaReplayPositionSource *source = new NmeaReplayPositionSource( replayFile );
+        source->setReplaySpeed( replaySpeed );
+        GnssPositionPipeline *pipeline = mPipeline;
+        connect( source, &NmeaReplayPositionSource::replayFinished, this, [pipeline]() {
+          QMetaObject::invokeMethod( pipeline, &GnssPositionPipeline::replayFinished );
+        } );
+        mSource.reset( source );
+      }
+      else if ( name.isEmpty() )
+      {
+        mSource.reset( QGeoPositionInfoSource::createDefaultSource( nullptr ) );
+      }
+      else
+      {
+        mSource.reset( QGeoPositionInfoSource::createSource( name, nullptr ) );
+      }
+
+      if ( mSource )
+      {
+        connect( mSource.get(), &QGeoPositionInfoSource::positionUpdated, this, &PositionWorker::positionUpdated );
+        if ( preferredPositioningMethods )
+          mSource->setPreferredPositioningMethods( static_cast<QGeoPositionInfoSource::PositioningMethods>( preferredPositioningMethods ) );
+        if ( active )
+          mSource->startUpdates();
+      }
+
+      const bool valid = static_cast<bool>( mSource );
+      GnssPositionPipeline *pipeline = mPipeline;
+      QMetaObject::invokeMethod( pipeline, [pipeline, valid]() { pipeline->sourceCreated( valid ); } );
+    }
+
+    void setActive( bool active )
+    {
+      if ( !mSource )
+        return;
+
+      if ( active )
+        mSource->startUpdates();
+      else
+        mSource->stopUpdates();
+    }
+
+    void setPreferredPositioningMethods( int methods )
+    {
+      if ( mSource )
+        mSource->setPreferredPositioningMethods( static_cast<QGeoPositionInfoSource::PositioningMethods>( methods ) );
+    }
+
+    void setReplaySpeed( double replaySpeed )
+    {
+      if ( NmeaReplayPositionSource *source = qobject_cast<NmeaReplayPositionSource *>( mSource.get() ) )
+        source->setReplaySpeed( replaySpeed );
+    }
+
+    void setTransform( const QgsCoordinateReferenceSystem &destinationCrs, const QgsCoordinateTransformContext &transformContext, double deltaZ, bool skipAltitudeTransformation )
+    {
+      // the transform is taken from the cache of the worker thread
+      mTransform = CoordinateTransformCache::instance()->transform( QgsCoordinateReferenceSystem::fromEpsgId( 4326 ), destinationCrs, transformContext );
+      mDeltaZ = deltaZ;
+      mSkipAltitudeTransformation = skipAltitudeTransformation;
+    }
+
+    void setDeliveryInterval( int deliveryInterval )
+    {
+      mDeliveryInterval = deliveryInterval;
+    }
+
+  private:
+    void positionUpdated( const QGeoPositionInfo &info )
+    {
+      mBatch << PositionSample { info, GnssPositionPipeline::transformPosition( info, mTransform, mDeltaZ, mSkipAltitudeTransformation ) };
+
+      if ( mDeliveryTimer.isActive() )
+        return;
+
+      // deliver right away if the previous delivery is at least an interval ago, i.e. unless samples arrive in a burst
+      const qint64 elapsed = mLastDelivery.isValid() ? mLastDelivery.elapsed() : mDeliveryInterval;
+      if ( elapsed >= mDeliveryInterval )
+        deliver();
+      else
+        mDeliveryTimer.start( static_cast<int>( mDeliveryInterval - elapsed ) );
+    }
+
+    void deliver()
+    {
+      if ( mBatch.isEmpty() )
+        return;
+
+      const QList<PositionSample> batch = mBatch;
+      mBatch.clear();
+      mLastDelivery.start();
+
+      GnssPositionPipeline *pipeline = mPipeline;
+      QMetaObject::invokeMethod( pipeline, [pipeline, batch]() { pipeline->receiveSamples( batch ); } );
+    }
+
+    GnssPositionPipeline *mPipeline = nullptr;
+    std::unique_ptr<QGeoPositionInfoSource> mSource;
+    QgsCoordinateTransform mTransform;
+    double mDeltaZ = 0.0;
+    bool mSkipAltitudeTransformation = false;
+
+    int mDeliveryInterval = GnssPositionPipeline::DEFAULT_DELIVERY_INTERVAL;
+    QTimer mDeliveryTimer;
+    QElapsedTimer mLastDelivery;
+    QList<PositionSample> mBatch;
+};
+
+GnssPositionPipeline::GnssPositionPipeline( QObject *parent )
+  : QObject( parent )
+{
+  mWorker = new PositionWorker( this );
+  mWorker->moveToThread( &mWorkerThread );
+  connect( &mWorkerThread, &QThread::finished, mWorker, &QObject::deleteLater );
+  mWorkerThread.start();
+
+  updateSource();
+}
+
+GnssPositionPipeline::~GnssPositionPipeline()
+{
+  mWorkerThread.quit();
+  mWorkerThread.wait();
+}
+
+bool GnssPositionPipeline::active() const
+{
+  return mActive;
+}
+
+void GnssPositionPipeline::setActive( bool active )
+{
+  if ( mActive == active )
+    return;
+
+  mActive = active;
+
+  if ( mActive )
+  {
+    mSampleCount = 0;
+    mRateSampleCount = 0;
+    mRateTimer.start();
+  }
+
+  PositionWorker *worker = mWorker;
+  QMetaObject::invokeMethod( worker, [worker, active]() { worker->setActive( active ); } );
+
+  emit activeChanged();
+}
+
+bool GnssPositionPipeline::valid() const
+{
+  return mValid;
+}
+
+QString GnssPositionPipeline::name() const
+{
+  return mReplayFile.isEmpty() ? mName : QStringLiteral( "nmea-replay" );
+}
+
+void GnssPositionPipeline::setName( const QString &name )
+{
+  if ( mName == name )
+    return;
+
+  mName = name;
+  updateSource();
+  emit nameChanged();
+}
+
+int GnssPositionPipeline::preferredPositioningMethods() const
+{
+  return mPreferredPositioningMethods;
+}
+
+void GnssPositionPipeline::setPreferredPositioningMethods( int methods )
+{
+  if ( mPreferredPositioningMethods == methods )
+    return;
+
+  mPreferredPositioningMethods = methods;
+
+  PositionWorker *worker = mWorker;
+  QMetaObject::invokeMethod( worker, [worker, methods]() { worker->setPreferredPositioningMethods( methods ); } );
+
+  emit preferredPositioningMethodsChanged();
+}
+
+QString GnssPositionPipeline::replayFile() const
+{
+  return mReplayFile;
+}
+
+void GnssPositionPipeline::setReplayFile( const QString &replayFile )
+{
+  if ( mReplayFile == replayFile )
+    return;
+
+  mReplayFile = replayFile;
+  updateSource();
+  emit replayFileChanged();
+  emit nameChanged();
+}
+
+double GnssPositionPipeline::replaySpeed() const
+{
+  return mReplaySpeed;
+}
+
+void GnssPositionPipeline::setReplaySpeed( double replaySpeed )
+{
+  if ( qgsDoubleNear( mReplaySpeed, replaySpeed ) )
+    return;
+
+  mReplaySpeed = replaySpeed;
+
+  PositionWorker *worker = mWorker;
+  QMetaObject::invokeMethod( worker, [worker, replaySpeed]() { worker->setReplaySpeed( replaySpeed ); } );
+
+  emit replaySpeedChanged();
+}
+
+QgsCoordinateReferenceSystem GnssPositionPipeline::destinationCrs() const
+{
+  return mDestinationCrs;
+}
+
+void GnssPositionPipeline::setDestinationCrs( const QgsCoordinateReferenceSystem &destinationCrs )
+{
+  if ( mDestinationCrs == destinationCrs )
+    return;
+
+  mDestinationCrs = destinationCrs;
+  updateTransform();
+  emit destinationCrsChanged();
+}
+
+QgsCoordinateTransformContext GnssPositionPipeline::transformContext() const
+{
+  return mTransformContext;
+}
+
+void GnssPositionPipeline::setTransformContext( const QgsCoordinateTransformContext &transformContext )
+{
+  if ( mTransformContext == transformContext )
+    return;
+
+  mTransformContext = transformContext;
+  updateTransform();
+  emit transformContextChanged();
+}
+
+double GnssPositionPipeline::deltaZ() const
+{
+  return mDeltaZ;
+}
+
+void GnssPositionPipeline::setDeltaZ( double deltaZ )
+{
+  if ( qgsDoubleNear( mDeltaZ, deltaZ ) )
+    return;
+
+  mDeltaZ = deltaZ;
+  updateTransform();
+  emit deltaZChanged();
+}
+
+bool GnssPositionPipeline::skipAltitudeTransformation() const
+{
+  return mSkipAltitudeTransformation;
+}
+
+void GnssPositionPipeline::setSkipAltitudeTransformation( bool skipAltitudeTransformation )
+{
+  if ( mSkipAltitudeTransformation == skipAltitudeTransformation )
+    return;
+
+  mSkipAltitudeTransformation = skipAltitudeTransformation;
+  updateTransform();
+  emit skipAltitudeTransformationChanged();
+}
+
+int GnssPositionPipeline::deliveryInterval() const
+{
+  return mDeliveryInterval;
+}
+
+void GnssPositionPipeline::setDeliveryInterval( int deliveryInterval )
+{
+  if ( mDeliveryInterval == deliveryInterval )
+    return;
+
+  mDeliveryInterval = deliveryInterval;
+
+  PositionWorker *worker = mWorker;
+  QMetaObject::invokeMethod( worker, [worker, deliveryInterval]() { worker->setDeliveryInterval( deliveryInterval ); } );
+
+  emit deliveryIntervalChanged();
+}
+
+GnssPositionInformation GnssPositionPipeline::position() const
+{
+  return mPosition;
+}
+
+QgsPoint GnssPositionPipeline::projectedPosition() const
+{
+  return mProjectedPosition;
+}
+
+double GnssPositionPipeline::projectedHorizontalAccuracy() const
+{
+  if ( !mPosition.horizontalAccuracyValid() || mDestinationCrs.mapUnits() == QgsUnitTypes::DistanceUnknownUnit )
+    return 0.0;
+
+  return mPosition.horizontalAccuracy() * QgsUnitTypes::fromUnitToUnitFactor( QgsUnitTypes::DistanceMeters, mDestinationCrs.mapUnits() );
+}
+
+int GnssPositionPipeline::sampleCount() const
+{
+  return mSampleCount;
+}
+
+double GnssPositionPipeline::samplesPerSecond() const
+{
+  return mSamplesPerSecond;
+}
+
+QgsPoint GnssPositionPipeline::transformPosition( const QGeoPositionInfo &info, const QgsCoordinateTransform &transform, double deltaZ, bool skipAltitudeTransformation )
+{
+  const QGeoCoordinate coordinate = info.coordinate();
+  double x = coordinate.longitude();
+  double y = coordinate.latitude();
+  // a NaN Z would turn X and Y into NaN as well
+  double z = std::isnan( coordinate.altitude() ) ? 0 : coordinate.altitude();
+
+  try
+  {
+    transform.transformInPlace( x, y, z );
+  }
+  catch ( const QgsCsException &exp )
+  {
+    QgsDebugMsg( exp.what() );
+  }
+  catch ( ... )
+  {
+    // catch any other errors
+    QgsDebugMsg( "Transform exception caught - possibly because of missing gsb file." );
+  }
+
+  if ( skipAltitudeTransformation )
+    z = coordinate.altitude();
+
+  QgsPoint point( x, y );
+  point.addZValue( z + deltaZ );
+  return point;
+}
+
+void GnssPositionPipeline::updateSource()
+{
+  PositionWorker *worker = mWorker;
+  const QString name = mName;
+  const QString replayFile = mReplayFile;
+  const double replaySpeed = mReplaySpeed;
+  const int methods = mPreferredPositioningMethods;
+  const bool active = mActive;
+  QMetaObject::invokeMethod( worker, [worker, name, replayFile, replaySpeed, methods, active]() {
+    worker->createSource( name, replayFile, replaySpeed, methods, active );
+  } );
+}
+
+void GnssPositionPipeline::updateTransform()
+{
+  PositionWorker *worker = mWorker;
+  const QgsCoordinateReferenceSystem destinationCrs = mDestinationCrs;
+  const QgsCoordinateTransformContext transformContext = mTransformContext;
+  const double deltaZ = mDeltaZ;
+  const bool skipAltitudeTransformation = mSkipAltitudeTransformation;
+  QMetaObject::invokeMethod( worker, [worker, destinationCrs, transformContext, deltaZ, skipAltitudeTransformation]() {
+    worker->setTransform( destinationCrs, transformContext, deltaZ, skipAltitudeTransformation );
+  } );
+}
+
+void GnssPositionPipeline::receiveSamples( const QList<PositionSample> &samples )
+{
+  if ( samples.isEmpty() )
+    return;
+
+  mSampleCount += samples.count();
+  mRateSampleCount += samples.count();
+  if ( !mRateTimer.isValid() )
+    mRateTimer.start();
+  if ( mRateTimer.elapsed() >= 1000 )
+  {
+    mSamplesPerSecond = mRateSampleCount * 1000.0 / mRateTimer.restart();
+    mRateSampleCount = 0;
+  }
+
+  // only the latest sample of the batch is shown
+  mPosition = GnssPositionInformation( samples.last().info );
+  mProjectedPosition = samples.last().projectedPosition;
+
+  emit samplesReceived( samples );
+  emit positionChanged();
+  emit projectedPositionChanged();
+}
+
+void GnssPositionPipeline::sourceCreated( bool valid )
+{
+  if ( mValid == valid )
+    return;
+
+  mValid = valid;
+  emit validChanged();
+}
+
+#include "gnsspositionpipeline.moc"
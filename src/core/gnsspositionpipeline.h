@@ -0,0 +1,269 @@
+/***************************************************************************
+  gnsspositionpipeline.h - GnssPositionPipeline
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef GNSSPOSITIONPIPELINE_H
+#define GNSSPOSITIONPIPELINE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThread>
+#include <QtPositioning/QGeoPositionInfo>
+
+#include <qgscoordinatereferencesystem.h>
+#include <qgscoordinatetransform.h>
+#include <qgscoordinatetransformcontext.h>
+#include <qgspoint.h>
+
+#include <cmath>
+
+class PositionWorker;
+
+/**
+ * The information of a position update, exposed to QML with the same properties as
+ * the position of a QML PositionSource.
+ */
+class GnssPositionInformation
+{
+    Q_GADGET
+
+    Q_PROPERTY( QGeoCoordinate coordinate READ coordinate )
+    Q_PROPERTY( QDateTime timestamp READ timestamp )
+    Q_PROPERTY( bool latitudeValid READ latitudeValid )
+    Q_PROPERTY( bool longitudeValid READ longitudeValid )
+    Q_PROPERTY( bool altitudeValid READ altitudeValid )
+    Q_PROPERTY( double speed READ speed )
+    Q_PROPERTY( bool speedValid READ speedValid )
+    Q_PROPERTY( double direction READ direction )
+    Q_PROPERTY( bool directionValid READ directionValid )
+    Q_PROPERTY( double horizontalAccuracy READ horizontalAccuracy )
+    Q_PROPERTY( bool horizontalAccuracyValid READ horizontalAccuracyValid )
+    Q_PROPERTY( double verticalAccuracy READ verticalAccuracy )
+    Q_PROPERTY( bool verticalAccuracyValid READ verticalAccuracyValid )
+
+  public:
+    GnssPositionInformation() = default;
+    explicit GnssPositionInformation( const QGeoPositionInfo &info )
+      : mInfo( info )
+    {}
+
+    QGeoPositionInfo info() const { return mInfo; }
+
+    QGeoCoordinate coordinate() const { return mInfo.coordinate(); }
+    QDateTime timestamp() const { return mInfo.timestamp(); }
+    bool latitudeValid() const { return !std::isnan( mInfo.coordinate().latitude() ); }
+    bool longitudeValid() const { return !std::isnan( mInfo.coordinate().longitude() ); }
+    bool altitudeValid() const { return !std::isnan( mInfo.coordinate().altitude() ); }
+    double speed() const { return mInfo.attribute( QGeoPositionInfo::GroundSpeed ); }
+    bool speedValid() const { return mInfo.hasAttribute( QGeoPositionInfo::GroundSpeed ); }
+    double direction() const { return mInfo.attribute( QGeoPositionInfo::Direction ); }
+    bool directionValid() const { return mInfo.hasAttribute( QGeoPositionInfo::Direction ); }
+    double horizontalAccuracy() const { return mInfo.attribute( QGeoPositionInfo::HorizontalAccuracy ); }
+    bool horizontalAccuracyValid() const { return mInfo.hasAttribute( QGeoPositionInfo::HorizontalAccuracy ); }
+    double verticalAccuracy() const { return mInfo.attribute( QGeoPositionInfo::VerticalAccuracy ); }
+    bool verticalAccuracyValid() const { return mInfo.hasAttribute( QGeoPositionInfo::VerticalAccuracy ); }
+
+  private:
+    QGeoPositionInfo mInfo;
+};
+
+Q_DECLARE_METATYPE( GnssPositionInformation )
+
+//! A position update together with its position in the destination crs
+struct PositionSample
+{
+  QGeoPositionInfo info;
+  QgsPoint projectedPosition;
+};
+
+/**
+ * The GnssPositionPipeline receives the position updates of a position source and transforms
+ * them into the destination crs on a worker thread.
+ *
+ * Rather than fanning out every update on the UI thread, the samples are batched and handed over
+ * at most once per \a deliveryInterval, one frame by default. A 10-20 Hz receiver is therefore
+ * delivered without delay, a sample at a time, while bursts, e.g. a replayed log or a receiver
+ * flushing its buffer, are folded into a few batches. The exposed position is only updated with
+ * the latest sample of a batch, while samplesReceived() carries all of them, e.g. for the trackers,
+ * which fold each batch into a single rubberband update.
+ *
+ * The source is either the position source with the given \a name or, if \a replayFile is set,
+ * a NmeaReplayPositionSource replaying a recorded NMEA log.
+ */
+class GnssPositionPipeline : public QObject
+{
+    Q_OBJECT
+
+    //! if the position source is active
+    Q_PROPERTY( bool active READ active WRITE setActive NOTIFY activeChanged )
+    //! if a position source could be created
+    Q_PROPERTY( bool valid READ valid NOTIFY validChanged )
+    //! the name of the position source to use, the default source if empty
+    Q_PROPERTY( QString name READ name WRITE setName NOTIFY nameChanged )
+    //! the preferred positioning methods of the position source
+    Q_PROPERTY( int preferredPositioningMethods READ preferredPositioningMethods WRITE setPreferredPositioningMethods NOTIFY preferredPositioningMethodsChanged )
+    //! a NMEA log file to replay instead of using the position source
+    Q_PROPERTY( QString replayFile READ replayFile WRITE setReplayFile NOTIFY replayFileChanged )
+    //! the replay speed factor of the NMEA log, 0 to replay as fast as possible
+    Q_PROPERTY( double replaySpeed READ replaySpeed WRITE setReplaySpeed NOTIFY replaySpeedChanged )
+    //! the crs the positions are transformed into
+    Q_PROPERTY( QgsCoordinateReferenceSystem destinationCrs READ destinationCrs WRITE setDestinationCrs NOTIFY destinationCrsChanged )
+    //! the transform context used to transform the positions
+    Q_PROPERTY( QgsCoordinateTransformContext transformContext READ transformContext WRITE setTransformContext NOTIFY transformContextChanged )
+    //! an offset added to the altitude, e.g. the antenna height
+    Q_PROPERTY( double deltaZ READ deltaZ WRITE setDeltaZ NOTIFY deltaZChanged )
+    //! if the altitude is not transformed into the destination crs
+    Q_PROPERTY( bool skipAltitudeTransformation READ skipAltitudeTransformation WRITE setSkipAltitudeTransformation NOTIFY skipAltitudeTransformationChanged )
+    //! the time in milliseconds between two deliveries of samples to the UI thread
+    Q_PROPERTY( int deliveryInterval READ deliveryInterval WRITE setDeliveryInterval NOTIFY deliveryIntervalChanged )
+
+    //! the latest position
+    Q_PROPERTY( GnssPositionInformation position READ position NOTIFY positionChanged )
+    //! the latest position in the destination crs
+    Q_PROPERTY( QgsPoint projectedPosition READ projectedPosition NOTIFY projectedPositionChanged )
+    //! the horizontal accuracy of the latest position in the map units of the destination crs
+    Q_PROPERTY( double projectedHorizontalAccuracy READ projectedHorizontalAccuracy NOTIFY projectedPositionChanged )
+    //! the number of samples received since the source has been activated
+    Q_PROPERTY( int sampleCount READ sampleCount NOTIFY positionChanged )
+    //! the number of samples received during the last second
+    Q_PROPERTY( double samplesPerSecond READ samplesPerSecond NOTIFY positionChanged )
+
+  public:
+    explicit GnssPositionPipeline( QObject *parent = nullptr );
+    ~GnssPositionPipeline() override;
+
+    //! \copydoc active
+    bool active() const;
+    //! \copydoc active
+    void setActive( bool active );
+
+    //! \copydoc valid
+    bool valid() const;
+
+    //! \copydoc name
+    QString name() const;
+    //! \copydoc name
+    void setName( const QString &name );
+
+    //! \copydoc preferredPositioningMethods
+    int preferredPositioningMethods() const;
+    //! \copydoc preferredPositioningMethods
+    void setPreferredPositioningMethods( int methods );
+
+    //! \copydoc replayFile
+    QString replayFile() const;
+    //! \copydoc replayFile
+    void setReplayFile( const QString &replayFile );
+
+    //! \copydoc replaySpeed
+    double replaySpeed() const;
+    //! \copydoc replaySpeed
+    void setReplaySpeed( double replaySpeed );
+
+    //! \copydoc destinationCrs
+    QgsCoordinateReferenceSystem destinationCrs() const;
+    //! \copydoc destinationCrs
+    void setDestinationCrs( const QgsCoordinateReferenceSystem &destinationCrs );
+
+    //! \copydoc transformContext
+    QgsCoordinateTransformContext transformContext() const;
+    //! \copydoc transformContext
+    void setTransformContext( const QgsCoordinateTransformContext &transformContext );
+
+    //! \copydoc deltaZ
+    double deltaZ() const;
+    //! \copydoc deltaZ
+    void setDeltaZ( double deltaZ );
+
+    //! \copydoc skipAltitudeTransformation
+    bool skipAltitudeTransformation() const;
+    //! \copydoc skipAltitudeTransformation
+    void setSkipAltitudeTransformation( bool skipAltitudeTransformation );
+
+    //! \copydoc deliveryInterval
+    int deliveryInterval() const;
+    //! \copydoc deliveryInterval
+    void setDeliveryInterval( int deliveryInterval );
+
+    //! \copydoc position
+    GnssPositionInformation position() const;
+    //! \copydoc projectedPosition
+    QgsPoint projectedPosition() const;
+    //! \copydoc projectedHorizontalAccuracy
+    double projectedHorizontalAccuracy() const;
+    //! \copydoc sampleCount
+    int sampleCount() const;
+    //! \copydoc samplesPerSecond
+    double samplesPerSecond() const;
+
+    //! Transforms the position of \a info into a point in the crs of \a transform
+    static QgsPoint transformPosition( const QGeoPositionInfo &info, const QgsCoordinateTransform &transform, double deltaZ, bool skipAltitudeTransformation );
+
+  signals:
+    void activeChanged();
+    void validChanged();
+    void nameChanged();
+    void preferredPositioningMethodsChanged();
+    void replayFileChanged();
+    void replaySpeedChanged();
+    void destinationCrsChanged();
+    void transformContextChanged();
+    void deltaZChanged();
+    void skipAltitudeTransformationChanged();
+    void deliveryIntervalChanged();
+    void positionChanged();
+    void projectedPositionChanged();
+
+    //! Emitted with all the samples received since the previous delivery, in the order they were received
+    void samplesReceived( const QList<PositionSample> &samples );
+
+    //! Emitted when the end of the replayed NMEA log has been reached
+    void replayFinished();
+
+  private:
+    //! the default time between two deliveries, one frame at 60 Hz
+    static const int DEFAULT_DELIVERY_INTERVAL = 16;
+
+    //! Creates the position source on the worker thread according to the name and the replay file
+    void updateSource();
+    void updateTransform();
+    void receiveSamples( const QList<PositionSample> &samples );
+    void sourceCreated( bool valid );
+
+    QThread mWorkerThread;
+    PositionWorker *mWorker = nullptr;
+
+    bool mActive = false;
+    bool mValid = false;
+    QString mName;
+    int mPreferredPositioningMethods = 0;
+    QString mReplayFile;
+    double mReplaySpeed = 1.0;
+    QgsCoordinateReferenceSystem mDestinationCrs;
+    QgsCoordinateTransformContext mTransformContext;
+    double mDeltaZ = 0.0;
+    bool mSkipAltitudeTransformation = false;
+    int mDeliveryInterval = DEFAULT_DELIVERY_INTERVAL;
+
+    GnssPositionInformation mPosition;
+    QgsPoint mProjectedPosition;
+    int mSampleCount = 0;
+    double mSamplesPerSecond = 0.0;
+    QElapsedTimer mRateTimer;
+    int mRateSampleCount = 0;
+
+    friend class PositionWorker;
+};
+
+#endif // GNSSPOSITIONPIPELINE_H
@@ -17,11 +17,13 @@
 
 #include "qgsquickmapsettings.h"
 #include "multifeaturelistmodel.h"
+#include "coordinatetransformcache.h"
 
 #include <qgsvectorlayer.h>
 #include <qgsproject.h>
 #include <qgsrenderer.h>
 #include <qgsexpressioncontextutils.h>
+#include <qgsmessagelog.h>
 
 IdentifyTool::IdentifyTool( QObject *parent )
   : QObject( parent )
@@ -183,7 +185,16 @@ double IdentifyTool::searchRadiusMU() const
 
 QgsRectangle IdentifyTool::toLayerCoordinates( QgsMapLayer *layer, const QgsRectangle &rect ) const
 {
-  return mMapSettings->mapSettings().mapToLayerCoordinates( layer, rect );
+  const QgsCoordinateTransform transform = CoordinateTransformCache::instance()->transform( layer->crs(), mMapSettings->destinationCrs(), mMapSettings->transformContext() );
+  try
+  {
+    return transform.transformBoundingBox( rect, QgsCoordinateTransform::ReverseTransform );
+  }
+  catch ( const QgsCsException &e )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Transform error caught: %1" ).arg( e.what() ), QStringLiteral( "QField" ) );
+    return rect;
+  }
 }
 
 double IdentifyTool::searchRadiusMm() const
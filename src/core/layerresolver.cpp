@@ -0,0 +1,160 @@
+/***************************************************************************
+  layerresolver.cpp - LayerResolver
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "layerresolver.h"
+
+#include <qgsdataprovider.h>
+#include <qgslayertree.h>
+#include <qgslayertreelayer.h>
+#include <qgsmaplayer.h>
+#include <qgsmessagelog.h>
+#include <qgsproject.h>
+
+LayerResolver::LayerResolver( QgsProject *project, QObject *parent )
+  : QObject( parent )
+  , mProject( project )
+{
+  // each layer in its own event loop iteration
+  mTimer.setSingleShot( true );
+  mTimer.setInterval( 0 );
+  connect( &mTimer, &QTimer::timeout, this, &LayerResolver::resolveNextLayer );
+}
+
+LayerResolver::~LayerResolver() = default;
+
+void LayerResolver::resolve( const QList<QgsMapLayer *> &visibleLayers )
+{
+  cancel();
+
+  // the visible layers are queued first
+  QList<QgsMapLayer *> layers;
+  const QList<QgsMapLayer *> projectLayers = mProject->mapLayers().values();
+  for ( QgsMapLayer *layer : visibleLayers )
+  {
+    if ( projectLayers.contains( layer ) && !layer->isValid() && !layers.contains( layer ) )
+      layers << layer;
+  }
+  mPendingVisibleCount = layers.size();
+  for ( QgsMapLayer *layer : projectLayers )
+  {
+    if ( !layer->isValid() && !layers.contains( layer ) )
+      layers << layer;
+  }
+
+  mLayerCount = layers.size();
+
+  for ( int i = 0; i < layers.size(); ++i )
+  {
+    PendingLayer pendingLayer;
+    pendingLayer.layer = layers.at( i );
+    pendingLayer.visible = i < mPendingVisibleCount;
+    mPendingLayers << pendingLayer;
+  }
+
+  if ( mPendingVisibleCount == 0 )
+    emit visibleLayersResolved();
+  if ( mPendingLayers.isEmpty() )
+    emit finished();
+  else
+    mTimer.start();
+}
+
+void LayerResolver::cancel()
+{
+  mTimer.stop();
+  mPendingLayers.clear();
+  mInvalidLayers.clear();
+  mPendingVisibleCount = 0;
+  mResolvedCount = 0;
+  mLayerCount = 0;
+}
+
+QList<QgsMapLayer *> LayerResolver::visibleLayers( const QgsProject *project )
+{
+  QList<QgsMapLayer *> layers;
+  const QList<QgsLayerTreeLayer *> treeLayers = project->layerTreeRoot()->findLayers();
+  for ( QgsLayerTreeLayer *treeLayer : treeLayers )
+  {
+    if ( treeLayer->isVisible() && treeLayer->layer() )
+      layers << treeLayer->layer();
+  }
+  return layers;
+}
+
+bool LayerResolver::isRunning() const
+{
+  return !mPendingLayers.isEmpty();
+}
+
+int LayerResolver::resolvedCount() const
+{
+  return mResolvedCount;
+}
+
+int LayerResolver::layerCount() const
+{
+  return mLayerCount;
+}
+
+QList<QgsMapLayer *> LayerResolver::invalidLayers() const
+{
+  QList<QgsMapLayer *> layers;
+  for ( const QPointer<QgsMapLayer> &layer : mInvalidLayers )
+  {
+    // the layer might have been removed in the meantime
+    if ( layer )
+      layers << layer;
+  }
+  return layers;
+}
+
+void LayerResolver::resolveNextLayer()
+{
+  if ( mPendingLayers.isEmpty() )
+    return;
+
+  const PendingLayer pendingLayer = mPendingLayers.takeFirst();
+
+  // the layer might have been removed in the meantime
+  if ( pendingLayer.layer )
+  {
+    resolveLayer( pendingLayer.layer );
+    if ( !pendingLayer.layer->isValid() )
+      mInvalidLayers << pendingLayer.layer;
+  }
+
+  mResolvedCount++;
+  emit progress( mResolvedCount, mLayerCount );
+
+  if ( pendingLayer.visible && --mPendingVisibleCount == 0 )
+    emit visibleLayersResolved();
+
+  if ( mPendingLayers.isEmpty() )
+    emit finished();
+  else
+    mTimer.start();
+}
+
+void LayerResolver::resolveLayer( QgsMapLayer *layer )
+{
+  QgsDataProvider::ProviderOptions options;
+  options.transformContext = mProject->transformContext();
+
+  // the style read from the project is kept
+  layer->setDataSource( layer->source(), layer->name(), layer->providerType(), options );
+
+  if ( !layer->isValid() )
+    QgsMessageLog::logMessage( tr( "Layer %1 could not be loaded" ).arg( layer->name() ), QStringLiteral( "QField" ) );
+}
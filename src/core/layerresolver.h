@@ -0,0 +1,102 @@
+/***************************************************************************
+  layerresolver.h - LayerResolver
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef LAYERRESOLVER_H
+#define LAYERRESOLVER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class QgsMapLayer;
+class QgsProject;
+
+/**
+ * The LayerResolver opens the data providers of the layers of a project read with
+ * QgsProject::FlagDontResolveLayers.
+ *
+ * Opening a provider, i.e. opening the dataset and reading its metadata, is the expensive part
+ * of loading a project. The layers are resolved one at a time on the main thread, with a return
+ * to the event loop in between, so the application stays responsive and can draw the layers
+ * already available. The visible layers are handled first.
+ *
+ * The layers which are still invalid once resolved are collected, see invalidLayers().
+ */
+class LayerResolver : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit LayerResolver( QgsProject *project, QObject *parent = nullptr );
+    ~LayerResolver() override;
+
+    /**
+     * Starts resolving the layers of the project, the \a visibleLayers first.
+     * A resolution still running for a previous project is cancelled.
+     */
+    void resolve( const QList<QgsMapLayer *> &visibleLayers );
+
+    //! Stops resolving the layers, the layers not resolved yet are left invalid
+    void cancel();
+
+    /**
+     * Returns the visible layers of the layer tree of \a project, in the order of the tree.
+     * The layers do not have to be valid.
+     */
+    static QList<QgsMapLayer *> visibleLayers( const QgsProject *project );
+
+    //! Returns TRUE while layers are being resolved
+    bool isRunning() const;
+
+    //! Returns the number of layers resolved so far
+    int resolvedCount() const;
+
+    //! Returns the number of layers to resolve
+    int layerCount() const;
+
+    //! Returns the layers which could not be resolved so far
+    QList<QgsMapLayer *> invalidLayers() const;
+
+  signals:
+    //! Emitted after each resolved layer
+    void progress( int resolvedCount, int layerCount );
+
+    //! Emitted once all the visible layers have been resolved
+    void visibleLayersResolved();
+
+    //! Emitted once all the layers have been resolved
+    void finished();
+
+  private:
+    struct PendingLayer
+    {
+      QPointer<QgsMapLayer> layer;
+      bool visible = false;
+    };
+
+    //! Resolves the next pending layer and schedules the one after it
+    void resolveNextLayer();
+    void resolveLayer( QgsMapLayer *layer );
+
+    QgsProject *mProject = nullptr;
+    QTimer mTimer;
+    QList<PendingLayer> mPendingLayers;
+    QList<QPointer<QgsMapLayer>> mInvalidLayers;
+    int mPendingVisibleCount = 0;
+    int mResolvedCount = 0;
+    int mLayerCount = 0;
+};
+
+#endif // LAYERRESOLVER_H
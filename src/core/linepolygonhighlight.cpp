@@ -18,16 +18,25 @@
 #include <qgsproject.h>
 
 #include "linepolygonhighlight.h"
+#include "coordinatetransformcache.h"
+#include "polygontriangulator.h"
 
 #include "qgsgeometrywrapper.h"
 #include "qgssggeometry.h"
 
+#include <cmath>
+
+//! the number of vertices above which the geometries are simplified according to the scale
+static const int SIMPLIFICATION_MINIMUM_VERTEX_COUNT = 5000;
+
 
 LinePolygonHighlight::LinePolygonHighlight( QQuickItem *parent )
   : QQuickItem( parent )
 {
   setFlags( QQuickItem::ItemHasContents );
   setAntialiasing( true );
+
+  connect( QgsProject::instance(), &QgsProject::transformContextChanged, this, &LinePolygonHighlight::mapCrsChanged );
 }
 
 QSGNode *LinePolygonHighlight::updatePaintNode( QSGNode *n, QQuickItem::UpdatePaintNodeData * )
@@ -37,21 +46,18 @@ QSGNode *LinePolygonHighlight::updatePaintNode( QSGNode *n, QQuickItem::UpdatePa
     delete n;
     n = new QSGNode;
 
-    QgsGeometry geometry;
+    PolygonTriangulator::Triangulation triangulation;
     if ( mGeometry )
     {
       Q_ASSERT( mGeometry->qgsGeometry().type() != QgsWkbTypes::PointGeometry );
 
-      geometry = QgsGeometry( mGeometry->qgsGeometry() );
-
-      if ( mMapSettings )
-      {
-        QgsCoordinateTransform ct( mGeometry->crs(), mMapSettings->destinationCrs(), QgsProject::instance()->transformContext() );
-        geometry.transform( ct );
-      }
+      // the transformed geometry and its triangles are reused as long as the geometry and the crs do not change
+      const QgsCoordinateTransform transform = CoordinateTransformCache::instance()->transform( mGeometry->crs(), mMapSettings->destinationCrs() );
+      mTolerance = levelOfDetailTolerance();
+      triangulation = PolygonTriangulator::instance()->triangulation( mGeometry->qgsGeometry(), transform, mTolerance );
     }
 
-    QgsSGGeometry *gn = new QgsSGGeometry( geometry, mColor, mWidth );
+    QgsSGGeometry *gn = new QgsSGGeometry( triangulation.geometry, triangulation.triangles, mColor, mWidth );
     gn->setFlag( QSGNode::OwnedByParent );
     n->appendChildNode( gn );
 
@@ -108,11 +114,15 @@ void LinePolygonHighlight::setMapSettings( QgsQuickMapSettings *mapSettings )
     return;
 
   if ( mMapSettings )
+  {
     disconnect( mMapSettings, &QgsQuickMapSettings::destinationCrsChanged, this, &LinePolygonHighlight::mapCrsChanged );
+    disconnect( mMapSettings, &QgsQuickMapSettings::mapUnitsPerPointChanged, this, &LinePolygonHighlight::mapScaleChanged );
+  }
 
   mMapSettings = mapSettings;
 
   connect( mMapSettings, &QgsQuickMapSettings::destinationCrsChanged, this, &LinePolygonHighlight::mapCrsChanged );
+  connect( mMapSettings, &QgsQuickMapSettings::mapUnitsPerPointChanged, this, &LinePolygonHighlight::mapScaleChanged );
 
   emit mapSettingsChanged();
 }
@@ -123,6 +133,36 @@ void LinePolygonHighlight::mapCrsChanged()
   update();
 }
 
+void LinePolygonHighlight::mapScaleChanged()
+{
+  if ( !mSimplify || mDirty )
+    return;
+
+  // refine when zooming in, but keep the finer level until the map is zoomed out by two levels
+  const double tolerance = levelOfDetailTolerance();
+  if ( tolerance < mTolerance || tolerance >= mTolerance * 4 )
+    makeDirty();
+}
+
+void LinePolygonHighlight::geometryChanged()
+{
+  mSimplify = mGeometry && mGeometry->qgsGeometry().constGet() && mGeometry->qgsGeometry().constGet()->nCoordinates() > SIMPLIFICATION_MINIMUM_VERTEX_COUNT;
+  makeDirty();
+}
+
+double LinePolygonHighlight::levelOfDetailTolerance() const
+{
+  if ( !mSimplify || !mMapSettings )
+    return 0;
+
+  // the power of two just below the size of a device pixel, so that a level is used over a range of scales
+  const double pixelSize = mMapSettings->mapUnitsPerPoint() / mMapSettings->devicePixelRatio();
+  if ( !( pixelSize > 0 ) || std::isinf( pixelSize ) )
+    return 0;
+
+  return std::pow( 2.0, std::floor( std::log2( pixelSize ) ) );
+}
+
 void LinePolygonHighlight::makeDirty()
 {
   mDirty = true;
@@ -141,7 +181,7 @@ void LinePolygonHighlight::setGeometry( QgsGeometryWrapper *geometry )
 
   if ( mGeometry )
   {
-    disconnect( mGeometry, &QgsGeometryWrapper::qgsGeometryChanged, this, &LinePolygonHighlight::makeDirty );
+    disconnect( mGeometry, &QgsGeometryWrapper::qgsGeometryChanged, this, &LinePolygonHighlight::geometryChanged );
     disconnect( mGeometry, &QgsGeometryWrapper::crsChanged, this, &LinePolygonHighlight::makeDirty );
   }
 
@@ -149,12 +189,10 @@ void LinePolygonHighlight::setGeometry( QgsGeometryWrapper *geometry )
 
   if ( mGeometry )
   {
-    connect( mGeometry, &QgsGeometryWrapper::qgsGeometryChanged, this, &LinePolygonHighlight::makeDirty );
+    connect( mGeometry, &QgsGeometryWrapper::qgsGeometryChanged, this, &LinePolygonHighlight::geometryChanged );
     connect( mGeometry, &QgsGeometryWrapper::crsChanged, this, &LinePolygonHighlight::makeDirty );
   }
 
-  mDirty = true;
+  geometryChanged();
   emit qgsGeometryChanged();
-
-  update();
 }
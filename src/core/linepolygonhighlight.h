@@ -20,6 +20,8 @@
 
 #include "qgsquickmapsettings.h"
 
+#include <qgscoordinatetransform.h>
+
 class QgsGeometryWrapper;
 class QgsGeometry;
 
@@ -27,6 +29,10 @@ class QgsGeometry;
 /**
  * LocatorHighlight allows highlighting geometries
  * on the canvas for the specific needs of the locator.
+ *
+ * Large geometries are simplified to the size of a device pixel before they are
+ * triangulated. The levels of detail are powers of two, a finer level is only used
+ * once the map is zoomed in and a coarser one once it is zoomed out by two levels.
  */
 class LinePolygonHighlight : public QQuickItem
 {
@@ -61,14 +67,23 @@ class LinePolygonHighlight : public QQuickItem
 
   private slots:
     void mapCrsChanged();
+    void mapScaleChanged();
+    void geometryChanged();
     void makeDirty();
 
   private:
     virtual QSGNode *updatePaintNode( QSGNode *n, UpdatePaintNodeData * ) override;
 
+    //! Returns the simplification tolerance for the current scale, 0 if the geometry is not simplified
+    double levelOfDetailTolerance() const;
+
     QColor mColor;
     float mWidth = 0;
     bool mDirty = false;
+    //! if the geometry has enough vertices to be simplified
+    bool mSimplify = false;
+    //! the simplification tolerance of the drawn geometry
+    double mTolerance = 0;
     QgsQuickMapSettings *mMapSettings = nullptr;
     QgsGeometryWrapper *mGeometry = nullptr;
 };
@@ -0,0 +1,600 @@
+/***************************************************************************
+  multifeaturehighlight.cpp - MultiFeatureHighlight
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "multifeaturehighlight.h"
+#include "coordinatetransformcache.h"
+#include "polygontriangulator.h"
+#include "qgsquickmapsettings.h"
+
+#include <QAbstractItemModel>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+
+#include <qgscurve.h>
+#include <qgscurvepolygon.h>
+#include <qgsexception.h>
+#include <qgsgeometrycollection.h>
+#include <qgslinestring.h>
+#include <qgsmessagelog.h>
+#include <qgsproject.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+//! the opacity of the fills relative to the color of the feature
+static const double FILL_OPACITY = 0.5;
+//! the number of vertices above which a geometry is simplified to the level of detail of the scale
+static const int SIMPLIFICATION_MINIMUM_VERTEX_COUNT = 5000;
+//! the number of segments approximating the circle of a point marker
+static const int MARKER_SEGMENTS = 16;
+//! the width of the border of the point markers in pixels
+static const double MARKER_BORDER_WIDTH = 2;
+
+namespace
+{
+  //! A premultiplied color, as expected by QSGVertexColorMaterial
+  struct VertexColor
+  {
+    VertexColor( const QColor &color, double opacity = 1.0 )
+      : r( static_cast<uchar>( color.red() * color.alphaF() * opacity ) )
+      , g( static_cast<uchar>( color.green() * color.alphaF() * opacity ) )
+      , b( static_cast<uchar>( color.blue() * color.alphaF() * opacity ) )
+      , a( static_cast<uchar>( color.alpha() * opacity ) )
+    {}
+
+    uchar r, g, b, a;
+  };
+
+  //! Appends the segments of all the curves of \a geometry, the rings of polygons included, two vertices per segment
+  void appendSegments( QVector<QSGGeometry::Point2D> &lines, const QgsAbstractGeometry *geometry )
+  {
+    if ( const QgsGeometryCollection *collection = qgsgeometry_cast<const QgsGeometryCollection *>( geometry ) )
+    {
+      for ( int i = 0; i < collection->numGeometries(); ++i )
+        appendSegments( lines, collection->geometryN( i ) );
+    }
+    else if ( const QgsCurvePolygon *polygon = qgsgeometry_cast<const QgsCurvePolygon *>( geometry ) )
+    {
+      appendSegments( lines, polygon->exteriorRing() );
+      for ( int i = 0; i < polygon->numInteriorRings(); ++i )
+        appendSegments( lines, polygon->interiorRing( i ) );
+    }
+    else if ( const QgsCurve *curve = qgsgeometry_cast<const QgsCurve *>( geometry ) )
+    {
+      std::unique_ptr<QgsLineString> segmentized;
+      const QgsLineString *line = qgsgeometry_cast<const QgsLineString *>( curve );
+      if ( !line )
+      {
+        segmentized.reset( curve->curveToLine() );
+        line = segmentized.get();
+      }
+
+      const int count = line->numPoints();
+      if ( count < 2 )
+        return;
+
+      const double *x = line->xData();
+      const double *y = line->yData();
+      const int offset = lines.size();
+      lines.resize( offset + ( count - 1 ) * 2 );
+      QSGGeometry::Point2D *vertex = lines.data() + offset;
+      for ( int i = 1; i < count; ++i )
+      {
+        ( vertex++ )->set( static_cast<float>( x[i - 1] ), static_cast<float>( y[i - 1] ) );
+        ( vertex++ )->set( static_cast<float>( x[i] ), static_cast<float>( y[i] ) );
+      }
+    }
+  }
+
+  void appendColoredVertices( QVector<QSGGeometry::ColoredPoint2D> &vertices, const QVector<QSGGeometry::Point2D> &points, const VertexColor &color )
+  {
+    const int offset = vertices.size();
+    vertices.resize( offset + points.size() );
+    QSGGeometry::ColoredPoint2D *vertex = vertices.data() + offset;
+    for ( const QSGGeometry::Point2D &point : points )
+      ( vertex++ )->set( point.x, point.y, color.r, color.g, color.b, color.a );
+  }
+
+  /**
+   * Appends the triangles of a point marker centered on \a point, a circle of \a radius filled
+   * with \a color and a border of \a borderWidth, both in map units, drawn within the circle.
+   */
+  void appendMarker( QVector<QSGGeometry::ColoredPoint2D> &vertices, const QgsPointXY &point, double radius, double borderWidth, const VertexColor &color, const VertexColor &borderColor )
+  {
+    const float x = static_cast<float>( point.x() );
+    const float y = static_cast<float>( point.y() );
+    const double innerRadius = std::max( 0.0, radius - borderWidth );
+
+    const int offset = vertices.size();
+    vertices.resize( offset + MARKER_SEGMENTS * 9 );
+    QSGGeometry::ColoredPoint2D *vertex = vertices.data() + offset;
+    for ( int i = 0; i < MARKER_SEGMENTS; ++i )
+    {
+      const double angle1 = 2 * M_PI * i / MARKER_SEGMENTS;
+      const double angle2 = 2 * M_PI * ( i + 1 ) / MARKER_SEGMENTS;
+      const float innerX1 = x + static_cast<float>( innerRadius * std::cos( angle1 ) );
+      const float innerY1 = y + static_cast<float>( innerRadius * std::sin( angle1 ) );
+      const float innerX2 = x + static_cast<float>( innerRadius * std::cos( angle2 ) );
+      const float innerY2 = y + static_cast<float>( innerRadius * std::sin( angle2 ) );
+      const float outerX1 = x + static_cast<float>( radius * std::cos( angle1 ) );
+      const float outerY1 = y + static_cast<float>( radius * std::sin( angle1 ) );
+      const float outerX2 = x + static_cast<float>( radius * std::cos( angle2 ) );
+      const float outerY2 = y + static_cast<float>( radius * std::sin( angle2 ) );
+
+      ( vertex++ )->set( x, y, color.r, color.g, color.b, color.a );
+      ( vertex++ )->set( innerX1, innerY1, color.r, color.g, color.b, color.a );
+      ( vertex++ )->set( innerX2, innerY2, color.r, color.g, color.b, color.a );
+
+      ( vertex++ )->set( innerX1, innerY1, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+      ( vertex++ )->set( outerX1, outerY1, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+      ( vertex++ )->set( outerX2, outerY2, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+      ( vertex++ )->set( innerX1, innerY1, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+      ( vertex++ )->set( outerX2, outerY2, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+      ( vertex++ )->set( innerX2, innerY2, borderColor.r, borderColor.g, borderColor.b, borderColor.a );
+    }
+  }
+
+  void uploadVertices( QSGGeometryNode *node, const QVector<QSGGeometry::ColoredPoint2D> &vertices )
+  {
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate( vertices.size() );
+    std::copy( vertices.constBegin(), vertices.constEnd(), geometry->vertexDataAsColoredPoint2D() );
+    node->markDirty( QSGNode::DirtyGeometry );
+  }
+
+  QSGGeometryNode *createNode( QSGGeometry::DrawingMode mode )
+  {
+    QSGGeometry *geometry = new QSGGeometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+    geometry->setDrawingMode( mode );
+
+    QSGGeometryNode *node = new QSGGeometryNode;
+    node->setGeometry( geometry );
+    node->setFlag( QSGNode::OwnsGeometry );
+    node->setMaterial( new QSGVertexColorMaterial );
+    node->setFlag( QSGNode::OwnsMaterial );
+    return node;
+  }
+}
+
+MultiFeatureHighlight::MultiFeatureHighlight( QQuickItem *parent )
+  : QQuickItem( parent )
+{
+  setFlags( QQuickItem::ItemHasContents );
+  setAntialiasing( true );
+
+  connect( QgsProject::instance(), &QgsProject::transformContextChanged, this, &MultiFeatureHighlight::invalidateRows );
+}
+
+QAbstractItemModel *MultiFeatureHighlight::model() const
+{
+  return mModel;
+}
+
+void MultiFeatureHighlight::setModel( QAbstractItemModel *model )
+{
+  if ( mModel == model )
+    return;
+
+  if ( mModel )
+    disconnect( mModel, nullptr, this, nullptr );
+
+  mModel = model;
+
+  if ( mModel )
+  {
+    connect( mModel, &QAbstractItemModel::rowsInserted, this, &MultiFeatureHighlight::onRowsInserted );
+    connect( mModel, &QAbstractItemModel::rowsRemoved, this, &MultiFeatureHighlight::onRowsRemoved );
+    connect( mModel, &QAbstractItemModel::dataChanged, this, &MultiFeatureHighlight::onDataChanged );
+    connect( mModel, &QAbstractItemModel::modelReset, this, &MultiFeatureHighlight::resetRows );
+    connect( mModel, &QAbstractItemModel::layoutChanged, this, &MultiFeatureHighlight::resetRows );
+    connect( mModel, &QAbstractItemModel::rowsMoved, this, &MultiFeatureHighlight::resetRows );
+  }
+
+  resetRows();
+
+  emit modelChanged();
+}
+
+QgsQuickMapSettings *MultiFeatureHighlight::mapSettings() const
+{
+  return mMapSettings;
+}
+
+void MultiFeatureHighlight::setMapSettings( QgsQuickMapSettings *mapSettings )
+{
+  if ( mMapSettings == mapSettings )
+    return;
+
+  if ( mMapSettings )
+  {
+    disconnect( mMapSettings, &QgsQuickMapSettings::destinationCrsChanged, this, &MultiFeatureHighlight::invalidateRows );
+    disconnect( mMapSettings, &QgsQuickMapSettings::mapUnitsPerPointChanged, this, &MultiFeatureHighlight::onMapScaleChanged );
+  }
+
+  mMapSettings = mapSettings;
+
+  if ( mMapSettings )
+  {
+    connect( mMapSettings, &QgsQuickMapSettings::destinationCrsChanged, this, &MultiFeatureHighlight::invalidateRows );
+    connect( mMapSettings, &QgsQuickMapSettings::mapUnitsPerPointChanged, this, &MultiFeatureHighlight::onMapScaleChanged );
+  }
+
+  invalidateRows();
+
+  emit mapSettingsChanged();
+}
+
+QColor MultiFeatureHighlight::color() const
+{
+  return mColor;
+}
+
+void MultiFeatureHighlight::setColor( const QColor &color )
+{
+  if ( mColor == color )
+    return;
+
+  mColor = color;
+  markDirty();
+
+  emit colorChanged();
+}
+
+QColor MultiFeatureHighlight::selectedColor() const
+{
+  return mSelectedColor;
+}
+
+void MultiFeatureHighlight::setSelectedColor( const QColor &color )
+{
+  if ( mSelectedColor == color )
+    return;
+
+  mSelectedColor = color;
+  markDirty();
+
+  emit selectedColorChanged();
+}
+
+QColor MultiFeatureHighlight::focusedColor() const
+{
+  return mFocusedColor;
+}
+
+void MultiFeatureHighlight::setFocusedColor( const QColor &color )
+{
+  if ( mFocusedColor == color )
+    return;
+
+  mFocusedColor = color;
+  markDirty();
+
+  emit focusedColorChanged();
+}
+
+int MultiFeatureHighlight::focusedRow() const
+{
+  return mFocusedRow;
+}
+
+void MultiFeatureHighlight::setFocusedRow( int row )
+{
+  if ( mFocusedRow == row )
+    return;
+
+  mFocusedRow = row;
+  markDirty();
+
+  emit focusedRowChanged();
+}
+
+double MultiFeatureHighlight::lineWidth() const
+{
+  return mLineWidth;
+}
+
+void MultiFeatureHighlight::setLineWidth( double width )
+{
+  if ( qgsDoubleNear( mLineWidth, width ) )
+    return;
+
+  mLineWidth = width;
+  markDirty();
+
+  emit lineWidthChanged();
+}
+
+double MultiFeatureHighlight::pointSize() const
+{
+  return mPointSize;
+}
+
+void MultiFeatureHighlight::setPointSize( double size )
+{
+  if ( qgsDoubleNear( mPointSize, size ) )
+    return;
+
+  mPointSize = size;
+  markDirty();
+
+  emit pointSizeChanged();
+}
+
+QColor MultiFeatureHighlight::pointBorderColor() const
+{
+  return mPointBorderColor;
+}
+
+void MultiFeatureHighlight::setPointBorderColor( const QColor &color )
+{
+  if ( mPointBorderColor == color )
+    return;
+
+  mPointBorderColor = color;
+  markDirty();
+
+  emit pointBorderColorChanged();
+}
+
+void MultiFeatureHighlight::onRowsInserted( const QModelIndex &parent, int first, int last )
+{
+  if ( parent.isValid() )
+    return;
+
+  mRows.insert( first, last - first + 1, Row() );
+  for ( int i = first; i <= last; ++i )
+    mRows[i] = createRow( i );
+
+  markDirty();
+}
+
+void MultiFeatureHighlight::onRowsRemoved( const QModelIndex &parent, int first, int last )
+{
+  if ( parent.isValid() )
+    return;
+
+  mRows.remove( first, last - first + 1 );
+
+  markDirty();
+}
+
+void MultiFeatureHighlight::onDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles )
+{
+  if ( topLeft.parent().isValid() )
+    return;
+
+  const bool geometryChanged = roles.isEmpty() || roles.contains( mGeometryRole ) || roles.contains( mCrsRole );
+  for ( int i = topLeft.row(); i <= bottomRight.row() && i < mRows.size(); ++i )
+  {
+    if ( geometryChanged )
+    {
+      mRows[i] = createRow( i );
+    }
+    else if ( mSelectedRole >= 0 )
+    {
+      // the selection only changes the colors
+      mRows[i].selected = mModel->index( i, 0 ).data( mSelectedRole ).toBool();
+    }
+  }
+
+  markDirty();
+}
+
+void MultiFeatureHighlight::resetRows()
+{
+  mRows.clear();
+
+  if ( mModel )
+  {
+    const QHash<int, QByteArray> roleNames = mModel->roleNames();
+    mGeometryRole = roleNames.key( QByteArrayLiteral( "geometry" ), -1 );
+    mCrsRole = roleNames.key( QByteArrayLiteral( "crs" ), -1 );
+    mSelectedRole = roleNames.key( QByteArrayLiteral( "featureSelected" ), -1 );
+
+    const int rowCount = mModel->rowCount();
+    mRows.reserve( rowCount );
+    for ( int i = 0; i < rowCount; ++i )
+      mRows << createRow( i );
+  }
+
+  markDirty();
+}
+
+void MultiFeatureHighlight::invalidateRows()
+{
+  for ( Row &row : mRows )
+    row.dirty = true;
+
+  markDirty();
+}
+
+void MultiFeatureHighlight::onMapScaleChanged()
+{
+  const double tolerance = levelOfDetailTolerance();
+  bool changed = false;
+  for ( Row &row : mRows )
+  {
+    // the markers have a size in pixels, a simplified row only changes its level of detail when zoomed in or zoomed out by two levels
+    if ( !row.points.isEmpty() )
+      changed = true;
+    else if ( row.simplify && ( tolerance < row.tolerance || tolerance >= row.tolerance * 4 ) )
+      row.dirty = changed = true;
+  }
+
+  if ( changed )
+    markDirty();
+}
+
+MultiFeatureHighlight::Row MultiFeatureHighlight::createRow( int row ) const
+{
+  Row result;
+  if ( !mModel || mGeometryRole < 0 )
+    return result;
+
+  const QModelIndex index = mModel->index( row, 0 );
+  result.geometry = index.data( mGeometryRole ).value<QgsGeometry>();
+  if ( mCrsRole >= 0 )
+    result.crs = index.data( mCrsRole ).value<QgsCoordinateReferenceSystem>();
+  if ( mSelectedRole >= 0 )
+    result.selected = index.data( mSelectedRole ).toBool();
+
+  return result;
+}
+
+void MultiFeatureHighlight::updateRowVertices( Row &row ) const
+{
+  row.lines.clear();
+  row.triangles.clear();
+  row.points.clear();
+  row.simplify = false;
+  row.tolerance = 0;
+  row.dirty = false;
+
+  if ( row.geometry.isNull() )
+    return;
+
+  const QgsCoordinateTransform transform = CoordinateTransformCache::instance()->transform( row.crs, mMapSettings->destinationCrs() );
+  const QgsWkbTypes::GeometryType type = row.geometry.type();
+  if ( type == QgsWkbTypes::PointGeometry )
+  {
+    for ( auto it = row.geometry.vertices_begin(); it != row.geometry.vertices_end(); ++it )
+    {
+      try
+      {
+        row.points << transform.transform( ( *it ).x(), ( *it ).y() );
+      }
+      catch ( const QgsCsException &e )
+      {
+        QgsMessageLog::logMessage( QStringLiteral( "Transform error caught: %1" ).arg( e.what() ), QStringLiteral( "QField" ) );
+      }
+    }
+    return;
+  }
+
+  if ( type != QgsWkbTypes::LineGeometry && type != QgsWkbTypes::PolygonGeometry )
+    return;
+
+  // the transformed geometry and its triangles are shared with the other highlights through the cache
+  row.simplify = row.geometry.constGet()->nCoordinates() > SIMPLIFICATION_MINIMUM_VERTEX_COUNT;
+  row.tolerance = row.simplify ? levelOfDetailTolerance() : 0;
+  const PolygonTriangulator::Triangulation triangulation = PolygonTriangulator::instance()->triangulation( row.geometry, transform, row.tolerance );
+
+  if ( type == QgsWkbTypes::PolygonGeometry )
+    row.triangles = triangulation.triangles;
+
+  appendSegments( row.lines, triangulation.geometry.constGet() );
+}
+
+double MultiFeatureHighlight::levelOfDetailTolerance() const
+{
+  if ( !mMapSettings )
+    return 0;
+
+  // a power of two, the same level of detail is kept over a range of scales
+  const double pixelSize = mMapSettings->mapUnitsPerPoint() / mMapSettings->devicePixelRatio();
+  if ( !( pixelSize > 0 ) || std::isinf( pixelSize ) )
+    return 0;
+
+  return std::pow( 2.0, std::floor( std::log2( pixelSize ) ) );
+}
+
+void MultiFeatureHighlight::markDirty()
+{
+  mDirty = true;
+  polish();
+  update();
+}
+
+void MultiFeatureHighlight::updatePolish()
+{
+  if ( !mDirty )
+    return;
+
+  mFillVertices.clear();
+  mLineVertices.clear();
+  mMarkerVertices.clear();
+
+  if ( mMapSettings )
+  {
+    // only the rows changed since the last update are transformed again
+    int lineVertexCount = 0;
+    int triangleVertexCount = 0;
+    int pointCount = 0;
+    for ( Row &row : mRows )
+    {
+      if ( row.dirty )
+        updateRowVertices( row );
+
+      lineVertexCount += row.lines.size();
+      triangleVertexCount += row.triangles.size();
+      pointCount += row.points.size();
+    }
+
+    mFillVertices.reserve( triangleVertexCount );
+    mLineVertices.reserve( lineVertexCount );
+    mMarkerVertices.reserve( pointCount * MARKER_SEGMENTS * 9 );
+
+    const double mapUnitsPerPoint = mMapSettings->mapUnitsPerPoint();
+    const double radius = mPointSize / 2 * mapUnitsPerPoint;
+    const double borderWidth = MARKER_BORDER_WIDTH * mapUnitsPerPoint;
+    const VertexColor borderColor( mPointBorderColor );
+    for ( int i = 0; i < mRows.size(); ++i )
+    {
+      const Row &row = mRows.at( i );
+      const QColor &color = row.selected ? mSelectedColor : i == mFocusedRow ? mFocusedColor : mColor;
+
+      appendColoredVertices( mFillVertices, row.triangles, VertexColor( color, FILL_OPACITY ) );
+      appendColoredVertices( mLineVertices, row.lines, VertexColor( color ) );
+      for ( const QgsPointXY &point : row.points )
+        appendMarker( mMarkerVertices, point, radius, borderWidth, VertexColor( color ), borderColor );
+    }
+  }
+
+  mDirty = false;
+  mBuffersChanged = true;
+
+  emit updated();
+}
+
+QSGNode *MultiFeatureHighlight::updatePaintNode( QSGNode *node, QQuickItem::UpdatePaintNodeData * )
+{
+  if ( !node )
+  {
+    node = new QSGNode;
+    // the fills below the outlines, the point markers on top
+    node->appendChildNode( createNode( QSGGeometry::DrawTriangles ) );
+    node->appendChildNode( createNode( QSGGeometry::DrawLines ) );
+    node->appendChildNode( createNode( QSGGeometry::DrawTriangles ) );
+    mBuffersChanged = true;
+  }
+
+  if ( !mBuffersChanged )
+    return node;
+
+  // the buffers have been merged on the GUI thread, which is blocked while they are copied
+  QSGGeometryNode *fillNode = static_cast<QSGGeometryNode *>( node->childAtIndex( 0 ) );
+  QSGGeometryNode *lineNode = static_cast<QSGGeometryNode *>( node->childAtIndex( 1 ) );
+  QSGGeometryNode *markerNode = static_cast<QSGGeometryNode *>( node->childAtIndex( 2 ) );
+
+  uploadVertices( fillNode, mFillVertices );
+  uploadVertices( lineNode, mLineVertices );
+  lineNode->geometry()->setLineWidth( static_cast<float>( mLineWidth ) );
+  uploadVertices( markerNode, mMarkerVertices );
+
+  mBuffersChanged = false;
+
+  return node;
+}
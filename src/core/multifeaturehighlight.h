@@ -0,0 +1,201 @@
+/***************************************************************************
+  multifeaturehighlight.h - MultiFeatureHighlight
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef MULTIFEATUREHIGHLIGHT_H
+#define MULTIFEATUREHIGHLIGHT_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+#include <QtQuick/QSGGeometry>
+
+#include <qgscoordinatereferencesystem.h>
+#include <qgsgeometry.h>
+
+class QAbstractItemModel;
+class QgsQuickMapSettings;
+
+/**
+ * The MultiFeatureHighlight item highlights the geometries of all the rows of a feature model,
+ * e.g. a MultiFeatureListModel, in a single scene graph node.
+ *
+ * The model has to provide the geometry and crs roles and may provide the featureSelected role.
+ * The outlines of all the features are merged into one vertex buffer, the fills into another one
+ * and the point markers, circles with a border, into a third one. The colors are stored per vertex.
+ *
+ * The rows are processed on the GUI thread, in updatePolish(). Each row keeps its transformed
+ * vertices, when rows are added, removed or changed only those rows are processed again before
+ * the buffers are merged. Lines and polygons are transformed and triangulated through the
+ * PolygonTriangulator cache, large geometries are simplified to the level of detail of the
+ * current scale like in the LinePolygonHighlight. The render thread only uploads the buffers.
+ *
+ * Like the LinePolygonHighlight, the item draws in map coordinates and is expected to be
+ * transformed with a MapTransform.
+ */
+class MultiFeatureHighlight : public QQuickItem
+{
+    Q_OBJECT
+
+    //! the model providing the features to highlight
+    Q_PROPERTY( QAbstractItemModel *model READ model WRITE setModel NOTIFY modelChanged )
+    //! Map settings is used to get the destination crs
+    Q_PROPERTY( QgsQuickMapSettings *mapSettings READ mapSettings WRITE setMapSettings NOTIFY mapSettingsChanged )
+    //! the color of the features
+    Q_PROPERTY( QColor color READ color WRITE setColor NOTIFY colorChanged )
+    //! the color of the selected features
+    Q_PROPERTY( QColor selectedColor READ selectedColor WRITE setSelectedColor NOTIFY selectedColorChanged )
+    //! the color of the feature of the focused row
+    Q_PROPERTY( QColor focusedColor READ focusedColor WRITE setFocusedColor NOTIFY focusedColorChanged )
+    //! the row of the focused feature, -1 if none
+    Q_PROPERTY( int focusedRow READ focusedRow WRITE setFocusedRow NOTIFY focusedRowChanged )
+    //! the width of the outlines in pixels
+    Q_PROPERTY( double lineWidth READ lineWidth WRITE setLineWidth NOTIFY lineWidthChanged )
+    //! the diameter of the point markers in pixels
+    Q_PROPERTY( double pointSize READ pointSize WRITE setPointSize NOTIFY pointSizeChanged )
+    //! the border color of the point markers
+    Q_PROPERTY( QColor pointBorderColor READ pointBorderColor WRITE setPointBorderColor NOTIFY pointBorderColorChanged )
+
+  public:
+    explicit MultiFeatureHighlight( QQuickItem *parent = nullptr );
+
+    //! \copydoc model
+    QAbstractItemModel *model() const;
+    //! \copydoc model
+    void setModel( QAbstractItemModel *model );
+
+    //! \copydoc mapSettings
+    QgsQuickMapSettings *mapSettings() const;
+    //! \copydoc mapSettings
+    void setMapSettings( QgsQuickMapSettings *mapSettings );
+
+    //! \copydoc color
+    QColor color() const;
+    //! \copydoc color
+    void setColor( const QColor &color );
+
+    //! \copydoc selectedColor
+    QColor selectedColor() const;
+    //! \copydoc selectedColor
+    void setSelectedColor( const QColor &color );
+
+    //! \copydoc focusedColor
+    QColor focusedColor() const;
+    //! \copydoc focusedColor
+    void setFocusedColor( const QColor &color );
+
+    //! \copydoc focusedRow
+    int focusedRow() const;
+    //! \copydoc focusedRow
+    void setFocusedRow( int row );
+
+    //! \copydoc lineWidth
+    double lineWidth() const;
+    //! \copydoc lineWidth
+    void setLineWidth( double width );
+
+    //! \copydoc pointSize
+    double pointSize() const;
+    //! \copydoc pointSize
+    void setPointSize( double size );
+
+    //! \copydoc pointBorderColor
+    QColor pointBorderColor() const;
+    //! \copydoc pointBorderColor
+    void setPointBorderColor( const QColor &color );
+
+  signals:
+    void modelChanged();
+    void mapSettingsChanged();
+    void colorChanged();
+    void selectedColorChanged();
+    void focusedColorChanged();
+    void focusedRowChanged();
+    void lineWidthChanged();
+    void pointSizeChanged();
+    void pointBorderColorChanged();
+
+    //! Emitted when the buffers have been updated
+    void updated();
+
+  protected:
+    void updatePolish() override;
+    QSGNode *updatePaintNode( QSGNode *node, UpdatePaintNodeData *data ) override;
+
+  private slots:
+    void onRowsInserted( const QModelIndex &parent, int first, int last );
+    void onRowsRemoved( const QModelIndex &parent, int first, int last );
+    void onDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles );
+    void resetRows();
+    //! Transforms all the rows again, e.g. after the destination crs has changed
+    void invalidateRows();
+    //! Updates the point markers and the level of detail of the simplified rows
+    void onMapScaleChanged();
+
+  private:
+    struct Row
+    {
+      QgsGeometry geometry;
+      QgsCoordinateReferenceSystem crs;
+      bool selected = false;
+      //! if the vertices have to be computed again
+      bool dirty = true;
+      //! the segments of the outlines, two vertices per segment
+      QVector<QSGGeometry::Point2D> lines;
+      //! the triangles of the polygons, three vertices per triangle
+      QVector<QSGGeometry::Point2D> triangles;
+      //! the points, in destination map coordinates
+      QVector<QgsPointXY> points;
+      //! if the geometry is large enough to be simplified
+      bool simplify = false;
+      //! the simplification tolerance the vertices have been computed with
+      double tolerance = 0;
+    };
+
+    Row createRow( int row ) const;
+    //! Transforms the geometry of \a row into the destination crs and computes its vertices
+    void updateRowVertices( Row &row ) const;
+    //! Returns the simplification tolerance for the current scale
+    double levelOfDetailTolerance() const;
+    //! Schedules the buffers to be merged again in the next polish
+    void markDirty();
+
+    QPointer<QAbstractItemModel> mModel;
+    QPointer<QgsQuickMapSettings> mMapSettings;
+    QColor mColor = QColor( 255, 255, 0 );
+    QColor mSelectedColor = QColor( 0, 255, 0 );
+    QColor mFocusedColor = QColor( 255, 0, 0 );
+    int mFocusedRow = -1;
+    double mLineWidth = 8;
+    double mPointSize = 20;
+    QColor mPointBorderColor = QColor( 255, 255, 255 );
+
+    int mGeometryRole = -1;
+    int mCrsRole = -1;
+    int mSelectedRole = -1;
+
+    //! the rows of the model, in the same order
+    QVector<Row> mRows;
+    bool mDirty = false;
+
+    //! the merged buffers, built on the GUI thread and uploaded on the render thread
+    QVector<QSGGeometry::ColoredPoint2D> mFillVertices;
+    QVector<QSGGeometry::ColoredPoint2D> mLineVertices;
+    QVector<QSGGeometry::ColoredPoint2D> mMarkerVertices;
+    bool mBuffersChanged = false;
+
+    friend class TestMultiFeatureHighlight;
+};
+
+#endif // MULTIFEATUREHIGHLIGHT_H
@@ -36,6 +36,23 @@ MultiFeatureListModel::MultiFeatureListModel( QObject *parent )
   connect( mSourceModel, &MultiFeatureListModelBase::modelReset, this, &MultiFeatureListModel::countChanged );
   connect( mSourceModel, &MultiFeatureListModelBase::countChanged, this, &MultiFeatureListModel::countChanged );
   connect( mSourceModel, &MultiFeatureListModelBase::selectedCountChanged, this, &MultiFeatureListModel::adjustFilterToSelectedCount);
+  connect( mSourceModel, &MultiFeatureListModelBase::isMergingChanged, this, &MultiFeatureListModel::isMergingChanged );
+  connect( mSourceModel, &MultiFeatureListModelBase::mergeProgressChanged, this, &MultiFeatureListModel::mergeProgressChanged );
+  connect( mSourceModel, &MultiFeatureListModelBase::mergeSelectionFinished, this, &MultiFeatureListModel::mergeSelectionFinished );
+}
+
+FeatureCommitQueue *MultiFeatureListModel::commitQueue() const
+{
+  return mSourceModel->commitQueue();
+}
+
+void MultiFeatureListModel::setCommitQueue( FeatureCommitQueue *commitQueue )
+{
+  if ( commitQueue == mSourceModel->commitQueue() )
+    return;
+
+  mSourceModel->setCommitQueue( commitQueue );
+  emit commitQueueChanged();
 }
 
 void MultiFeatureListModel::setFeatures( const QMap<QgsVectorLayer *, QgsFeatureRequest> requests )
@@ -93,6 +110,21 @@ bool MultiFeatureListModel::mergeSelection()
   return mSourceModel->mergeSelection();
 }
 
+void MultiFeatureListModel::cancelMerge()
+{
+  mSourceModel->cancelMerge();
+}
+
+bool MultiFeatureListModel::isMerging() const
+{
+  return mSourceModel->isMerging();
+}
+
+double MultiFeatureListModel::mergeProgress() const
+{
+  return mSourceModel->mergeProgress();
+}
+
 bool MultiFeatureListModel::deleteFeature( QgsVectorLayer *layer, QgsFeatureId fid )
 {
   return mSourceModel->deleteFeature( layer, fid );
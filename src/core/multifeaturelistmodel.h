@@ -25,6 +25,8 @@
 #include "identifytool.h"
 #include "multifeaturelistmodelbase.h"
 
+class FeatureCommitQueue;
+
 class MultiFeatureListModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -35,6 +37,10 @@ class MultiFeatureListModel : public QSortFilterProxyModel
     Q_PROPERTY( bool canEditAttributesSelection READ canEditAttributesSelection NOTIFY selectedCountChanged  )
     Q_PROPERTY( bool canMergeSelection READ canMergeSelection NOTIFY selectedCountChanged  )
     Q_PROPERTY( bool canDeleteSelection READ canDeleteSelection NOTIFY selectedCountChanged  )
+    Q_PROPERTY( bool isMerging READ isMerging NOTIFY isMergingChanged )
+    Q_PROPERTY( double mergeProgress READ mergeProgress NOTIFY mergeProgressChanged )
+    //! the queue whose pending edits are committed before the features are edited
+    Q_PROPERTY( FeatureCommitQueue *commitQueue READ commitQueue WRITE setCommitQueue NOTIFY commitQueueChanged )
 
   public:
     enum FeatureListRoles
@@ -52,6 +58,11 @@ class MultiFeatureListModel : public QSortFilterProxyModel
 
     explicit MultiFeatureListModel( QObject *parent = nullptr );
 
+    //! \copydoc commitQueue
+    FeatureCommitQueue *commitQueue() const;
+    //! \copydoc commitQueue
+    void setCommitQueue( FeatureCommitQueue *commitQueue );
+
     /**
      * Resets the model to contain features found from a list of \a requests.
      */
@@ -98,9 +109,22 @@ class MultiFeatureListModel : public QSortFilterProxyModel
      *
      * All but the first feature will then be removed from the vector layer containing
      * the selected features.
+     *
+     * The union is computed in a background task, mergeSelectionFinished() is emitted
+     * once the features have been merged.
+     * \returns TRUE if the merge has been started
      */
     Q_INVOKABLE bool mergeSelection();
 
+    //! Cancels the running merge, mergeSelectionFinished() will be emitted with a failure
+    Q_INVOKABLE void cancelMerge();
+
+    //! Returns TRUE while a merge is running
+    bool isMerging() const;
+
+    //! Returns the progress of the running merge, between 0 and 100
+    double mergeProgress() const;
+
     /**
      * Deletes a feature from a vector layer
      *
@@ -127,8 +151,17 @@ class MultiFeatureListModel : public QSortFilterProxyModel
 
     void countChanged();
 
+    void commitQueueChanged();
+
     void selectedCountChanged();
 
+    void isMergingChanged();
+
+    void mergeProgressChanged();
+
+    //! Emitted when a merge started by mergeSelection() has ended
+    void mergeSelectionFinished( bool success );
+
   protected:
 
     virtual bool filterAcceptsRow( int source_row, const QModelIndex &source_parent ) const override;
@@ -21,11 +21,17 @@
 #include <qgsgeometry.h>
 #include <qgscoordinatereferencesystem.h>
 #include <qgsrelationmanager.h>
+#include <qgsexpression.h>
 #include <qgsmessagelog.h>
+#include <qgsapplication.h>
+#include <qgsfeedback.h>
+#include <qgstransaction.h>
 
 #include "multifeaturelistmodel.h"
 #include "multifeaturelistmodelbase.h"
+#include "featurecommitqueue.h"
 #include "featureutils.h"
+#include "geometryutils.h"
 
 #include <QDebug>
 
@@ -35,6 +41,22 @@ MultiFeatureListModelBase::MultiFeatureListModelBase( QObject *parent )
   connect( this, &MultiFeatureListModelBase::modelReset, this, &MultiFeatureListModelBase::countChanged );
 }
 
+FeatureCommitQueue *MultiFeatureListModelBase::commitQueue() const
+{
+  return mCommitQueue;
+}
+
+void MultiFeatureListModelBase::setCommitQueue( FeatureCommitQueue *commitQueue )
+{
+  mCommitQueue = commitQueue;
+}
+
+void MultiFeatureListModelBase::flushCommitQueue( QgsVectorLayer *layer )
+{
+  if ( mCommitQueue )
+    mCommitQueue->flush( layer );
+}
+
 void MultiFeatureListModelBase::setFeatures( const QMap<QgsVectorLayer *, QgsFeatureRequest> requests )
 {
   beginResetModel();
@@ -320,58 +342,123 @@ bool MultiFeatureListModelBase::canDeleteSelection()
          !vlayer->customProperty( QStringLiteral( "QFieldSync/is_geometry_locked" ), false ).toBool();
 }
 
-bool MultiFeatureListModelBase::mergeSelection()
+/**
+ * Computes the union of geometries for MultiFeatureListModelBase::mergeSelection()
+ */
+class GeometryUnionTask : public QgsTask
 {
-  if ( !canMergeSelection() )
-    return false;
-
-  QList< QPair< QgsVectorLayer *, QgsFeature > > selectedFeatures = mSelectedFeatures;
-  QgsVectorLayer *vlayer = selectedFeatures[0].first;
-  bool isSuccess = true;
-  QgsGeometry combinedGeometry;
-  for ( const auto &pair : selectedFeatures )
-  {
-    if ( combinedGeometry.isEmpty() )
+  public:
+    explicit GeometryUnionTask( const QVector<QgsGeometry> &geometries )
+      : QgsTask( QObject::tr( "Merging geometries" ) )
+      , mGeometries( geometries )
     {
-      combinedGeometry = pair.second.geometry();
-      continue;
     }
 
-    QgsGeometry geom = combinedGeometry.combine( pair.second.geometry() );
-    if ( combinedGeometry.lastError().isEmpty() )
+    void cancel() override
     {
-      combinedGeometry = geom;
+      mFeedback.cancel();
+      QgsTask::cancel();
     }
-    else
+
+    QgsGeometry result() const { return mResult; }
+
+  protected:
+    bool run() override
     {
-      isSuccess = false;
-      break;
+      QObject::connect( &mFeedback, &QgsFeedback::progressChanged, [this]( double progress ) { setProgress( progress ); } );
+      mResult = GeometryUtils::unaryUnion( mGeometries, &mFeedback );
+      return !mResult.isNull() && !mFeedback.isCanceled();
     }
-  }
 
+  private:
+    QVector<QgsGeometry> mGeometries;
+    QgsGeometry mResult;
+    QgsFeedback mFeedback;
+};
+
+bool MultiFeatureListModelBase::mergeSelection()
+{
+  if ( !canMergeSelection() || mMergeTask )
+    return false;
+
+  mMergeFeatures = mSelectedFeatures;
+  mMergeLayer = mMergeFeatures[0].first;
+
+  QVector<QgsGeometry> geometries;
+  geometries.reserve( mMergeFeatures.size() );
+  for ( const auto &pair : qgis::as_const( mMergeFeatures ) )
+    geometries << pair.second.geometry();
+
+  GeometryUnionTask *task = new GeometryUnionTask( geometries );
+  connect( task, &QgsTask::progressChanged, this, [this]( double progress )
+  {
+    mMergeProgress = progress;
+    emit mergeProgressChanged();
+  } );
+  connect( task, &QgsTask::taskCompleted, this, [this, task]() { finishMerge( task->result() ); } );
+  connect( task, &QgsTask::taskTerminated, this, [this]() { finishMerge( QgsGeometry() ); } );
+
+  mMergeTask = task;
+  mMergeProgress = 0.0;
+  emit mergeProgressChanged();
+  emit isMergingChanged();
+
+  QgsApplication::taskManager()->addTask( task );
+  return true;
+}
+
+void MultiFeatureListModelBase::cancelMerge()
+{
+  if ( mMergeTask )
+    mMergeTask->cancel();
+}
+
+bool MultiFeatureListModelBase::isMerging() const
+{
+  return !mMergeTask.isNull();
+}
+
+double MultiFeatureListModelBase::mergeProgress() const
+{
+  return mMergeProgress;
+}
+
+void MultiFeatureListModelBase::finishMerge( const QgsGeometry &combinedGeometry )
+{
+  QList< QPair< QgsVectorLayer *, QgsFeature > > selectedFeatures = mMergeFeatures;
+  QgsVectorLayer *vlayer = mMergeLayer;
+  mMergeFeatures.clear();
+  mMergeTask = nullptr;
+
+  bool isSuccess = !combinedGeometry.isNull() && vlayer;
+  std::unique_ptr<QgsTransaction> transaction;
   if ( isSuccess )
   {
+    transaction = beginTransaction( vlayer );
     if ( ! vlayer->startEditing() )
     {
       QgsMessageLog::logMessage( tr( "Cannot start editing" ), "QField", Qgis::Warning );
-      return false;
+      isSuccess = false;
     }
+  }
 
+  if ( isSuccess )
+  {
     QgsFeature mergedFeature = selectedFeatures[0].second;
-    mergedFeature.setGeometry( combinedGeometry );
+    QgsGeometry mergedGeometry = combinedGeometry;
+    if ( QgsWkbTypes::isMultiType( vlayer->wkbType() ) )
+      mergedGeometry.convertToMultiType();
+    mergedFeature.setGeometry( mergedGeometry );
     isSuccess = vlayer->updateFeature( mergedFeature );
 
     if ( isSuccess )
     {
       selectedFeatures.removeFirst();
+      QgsFeatureIds fids;
       for ( const auto &pair : qgis::as_const( selectedFeatures ) )
-      {
-        isSuccess = deleteFeature( pair.first, pair.second.id(), true );
-        if ( !isSuccess )
-        {
-          break;
-        }
-      }
+        fids << pair.second.id();
+
+      isSuccess = deleteFeatures( vlayer, fids, true );
     }
 
     if ( isSuccess )
@@ -380,20 +467,28 @@ bool MultiFeatureListModelBase::mergeSelection()
       isSuccess = vlayer->commitChanges();
     }
 
-    if ( !isSuccess )
+    if ( !isSuccess && vlayer->isEditable() )
     {
       if ( !vlayer->rollBack() )
         QgsMessageLog::logMessage( tr( "Cannot rollback layer changes in layer %1" ).arg( vlayer->name() ), "QField", Qgis::Critical );
     }
   }
 
+  if ( vlayer )
+    isSuccess = endTransaction( transaction.get(), isSuccess, vlayer );
+
   mSelectedFeatures.clear();
   emit selectedCountChanged();
-
-  return isSuccess;
+  emit isMergingChanged();
+  emit mergeSelectionFinished( isSuccess );
 }
 
 bool MultiFeatureListModelBase::deleteFeature( QgsVectorLayer *layer, QgsFeatureId fid, bool selectionAction )
+{
+  return deleteFeatures( layer, QgsFeatureIds() << fid, selectionAction );
+}
+
+bool MultiFeatureListModelBase::deleteFeatures( QgsVectorLayer *layer, const QgsFeatureIds &fids, bool selectionAction )
 {
   if ( !layer )
   {
@@ -401,122 +496,238 @@ bool MultiFeatureListModelBase::deleteFeature( QgsVectorLayer *layer, QgsFeature
     return false;
   }
 
+  //delete child features in case of compositions
+  const QList<QgsRelation> relations = compositionRelations( layer );
+
+  std::unique_ptr<QgsTransaction> transaction;
   if ( !selectionAction )
   {
+    transaction = beginTransaction( layer );
     if ( ! layer->startEditing() )
     {
       QgsMessageLog::logMessage( tr( "Cannot start editing" ), "QField", Qgis::Warning );
+      endTransaction( transaction.get(), false, layer );
       return false;
     }
   }
 
-  //delete child features in case of compositions
-  const QList<QgsRelation> referencingRelations = QgsProject::instance()->relationManager()->referencedRelations( layer );
+  // fetch all the parent features at once, only their attributes are needed to find the children
+  QgsFeatureList parentFeatures;
+  if ( !relations.isEmpty() )
+  {
+    QgsFeatureIterator parentFeaturesIt = layer->getFeatures( QgsFeatureRequest().setFilterFids( fids ).setFlags( QgsFeatureRequest::NoGeometry ) );
+    QgsFeature parentFeature;
+    while ( parentFeaturesIt.nextFeature( parentFeature ) )
+      parentFeatures << parentFeature;
+  }
+
+  // the children and the parents are deleted in the edit buffers first, nothing is committed unless all of them could be deleted
   QList<QgsVectorLayer *> childLayersEdited;
   bool isSuccess = true;
-  for ( const QgsRelation &referencingRelation : referencingRelations )
+  for ( const QgsRelation &compositionRelation : relations )
   {
-    if ( referencingRelation.strength() == QgsRelation::Composition )
+    QgsVectorLayer *childLayer = compositionRelation.referencingLayer();
+
+    flushCommitQueue( childLayer );
+    if ( !childLayer->startEditing() )
     {
-      QgsVectorLayer *childLayer = referencingRelation.referencingLayer();
+      QgsMessageLog::logMessage( tr( "Cannot start editing child layer" ), "QField", Qgis::Critical );
+      isSuccess = false;
+      break;
+    }
 
-      if ( childLayer->startEditing() )
-      {
-        QgsFeatureIterator relatedFeaturesIt = referencingRelation.getRelatedFeatures( layer->getFeature( fid ) );
-        QgsFeature childFeature;
-        while ( relatedFeaturesIt.nextFeature( childFeature ) )
-        {
-          if ( ! childLayer->deleteFeature( childFeature.id() ) )
-          {
-            QgsMessageLog::logMessage( tr( "Cannot delete feature from child layer" ), "QField", Qgis::Critical );
-            isSuccess = false;
-          }
-        }
-      }
-      else
-      {
-        QgsMessageLog::logMessage( tr( "Cannot start editing child layer" ), "QField", Qgis::Critical );
-        isSuccess = false;
-        break;
-      }
+    childLayersEdited.append( childLayer );
 
-      if ( isSuccess )
-        childLayersEdited.append( childLayer );
-      else
-        break;
+    const QgsFeatureIds childFids = relatedFeatureIds( compositionRelation, parentFeatures );
+    if ( ! childLayer->deleteFeatures( childFids ) )
+    {
+      QgsMessageLog::logMessage( tr( "Cannot delete feature from child layer" ), "QField", Qgis::Critical );
+      isSuccess = false;
+      break;
     }
   }
 
-  // we need to either commit or rollback the child layers that have experienced any modification
+  if ( isSuccess && !layer->deleteFeatures( fids ) )
+  {
+    QgsMessageLog::logMessage( tr( "Cannot delete %n feature(s)", nullptr, fids.size() ), "QField", Qgis::Warning );
+    isSuccess = false;
+  }
+
+  // the children are committed before their parents, which might be referenced by foreign key constraints.
+  // Without a shared transaction, a parent commit failing after that cannot bring back the deleted children.
   for ( QgsVectorLayer *childLayer : qgis::as_const( childLayersEdited ) )
   {
-    // if everything went well so far, we try to commit
-    if ( isSuccess )
+    if ( isSuccess && ! childLayer->commitChanges() )
     {
-      if ( ! childLayer->commitChanges() )
-      {
-        QgsMessageLog::logMessage( tr( "Cannot commit layer changes in layer %1." ).arg( childLayer->name() ), "QField", Qgis::Critical );
-        isSuccess = false;
-      }
+      QgsMessageLog::logMessage( tr( "Cannot commit layer changes in layer %1." ).arg( childLayer->name() ), "QField", Qgis::Critical );
+      isSuccess = false;
     }
 
-    // if the commit failed, we try to rollback the changes and the rest of the modified layers (parent and children) will be rollbacked
-    if ( ! isSuccess )
+    // the rest of the modified layers (parent and children) will be rolled back
+    if ( ! isSuccess && childLayer->isEditable() )
     {
       if ( ! childLayer->rollBack() )
         QgsMessageLog::logMessage( tr( "Cannot rollback layer changes in layer %1" ).arg( childLayer->name() ), "QField", Qgis::Critical );
     }
   }
 
-  if ( isSuccess )
+  if ( !selectionAction )
   {
-    //delete parent
-    if ( layer->deleteFeature( fid ) )
-    {
-      if ( !selectionAction )
-      {
-        // commit changes
-        if ( ! layer->commitChanges() )
-          isSuccess = false;
-      }
-    }
-    else
+    if ( isSuccess && ! layer->commitChanges() )
     {
-      QgsMessageLog::logMessage( tr( "Cannot delete feature %1" ).arg( fid ), "QField", Qgis::Warning );
-
+      QgsMessageLog::logMessage( tr( "Cannot commit layer changes in layer %1." ).arg( layer->name() ), "QField", Qgis::Critical );
       isSuccess = false;
     }
-  }
 
-  if ( !selectionAction )
-  {
-    if ( ! isSuccess )
+    if ( ! isSuccess && layer->isEditable() )
     {
       if ( ! layer->rollBack() )
         QgsMessageLog::logMessage( tr( "Cannot rollback layer changes in layer %1" ).arg( layer->name() ), "QField", Qgis::Critical );
     }
+
+    isSuccess = endTransaction( transaction.get(), isSuccess, layer );
   }
 
   return isSuccess;
 }
 
+QList<QgsRelation> MultiFeatureListModelBase::compositionRelations( QgsVectorLayer *layer ) const
+{
+  QList<QgsRelation> relations;
+  const QList<QgsRelation> referencingRelations = QgsProject::instance()->relationManager()->referencedRelations( layer );
+  for ( const QgsRelation &referencingRelation : referencingRelations )
+  {
+    if ( referencingRelation.strength() == QgsRelation::Composition )
+      relations << referencingRelation;
+  }
+  return relations;
+}
+
+std::unique_ptr<QgsTransaction> MultiFeatureListModelBase::beginTransaction( QgsVectorLayer *layer )
+{
+  QSet<QgsVectorLayer *> layers;
+  layers << layer;
+  const QList<QgsRelation> relations = compositionRelations( layer );
+  for ( const QgsRelation &relation : relations )
+    layers << relation.referencingLayer();
+
+  for ( QgsVectorLayer *vlayer : qgis::as_const( layers ) )
+  {
+    flushCommitQueue( vlayer );
+
+    // an edit session which is already open cannot be moved into a transaction
+    if ( vlayer->isEditable() || vlayer->dataProvider()->transaction() || !QgsTransaction::supportsTransaction( vlayer ) )
+      return nullptr;
+  }
+
+  // the edits of a single layer are committed at once anyway
+  if ( layers.size() < 2 )
+    return nullptr;
+
+  // only succeeds if all the layers share the same database, e.g. the same GeoPackage
+  std::unique_ptr<QgsTransaction> transaction( QgsTransaction::create( layers ) );
+  if ( !transaction )
+    return nullptr;
+
+  QString errorMsg;
+  if ( !transaction->begin( errorMsg ) )
+  {
+    QgsMessageLog::logMessage( tr( "Cannot begin a transaction on layer %1. Reason:\n%2" ).arg( layer->name(), errorMsg ), "QField", Qgis::Warning );
+    return nullptr;
+  }
+
+  return transaction;
+}
+
+bool MultiFeatureListModelBase::endTransaction( QgsTransaction *transaction, bool commit, QgsVectorLayer *layer )
+{
+  if ( !transaction )
+    return commit;
+
+  QString errorMsg;
+  if ( commit )
+  {
+    if ( transaction->commit( errorMsg ) )
+      return true;
+
+    QgsMessageLog::logMessage( tr( "Cannot commit the transaction on layer %1. Reason:\n%2" ).arg( layer->name(), errorMsg ), "QField", Qgis::Critical );
+  }
+
+  if ( !transaction->rollback( errorMsg ) )
+    QgsMessageLog::logMessage( tr( "Cannot rollback the transaction on layer %1. Reason:\n%2" ).arg( layer->name(), errorMsg ), "QField", Qgis::Critical );
+
+  // within a transaction the edits are written to the database right away, the layers have to forget the rolled back ones
+  layer->reload();
+  const QList<QgsRelation> relations = compositionRelations( layer );
+  for ( const QgsRelation &relation : relations )
+    relation.referencingLayer()->reload();
+
+  return false;
+}
+
+QgsFeatureIds MultiFeatureListModelBase::relatedFeatureIds( const QgsRelation &relation, const QgsFeatureList &parentFeatures ) const
+{
+  QgsFeatureIds fids;
+  const QList<QgsRelation::FieldPair> fieldPairs = relation.fieldPairs();
+
+  // keep the filter expressions at a reasonable size for the providers
+  const int chunkSize = 500;
+  for ( int offset = 0; offset < parentFeatures.size(); offset += chunkSize )
+  {
+    const QgsFeatureList chunk = parentFeatures.mid( offset, chunkSize );
+
+    QStringList referencedFields;
+    QStringList referencingFields;
+    for ( const QgsRelation::FieldPair &fieldPair : fieldPairs )
+    {
+      referencedFields << fieldPair.referencedField();
+      referencingFields << fieldPair.referencingField();
+    }
+
+    QList<QgsAttributes> values;
+    for ( const QgsFeature &parentFeature : chunk )
+    {
+      QgsAttributes attributes;
+      for ( const QString &referencedField : qgis::as_const( referencedFields ) )
+        attributes << parentFeature.attribute( referencedField );
+      values << attributes;
+    }
+
+    const QString filter = FeatureUtils::attributeValuesFilter( referencingFields, values );
+    if ( filter.isEmpty() )
+      continue;
+
+    QgsFeatureIterator childFeaturesIt = relation.referencingLayer()->getFeatures( QgsFeatureRequest().setFilterExpression( filter ).setNoAttributes().setFlags( QgsFeatureRequest::NoGeometry ) );
+    QgsFeature childFeature;
+    while ( childFeaturesIt.nextFeature( childFeature ) )
+      fids << childFeature.id();
+  }
+
+  return fids;
+}
+
 bool MultiFeatureListModelBase::deleteSelection()
 {
   if ( !canDeleteSelection() )
     return false;
 
   QgsVectorLayer *vlayer = mSelectedFeatures[0].first;
+  std::unique_ptr<QgsTransaction> transaction = beginTransaction( vlayer );
   if ( !vlayer->startEditing() )
   {
     QgsMessageLog::logMessage( tr( "Cannot start editing" ), "QField", Qgis::Warning );
+    endTransaction( transaction.get(), false, vlayer );
     return false;
   }
 
-  const QList< QPair< QgsVectorLayer *, QgsFeature > > selectedFeatures = mSelectedFeatures;
+  QMap<QgsVectorLayer *, QgsFeatureIds> selectedFids;
+  for ( const auto &pair : qgis::as_const( mSelectedFeatures ) )
+    selectedFids[pair.first] << pair.second.id();
+
   bool isSuccess = false;
-  for ( const auto &pair : selectedFeatures )
+  for ( auto it = selectedFids.constBegin(); it != selectedFids.constEnd(); ++it )
   {
-    isSuccess = deleteFeature( pair.first, pair.second.id(), true );
+    isSuccess = deleteFeatures( it.key(), it.value(), true );
     if ( !isSuccess )
       break;
   }
@@ -533,7 +744,7 @@ bool MultiFeatureListModelBase::deleteSelection()
       QgsMessageLog::logMessage( tr( "Cannot rollback layer changes in layer %1" ).arg( vlayer->name() ), "QField", Qgis::Critical );
   }
 
-  return isSuccess;
+  return endTransaction( transaction.get(), isSuccess, vlayer );
 }
 
 void MultiFeatureListModelBase::layerDeleted( QObject *object )
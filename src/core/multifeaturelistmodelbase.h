@@ -19,11 +19,19 @@
 #define MULTIFEATURELISTMODELBASE_H
 
 #include <QAbstractItemModel>
+#include <QPointer>
+
+#include <memory>
 
 #include <qgsfeaturerequest.h>
+#include <qgstaskmanager.h>
+#include <qgsrelation.h>
 
 #include "identifytool.h"
 
+class FeatureCommitQueue;
+class QgsTransaction;
+
 class MultiFeatureListModelBase : public QAbstractItemModel
 {
     Q_OBJECT
@@ -32,6 +40,17 @@ class MultiFeatureListModelBase : public QAbstractItemModel
 
     explicit MultiFeatureListModelBase( QObject *parent = nullptr );
 
+    /**
+     * Returns the queue whose pending edits are committed before the features are edited.
+     */
+    FeatureCommitQueue *commitQueue() const;
+
+    /**
+     * Sets the queue whose pending edits are committed before the features are edited,
+     * so that rolling back a failed merge or deletion does not discard them.
+     */
+    void setCommitQueue( FeatureCommitQueue *commitQueue );
+
     /**
      * Resets the model to contain features found from a list of \a requests.
      */
@@ -95,9 +114,22 @@ class MultiFeatureListModelBase : public QAbstractItemModel
      *
      * All but the first feature will then be removed from the vector layer containing
      * the selected features.
+     *
+     * The union is computed in a background task, mergeSelectionFinished() is emitted
+     * once the features have been merged.
+     * \returns TRUE if the merge has been started
      */
     bool mergeSelection();
 
+    //! Cancels the running merge, mergeSelectionFinished() will be emitted with a failure
+    void cancelMerge();
+
+    //! Returns TRUE while a merge is running
+    bool isMerging() const;
+
+    //! Returns the progress of the running merge, between 0 and 100
+    double mergeProgress() const;
+
     /**
      * Deletes a feature from a vector layer
      *
@@ -106,6 +138,18 @@ class MultiFeatureListModelBase : public QAbstractItemModel
      */
     bool deleteFeature( QgsVectorLayer *layer, QgsFeatureId fid, bool selectionAction = false );
 
+    /**
+     * Deletes features from a vector layer, including the children of composition relations.
+     * The parent and the child features are fetched with one request per relation and
+     * every layer is committed once, after the parents and all their children have been deleted.
+     * If the layers share a database, the deletions are committed in a single transaction.
+     *
+     * \param layer The layer from which the features will be removed
+     * \param fids The ids of the features to remove
+     * \param selectionAction if set to TRUE, starting the edit session and committing the layer is left to the caller
+     */
+    bool deleteFeatures( QgsVectorLayer *layer, const QgsFeatureIds &fids, bool selectionAction = false );
+
     //! Deletes selected features
     bool deleteSelection();
 
@@ -126,6 +170,13 @@ class MultiFeatureListModelBase : public QAbstractItemModel
 
     void selectedCountChanged();
 
+    void isMergingChanged();
+
+    void mergeProgressChanged();
+
+    //! Emitted when a merge started by mergeSelection() has ended
+    void mergeSelectionFinished( bool success );
+
   private slots:
 
     void layerDeleted( QObject *object );
@@ -138,6 +189,33 @@ class MultiFeatureListModelBase : public QAbstractItemModel
 
   private:
 
+    //! Applies the \a combinedGeometry of a merge to the first merged feature and deletes the other ones
+    void finishMerge( const QgsGeometry &combinedGeometry );
+
+    //! Commits the edits of \a layer waiting in the commit queue before starting an edit session
+    void flushCommitQueue( QgsVectorLayer *layer );
+
+    //! Returns the composition relations whose children are deleted with the features of \a layer
+    QList<QgsRelation> compositionRelations( QgsVectorLayer *layer ) const;
+
+    /**
+     * Begins a transaction on \a layer and the child layers of its composition relations if they
+     * all share the same database, e.g. the same GeoPackage, so that deleting the parents and their
+     * children either succeeds or fails as a whole.
+     * \returns NULLPTR if the layers do not share a database or one of them is already being edited
+     */
+    std::unique_ptr<QgsTransaction> beginTransaction( QgsVectorLayer *layer );
+
+    /**
+     * Commits \a transaction if \a commit is TRUE, rolls it back otherwise or if the commit fails.
+     * The layers of the transaction have to be committed or rolled back already.
+     * \returns TRUE if \a transaction has been committed, \a commit if there is no transaction
+     */
+    bool endTransaction( QgsTransaction *transaction, bool commit, QgsVectorLayer *layer );
+
+    //! Returns the ids of the features related to any of the \a parentFeatures over \a relation
+    QgsFeatureIds relatedFeatureIds( const QgsRelation &relation, const QgsFeatureList &parentFeatures ) const;
+
     inline QPair< QgsVectorLayer *, QgsFeature > *toFeature( const QModelIndex &index ) const
     {
       return static_cast<QPair< QgsVectorLayer *, QgsFeature >*>( index.internalPointer() );
@@ -145,6 +223,13 @@ class MultiFeatureListModelBase : public QAbstractItemModel
 
     QList< QPair< QgsVectorLayer *, QgsFeature > > mFeatures;
     QList< QPair< QgsVectorLayer *, QgsFeature > > mSelectedFeatures;
+
+    QPointer<FeatureCommitQueue> mCommitQueue;
+
+    QPointer<QgsTask> mMergeTask;
+    QPointer<QgsVectorLayer> mMergeLayer;
+    QList< QPair< QgsVectorLayer *, QgsFeature > > mMergeFeatures;
+    double mMergeProgress = 0.0;
 };
 
 #endif // MULTIFEATURELISTMODELBASE_H
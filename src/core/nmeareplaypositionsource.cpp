@@ -0,0 +1,364 @@
+/***************************************************************************
+  nmeareplaypositionsource.cpp - NmeaReplayPositionSource
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "nmeareplaypositionsource.h"
+
+#include <QList>
+#include <QTime>
+
+#include <cmath>
+
+//! the number of positions replayed at once when replaying as fast as possible
+static const int FAST_REPLAY_CHUNK_SIZE = 1000;
+
+static const double KNOTS_TO_METERS_PER_SECOND = 0.514444;
+
+namespace
+{
+  //! Returns the fields of a sentence with a valid checksum, without the leading $ and the checksum
+  QList<QByteArray> sentenceFields( const QByteArray &sentence )
+  {
+    if ( !sentence.startsWith( '$' ) )
+      return QList<QByteArray>();
+
+    const int checksumPosition = sentence.lastIndexOf( '*' );
+    const QByteArray body = sentence.mid( 1, checksumPosition < 0 ? -1 : checksumPosition - 1 );
+
+    if ( checksumPosition >= 0 )
+    {
+      quint8 checksum = 0;
+      for ( const char c : body )
+        checksum ^= static_cast<quint8>( c );
+
+      bool ok = false;
+      if ( sentence.mid( checksumPosition + 1, 2 ).toUInt( &ok, 16 ) != checksum || !ok )
+        return QList<QByteArray>();
+    }
+
+    const QList<QByteArray> fields = body.split( ',' );
+    if ( fields.at( 0 ).size() < 5 )
+      return QList<QByteArray>();
+
+    return fields;
+  }
+
+  //! Returns the sentence type without the talker id, e.g. GGA
+  QByteArray sentenceType( const QList<QByteArray> &fields )
+  {
+    return fields.at( 0 ).mid( 2 );
+  }
+
+  QTime parseTime( const QByteArray &field )
+  {
+    if ( field.size() < 6 )
+      return QTime();
+
+    const int msecs = field.size() > 7 ? static_cast<int>( std::round( field.mid( 6 ).toDouble() * 1000 ) ) : 0;
+    return QTime( field.mid( 0, 2 ).toInt(), field.mid( 2, 2 ).toInt(), field.mid( 4, 2 ).toInt(), msecs );
+  }
+
+  //! Parses a ddmm.mmmm or dddmm.mmmm field into decimal degrees
+  bool parseDegrees( const QByteArray &field, const QByteArray &hemisphere, double &degrees )
+  {
+    bool ok = false;
+    const double value = field.toDouble( &ok );
+    if ( !ok )
+      return false;
+
+    const double wholeDegrees = std::floor( value / 100 );
+    degrees = wholeDegrees + ( value - wholeDegrees * 100 ) / 60;
+    if ( hemisphere == "S" || hemisphere == "W" )
+      degrees = -degrees;
+    return true;
+  }
+
+  //! Returns the field at \a index, or an empty field for truncated sentences
+  QByteArray field( const QList<QByteArray> &fields, int index )
+  {
+    return fields.value( index );
+  }
+}
+
+NmeaReplayPositionSource::NmeaReplayPositionSource( const QString &fileName, QObject *parent )
+  : QGeoPositionInfoSource( parent )
+  , mFile( fileName )
+{
+  mTimer.setSingleShot( true );
+  connect( &mTimer, &QTimer::timeout, this, &NmeaReplayPositionSource::replayNext );
+}
+
+double NmeaReplayPositionSource::replaySpeed() const
+{
+  return mReplaySpeed;
+}
+
+void NmeaReplayPositionSource::setReplaySpeed( double replaySpeed )
+{
+  mReplaySpeed = std::max( 0.0, replaySpeed );
+}
+
+bool NmeaReplayPositionSource::stopAtEnd() const
+{
+  return mStopAtEnd;
+}
+
+void NmeaReplayPositionSource::setStopAtEnd( bool stopAtEnd )
+{
+  mStopAtEnd = stopAtEnd;
+}
+
+QGeoPositionInfo NmeaReplayPositionSource::lastKnownPosition( bool fromSatellitePositioningMethodsOnly ) const
+{
+  Q_UNUSED( fromSatellitePositioningMethodsOnly )
+  return mLastPosition;
+}
+
+QGeoPositionInfoSource::PositioningMethods NmeaReplayPositionSource::supportedPositioningMethods() const
+{
+  return SatellitePositioningMethods;
+}
+
+int NmeaReplayPositionSource::minimumUpdateInterval() const
+{
+  return 0;
+}
+
+QGeoPositionInfoSource::Error NmeaReplayPositionSource::error() const
+{
+  return mError;
+}
+
+void NmeaReplayPositionSource::startUpdates()
+{
+  if ( mTimer.isActive() )
+    return;
+
+  if ( !mFile.isOpen() )
+  {
+    if ( !mFile.open( QIODevice::ReadOnly ) )
+    {
+      mError = AccessError;
+      emit QGeoPositionInfoSource::error( mError );
+      return;
+    }
+
+    if ( !advance() )
+      return;
+  }
+
+  mTimer.start( 0 );
+}
+
+void NmeaReplayPositionSource::stopUpdates()
+{
+  mTimer.stop();
+}
+
+void NmeaReplayPositionSource::requestUpdate( int timeout )
+{
+  Q_UNUSED( timeout )
+
+  if ( mLastPosition.isValid() )
+    emit positionUpdated( mLastPosition );
+  else
+    emit updateTimeout();
+}
+
+void NmeaReplayPositionSource::replayNext()
+{
+  if ( mReplaySpeed <= 0 )
+  {
+    for ( int i = 0; i < FAST_REPLAY_CHUNK_SIZE; ++i )
+    {
+      mLastPosition = mNextPosition;
+      emit positionUpdated( mLastPosition );
+
+      if ( !advance() )
+        return;
+    }
+
+    // give the event loop a chance to process the stop requests
+    mTimer.start( 0 );
+    return;
+  }
+
+  mLastPosition = mNextPosition;
+  emit positionUpdated( mLastPosition );
+
+  if ( !advance() )
+    return;
+
+  const qint64 delay = mLastPosition.timestamp().msecsTo( mNextPosition.timestamp() );
+  mTimer.start( static_cast<int>( std::max<qint64>( 0, static_cast<qint64>( delay / mReplaySpeed ) ) ) );
+}
+
+bool NmeaReplayPositionSource::advance()
+{
+  if ( readEpoch( mNextPosition ) )
+    return true;
+
+  emit replayFinished();
+
+  if ( !mStopAtEnd )
+  {
+    mFile.seek( 0 );
+    mPendingSentence.clear();
+    if ( readEpoch( mNextPosition ) )
+      return true;
+  }
+
+  mTimer.stop();
+  return false;
+}
+
+bool NmeaReplayPositionSource::readEpoch( QGeoPositionInfo &info )
+{
+  while ( true )
+  {
+    // the date is only part of some sentences, carry it over from the previous epoch
+    info = QGeoPositionInfo();
+    info.setTimestamp( mLastPosition.timestamp() );
+
+    QTime epochTime;
+    bool hasFix = false;
+    bool atEnd = false;
+
+    while ( true )
+    {
+      QByteArray sentence;
+      if ( !mPendingSentence.isEmpty() )
+      {
+        sentence = mPendingSentence;
+        mPendingSentence.clear();
+      }
+      else if ( !mFile.atEnd() )
+      {
+        sentence = mFile.readLine().trimmed();
+      }
+      else
+      {
+        atEnd = true;
+        break;
+      }
+
+      const QList<QByteArray> fields = sentenceFields( sentence );
+      if ( fields.isEmpty() )
+        continue;
+
+      const QTime time = parseTime( field( fields, 1 ) );
+      if ( epochTime.isValid() && time.isValid() && time != epochTime )
+      {
+        mPendingSentence = sentence;
+        break;
+      }
+      if ( time.isValid() )
+        epochTime = time;
+
+      hasFix |= parseSentence( sentence, info ) && info.coordinate().isValid();
+    }
+
+    if ( hasFix && info.isValid() )
+      return true;
+
+    if ( atEnd )
+      return false;
+  }
+}
+
+bool NmeaReplayPositionSource::parseSentence( const QByteArray &sentence, QGeoPositionInfo &info )
+{
+  const QList<QByteArray> fields = sentenceFields( sentence );
+  if ( fields.isEmpty() )
+    return false;
+
+  const QByteArray type = sentenceType( fields );
+  const QTime time = parseTime( field( fields, 1 ) );
+
+  if ( type == "GGA" )
+  {
+    // no fix
+    if ( field( fields, 6 ).toInt() == 0 )
+      return false;
+
+    double latitude, longitude;
+    if ( !parseDegrees( field( fields, 2 ), field( fields, 3 ), latitude ) || !parseDegrees( field( fields, 4 ), field( fields, 5 ), longitude ) )
+      return false;
+
+    QGeoCoordinate coordinate( latitude, longitude );
+    bool ok = false;
+    const double altitude = field( fields, 9 ).toDouble( &ok );
+    if ( ok )
+      coordinate.setAltitude( altitude );
+    info.setCoordinate( coordinate );
+
+    const QDate date = info.timestamp().isValid() ? info.timestamp().date() : QDateTime::currentDateTimeUtc().date();
+    if ( time.isValid() )
+      info.setTimestamp( QDateTime( date, time, Qt::UTC ) );
+
+    return true;
+  }
+  else if ( type == "RMC" )
+  {
+    if ( field( fields, 2 ) != "A" )
+      return false;
+
+    double latitude, longitude;
+    if ( !parseDegrees( field( fields, 3 ), field( fields, 4 ), latitude ) || !parseDegrees( field( fields, 5 ), field( fields, 6 ), longitude ) )
+      return false;
+
+    // keep the altitude of a GGA sentence of the same epoch
+    QGeoCoordinate coordinate = info.coordinate();
+    coordinate.setLatitude( latitude );
+    coordinate.setLongitude( longitude );
+    info.setCoordinate( coordinate );
+
+    bool ok = false;
+    const double speed = field( fields, 7 ).toDouble( &ok );
+    if ( ok )
+      info.setAttribute( QGeoPositionInfo::GroundSpeed, speed * KNOTS_TO_METERS_PER_SECOND );
+    const double direction = field( fields, 8 ).toDouble( &ok );
+    if ( ok )
+      info.setAttribute( QGeoPositionInfo::Direction, direction );
+
+    const QByteArray dateField = field( fields, 9 );
+    // two digit years, receivers from before 1980 do not exist
+    const int year = dateField.mid( 4, 2 ).toInt();
+    QDate date = QDate( year < 80 ? 2000 + year : 1900 + year, dateField.mid( 2, 2 ).toInt(), dateField.mid( 0, 2 ).toInt() );
+    if ( !date.isValid() )
+      date = info.timestamp().isValid() ? info.timestamp().date() : QDateTime::currentDateTimeUtc().date();
+    if ( time.isValid() )
+      info.setTimestamp( QDateTime( date, time, Qt::UTC ) );
+
+    return true;
+  }
+  else if ( type == "GST" )
+  {
+    bool latitudeOk = false;
+    bool longitudeOk = false;
+    const double latitudeError = field( fields, 6 ).toDouble( &latitudeOk );
+    const double longitudeError = field( fields, 7 ).toDouble( &longitudeOk );
+    if ( latitudeOk && longitudeOk )
+      info.setAttribute( QGeoPositionInfo::HorizontalAccuracy, std::sqrt( latitudeError * latitudeError + longitudeError * longitudeError ) );
+
+    bool ok = false;
+    const double altitudeError = field( fields, 8 ).toDouble( &ok );
+    if ( ok )
+      info.setAttribute( QGeoPositionInfo::VerticalAccuracy, altitudeError );
+
+    return true;
+  }
+
+  return false;
+}
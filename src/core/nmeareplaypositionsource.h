@@ -0,0 +1,88 @@
+/***************************************************************************
+  nmeareplaypositionsource.h - NmeaReplayPositionSource
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef NMEAREPLAYPOSITIONSOURCE_H
+#define NMEAREPLAYPOSITIONSOURCE_H
+
+#include <QFile>
+#include <QTimer>
+#include <QtPositioning/QGeoPositionInfoSource>
+
+/**
+ * A position source replaying the fixes recorded in an NMEA log file.
+ *
+ * The GGA, RMC and GST sentences of an epoch are merged into one position update.
+ * With a replay speed of 1 the fixes are replayed at the pace they have been recorded,
+ * higher values replay them faster and a speed of 0 replays them as fast as possible,
+ * which is used to benchmark the positioning pipeline.
+ */
+class NmeaReplayPositionSource : public QGeoPositionInfoSource
+{
+    Q_OBJECT
+
+  public:
+    explicit NmeaReplayPositionSource( const QString &fileName, QObject *parent = nullptr );
+
+    //! Returns the replay speed factor, 0 to replay as fast as possible
+    double replaySpeed() const;
+    //! Sets the replay speed factor, 0 to replay as fast as possible
+    void setReplaySpeed( double replaySpeed );
+
+    //! Returns if the replay stops at the end of the file rather than starting over
+    bool stopAtEnd() const;
+    //! Sets if the replay stops at the end of the file rather than starting over
+    void setStopAtEnd( bool stopAtEnd );
+
+    QGeoPositionInfo lastKnownPosition( bool fromSatellitePositioningMethodsOnly = false ) const override;
+    PositioningMethods supportedPositioningMethods() const override;
+    int minimumUpdateInterval() const override;
+    Error error() const override;
+
+    /**
+     * Parses an NMEA \a sentence and merges its content into \a info.
+     * Returns FALSE if the sentence is not supported, has a wrong checksum or carries no fix.
+     */
+    static bool parseSentence( const QByteArray &sentence, QGeoPositionInfo &info );
+
+  public slots:
+    void startUpdates() override;
+    void stopUpdates() override;
+    void requestUpdate( int timeout = 0 ) override;
+
+  signals:
+    //! Emitted when the end of the file has been reached
+    void replayFinished();
+
+  private slots:
+    void replayNext();
+
+  private:
+    //! Reads the sentences of the next epoch, returns FALSE at the end of the file
+    bool readEpoch( QGeoPositionInfo &info );
+    //! Reads the next position to replay, starting over at the end of the file unless stopAtEnd is set
+    bool advance();
+
+    QFile mFile;
+    QTimer mTimer;
+    double mReplaySpeed = 1.0;
+    bool mStopAtEnd = false;
+    Error mError = NoError;
+    QGeoPositionInfo mLastPosition;
+    QGeoPositionInfo mNextPosition;
+    //! the first sentence of the next epoch, read ahead while looking for the end of the current one
+    QByteArray mPendingSentence;
+};
+
+#endif // NMEAREPLAYPOSITIONSOURCE_H
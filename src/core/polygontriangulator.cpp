@@ -0,0 +1,286 @@
+/***************************************************************************
+  polygontriangulator.cpp - PolygonTriangulator
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "earcuttriangulator.h"
+#include "polygontriangulator.h"
+
+#include <QMutexLocker>
+
+#include <qgscurvepolygon.h>
+#include <qgsexception.h>
+#include <qgsgeometrycollection.h>
+#include <qgslinestring.h>
+#include <qgsmaptopixelgeometrysimplifier.h>
+#include <qgsmessagelog.h>
+#include <qgspolygon.h>
+#include <qgsproject.h>
+
+#include <atomic>
+#include <memory>
+
+extern "C" {
+#include "tessellate.h"
+}
+
+//! the number of triangulations kept by the cache
+static const int MAXIMUM_CACHED_TRIANGULATIONS = 16;
+
+static std::atomic<int> sEngine( PolygonTriangulator::Tessellate );
+
+namespace
+{
+  //! Returns the coordinate operation the transform context of \a transform has chosen, empty for the default one
+  QString coordinateOperation( const QgsCoordinateTransform &transform )
+  {
+#if VERSION_INT >= 30800
+    return transform.coordinateOperation();
+#else
+    Q_UNUSED( transform )
+    return QString();
+#endif
+  }
+
+  void appendTessellateTriangles( QVector<QSGGeometry::Point2D> &triangles, const QVector<double> &coordinates, const QVector<int> &ringStarts )
+  {
+    // the start of each ring followed by the end of the last one
+    QVector<const double *> contours;
+    contours.reserve( ringStarts.size() + 1 );
+    for ( int ringStart : ringStarts )
+      contours << coordinates.constData() + ringStart * 2;
+    contours << coordinates.constData() + coordinates.size();
+
+    double *coordinatesOut = nullptr;
+    int *trisOut = nullptr;
+    int vertexCount = 0;
+    int triangleCount = 0;
+
+    tessellate( &coordinatesOut, &vertexCount,
+                &trisOut, &triangleCount,
+                contours.constData(), contours.constData() + contours.size() );
+
+    const int offset = triangles.size();
+    triangles.resize( offset + triangleCount * 3 );
+    QSGGeometry::Point2D *vertices = triangles.data() + offset;
+    for ( int i = 0; i < triangleCount * 3; ++i )
+    {
+      vertices[i].set( static_cast<float>( coordinatesOut[trisOut[i] * 2] ), static_cast<float>( coordinatesOut[trisOut[i] * 2 + 1] ) );
+    }
+
+    free( coordinatesOut );
+    free( trisOut );
+  }
+
+  void appendEarcutTriangles( QVector<QSGGeometry::Point2D> &triangles, const QVector<double> &coordinates, const QVector<int> &ringStarts )
+  {
+    const QVector<int> indices = EarcutTriangulator::triangulate( coordinates, ringStarts.mid( 1 ) );
+
+    const int offset = triangles.size();
+    triangles.resize( offset + indices.size() );
+    QSGGeometry::Point2D *vertices = triangles.data() + offset;
+    for ( int i = 0; i < indices.size(); ++i )
+    {
+      vertices[i].set( static_cast<float>( coordinates.at( indices.at( i ) * 2 ) ), static_cast<float>( coordinates.at( indices.at( i ) * 2 + 1 ) ) );
+    }
+  }
+
+  /**
+   * Triangulates the rings with the interleaved x, y \a coordinates, each ring starting
+   * at the point index in \a ringStarts, and appends the triangles to \a triangles.
+   */
+  void appendTriangles( QVector<QSGGeometry::Point2D> &triangles, const QVector<double> &coordinates, const QVector<int> &ringStarts )
+  {
+    if ( ringStarts.isEmpty() )
+      return;
+
+    switch ( PolygonTriangulator::engine() )
+    {
+      case PolygonTriangulator::Tessellate:
+        appendTessellateTriangles( triangles, coordinates, ringStarts );
+        break;
+      case PolygonTriangulator::Earcut:
+        appendEarcutTriangles( triangles, coordinates, ringStarts );
+        break;
+    }
+  }
+
+  void appendPolygonTriangles( QVector<QSGGeometry::Point2D> &triangles, const QgsCurvePolygon *curvePolygon )
+  {
+    if ( !curvePolygon || !curvePolygon->exteriorRing() )
+      return;
+
+    std::unique_ptr<QgsPolygon> segmentized;
+    const QgsCurvePolygon *polygon = curvePolygon;
+    if ( curvePolygon->hasCurvedSegments() )
+    {
+      segmentized.reset( curvePolygon->toPolygon() );
+      polygon = segmentized.get();
+    }
+
+    QVector<const QgsLineString *> rings;
+    rings.reserve( 1 + polygon->numInteriorRings() );
+    rings << qgsgeometry_cast<const QgsLineString *>( polygon->exteriorRing() );
+    for ( int i = 0; i < polygon->numInteriorRings(); ++i )
+      rings << qgsgeometry_cast<const QgsLineString *>( polygon->interiorRing( i ) );
+
+    int pointCount = 0;
+    for ( const QgsLineString *ring : qgis::as_const( rings ) )
+      pointCount += ring ? ring->numPoints() : 0;
+
+    QVector<double> coordinates( pointCount * 2 );
+    QVector<int> ringStarts;
+    ringStarts.reserve( rings.size() );
+    double *coordinate = coordinates.data();
+    for ( const QgsLineString *ring : qgis::as_const( rings ) )
+    {
+      if ( !ring || ring->numPoints() < 3 )
+        continue;
+
+      ringStarts << static_cast<int>( coordinate - coordinates.constData() ) / 2;
+      const double *x = ring->xData();
+      const double *y = ring->yData();
+      for ( int i = 0; i < ring->numPoints(); ++i )
+      {
+        *coordinate++ = x[i];
+        *coordinate++ = y[i];
+      }
+    }
+    coordinates.resize( static_cast<int>( coordinate - coordinates.constData() ) );
+
+    appendTriangles( triangles, coordinates, ringStarts );
+  }
+}
+
+PolygonTriangulator::PolygonTriangulator()
+{
+  // the cached geometries have been transformed with the previous context
+  QObject::connect( QgsProject::instance(), &QgsProject::transformContextChanged, QgsProject::instance(), [this] { clear(); } );
+}
+
+PolygonTriangulator *PolygonTriangulator::instance()
+{
+  // thread safe initialization, the render thread is the main user
+  static PolygonTriangulator sInstance;
+  return &sInstance;
+}
+
+PolygonTriangulator::Engine PolygonTriangulator::engine()
+{
+  return static_cast<Engine>( sEngine.load() );
+}
+
+void PolygonTriangulator::setEngine( Engine engine )
+{
+  if ( sEngine.exchange( engine ) != engine )
+    instance()->clear();
+}
+
+PolygonTriangulator::Triangulation PolygonTriangulator::triangulation( const QgsGeometry &geometry, const QgsCoordinateTransform &transform, double tolerance )
+{
+  QMutexLocker locker( &mMutex );
+
+  const QString operation = coordinateOperation( transform );
+  QgsGeometry transformedGeometry;
+  for ( int i = 0; i < mEntries.size(); ++i )
+  {
+    const Entry &entry = mEntries.at( i );
+    if ( entry.sourceGeometry.constGet() == geometry.constGet() && entry.sourceCrs == transform.sourceCrs() && entry.destinationCrs == transform.destinationCrs()
+         && entry.coordinateOperation == operation )
+    {
+      if ( qgsDoubleNear( entry.tolerance, tolerance ) )
+      {
+        mEntries.move( i, 0 );
+        return mEntries.first().triangulation;
+      }
+
+      // another level of detail of the same geometry
+      transformedGeometry = entry.transformedGeometry;
+    }
+  }
+  locker.unlock();
+
+  if ( transformedGeometry.isNull() )
+  {
+    transformedGeometry = geometry;
+    if ( transform.isValid() && !transform.isShortCircuited() )
+    {
+      try
+      {
+        transformedGeometry.transform( transform );
+      }
+      catch ( const QgsCsException &e )
+      {
+        QgsMessageLog::logMessage( QStringLiteral( "Transform error caught: %1" ).arg( e.what() ), QStringLiteral( "QField" ) );
+      }
+    }
+  }
+
+  Triangulation triangulation;
+  triangulation.geometry = transformedGeometry;
+  if ( tolerance > 0 )
+  {
+    const QgsMapToPixelSimplifier simplifier( QgsMapToPixelSimplifier::SimplifyGeometry, tolerance );
+    triangulation.geometry = simplifier.simplify( transformedGeometry );
+  }
+
+  if ( triangulation.geometry.type() == QgsWkbTypes::PolygonGeometry )
+    triangulation.triangles = triangulate( triangulation.geometry.constGet() );
+
+  locker.relock();
+  mEntries.prepend( Entry { geometry, transform.sourceCrs(), transform.destinationCrs(), operation, tolerance, transformedGeometry, triangulation } );
+  while ( mEntries.size() > MAXIMUM_CACHED_TRIANGULATIONS )
+    mEntries.removeLast();
+
+  return triangulation;
+}
+
+void PolygonTriangulator::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mEntries.clear();
+}
+
+QVector<QSGGeometry::Point2D> PolygonTriangulator::triangulate( const QgsAbstractGeometry *geometry )
+{
+  QVector<QSGGeometry::Point2D> triangles;
+
+  if ( const QgsGeometryCollection *collection = qgsgeometry_cast<const QgsGeometryCollection *>( geometry ) )
+  {
+    for ( int i = 0; i < collection->numGeometries(); ++i )
+      appendPolygonTriangles( triangles, qgsgeometry_cast<const QgsCurvePolygon *>( collection->geometryN( i ) ) );
+  }
+  else
+  {
+    appendPolygonTriangles( triangles, qgsgeometry_cast<const QgsCurvePolygon *>( geometry ) );
+  }
+
+  return triangles;
+}
+
+QVector<QSGGeometry::Point2D> PolygonTriangulator::triangulate( const QVector<double> &x, const QVector<double> &y )
+{
+  QVector<QSGGeometry::Point2D> triangles;
+
+  QVector<double> coordinates( x.size() * 2 );
+  for ( int i = 0; i < x.size(); ++i )
+  {
+    coordinates[i * 2] = x.at( i );
+    coordinates[i * 2 + 1] = y.at( i );
+  }
+
+  if ( x.size() >= 3 )
+    appendTriangles( triangles, coordinates, QVector<int> { 0 } );
+
+  return triangles;
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+  polygontriangulator.h - PolygonTriangulator
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef POLYGONTRIANGULATOR_H
+#define POLYGONTRIANGULATOR_H
+
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QtQuick/QSGGeometry>
+
+#include <qgscoordinatetransform.h>
+#include <qgsgeometry.h>
+
+class QgsAbstractGeometry;
+
+/**
+ * The PolygonTriangulator turns polygons into triangles which can be drawn by the scene graph.
+ *
+ * Interior rings are taken into account, holes are left empty. The coordinates of the rings
+ * are read straight from the line strings of the geometry. Either the general purpose
+ * tessellator or the EarcutTriangulator is used, see setEngine(). The application picks the engine
+ * at startup from the "polygonTriangulationEngine" setting, "tessellate" (default) or "earcut".
+ *
+ * Triangulating a large polygon is expensive compared to drawing it, the instance() keeps the
+ * triangles of the most recently drawn geometries. They are looked up by the identity of the
+ * geometry, i.e. as long as the implicitly shared geometry is not modified, by the transform
+ * applied before triangulating, including the coordinate operation chosen by its transform
+ * context, and by the simplification tolerance. The levels of detail of a
+ * geometry share its transformed geometry, switching between them only simplifies and triangulates.
+ */
+class PolygonTriangulator
+{
+  public:
+    //! The algorithms available to triangulate the polygons
+    enum Engine
+    {
+      Tessellate, //!< The general purpose tessellator of 3rdparty/tessellate
+      Earcut, //!< The EarcutTriangulator, faster on simple polygons
+    };
+
+    //! A geometry transformed into the destination crs with the triangles of its polygons
+    struct Triangulation
+    {
+      QgsGeometry geometry;
+      QVector<QSGGeometry::Point2D> triangles;
+    };
+
+    //! Returns the application wide instance, which caches the triangulations
+    static PolygonTriangulator *instance();
+
+    /**
+     * Returns \a geometry transformed with \a transform, together with its triangles.
+     * If \a tolerance is greater than 0, the transformed geometry is simplified with the given
+     * tolerance in destination map units before it is triangulated.
+     * The result is cached, a later call with the same geometry, transform and tolerance returns it without any work.
+     * This is safe to be called from the render thread.
+     */
+    Triangulation triangulation( const QgsGeometry &geometry, const QgsCoordinateTransform &transform, double tolerance = 0 );
+
+    //! Drops all the cached triangulations
+    void clear();
+
+    //! Returns the engine used to triangulate the polygons
+    static Engine engine();
+
+    /**
+     * Sets the \a engine used to triangulate the polygons.
+     * The cached triangulations are dropped when the engine changes.
+     */
+    static void setEngine( Engine engine );
+
+    //! Returns the vertices of the triangles of the polygons of \a geometry, three per triangle
+    static QVector<QSGGeometry::Point2D> triangulate( const QgsAbstractGeometry *geometry );
+
+    //! Returns the vertices of the triangles of the polygon with the single ring \a x, \a y, three per triangle
+    static QVector<QSGGeometry::Point2D> triangulate( const QVector<double> &x, const QVector<double> &y );
+
+  private:
+    PolygonTriangulator();
+
+    struct Entry
+    {
+      //! keeps the source geometry alive, so its address cannot be taken by another geometry
+      QgsGeometry sourceGeometry;
+      QgsCoordinateReferenceSystem sourceCrs;
+      QgsCoordinateReferenceSystem destinationCrs;
+      //! the coordinate operation chosen by the transform context
+      QString coordinateOperation;
+      double tolerance;
+      //! the source geometry transformed into the destination crs, before the simplification
+      QgsGeometry transformedGeometry;
+      Triangulation triangulation;
+    };
+
+    QMutex mMutex;
+    //! the most recently used entry first
+    QList<Entry> mEntries;
+};
+
+#endif // POLYGONTRIANGULATOR_H
@@ -79,6 +79,8 @@
 #include "submodel.h"
 #include "expressionvariablemodel.h"
 #include "badlayerhandler.h"
+#include "layerresolver.h"
+#include "polygontriangulator.h"
 #include "snappingutils.h"
 #include "snappingresult.h"
 #include "layertreemodel.h"
@@ -87,19 +89,23 @@
 #include "qgsrelationmanager.h"
 #include "distancearea.h"
 #include "printlayoutlistmodel.h"
+#include "vertexhandles.h"
 #include "vertexmodel.h"
 #include "maptoscreen.h"
 #include "projectsource.h"
 #include "locatormodelsuperbridge.h"
 #include "qgsgeometrywrapper.h"
 #include "linepolygonhighlight.h"
+#include "multifeaturehighlight.h"
 #include "valuemapmodel.h"
 #include "recentprojectlistmodel.h"
 #include "referencingfeaturelistmodel.h"
 #include "featurechecklistmodel.h"
+#include "featurecommitqueue.h"
 #include "geometryeditorsmodel.h"
 #include "geometryutils.h"
 #include "trackingmodel.h"
+#include "gnsspositionpipeline.h"
 #include "fileutils.h"
 #include "featureutils.h"
 #include "expressionevaluator.h"
@@ -149,11 +155,28 @@ QgisMobileapp::QgisMobileapp( QgsApplication *app, QObject *parent )
   mFlatLayerTree = new FlatLayerTreeModel( mProject->layerTreeRoot(), mProject, this );
   mLegendImageProvider = new LegendImageProvider( mFlatLayerTree->layerTreeModel() );
   mTrackingModel = new TrackingModel;
+  mFeatureCommitQueue = new FeatureCommitQueue( this );
+  mTrackingModel->setCommitQueue( mFeatureCommitQueue );
+  mLayerResolver = new LayerResolver( mProject, this );
+
+  // never keep uncommitted edits around while the app might get killed in the background
+  connect( app, &QGuiApplication::applicationStateChanged, mFeatureCommitQueue, [this]( Qt::ApplicationState state )
+  {
+    if ( state != Qt::ApplicationActive )
+    {
+      mFeatureCommitQueue->flush();
+      mGpkgFlusher->flushAll();
+    }
+  } );
 
   // cppcheck-suppress leakReturnValNotUsed
   initDeclarative();
 
   QSettings settings;
+  // the earcut triangulator is faster on simple polygons, the tessellator remains the default
+  const bool earcut = settings.value( QStringLiteral( "polygonTriangulationEngine" ), QStringLiteral( "tessellate" ) ).toString() == QLatin1String( "earcut" );
+  PolygonTriangulator::setEngine( earcut ? PolygonTriangulator::Earcut : PolygonTriangulator::Tessellate );
+
   const bool firstRunFlag = settings.value( QStringLiteral( "/QField/FirstRunFlag" ), QString() ).toString().isEmpty();
   if ( firstRunFlag && !mPlatformUtils.packagePath().isEmpty() )
   {
@@ -181,7 +204,11 @@ QgisMobileapp::QgisMobileapp( QgsApplication *app, QObject *parent )
 
   mLayerTreeCanvasBridge = new LayerTreeMapCanvasBridge( mFlatLayerTree, mMapCanvas->mapSettings(), mTrackingModel, this );
   connect( this, &QgisMobileapp::loadProjectStarted, mIface, &AppInterface::loadProjectStarted );
+  connect( this, &QgisMobileapp::projectLayersReady, mIface, &AppInterface::projectLayersReady );
   connect( this, &QgisMobileapp::loadProjectEnded, mIface, &AppInterface::loadProjectEnded );
+  connect( mLayerResolver, &LayerResolver::visibleLayersResolved, this, &QgisMobileapp::projectLayersReady );
+  connect( mLayerResolver, &LayerResolver::finished, this, &QgisMobileapp::onLayersResolved );
+  connect( mLayerResolver, &LayerResolver::progress, mIface, &AppInterface::loadProjectProgress );
   QTimer::singleShot( 1, this, &QgisMobileapp::onAfterFirstRendering );
 
   mOfflineEditing = new QgsOfflineEditing();
@@ -268,10 +295,12 @@ void QgisMobileapp::initDeclarative()
   qmlRegisterType<FocusStack>( "org.qfield", 1, 0, "FocusStack" );
   qmlRegisterType<PrintLayoutListModel>( "org.qfield", 1, 0, "PrintLayoutListModel" );
   qmlRegisterType<VertexModel>( "org.qfield", 1, 0, "VertexModel" );
+  qmlRegisterType<VertexHandles>( "org.qfield", 1, 0, "VertexHandles" );
   qmlRegisterType<MapToScreen>( "org.qfield", 1, 0, "MapToScreen" );
   qmlRegisterType<LocatorModelSuperBridge>( "org.qfield", 1, 0, "LocatorModelSuperBridge" );
   qmlRegisterType<LocatorActionsModel>( "org.qfield", 1, 0, "LocatorActionsModel" );
   qmlRegisterType<LinePolygonHighlight>( "org.qfield", 1, 0, "LinePolygonHighlight" );
+  qmlRegisterType<MultiFeatureHighlight>( "org.qfield", 1, 0, "MultiFeatureHighlight" );
   qmlRegisterType<QgsGeometryWrapper>( "org.qfield", 1, 0, "QgsGeometryWrapper" );
   qmlRegisterType<ValueMapModel>( "org.qfield", 1, 0, "ValueMapModel" );
   qmlRegisterType<RecentProjectListModel>( "org.qgis", 1, 0, "RecentProjectListModel" );
@@ -279,6 +308,7 @@ void QgisMobileapp::initDeclarative()
   qmlRegisterType<FeatureCheckListModel>( "org.qgis", 1, 0, "FeatureCheckListModel" );
   qmlRegisterType<GeometryEditorsModel>( "org.qfield", 1, 0, "GeometryEditorsModel" );
   qmlRegisterType<ExpressionEvaluator>( "org.qfield", 1, 0, "ExpressionEvaluator" );
+  qmlRegisterType<GnssPositionPipeline>( "org.qfield", 1, 0, "GnssPositionPipeline" );
   REGISTER_SINGLETON( "org.qfield", GeometryEditorsModel, "GeometryEditorsModelSingleton" );
   REGISTER_SINGLETON( "org.qfield", GeometryUtils, "GeometryUtils" );
   REGISTER_SINGLETON( "org.qfield", FeatureUtils, "FeatureUtils" );
@@ -291,8 +321,10 @@ void QgisMobileapp::initDeclarative()
   qmlRegisterUncreatableType<PlatformUtilities>( "org.qgis", 1, 0, "PlatformUtilities", "" );
   qmlRegisterUncreatableType<FlatLayerTreeModel>( "org.qfield", 1, 0, "FlatLayerTreeModel", "The FlatLayerTreeModel is available as context property `flatLayerTree`." );
   qmlRegisterUncreatableType<TrackingModel>( "org.qfield", 1, 0, "TrackingModel", "The TrackingModel is available as context property `trackingModel`." );
+  qmlRegisterUncreatableType<FeatureCommitQueue>( "org.qfield", 1, 0, "FeatureCommitQueue", "The FeatureCommitQueue is available as context property `featureCommitQueue`." );
 
   qRegisterMetaType<SnappingResult>( "SnappingResult" );
+  qRegisterMetaType<GnssPositionInformation>( "GnssPositionInformation" );
 
   // Calculate device pixels
   qreal dpi = std::max( QApplication::desktop()->logicalDpiY(), QApplication::desktop()->logicalDpiY() );
@@ -317,6 +349,7 @@ void QgisMobileapp::initDeclarative()
   rootContext()->setContextProperty( "qfieldAuthRequestHandler", mAuthRequestHandler );
 #endif
   rootContext()->setContextProperty( "trackingModel", mTrackingModel );
+  rootContext()->setContextProperty( "featureCommitQueue", mFeatureCommitQueue );
 
   addImageProvider( QLatin1String( "legend" ), mLegendImageProvider );
 }
@@ -458,12 +491,57 @@ void QgisMobileapp::loadProjectFile( const QString &path )
 
 void QgisMobileapp::reloadProjectFile( const QString &path )
 {
+  mFeatureCommitQueue->flush();
+  mLayerResolver->cancel();
   mProject->removeAllMapLayers();
   mTrackingModel->reset();
 
+#if VERSION_INT >= 31000
+  const bool asynchronous = QSettings().value( QStringLiteral( "asynchronousProjectLoading" ), false ).toBool();
+#else
+  const bool asynchronous = false;
+#endif
+
   emit loadProjectStarted( path );
+
+#if VERSION_INT >= 31000
+  if ( asynchronous )
+  {
+    // the layers are opened in the background, see onLayersResolved()
+    mProject->read( path, QgsProject::FlagDontResolveLayers );
+    loadProjectFonts( path );
+    loadProjectQuirks();
+
+    // the canvas layers are only set once the project has been read completely, the layer tree is already known
+    mLayerResolver->resolve( LayerResolver::visibleLayers( mProject ) );
+    return;
+  }
+#endif
+
   mProject->read( path );
+  mTrackingModel->recoverTracks();
+  loadProjectFonts( path );
+  loadProjectQuirks();
 
+  emit projectLayersReady();
+  emit loadProjectEnded();
+}
+
+void QgisMobileapp::onLayersResolved()
+{
+  // the project does not report the layers read without resolving them as bad
+  BadLayerHandler *handler = badLayerHandler();
+  if ( handler )
+    handler->handleInvalidLayers( mLayerResolver->invalidLayers() );
+
+  // the tracks are stored in layers which might have only been resolved now
+  mTrackingModel->recoverTracks();
+
+  emit loadProjectEnded();
+}
+
+void QgisMobileapp::loadProjectFonts( const QString &path )
+{
   // load fonts in same directory
   QDir fontDir = QDir::cleanPath( QFileInfo( path ).absoluteDir().path() + QDir::separator() + ".fonts" );
   QStringList fontExts = QStringList() << "*.ttf" << "*.TTF" << "*.otf" << "*.OTF";
@@ -476,10 +554,11 @@ void QgisMobileapp::reloadProjectFile( const QString &path )
     else
       QgsMessageLog::logMessage( tr( "Loading font %1" ).arg( fontFile ) );
   }
+}
 
-  loadProjectQuirks();
-
-  emit loadProjectEnded();
+BadLayerHandler *QgisMobileapp::badLayerHandler() const
+{
+  return rootObjects().isEmpty() ? nullptr : rootObjects().first()->findChild<BadLayerHandler *>();
 }
 
 void QgisMobileapp::print( int layoutIndex )
@@ -523,6 +602,7 @@ bool QgisMobileapp::event( QEvent *event )
 QgisMobileapp::~QgisMobileapp()
 {
   delete mOfflineEditing;
+  mFeatureCommitQueue->flush();
   mProject->removeAllMapLayers();
   // Reintroduce when created on the heap
   delete mProject;
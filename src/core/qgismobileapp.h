@@ -45,6 +45,8 @@
 #endif
 
 class AppInterface;
+class BadLayerHandler;
+class LayerResolver;
 class QgsOfflineEditing;
 class QgsQuickMapCanvasMap;
 class LayerTreeMapCanvasBridge;
@@ -52,6 +54,7 @@ class FlatLayerTreeModel;
 class LayerTreeModel;
 class LegendImageProvider;
 class TrackingModel;
+class FeatureCommitQueue;
 class QgsProject;
 
 
@@ -95,6 +98,10 @@ class QgisMobileapp : public QQmlApplicationEngine
      * Loads the project file found at path.
      * It does not reset the Auth Request Handler.
      *
+     * With the asynchronous project loading setting, the project is read without opening the
+     * layers, which are then opened in parallel in the background. The function returns right
+     * away, projectLayersReady() and loadProjectEnded() are emitted later on.
+     *
      * @param path The project file to load
      */
     void reloadProjectFile( const QString &path );
@@ -110,6 +117,12 @@ class QgisMobileapp : public QQmlApplicationEngine
      */
     void loadProjectStarted( const QString &filename );
 
+    /**
+     * Emitted when the visible layers of the project being loaded are available and the map
+     * can be used, while the remaining layers might still be loading.
+     */
+    void projectLayersReady();
+
     /**
      * Emitted when the project is fully loaded
      */
@@ -126,11 +139,20 @@ class QgisMobileapp : public QQmlApplicationEngine
 
     void onAfterFirstRendering();
 
+    //! Finishes loading a project once all its layers have been resolved
+    void onLayersResolved();
+
   private:
     void initDeclarative();
 
     void loadProjectQuirks();
 
+    //! Loads the fonts shipped in the .fonts directory next to the project at \a path
+    void loadProjectFonts( const QString &path );
+
+    //! Returns the bad layer handler of the QML interface
+    BadLayerHandler *badLayerHandler() const;
+
     QgsOfflineEditing *mOfflineEditing = nullptr;
     LayerTreeMapCanvasBridge *mLayerTreeCanvasBridge = nullptr;
     FlatLayerTreeModel *mFlatLayerTree = nullptr;
@@ -142,6 +164,7 @@ class QgisMobileapp : public QQmlApplicationEngine
     LegendImageProvider *mLegendImageProvider = nullptr;
 
     QgsProject *mProject = nullptr;
+    LayerResolver *mLayerResolver = nullptr;
     std::unique_ptr<QgsGpkgFlusher> mGpkgFlusher;
 #if VERSION_INT >= 30600
     QFieldAppAuthRequestHandler *mAuthRequestHandler = nullptr;
@@ -152,6 +175,7 @@ class QgisMobileapp : public QQmlApplicationEngine
     QgsExifTools mExifTools;
 
     TrackingModel *mTrackingModel = nullptr;
+    FeatureCommitQueue *mFeatureCommitQueue = nullptr;
 
 #if defined(Q_OS_ANDROID)
     AndroidPlatformUtilities mPlatformUtils;
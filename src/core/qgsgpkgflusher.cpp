@@ -21,38 +21,143 @@
 #include <qgsvectorlayer.h>
 
 #include <qgsproject.h>
+#include <qgssqliteutils.h>
 #include <sqlite3.h>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QObject>
+#include <QTimer>
+
+#include <map>
+
+namespace
+{
+  //! Returns the sqlite checkpoint mode of \a mode
+  int sqliteCheckpointMode( QgsGpkgFlusher::CheckpointMode mode )
+  {
+    switch ( mode )
+    {
+      case QgsGpkgFlusher::CheckpointMode::Restart:
+        return SQLITE_CHECKPOINT_RESTART;
+      case QgsGpkgFlusher::CheckpointMode::Truncate:
+        return SQLITE_CHECKPOINT_TRUNCATE;
+      case QgsGpkgFlusher::CheckpointMode::None:
+      case QgsGpkgFlusher::CheckpointMode::Passive:
+        break;
+    }
+    return SQLITE_CHECKPOINT_PASSIVE;
+  }
+}
 
 class Flusher : public QObject
 {
     Q_OBJECT
 
+  public:
+    ~Flusher() override;
+
+    void setCheckpointPolicy( const QgsGpkgFlusher::CheckpointPolicy &policy ) { mPolicy = policy; }
+
   public slots:
     void scheduleFlush( const QString &filename );
 
     void flush( const QString &filename );
 
+    void flushAll();
+
+    void close();
+
+  signals:
+    void checkpointed( const QString &filename, qint64 walSizeBefore, qint64 walSizeAfter, qint64 latency );
+
   private:
-    QMap<QString, QTimer *> mScheduledFlushes;
+    struct Database
+    {
+      sqlite3_database_unique_ptr db;
+      QTimer *timer = nullptr;
+      QElapsedTimer lastChange;
+    };
+
+    bool checkpoint( const QString &filename, Database &database, int mode );
+
+    QgsGpkgFlusher::CheckpointPolicy mPolicy;
+    std::map<QString, Database> mDatabases;
 };
 
 QgsGpkgFlusher::QgsGpkgFlusher( QgsProject *project )
   : QObject()
+  , mProject( project )
 {
   connect( project, &QgsProject::layersAdded, this, &QgsGpkgFlusher::onLayersAdded );
   mFlusher = new Flusher();
   mFlusher->moveToThread( &mFlusherThread );
+  connect( &mFlusherThread, &QThread::finished, mFlusher, &QObject::deleteLater );
   connect( this, &QgsGpkgFlusher::requestFlush, mFlusher, &Flusher::scheduleFlush );
+  connect( this, &QgsGpkgFlusher::requestFlushAll, mFlusher, &Flusher::flushAll );
+  connect( this, &QgsGpkgFlusher::requestClose, mFlusher, &Flusher::close );
+  connect( mFlusher, &Flusher::checkpointed, this, &QgsGpkgFlusher::onCheckpointed );
+  // do not keep connections to files which might get replaced while no project is open
+  connect( project, &QgsProject::cleared, this, &QgsGpkgFlusher::requestClose );
   mFlusherThread.start();
 }
 
 QgsGpkgFlusher::~QgsGpkgFlusher()
 {
+  emit requestClose();
   mFlusherThread.quit();
   mFlusherThread.wait();
 }
 
+QgsGpkgFlusher::CheckpointPolicy QgsGpkgFlusher::checkpointPolicy() const
+{
+  return mPolicy;
+}
+
+void QgsGpkgFlusher::setCheckpointPolicy( const CheckpointPolicy &policy )
+{
+  mPolicy = policy;
+  QMetaObject::invokeMethod( mFlusher, [this, policy]() { mFlusher->setCheckpointPolicy( policy ); } );
+}
+
+QgsGpkgFlusher::CheckpointStatistics QgsGpkgFlusher::statistics( const QString &filename ) const
+{
+  return mStatistics.value( filename );
+}
+
+qint64 QgsGpkgFlusher::walSize( const QString &filename )
+{
+  QFileInfo fi( filename + QStringLiteral( "-wal" ) );
+  return fi.exists() ? fi.size() : 0;
+}
+
+QgsGpkgFlusher::CheckpointMode QgsGpkgFlusher::checkpointMode( const CheckpointPolicy &policy, qint64 walSize, bool idle )
+{
+  if ( walSize == 0 )
+    return CheckpointMode::None;
+  else if ( walSize >= policy.truncateWalSize || idle )
+    return CheckpointMode::Truncate;
+  else if ( walSize >= policy.restartWalSize )
+    return CheckpointMode::Restart;
+  else
+    return CheckpointMode::Passive;
+}
+
+void QgsGpkgFlusher::flushAll()
+{
+  emit requestFlushAll();
+}
+
+void QgsGpkgFlusher::onCheckpointed( const QString &filename, qint64 walSizeBefore, qint64 walSizeAfter, qint64 latency )
+{
+  CheckpointStatistics &statistics = mStatistics[filename];
+  statistics.walSizeBefore = walSizeBefore;
+  statistics.walSizeAfter = walSizeAfter;
+  statistics.latency = latency;
+  statistics.count++;
+
+  emit checkpointed( filename, statistics );
+}
+
 void QgsGpkgFlusher::onLayersAdded( const QList<QgsMapLayer *> &layers )
 {
   for ( QgsMapLayer *layer : layers )
@@ -84,50 +189,115 @@ void QgsGpkgFlusher::onLayersAdded( const QList<QgsMapLayer *> &layers )
       QFileInfo fi( filePath );
       if ( fi.isFile() )
       {
-        connect( vl, &QgsVectorLayer::editingStopped, [this, filePath]() { emit requestFlush( filePath ); } );
+        connect( vl, &QgsVectorLayer::editingStopped, this, [this, filePath]() { emit requestFlush( filePath ); } );
       }
     }
   }
 }
 
+Flusher::~Flusher()
+{
+  close();
+}
+
 void Flusher::scheduleFlush( const QString &filename )
 {
-  if ( mScheduledFlushes.contains( filename ) )
+  Database &database = mDatabases[filename];
+  if ( !database.timer )
   {
-    mScheduledFlushes.value( filename )->start( 500 );
+    database.timer = new QTimer( this );
+    database.timer->setSingleShot( true );
+    connect( database.timer, &QTimer::timeout, this, [this, filename]() { flush( filename ); } );
   }
-  else
+
+  database.lastChange.start();
+  database.timer->start( mPolicy.flushDelay );
+}
+
+void Flusher::flush( const QString &filename )
+{
+  auto it = mDatabases.find( filename );
+  if ( it == mDatabases.end() )
+    return;
+
+  Database &database = it->second;
+  const qint64 walSize = QgsGpkgFlusher::walSize( filename );
+  const bool idle = !database.lastChange.isValid() || database.lastChange.elapsed() >= mPolicy.idleTimeout;
+
+  const QgsGpkgFlusher::CheckpointMode mode = QgsGpkgFlusher::checkpointMode( mPolicy, walSize, idle );
+  if ( mode == QgsGpkgFlusher::CheckpointMode::None )
+  {
+    // the timer is started again with the next change
+    return;
+  }
+
+  if ( !checkpoint( filename, database, sqliteCheckpointMode( mode ) ) )
+  {
+    database.timer->start( mPolicy.flushDelay );
+  }
+  else if ( mode != QgsGpkgFlusher::CheckpointMode::Truncate )
   {
-    QTimer *timer = new QTimer();
-    connect( timer, &QTimer::timeout, this, [this, filename]() { flush( filename ); } );
-    timer->setSingleShot( true );
-    mScheduledFlushes.insert( filename, timer );
-    timer->start( 500 );
+    // come back once the database has been idle long enough to reclaim the wal file
+    database.timer->start( static_cast<int>( std::max<qint64>( mPolicy.idleTimeout - database.lastChange.elapsed(), mPolicy.flushDelay ) ) );
   }
 }
 
-void Flusher::flush( const QString &filename )
+void Flusher::flushAll()
+{
+  for ( auto &it : mDatabases )
+  {
+    if ( it.second.timer )
+      it.second.timer->stop();
+
+    if ( QgsGpkgFlusher::walSize( it.first ) > 0 && !checkpoint( it.first, it.second, SQLITE_CHECKPOINT_TRUNCATE ) && it.second.timer )
+      it.second.timer->start( mPolicy.flushDelay );
+  }
+}
+
+void Flusher::close()
+{
+  flushAll();
+
+  for ( auto &it : mDatabases )
+    delete it.second.timer;
+
+  mDatabases.clear();
+}
+
+bool Flusher::checkpoint( const QString &filename, Database &database, int mode )
 {
-  sqlite3_database_unique_ptr db;
-  int status = db.open_v2( filename, SQLITE_OPEN_READWRITE, nullptr );
-  if ( status != SQLITE_OK )
+  if ( !database.db )
   {
-    QgsMessageLog::logMessage( QObject::tr( "There was an error opening the database <b>%1</b>: %2" ).arg( filename, db.errorMessage() ) );
+    int status = database.db.open_v2( filename, SQLITE_OPEN_READWRITE, nullptr );
+    if ( status != SQLITE_OK )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "There was an error opening the database <b>%1</b>: %2" ).arg( filename, database.db.errorMessage() ) );
+      database.db.reset();
+      return false;
+    }
+    // wait for concurrent writers instead of failing right away on RESTART and TRUNCATE checkpoints
+    sqlite3_busy_timeout( database.db.get(), 100 );
   }
 
-  QString error;
-  db.exec( "PRAGMA wal_checkpoint;", error );
+  const qint64 walSizeBefore = QgsGpkgFlusher::walSize( filename );
+
+  QElapsedTimer latency;
+  latency.start();
+  int status = sqlite3_wal_checkpoint_v2( database.db.get(), nullptr, mode, nullptr, nullptr );
 
-  if ( error.isEmpty() )
+  if ( status == SQLITE_BUSY )
   {
-    delete mScheduledFlushes[filename];
-    mScheduledFlushes.remove( filename );
+    // a reader or writer is still active, it will be retried
+    return false;
   }
-  else
+  else if ( status != SQLITE_OK )
   {
-    QgsMessageLog::logMessage( QObject::tr( "Could not flush database %1 (%3) " ).arg( filename, error ) );
-    mScheduledFlushes[filename]->start( 500 );
+    QgsMessageLog::logMessage( QObject::tr( "Could not flush database %1 (%2) " ).arg( filename, database.db.errorMessage() ) );
+    return false;
   }
+
+  emit checkpointed( filename, walSizeBefore, QgsGpkgFlusher::walSize( filename ), latency.elapsed() );
+  return true;
 }
 
 #include "qgsgpkgflusher.moc"
@@ -18,7 +18,9 @@
 #ifndef QGSGPKGFLUSHER_H
 #define QGSGPKGFLUSHER_H
 
+#include <QHash>
 #include <QObject>
+#include <QThread>
 #include <qgsmaplayer.h>
 
 class QgsProject;
@@ -30,28 +32,116 @@ class Flusher;
  * to the gpkg itself on all added layers.
  * It will start a background thread and post an event to it whenever the gpkg has been changed.
  * After a delay of 500ms without any changes the wal file will be flushed.
+ *
+ * The background thread keeps one connection per database open and picks the checkpoint
+ * mode according to the CheckpointPolicy: a PASSIVE checkpoint for small wal files, a
+ * RESTART checkpoint once the wal file grows large and a TRUNCATE checkpoint once it is
+ * huge or the database has been idle for a while. Once the wal file is empty or has been truncated
+ * the database is left alone until it changes again.
  */
 class QgsGpkgFlusher : public QObject
 {
     Q_OBJECT
 
   public:
+
+    //! Thresholds used to pick the checkpoint mode
+    struct CheckpointPolicy
+    {
+      //! the delay in milliseconds without changes after which a checkpoint is run
+      int flushDelay = 500;
+      //! the wal size in bytes from which on RESTART checkpoints are run
+      qint64 restartWalSize = 4 * 1024 * 1024;
+      //! the wal size in bytes from which on TRUNCATE checkpoints are run
+      qint64 truncateWalSize = 64 * 1024 * 1024;
+      //! the time in milliseconds without changes after which the wal file is truncated
+      int idleTimeout = 30000;
+    };
+
+    //! The checkpoint run on a database
+    enum class CheckpointMode
+    {
+      None, //!< Nothing to checkpoint, the wal file is empty
+      Passive,
+      Restart,
+      Truncate,
+    };
+
+    //! Metrics collected on the latest checkpoint of a database
+    struct CheckpointStatistics
+    {
+      //! the wal size in bytes before the checkpoint
+      qint64 walSizeBefore = 0;
+      //! the wal size in bytes after the checkpoint
+      qint64 walSizeAfter = 0;
+      //! the time in milliseconds the checkpoint took
+      qint64 latency = 0;
+      //! the total number of checkpoints run on the database
+      int count = 0;
+    };
+
     explicit QgsGpkgFlusher( QgsProject *project );
     ~QgsGpkgFlusher();
 
+    //! Returns the policy used to pick the checkpoint mode
+    CheckpointPolicy checkpointPolicy() const;
+
+    //! Sets the \a policy used to pick the checkpoint mode
+    void setCheckpointPolicy( const CheckpointPolicy &policy );
+
+    //! Returns the metrics of the latest checkpoint run on the database at \a filename
+    CheckpointStatistics statistics( const QString &filename ) const;
+
+    //! Returns the current size of the wal file of the database at \a filename in bytes
+    static qint64 walSize( const QString &filename );
+
+    /**
+     * Returns the checkpoint to run according to \a policy on a database with a wal file of \a walSize bytes,
+     * which has been \a idle for at least the idle timeout of the policy.
+     */
+    static CheckpointMode checkpointMode( const CheckpointPolicy &policy, qint64 walSize, bool idle );
+
+  public slots:
+
+    /**
+     * Truncates the wal files of all known databases right away.
+     * Should be called when the application gets suspended.
+     */
+    void flushAll();
+
   signals:
     /**
      * Emitted when a file has changed and a flush should be scheduled.
      */
     void requestFlush( const QString &filename );
 
+    /**
+     * Emitted when all files should be flushed right away.
+     */
+    void requestFlushAll();
+
+    /**
+     * Emitted when all connections should be closed, e.g. because the project is cleared.
+     */
+    void requestClose();
+
+    /**
+     * Emitted when a checkpoint has been run on the database at \a filename.
+     */
+    void checkpointed( const QString &filename, const QgsGpkgFlusher::CheckpointStatistics &statistics );
+
   private slots:
     void onLayersAdded( const QList<QgsMapLayer *> &layers );
+    void onCheckpointed( const QString &filename, qint64 walSizeBefore, qint64 walSizeAfter, qint64 latency );
 
   private:
     QgsProject *mProject = nullptr;
     QThread mFlusherThread;
     Flusher *mFlusher = nullptr;
+    CheckpointPolicy mPolicy;
+    QHash<QString, CheckpointStatistics> mStatistics;
 };
 
+Q_DECLARE_METATYPE( QgsGpkgFlusher::CheckpointStatistics )
+
 #endif // QGSGPKGFLUSHER_H
@@ -15,9 +15,15 @@
 #include "math.h"
 
 #include "qgssggeometry.h"
-extern "C" {
-#include "tessellate.h"
-}
+#include "polygontriangulator.h"
+
+#include <qgscurve.h>
+#include <qgscurvepolygon.h>
+#include <qgsgeometrycollection.h>
+#include <qgslinestring.h>
+
+#include <algorithm>
+#include <memory>
 
 
 QgsSGGeometry::QgsSGGeometry()
@@ -25,13 +31,15 @@ QgsSGGeometry::QgsSGGeometry()
 }
 
 QgsSGGeometry::QgsSGGeometry( const QgsGeometry &geom, const QColor &color, int width )
+  : QgsSGGeometry( geom, geom.type() == QgsWkbTypes::PolygonGeometry ? PolygonTriangulator::triangulate( geom.constGet() ) : QVector<QSGGeometry::Point2D>(), color, width )
 {
-  //TODO: Fix const-correcteness upstream
-  QgsGeometry &gg = const_cast<QgsGeometry &>( geom );
+}
 
+QgsSGGeometry::QgsSGGeometry( const QgsGeometry &geom, const QVector<QSGGeometry::Point2D> &triangles, const QColor &color, int width )
+{
   mMaterial.setColor( color );
 
-  switch ( gg.type() )
+  switch ( geom.type() )
   {
     case QgsWkbTypes::PointGeometry:
       // we should never get point here, use GeometryRenderer quick item to render geometries
@@ -39,71 +47,25 @@ QgsSGGeometry::QgsSGGeometry( const QgsGeometry &geom, const QColor &color, int
       break;
 
     case QgsWkbTypes::LineGeometry:
-      if ( gg.isMultipart() )
-      {
-        const QgsMultiPolylineXY lines = gg.asMultiPolyline();
-
-        for ( const QgsPolylineXY &line : lines )
-        {
-          QSGGeometryNode *geomNode = new QSGGeometryNode;
-          geomNode->setGeometry( qgsPolylineToQSGGeometry( line, width ) );
-          geomNode->setFlag( QSGNode::OwnsGeometry );
-          applyStyle( geomNode );
-          appendChildNode( geomNode );
-        }
-      }
-      else
-      {
-        QSGGeometryNode *geomNode = new QSGGeometryNode;
-        geomNode->setGeometry( qgsPolylineToQSGGeometry( gg.asPolyline(), width ) );
-        geomNode->setFlag( QSGNode::OwnsGeometry );
-        applyStyle( geomNode );
-        appendChildNode( geomNode );
-      }
+      appendCurveNodes( geom.constGet(), width );
       break;
 
     case QgsWkbTypes::PolygonGeometry:
-      if ( gg.isMultipart() )
-      {
-        const QgsMultiPolygonXY polygons = gg.asMultiPolygon();
-
-        QSGOpacityNode *on = new QSGOpacityNode;
-        on->setOpacity( 0.5 );
-
-        for ( const QgsPolygonXY &polygon : polygons )
-        {
-          QSGGeometryNode *geomNode = new QSGGeometryNode;
-          geomNode->setGeometry( qgsPolygonToQSGGeometry( polygon ) );
-          geomNode->setFlag( QSGNode::OwnsGeometry );
-          applyStyle( geomNode );
-          on->appendChildNode( geomNode );
-
-          geomNode = new QSGGeometryNode;
-          geomNode->setGeometry( qgsPolylineToQSGGeometry( polygon.first(), width ) );
-          geomNode->setFlag( QSGNode::OwnsGeometry );
-          applyStyle( geomNode );
-          appendChildNode( geomNode );
-        }
-
-        appendChildNode( on );
-      }
-      else
-      {
-        QSGOpacityNode *on = new QSGOpacityNode;
-        on->setOpacity( 0.5 );
-        QSGGeometryNode *geomNode = new QSGGeometryNode;
-        geomNode->setGeometry( qgsPolygonToQSGGeometry( gg.asPolygon() ) );
-        geomNode->setFlag( QSGNode::OwnsGeometry );
-        applyStyle( geomNode );
-        on->appendChildNode( geomNode );
-        appendChildNode( on );
-        geomNode = new QSGGeometryNode;
-        geomNode->setGeometry( qgsPolylineToQSGGeometry( gg.asPolygon().first(), width ) );
-        geomNode->setFlag( QSGNode::OwnsGeometry );
-        applyStyle( geomNode );
-        appendChildNode( geomNode );
-      }
+    {
+      // all the parts are filled by a single node
+      QSGOpacityNode *on = new QSGOpacityNode;
+      on->setOpacity( 0.5 );
+      QSGGeometryNode *geomNode = new QSGGeometryNode;
+      geomNode->setGeometry( trianglesToQSGGeometry( triangles ) );
+      geomNode->setFlag( QSGNode::OwnsGeometry );
+      applyStyle( geomNode );
+      on->appendChildNode( geomNode );
+      appendChildNode( on );
+
+      // the outlines of the exterior and the interior rings, drawn on top of the fill
+      appendCurveNodes( geom.constGet(), width );
       break;
+    }
 
     default:
       // Nothing to do
@@ -116,16 +78,48 @@ void QgsSGGeometry::applyStyle( QSGGeometryNode *geomNode )
   geomNode->setMaterial( &mMaterial );
 }
 
-QSGGeometry *QgsSGGeometry::qgsPolylineToQSGGeometry( const QgsPolylineXY &line, int width )
+void QgsSGGeometry::appendCurveNodes( const QgsAbstractGeometry *geometry, int width )
 {
-  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), line.count() );
+  if ( const QgsGeometryCollection *collection = qgsgeometry_cast<const QgsGeometryCollection *>( geometry ) )
+  {
+    for ( int i = 0; i < collection->numGeometries(); ++i )
+      appendCurveNodes( collection->geometryN( i ), width );
+  }
+  else if ( const QgsCurvePolygon *polygon = qgsgeometry_cast<const QgsCurvePolygon *>( geometry ) )
+  {
+    appendCurveNodes( polygon->exteriorRing(), width );
+    for ( int i = 0; i < polygon->numInteriorRings(); ++i )
+      appendCurveNodes( polygon->interiorRing( i ), width );
+  }
+  else if ( const QgsCurve *curve = qgsgeometry_cast<const QgsCurve *>( geometry ) )
+  {
+    QSGGeometryNode *geomNode = new QSGGeometryNode;
+    if ( const QgsLineString *line = qgsgeometry_cast<const QgsLineString *>( curve ) )
+    {
+      geomNode->setGeometry( qgsLineStringToQSGGeometry( line, width ) );
+    }
+    else
+    {
+      const std::unique_ptr<QgsLineString> segmentized( curve->curveToLine() );
+      geomNode->setGeometry( qgsLineStringToQSGGeometry( segmentized.get(), width ) );
+    }
+    geomNode->setFlag( QSGNode::OwnsGeometry );
+    applyStyle( geomNode );
+    appendChildNode( geomNode );
+  }
+}
+
+QSGGeometry *QgsSGGeometry::qgsLineStringToQSGGeometry( const QgsLineString *line, int width )
+{
+  const int count = line->numPoints();
+  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), count );
   QSGGeometry::Point2D *vertices = sgGeom->vertexDataAsPoint2D();
 
-  int i = 0;
-  for ( const QgsPointXY &pt : line )
+  const double *x = line->xData();
+  const double *y = line->yData();
+  for ( int i = 0; i < count; ++i )
   {
-    vertices[i].set( static_cast<float>( pt.x() ), static_cast<float>( pt.y() ) );
-    i++;
+    vertices[i].set( static_cast<float>( x[i] ), static_cast<float>( y[i] ) );
   }
 
   sgGeom->setLineWidth( width );
@@ -134,44 +128,10 @@ QSGGeometry *QgsSGGeometry::qgsPolylineToQSGGeometry( const QgsPolylineXY &line,
   return sgGeom;
 }
 
-QSGGeometry *QgsSGGeometry::qgsPolygonToQSGGeometry( const QgsPolygonXY &polygon )
+QSGGeometry *QgsSGGeometry::trianglesToQSGGeometry( const QVector<QSGGeometry::Point2D> &triangles )
 {
-  QgsPolygonXY::ConstIterator it = polygon.constBegin();
-
-  double *coordinates_out;
-  int *tris_out;
-  int nverts, ntris;
-
-  const QgsPolylineXY &ring = *it;
-
-  double *vertices_in = ( double * )malloc( ring.size() * 2 * sizeof( double ) );
-  const double *contours_array[] = { vertices_in, vertices_in + ring.size() * 2 };
-  int i = 0;
-
-  for ( const QgsPointXY &point : ring )
-  {
-    vertices_in[i++] = point.x();
-    vertices_in[i++] = point.y();
-  }
-
-  tessellate( &coordinates_out, &nverts,
-              &tris_out, &ntris,
-              contours_array, contours_array + 2 );
-
-  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), ntris * 3 );
-
-  QSGGeometry::Point2D *vertices = sgGeom->vertexDataAsPoint2D();
-
-  for ( int j = 0; j < ntris * 3; j++ )
-  {
-    vertices[j].x = coordinates_out[tris_out[j] * 2];
-    vertices[j].y = coordinates_out[tris_out[j] * 2 + 1];
-  }
-
-  free( vertices_in );
-  free( coordinates_out );
-  free( tris_out );
-
+  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), triangles.size() );
+  std::copy( triangles.constBegin(), triangles.constEnd(), sgGeom->vertexDataAsPoint2D() );
   sgGeom->setDrawingMode( QSGGeometry::DrawTriangles );
 
   return sgGeom;
@@ -20,17 +20,30 @@
 
 #include "qgsgeometry.h"
 
+class QgsLineString;
+
 class QgsSGGeometry : public QSGNode
 {
   public:
     QgsSGGeometry();
+
+    //! Creates the nodes of \a geom, polygons are triangulated on the fly
     QgsSGGeometry( const QgsGeometry &geom, const QColor &color, int width );
 
+    /**
+     * Creates the nodes of \a geom, with the polygons filled by the already computed \a triangles,
+     * e.g. taken from the PolygonTriangulator cache.
+     */
+    QgsSGGeometry( const QgsGeometry &geom, const QVector<QSGGeometry::Point2D> &triangles, const QColor &color, int width );
+
   private:
     void applyStyle( QSGGeometryNode *geomNode );
 
-    static QSGGeometry *qgsPolylineToQSGGeometry( const QgsPolylineXY &line, int width );
-    static QSGGeometry *qgsPolygonToQSGGeometry( const QgsPolygonXY &polygon );
+    //! Appends a line strip node for each curve of \a geometry, the rings of polygons included
+    void appendCurveNodes( const QgsAbstractGeometry *geometry, int width );
+
+    static QSGGeometry *qgsLineStringToQSGGeometry( const QgsLineString *line, int width );
+    static QSGGeometry *trianglesToQSGGeometry( const QVector<QSGGeometry::Point2D> &triangles );
 
     QSGFlatColorMaterial mMaterial;
 };
@@ -15,8 +15,14 @@
  ***************************************************************************/
 
 #include <qgsmessagelog.h>
+#include <qgsexpressioncontextutils.h>
 
 #include "referencingfeaturelistmodel.h"
+#include "featureutils.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
 
 ReferencingFeatureListModel::ReferencingFeatureListModel( QObject *parent )
   : QAbstractItemModel( parent )
@@ -67,14 +73,36 @@ QVariant ReferencingFeatureListModel::data( const QModelIndex &index, int role )
   if ( role == DisplayString )
     return mEntries.value( index.row() ).displayString;
   if ( role == ReferencingFeature )
-    return mEntries.value( index.row() ).referencingFeature;
+    return completeFeature( mRelation.referencingLayer(), mEntries.value( index.row() ).referencingFeature );
   if ( role == NmReferencedFeature )
-    return mEntries.value( index.row() ).nmReferencedFeature;
+    return completeFeature( mNmRelation.referencedLayer(), mEntries.value( index.row() ).nmReferencedFeature );
   if ( role == NmDisplayString )
     return mEntries.value( index.row() ).nmDisplayString;
   return QVariant();
 }
 
+bool ReferencingFeatureListModel::canFetchMore( const QModelIndex &parent ) const
+{
+  Q_UNUSED( parent )
+  return mPageSize > 0 && mFetchedCount < mFeatureIds.size();
+}
+
+void ReferencingFeatureListModel::fetchMore( const QModelIndex &parent )
+{
+  Q_UNUSED( parent )
+
+  // a page is still loading, views ask again once its rows have been inserted
+  if ( mGatherer || !canFetchMore( QModelIndex() ) )
+    return;
+
+  const QList<QgsFeatureId> ids = mFeatureIds.mid( mFetchedCount, mPageSize );
+  mFetchedCount += ids.size();
+
+  FeatureGatherer *gatherer = createGatherer();
+  gatherer->setFeatureIds( ids );
+  startGatherer( gatherer );
+}
+
 void ReferencingFeatureListModel::setFeature( const QgsFeature &feature )
 {
   mFeature = feature;
@@ -118,15 +146,86 @@ bool ReferencingFeatureListModel::parentPrimariesAvailable() const
   return mParentPrimariesAvailable;
 }
 
+void ReferencingFeatureListModel::setPageSize( int pageSize )
+{
+  if ( mPageSize == pageSize )
+    return;
+
+  mPageSize = pageSize;
+  emit pageSizeChanged();
+  reload();
+}
+
+void ReferencingFeatureListModel::setOrderBy( const QString &orderBy )
+{
+  if ( mOrderBy == orderBy )
+    return;
+
+  mOrderBy = orderBy;
+  emit orderByChanged();
+  reload();
+}
+
+void ReferencingFeatureListModel::setOrderAscending( bool orderAscending )
+{
+  if ( mOrderAscending == orderAscending )
+    return;
+
+  mOrderAscending = orderAscending;
+  emit orderAscendingChanged();
+  reload();
+}
+
+void ReferencingFeatureListModel::setTotalCount( int totalCount )
+{
+  if ( mTotalCount == totalCount )
+    return;
+
+  mTotalCount = totalCount;
+  emit totalCountChanged();
+}
+
+void ReferencingFeatureListModel::featureIdsCollected()
+{
+  if ( !mGatherer )
+    return;
+
+  mFeatureIds = mGatherer->featureIds();
+  mFetchedCount = std::min( mPageSize, static_cast<int>( mFeatureIds.size() ) );
+  setTotalCount( mFeatureIds.size() );
+}
+
+void ReferencingFeatureListModel::appendEntries()
+{
+  if ( !mGatherer )
+    return;
+
+  const QList<Entry> entries = mGatherer->takeEntries();
+
+  if ( mEntriesOutdated )
+  {
+    // keep showing the previous entries until the first batch arrives
+    beginResetModel();
+    mEntries = entries;
+    endResetModel();
+    mEntriesOutdated = false;
+  }
+  else if ( !entries.isEmpty() )
+  {
+    beginInsertRows( QModelIndex(), mEntries.size(), mEntries.size() + entries.size() - 1 );
+    mEntries.append( entries );
+    endInsertRows();
+  }
+}
+
 void ReferencingFeatureListModel::updateModel()
 {
-  beginResetModel();
+  appendEntries();
 
-  if ( mGatherer )
-    mEntries = mGatherer->entries();
+  if ( mPageSize <= 0 )
+    setTotalCount( mEntries.size() );
 
-  endResetModel();
-  modelUpdated();
+  emit modelUpdated();
 }
 
 void ReferencingFeatureListModel::gathererThreadFinished()
@@ -147,40 +246,75 @@ void ReferencingFeatureListModel::reload()
 
   if ( checkParentPrimaries() )
   {
-    bool wasLoading = false;
+    FeatureGatherer *gatherer = createGatherer();
+    gatherer->setPageSize( mPageSize );
 
-    if ( mGatherer )
-    {
-      // Send the gatherer thread to the graveyard:
-      //   forget about it, tell it to stop and delete when finished
-      disconnect( mGatherer, &FeatureGatherer::collectedValues, this, &ReferencingFeatureListModel::updateModel );
-      disconnect( mGatherer, &FeatureGatherer::finished, this, &ReferencingFeatureListModel::gathererThreadFinished );
-      connect( mGatherer, &FeatureGatherer::finished, mGatherer, &FeatureGatherer::deleteLater );
-      mGatherer->stop();
-      wasLoading = true;
-    }
-
-    mGatherer = new FeatureGatherer( mFeature, mRelation, mNmRelation );
-
-    connect( mGatherer, &FeatureGatherer::collectedValues, this, &ReferencingFeatureListModel::updateModel );
-    connect( mGatherer, &FeatureGatherer::finished, this, &ReferencingFeatureListModel::gathererThreadFinished );
-
-    mGatherer->start();
-    if ( !wasLoading )
-      emit isLoadingChanged();
+    mFeatureIds.clear();
+    mFetchedCount = 0;
+    mEntriesOutdated = true;
+    startGatherer( gatherer );
   }
   else
   {
     //clear model entries
     beginResetModel();
     mEntries.clear();
+    mFeatureIds.clear();
+    mFetchedCount = 0;
+    mEntriesOutdated = false;
     endResetModel();
+    setTotalCount( 0 );
   }
 
   //set the property for parent primaries available status
   setParentPrimariesAvailable( checkParentPrimaries() );
 }
 
+FeatureGatherer *ReferencingFeatureListModel::createGatherer() const
+{
+  FeatureGatherer *gatherer = new FeatureGatherer( mFeature, mRelation, mNmRelation );
+  if ( !mOrderBy.isEmpty() )
+    gatherer->setOrderBy( QgsFeatureRequest::OrderBy( QList<QgsFeatureRequest::OrderByClause>() << QgsFeatureRequest::OrderByClause( mOrderBy, mOrderAscending ) ) );
+  return gatherer;
+}
+
+void ReferencingFeatureListModel::startGatherer( FeatureGatherer *gatherer )
+{
+  bool wasLoading = false;
+
+  if ( mGatherer )
+  {
+    // Send the gatherer thread to the graveyard:
+    //   forget about it, tell it to stop and delete when finished
+    disconnect( mGatherer, &FeatureGatherer::featureIdsCollected, this, &ReferencingFeatureListModel::featureIdsCollected );
+    disconnect( mGatherer, &FeatureGatherer::entriesAvailable, this, &ReferencingFeatureListModel::appendEntries );
+    disconnect( mGatherer, &FeatureGatherer::collectedValues, this, &ReferencingFeatureListModel::updateModel );
+    disconnect( mGatherer, &FeatureGatherer::finished, this, &ReferencingFeatureListModel::gathererThreadFinished );
+    connect( mGatherer, &FeatureGatherer::finished, mGatherer, &FeatureGatherer::deleteLater );
+    mGatherer->stop();
+    wasLoading = true;
+  }
+
+  mGatherer = gatherer;
+
+  connect( mGatherer, &FeatureGatherer::featureIdsCollected, this, &ReferencingFeatureListModel::featureIdsCollected );
+  connect( mGatherer, &FeatureGatherer::entriesAvailable, this, &ReferencingFeatureListModel::appendEntries );
+  connect( mGatherer, &FeatureGatherer::collectedValues, this, &ReferencingFeatureListModel::updateModel );
+  connect( mGatherer, &FeatureGatherer::finished, this, &ReferencingFeatureListModel::gathererThreadFinished );
+
+  mGatherer->start();
+  if ( !wasLoading )
+    emit isLoadingChanged();
+}
+
+QgsFeature ReferencingFeatureListModel::completeFeature( QgsVectorLayer *layer, const QgsFeature &feature ) const
+{
+  if ( !layer || !layer->isSpatial() || !feature.isValid() || feature.hasGeometry() )
+    return feature;
+
+  return layer->getFeature( feature.id() );
+}
+
 bool ReferencingFeatureListModel::deleteFeature( QgsFeatureId referencingFeatureId )
 {
   QgsVectorLayer *vl = mRelation.referencingLayer();
@@ -230,3 +364,209 @@ bool ReferencingFeatureListModel::checkParentPrimaries()
   }
   return true;
 }
+
+FeatureGatherer::FeatureGatherer( const QgsFeature &feature, const QgsRelation &relation, const QgsRelation &nmRelation )
+  : mNmRelation( nmRelation )
+{
+  // everything touching the layers is set up here on the main thread, run() only works on snapshots
+  QgsVectorLayer *referencingLayer = relation.referencingLayer();
+  mReferencingSource.reset( new QgsVectorLayerFeatureSource( referencingLayer ) );
+  mContext = QgsExpressionContext( QgsExpressionContextUtils::globalProjectLayerScopes( referencingLayer ) );
+  mDisplayExpression = referencingLayer->displayExpression();
+  mRequest = relation.getRelatedFeaturesRequest( feature );
+  if ( !QgsExpression( mDisplayExpression ).needsGeometry() )
+    mRequest.setFlags( mRequest.flags() | QgsFeatureRequest::NoGeometry );
+
+  if ( mNmRelation.isValid() )
+  {
+    QgsVectorLayer *nmReferencedLayer = mNmRelation.referencedLayer();
+    mNmReferencedSource.reset( new QgsVectorLayerFeatureSource( nmReferencedLayer ) );
+    mNmContext = QgsExpressionContext( QgsExpressionContextUtils::globalProjectLayerScopes( nmReferencedLayer ) );
+    mNmDisplayExpression = nmReferencedLayer->displayExpression();
+    mNmNeedsGeometry = QgsExpression( mNmDisplayExpression ).needsGeometry();
+  }
+}
+
+void FeatureGatherer::setOrderBy( const QgsFeatureRequest::OrderBy &orderBy )
+{
+  mRequest.setOrderBy( orderBy );
+}
+
+void FeatureGatherer::setPageSize( int pageSize )
+{
+  mPageSize = pageSize;
+}
+
+void FeatureGatherer::setFeatureIds( const QList<QgsFeatureId> &ids )
+{
+  QgsFeatureIds fids;
+  for ( QgsFeatureId id : ids )
+    fids << id;
+
+  // the ids already match the relation, the order by clause keeps them in order
+  mRequest.setFilterFids( fids );
+}
+
+void FeatureGatherer::run()
+{
+  mWasCanceled = false;
+
+  // small first batch to show something quickly, larger ones afterwards
+  const int firstBatchSize = 20;
+  const int batchSize = 200;
+
+  QgsExpression expression( mDisplayExpression );
+  expression.prepare( &mContext );
+  QgsExpression nmExpression( mNmDisplayExpression );
+  if ( mNmReferencedSource )
+    nmExpression.prepare( &mNmContext );
+
+  QgsFeatureRequest request( mRequest );
+  if ( mPageSize > 0 )
+  {
+    // cheap first pass to know the number and the order of all children
+    QgsFeatureRequest idsRequest( mRequest );
+    idsRequest.setNoAttributes();
+    idsRequest.setFlags( idsRequest.flags() | QgsFeatureRequest::NoGeometry );
+
+    QgsFeatureIterator idsIt = mReferencingSource->getFeatures( idsRequest );
+    QgsFeature feature;
+    while ( idsIt.nextFeature( feature ) )
+    {
+      if ( mWasCanceled )
+        return;
+
+      mFeatureIds << feature.id();
+    }
+
+    emit featureIdsCollected();
+
+    QgsFeatureIds pageIds;
+    for ( int i = 0; i < std::min( mPageSize, static_cast<int>( mFeatureIds.size() ) ); i++ )
+      pageIds << mFeatureIds.at( i );
+    request.setFilterFids( pageIds );
+  }
+
+  QgsFeatureIterator relatedFeaturesIt = mReferencingSource->getFeatures( request );
+
+  QgsFeatureList childFeatures;
+  int currentBatchSize = firstBatchSize;
+  QgsFeature childFeature;
+  while ( relatedFeaturesIt.nextFeature( childFeature ) )
+  {
+    if ( mWasCanceled )
+      return;
+
+    childFeatures << childFeature;
+    if ( childFeatures.size() >= currentBatchSize )
+    {
+      processBatch( childFeatures, expression, nmExpression );
+      childFeatures.clear();
+      currentBatchSize = batchSize;
+    }
+  }
+
+  if ( !childFeatures.isEmpty() )
+    processBatch( childFeatures, expression, nmExpression );
+
+  if ( mWasCanceled )
+    return;
+
+  emit collectedValues();
+}
+
+QList<ReferencingFeatureListModel::Entry> FeatureGatherer::takeEntries()
+{
+  QMutexLocker locker( &mEntriesMutex );
+  QList<ReferencingFeatureListModel::Entry> entries;
+  entries.swap( mEntries );
+  return entries;
+}
+
+void FeatureGatherer::processBatch( const QgsFeatureList &childFeatures, QgsExpression &expression, QgsExpression &nmExpression )
+{
+  QList<QgsRelation::FieldPair> fieldPairs;
+  QStringList referencedFields;
+  QStringList referencingFields;
+  QHash<QgsAttributes, QgsFeature> nmFeatures;
+
+  // the features are joined on their typed values, e.g. a NULL key must not match an empty string.
+  // Integer keys are widened, the fields of both sides might have been created with different sizes.
+  auto attributesKey = []( const QgsFeature & feature, const QStringList & fields )
+  {
+    QgsAttributes values;
+    values.reserve( fields.size() );
+    for ( const QString &field : fields )
+    {
+      QVariant value = feature.attribute( field );
+      if ( value.type() == QVariant::Int || value.type() == QVariant::UInt || value.type() == QVariant::LongLong )
+        value = value.isNull() ? QVariant( QVariant::LongLong ) : QVariant( value.toLongLong() );
+      values << value;
+    }
+    return values;
+  };
+
+  if ( mNmReferencedSource )
+  {
+    fieldPairs = mNmRelation.fieldPairs();
+    for ( const QgsRelation::FieldPair &fieldPair : qgis::as_const( fieldPairs ) )
+    {
+      referencedFields << fieldPair.referencedField();
+      referencingFields << fieldPair.referencingField();
+    }
+
+    QList<QgsAttributes> values;
+    for ( const QgsFeature &childFeature : childFeatures )
+    {
+      QgsAttributes attributes;
+      for ( const QString &referencingField : qgis::as_const( referencingFields ) )
+        attributes << childFeature.attribute( referencingField );
+      values << attributes;
+    }
+
+    // one request for the whole batch instead of one per child
+    const QString filter = FeatureUtils::attributeValuesFilter( referencedFields, values );
+    if ( !filter.isEmpty() )
+    {
+      QgsFeatureRequest nmRequest = QgsFeatureRequest().setFilterExpression( filter );
+      if ( !mNmNeedsGeometry )
+        nmRequest.setFlags( QgsFeatureRequest::NoGeometry );
+
+      QgsFeatureIterator nmFeaturesIt = mNmReferencedSource->getFeatures( nmRequest );
+      QgsFeature nmFeature;
+      while ( nmFeaturesIt.nextFeature( nmFeature ) )
+      {
+        if ( mWasCanceled )
+          return;
+
+        nmFeatures.insert( attributesKey( nmFeature, referencedFields ), nmFeature );
+      }
+    }
+  }
+
+  QList<ReferencingFeatureListModel::Entry> entries;
+  entries.reserve( childFeatures.size() );
+  for ( const QgsFeature &childFeature : childFeatures )
+  {
+    mContext.setFeature( childFeature );
+    const QString displayString = expression.evaluate( &mContext ).toString();
+
+    QgsFeature nmFeature;
+    QString nmDisplayString;
+    if ( mNmReferencedSource )
+    {
+      nmFeature = nmFeatures.value( attributesKey( childFeature, referencingFields ) );
+      mNmContext.setFeature( nmFeature );
+      nmDisplayString = nmExpression.evaluate( &mNmContext ).toString();
+    }
+
+    entries.append( ReferencingFeatureListModel::Entry( displayString, childFeature, nmDisplayString, nmFeature ) );
+  }
+
+  {
+    QMutexLocker locker( &mEntriesMutex );
+    mEntries.append( entries );
+  }
+
+  emit entriesAvailable();
+}
@@ -22,7 +22,12 @@
 #include "attributeformmodel.h"
 
 //used for gatherer
+#include <QMutex>
 #include <QThread>
+#include <qgsvectorlayerfeatureiterator.h>
+
+#include <atomic>
+#include <memory>
 
 class QgsVectorLayer;
 class FeatureGatherer;
@@ -36,6 +41,14 @@ class ReferencingFeatureListModel : public QAbstractItemModel
     Q_PROPERTY( QgsRelation nmRelation WRITE setNmRelation READ nmRelation NOTIFY nmRelationChanged )
     Q_PROPERTY( bool parentPrimariesAvailable WRITE setParentPrimariesAvailable READ parentPrimariesAvailable NOTIFY parentPrimariesAvailableChanged )
     Q_PROPERTY( bool isLoading READ isLoading NOTIFY isLoadingChanged )
+    //! the number of children loaded per page, further pages are loaded with fetchMore(). If 0, all children are loaded at once
+    Q_PROPERTY( int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged )
+    //! the expression the children are ordered by, if empty the order of the data provider is used
+    Q_PROPERTY( QString orderBy READ orderBy WRITE setOrderBy NOTIFY orderByChanged )
+    //! if the children are ordered ascending or descending by \a orderBy
+    Q_PROPERTY( bool orderAscending READ orderAscending WRITE setOrderAscending NOTIFY orderAscendingChanged )
+    //! the total number of children, in paged mode it is known before all pages are loaded
+    Q_PROPERTY( int totalCount READ totalCount NOTIFY totalCountChanged )
 
   public:
     explicit ReferencingFeatureListModel( QObject *parent = nullptr );
@@ -54,6 +67,8 @@ class ReferencingFeatureListModel : public QAbstractItemModel
     int rowCount( const QModelIndex &parent = QModelIndex() ) const override;
     int columnCount( const QModelIndex &parent = QModelIndex() ) const override;
     QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const override;
+    bool canFetchMore( const QModelIndex &parent ) const override;
+    void fetchMore( const QModelIndex &parent ) override;
 
     /**
      * The parent feature for which this model contains the children
@@ -112,6 +127,24 @@ class ReferencingFeatureListModel : public QAbstractItemModel
      */
     bool parentPrimariesAvailable() const;
 
+    //! \copydoc pageSize
+    int pageSize() const { return mPageSize; }
+    //! \copydoc pageSize
+    void setPageSize( int pageSize );
+
+    //! \copydoc orderBy
+    QString orderBy() const { return mOrderBy; }
+    //! \copydoc orderBy
+    void setOrderBy( const QString &orderBy );
+
+    //! \copydoc orderAscending
+    bool orderAscending() const { return mOrderAscending; }
+    //! \copydoc orderAscending
+    void setOrderAscending( bool orderAscending );
+
+    //! \copydoc totalCount
+    int totalCount() const { return mTotalCount; }
+
     /**
      * Reloads the model by starting the reload functionality in the gatherer (seperate thread)
      * Sets the property parentPrimariesAvailable
@@ -136,9 +169,15 @@ class ReferencingFeatureListModel : public QAbstractItemModel
     void nmRelationChanged();
     void parentPrimariesAvailableChanged();
     void isLoadingChanged();
+    void pageSizeChanged();
+    void orderByChanged();
+    void orderAscendingChanged();
+    void totalCountChanged();
     void modelUpdated();
 
   private slots:
+    void featureIdsCollected();
+    void appendEntries();
     void updateModel();
     void gathererThreadFinished();
 
@@ -165,64 +204,70 @@ class ReferencingFeatureListModel : public QAbstractItemModel
     QgsRelation mRelation;
     QgsRelation mNmRelation;
     bool mParentPrimariesAvailable = false;
+    int mPageSize = 0;
+    QString mOrderBy;
+    bool mOrderAscending = true;
+    int mTotalCount = 0;
+    //! the ordered ids of all children in paged mode
+    QList<QgsFeatureId> mFeatureIds;
+    //! the number of children in mFeatureIds already requested from a gatherer
+    int mFetchedCount = 0;
 
     FeatureGatherer *mGatherer = nullptr;
+    //! the entries are replaced by the first batch of the running gatherer
+    bool mEntriesOutdated = false;
 
     //! Checks if the parent pk(s) is not null
     bool checkParentPrimaries();
 
+    //! Creates a gatherer for the children of the current feature in the configured order
+    FeatureGatherer *createGatherer() const;
+
+    //! Starts \a gatherer and makes it the current one, a previously running gatherer is stopped
+    void startGatherer( FeatureGatherer *gatherer );
+
+    //! Returns \a feature with its geometry, which is skipped by the gatherer if not needed for the display string
+    QgsFeature completeFeature( QgsVectorLayer *layer, const QgsFeature &feature ) const;
+
+    void setTotalCount( int totalCount );
+
     friend class FeatureGatherer;
     friend class TestReferencingFeatureListModel;
 };
 
+/**
+ * Collects the children of a feature on a background thread.
+ *
+ * The layers are only accessed through feature source snapshots taken on construction,
+ * the display expressions are prepared once per run. The entries are handed over in
+ * batches, each time \a entriesAvailable is emitted a new batch can be fetched with
+ * takeEntries(). On many-to-many relations the referenced features of a whole batch
+ * are fetched with a single request.
+ *
+ * Geometries are only fetched if the display expressions need them. With a page size set,
+ * the ordered ids of all children are collected first, which only needs the attributes
+ * used for ordering, and only the first page is gathered.
+ */
 class FeatureGatherer: public QThread
 {
     Q_OBJECT
 
   public:
-    FeatureGatherer( QgsFeature feature, QgsRelation relation, QgsRelation nmRelation = QgsRelation() )
-      : mFeature( feature )
-      , mRelation( relation )
-      , mNmRelation( nmRelation )
-    {
-    }
+    FeatureGatherer( const QgsFeature &feature, const QgsRelation &relation, const QgsRelation &nmRelation = QgsRelation() );
 
-    void run() override
-    {
-      mWasCanceled = false;
+    void run() override;
 
-      QgsFeatureIterator relatedFeaturesIt = mRelation.getRelatedFeatures( mFeature );
-      QgsExpressionContext context = mRelation.referencingLayer()->createExpressionContext();
-      QgsExpression expression( mRelation.referencingLayer()->displayExpression() );
+    //! Sets the order in which the children are gathered
+    void setOrderBy( const QgsFeatureRequest::OrderBy &orderBy );
 
-      QgsFeature childFeature;
-      QString displayString;
-      while ( relatedFeaturesIt.nextFeature( childFeature ) )
-      {
-        context.setFeature( childFeature );
-        displayString = expression.evaluate( &context ).toString();
-
-        QgsFeature nmFeature;
-        QString nmDisplayString;
-        if ( mNmRelation.isValid() )
-        {
-          QgsExpressionContext nmContext = mNmRelation.referencedLayer()->createExpressionContext();
-          QgsExpression nmExpression( mNmRelation.referencedLayer()->displayExpression() );
-
-          nmFeature = mNmRelation.getReferencedFeature( childFeature );
-          nmContext.setFeature( nmFeature );
-          nmDisplayString = nmExpression.evaluate( &nmContext ).toString();
-        }
-
-        //test sleep(1);
-        mEntries.append( ReferencingFeatureListModel::Entry( displayString, childFeature, nmDisplayString, nmFeature ) );
-
-        if ( mWasCanceled )
-          return;
-      }
-
-      emit collectedValues();
-    }
+    //! Collects the ids of all children first and gathers only the first \a pageSize of them
+    void setPageSize( int pageSize );
+
+    //! Restricts the gathered children to \a ids, used to gather the following pages
+    void setFeatureIds( const QList<QgsFeatureId> &ids );
+
+    //! \returns the ordered ids of all children, available once featureIdsCollected has been emitted
+    QList<QgsFeatureId> featureIds() const { return mFeatureIds; }
 
     //! Informs the gatherer to immediately stop collecting values
     void stop()
@@ -233,27 +278,41 @@ class FeatureGatherer: public QThread
     //! \returns true if collection was canceled before completion
     bool wasCanceled() const { return mWasCanceled; }
 
-    //! \returns the list of entries
-    QList<ReferencingFeatureListModel::Entry> entries() const { return mEntries; }
+    //! \returns the entries collected since the last call and removes them from the gatherer
+    QList<ReferencingFeatureListModel::Entry> takeEntries();
 
   signals:
 
-    /**
-     * Emitted when values have been collected
-     * \param values list of unique matching string values
-     */
+    //! Emitted in paged mode when the ids of all children have been collected
+    void featureIdsCollected();
+
+    //! Emitted when a batch of entries has been collected, more batches may follow
+    void entriesAvailable();
+
+    //! Emitted when all values have been collected
     void collectedValues();
 
   private:
+    //! Evaluates the display strings of \a childFeatures and resolves their nm referenced features
+    void processBatch( const QgsFeatureList &childFeatures, QgsExpression &expression, QgsExpression &nmExpression );
 
+    QMutex mEntriesMutex;
     QList<ReferencingFeatureListModel::Entry> mEntries;
 
-    QgsFeature mFeature;
-    QgsRelation mRelation;
     QgsRelation mNmRelation;
 
+    std::unique_ptr<QgsVectorLayerFeatureSource> mReferencingSource;
+    std::unique_ptr<QgsVectorLayerFeatureSource> mNmReferencedSource;
+    QgsExpressionContext mContext;
+    QgsExpressionContext mNmContext;
+    QString mDisplayExpression;
+    QString mNmDisplayExpression;
+    bool mNmNeedsGeometry = false;
+
     QgsFeatureRequest mRequest;
-    bool mWasCanceled = false;
+    int mPageSize = 0;
+    QList<QgsFeatureId> mFeatureIds;
+    std::atomic<bool> mWasCanceled { false };
 };
 
 #endif // REFERENCINGFEATURELISTMODEL_H
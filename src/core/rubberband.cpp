@@ -129,36 +129,35 @@ QSGNode *Rubberband::updatePaintNode( QSGNode *n, QQuickItem::UpdatePaintNodeDat
 
     bool frozen = mRubberbandModel && mRubberbandModel->frozen();
 
-    QVector<QgsPoint> allVertices = QVector<QgsPoint>();
-    QVector<QgsPoint> allButCurrentVertices = QVector<QgsPoint>();
-    QgsWkbTypes::GeometryType geomType = QgsWkbTypes::LineGeometry;
-
     if ( mRubberbandModel && !mRubberbandModel->isEmpty() )
     {
-      allVertices = mRubberbandModel->flatVertices();
-      geomType = mRubberbandModel->geometryType();
-      if ( !frozen )
-        allButCurrentVertices = mRubberbandModel->flatVertices( true );
-    }
-    else if ( mVertexModel && mVertexModel->vertexCount() > 0 )
-    {
-      allVertices = mVertexModel->flatVertices();
-      geomType = mVertexModel->geometryType();
-    }
+      // the coordinate arrays of the model are shared, not copied
+      const QVector<double> &x = mRubberbandModel->xValues();
+      const QVector<double> &y = mRubberbandModel->yValues();
+      const QgsWkbTypes::GeometryType geomType = mRubberbandModel->geometryType();
 
-    if ( !allVertices.isEmpty() )
-    {
-      SGRubberband *rb = new SGRubberband( allVertices, geomType, mColor, mWidth );
+      SGRubberband *rb = new SGRubberband( x, y, geomType, mColor, mWidth );
       rb->setFlag( QSGNode::OwnedByParent );
       n->appendChildNode( rb );
 
       if ( !frozen )
       {
-        SGRubberband *rbCurrentPoint = new SGRubberband( allButCurrentVertices, geomType, mColorCurrentPoint, mWidthCurrentPoint );
+        QVector<double> allButCurrentX = x;
+        QVector<double> allButCurrentY = y;
+        allButCurrentX.remove( mRubberbandModel->currentCoordinateIndex() );
+        allButCurrentY.remove( mRubberbandModel->currentCoordinateIndex() );
+
+        SGRubberband *rbCurrentPoint = new SGRubberband( allButCurrentX, allButCurrentY, geomType, mColorCurrentPoint, mWidthCurrentPoint );
         rbCurrentPoint->setFlag( QSGNode::OwnedByParent );
         n->appendChildNode( rbCurrentPoint );
       }
     }
+    else if ( mVertexModel && mVertexModel->vertexCount() > 0 )
+    {
+      SGRubberband *rb = new SGRubberband( mVertexModel->flatVertices(), mVertexModel->geometryType(), mColor, mWidth );
+      rb->setFlag( QSGNode::OwnedByParent );
+      n->appendChildNode( rb );
+    }
   }
 
   mDirty = false;
@@ -15,76 +15,139 @@
  ***************************************************************************/
 #include "rubberbandmodel.h"
 #include "snappingutils.h"
+#include "geometryutils.h"
+#include "coordinatetransformcache.h"
 
 #include <qgsvectorlayer.h>
 #include <qgsproject.h>
 #include <qgslogger.h>
 
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  //! Returns if \a a and \a b are the same value, both NaN meaning the value is missing
+  bool sameValue( double a, double b )
+  {
+    return a == b || ( std::isnan( a ) && std::isnan( b ) );
+  }
+}
+
 RubberbandModel::RubberbandModel( QObject *parent )
   : QObject( parent )
   , mCurrentCoordinateIndex( 0 )
   , mGeometryType( QgsWkbTypes::LineGeometry )
   , mLayer( nullptr )
 {
-  mPointList.insert( 0, QgsPoint() );
+  insertStoredVertices( 0, 1, QgsPoint() );
 }
 
 int RubberbandModel::vertexCount() const
 {
-  return mPointList.size();
+  return mX.size();
 }
 
 bool RubberbandModel::isEmpty() const
 {
-  return mPointList.isEmpty();
+  return mX.isEmpty();
 }
 
 QVector<QgsPoint> RubberbandModel::vertices() const
 {
-  return mPointList;
+  QVector<QgsPoint> points;
+  points.reserve( mX.size() );
+  for ( int i = 0; i < mX.size(); ++i )
+    points << vertex( i );
+
+  return points;
 }
 
 QVector<QgsPoint> RubberbandModel::flatVertices( bool skipCurrentPoint ) const
 {
-  QVector<QgsPoint> points;
-  for ( const QgsPoint &pt : mPointList )
-  {
-    points << QgsPoint( pt );
-  }
+  QVector<QgsPoint> points = vertices();
   if ( skipCurrentPoint )
     points.remove( mCurrentCoordinateIndex );
 
   return points;
 }
 
+QgsPoint RubberbandModel::vertex( int index ) const
+{
+  // the type is deduced from the presence of z and m values
+  return QgsPoint( mX.at( index ), mY.at( index ),
+                   mZ.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : mZ.at( index ),
+                   mM.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : mM.at( index ) );
+}
+
+bool RubberbandModel::storeVertex( int index, const QgsPoint &point )
+{
+  const double z = QgsWkbTypes::hasZ( point.wkbType() ) ? point.z() : std::numeric_limits<double>::quiet_NaN();
+  const double m = QgsWkbTypes::hasM( point.wkbType() ) ? point.m() : std::numeric_limits<double>::quiet_NaN();
+
+  if ( sameValue( mX.at( index ), point.x() ) && sameValue( mY.at( index ), point.y() )
+       && sameValue( mZ.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : mZ.at( index ), z )
+       && sameValue( mM.isEmpty() ? std::numeric_limits<double>::quiet_NaN() : mM.at( index ), m ) )
+    return false;
+
+  mX[index] = point.x();
+  mY[index] = point.y();
+
+  if ( mZ.isEmpty() && !std::isnan( z ) )
+    mZ.fill( std::numeric_limits<double>::quiet_NaN(), mX.size() );
+  if ( !mZ.isEmpty() )
+    mZ[index] = z;
+
+  if ( mM.isEmpty() && !std::isnan( m ) )
+    mM.fill( std::numeric_limits<double>::quiet_NaN(), mX.size() );
+  if ( !mM.isEmpty() )
+    mM[index] = m;
+
+  return true;
+}
+
+void RubberbandModel::insertStoredVertices( int index, int count, const QgsPoint &point )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  mX.insert( index, count, nan );
+  mY.insert( index, count, nan );
+  if ( !mZ.isEmpty() )
+    mZ.insert( index, count, nan );
+  if ( !mM.isEmpty() )
+    mM.insert( index, count, nan );
+
+  for ( int i = index; i < index + count; ++i )
+    storeVertex( i, point );
+}
+
+void RubberbandModel::clearStoredVertices()
+{
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mM.clear();
+}
+
 QgsPointSequence RubberbandModel::pointSequence( const QgsCoordinateReferenceSystem &crs, QgsWkbTypes::Type wkbType, bool closeLine ) const
 {
   QgsPointSequence sequence;
 
-  QgsCoordinateTransform ct( mCrs, crs, QgsProject::instance()->transformContext() );
+  //crs transformation of XY
+  QVector<double> x = mX;
+  QVector<double> y = mY;
+  if ( !GeometryUtils::transformCoordinates( transformTo( crs ), x, y ) )
+    return sequence;
 
-  for ( const QgsPoint &pt : mPointList )
+  sequence.reserve( mX.size() + ( closeLine ? 1 : 0 ) );
+  for ( int i = 0; i < mX.size(); ++i )
   {
-    //crs transformation of XY
-    QgsPointXY p1 = ct.transform( pt.x(), pt.y() );
-
     //get point containing ZM if existing
-    QgsPoint p2 = SnappingUtils::newPoint( pt, wkbType );
-    p2.setX( p1.x() );
-    p2.setY( p1.y() );
-
-    //overwrite z and m values if already existent in the point
-    if ( QgsWkbTypes::hasM( pt.wkbType() ) && QgsWkbTypes::hasM( wkbType ) )
-    {
-      p2.addMValue( pt.m() );
-    }
-
-    if ( QgsWkbTypes::hasZ( pt.wkbType() ) && QgsWkbTypes::hasZ( wkbType ) )
-    {
-      p2.addMValue( pt.z() );
-    }
+    QgsPoint point = SnappingUtils::newPoint( vertex( i ), wkbType );
+    point.setX( x.at( i ) );
+    point.setY( y.at( i ) );
 
-    sequence.append( p2 );
+    sequence.append( point );
   }
 
   if ( closeLine && sequence.count() > 1 )
@@ -99,31 +162,36 @@ QVector<QgsPointXY> RubberbandModel::flatPointSequence( const QgsCoordinateRefer
 {
   QVector<QgsPointXY> sequence;
 
-  QgsCoordinateTransform ct( mCrs, crs, QgsProject::instance()->transformContext() );
+  QVector<double> x = mX;
+  QVector<double> y = mY;
+  if ( !GeometryUtils::transformCoordinates( transformTo( crs ), x, y ) )
+    return sequence;
 
-  for ( const QgsPoint &pt : mPointList )
+  sequence.reserve( mX.size() );
+  for ( int i = 0; i < mX.size(); ++i )
   {
-    sequence.append( ct.transform( pt.x(), pt.y() ) );
+    sequence.append( QgsPointXY( x.at( i ), y.at( i ) ) );
   }
 
   return sequence;
 }
 
+QgsCoordinateTransform RubberbandModel::transformTo( const QgsCoordinateReferenceSystem &crs ) const
+{
+  return CoordinateTransformCache::instance()->transform( mCrs, crs );
+}
+
 void RubberbandModel::setVertex( int index, QgsPoint coordinate )
 {
-  if ( mPointList.at( index ) != coordinate )
+  if ( storeVertex( index, coordinate ) )
   {
-    mPointList.replace( index, coordinate );
     emit vertexChanged( index );
   }
 }
 
 void RubberbandModel::insertVertices( int index, int count )
 {
-  for ( int i = 0; i < count; ++i )
-  {
-    mPointList.insert( index, currentCoordinate() );
-  }
+  insertStoredVertices( index, count, currentCoordinate() );
 
   emit verticesInserted( index, count );
   emit vertexCountChanged();
@@ -131,16 +199,21 @@ void RubberbandModel::insertVertices( int index, int count )
 
 void RubberbandModel::removeVertices( int index, int count )
 {
-  if ( mPointList.size() <= 1 )
+  if ( mX.size() <= 1 )
     return;
 
-  mPointList.remove( index, count );
+  mX.remove( index, count );
+  mY.remove( index, count );
+  if ( !mZ.isEmpty() )
+    mZ.remove( index, count );
+  if ( !mM.isEmpty() )
+    mM.remove( index, count );
   emit verticesRemoved( index, count );
   emit vertexCountChanged();
 
-  if ( mCurrentCoordinateIndex >= mPointList.size() )
+  if ( mCurrentCoordinateIndex >= mX.size() )
   {
-    setCurrentCoordinateIndex( mPointList.size() - 1 );
+    setCurrentCoordinateIndex( mX.size() - 1 );
     emit currentCoordinateChanged();
   }
 }
@@ -162,9 +235,9 @@ void RubberbandModel::setCurrentCoordinateIndex( int currentCoordinateIndex )
 
 QgsPoint RubberbandModel::currentPoint( const QgsCoordinateReferenceSystem &crs, QgsWkbTypes::Type wkbType ) const
 {
-  QgsCoordinateTransform ct( mCrs, crs, QgsProject::instance()->transformContext() );
+  const QgsCoordinateTransform &ct = transformTo( crs );
 
-  QgsPoint currentPt = mPointList.at( mCurrentCoordinateIndex );
+  QgsPoint currentPt = vertex( mCurrentCoordinateIndex );
   double x = currentPt.x();
   double y = currentPt.y();
   double z = QgsWkbTypes::hasZ( currentPt.wkbType() ) ? currentPt.z() : 0;
@@ -195,23 +268,22 @@ QgsPoint RubberbandModel::currentPoint( const QgsCoordinateReferenceSystem &crs,
 
 QgsPoint RubberbandModel::currentCoordinate() const
 {
-  return mPointList.at( mCurrentCoordinateIndex );
+  return vertex( mCurrentCoordinateIndex );
 }
 
 void RubberbandModel::setCurrentCoordinate( const QgsPoint &currentCoordinate )
 {
   // play safe, but try to find out
-  // Q_ASSERT( mPointList.count() != 0 );
-  if ( mPointList.count() == 0 )
+  // Q_ASSERT( mX.count() != 0 );
+  if ( mX.count() == 0 )
     return;
 
-  if ( mPointList.at( mCurrentCoordinateIndex ) == currentCoordinate )
+  if ( mFrozen )
     return;
 
-  if ( mFrozen )
+  if ( !storeVertex( mCurrentCoordinateIndex, currentCoordinate ) )
     return;
 
-  mPointList.replace( mCurrentCoordinateIndex, currentCoordinate );
   emit currentCoordinateChanged();
   emit vertexChanged( mCurrentCoordinateIndex );
 }
@@ -228,7 +300,7 @@ void RubberbandModel::setCurrentPositionTimestamp( const QDateTime &currentPosit
 
 double RubberbandModel::measureValue() const
 {
-  return QgsWkbTypes::hasM( mPointList.at( mCurrentCoordinateIndex ).wkbType() ) ? mPointList.at( mCurrentCoordinateIndex ).m() : 0;
+  return !mM.isEmpty() && !std::isnan( mM.at( mCurrentCoordinateIndex ) ) ? mM.at( mCurrentCoordinateIndex ) : 0;
 }
 
 void RubberbandModel::setMeasureValue( const double measureValue )
@@ -249,7 +321,7 @@ void RubberbandModel::setMeasureValue( const double measureValue )
 void RubberbandModel::addVertex()
 {
   // Avoid double vertices accidentally
-  if ( mPointList.size() > 1 && *( mPointList.end() - 1 ) == *( mPointList.end() - 2 ) )
+  if ( mX.size() > 1 && vertex( mX.size() - 1 ) == vertex( mX.size() - 2 ) )
     return;
 
   insertVertices( mCurrentCoordinateIndex + 1, 1 );
@@ -270,7 +342,7 @@ void RubberbandModel::removeVertex()
 
 void RubberbandModel::reset()
 {
-  removeVertices( 0, mPointList.size() - 1 );
+  removeVertices( 0, mX.size() - 1 );
   mFrozen = false;
   emit frozenChanged();
 }
@@ -280,7 +352,7 @@ void RubberbandModel::setDataFromGeometry( const QgsGeometry &geometry )
   if ( geometry.type() != mGeometryType )
     return;
 
-  mPointList.clear();
+  clearStoredVertices();
   const QgsAbstractGeometry *abstractGeom = geometry.constGet();
   if ( !abstractGeom )
     return;
@@ -296,12 +368,12 @@ void RubberbandModel::setDataFromGeometry( const QgsGeometry &geometry )
     if ( geometry.type() == QgsWkbTypes::PolygonGeometry && vertexId.vertex == 0 )
       continue;
 
-    mPointList << pt;
+    insertStoredVertices( mX.size(), 1, pt );
   }
 
-  mCurrentCoordinateIndex = mPointList.size() - 1;
+  mCurrentCoordinateIndex = mX.size() - 1;
 
-  emit verticesInserted( 0, mPointList.size() );
+  emit verticesInserted( 0, mX.size() );
   emit vertexCountChanged();
 }
 
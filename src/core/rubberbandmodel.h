@@ -24,6 +24,7 @@
 #include <qgspoint.h>
 #include <qgsabstractgeometry.h>
 #include <qgsgeometry.h>
+#include <qgscoordinatetransform.h>
 
 class QgsVectorLayer;
 
@@ -31,6 +32,10 @@ class QgsVectorLayer;
  * This model manages a list of vertices.
  *
  * It can be used as a linestring or as a ring in a polygon.
+ *
+ * The coordinates are kept in contiguous arrays of x, y, z and m values rather than in a list
+ * of points, the z and m arrays are only allocated once a vertex has such a value. They can be
+ * read without copying them through xValues(), yValues(), zValues() and mValues().
  */
 
 class RubberbandModel : public QObject
@@ -61,6 +66,18 @@ class RubberbandModel : public QObject
 
     QVector<QgsPoint> flatVertices( bool skipCurrentPoint = false ) const;
 
+    //! Returns the vertex at \a index
+    QgsPoint vertex( int index ) const;
+
+    //! Returns the x coordinates of the vertices
+    const QVector<double> &xValues() const { return mX; }
+    //! Returns the y coordinates of the vertices
+    const QVector<double> &yValues() const { return mY; }
+    //! Returns the z values of the vertices, NaN for vertices without z value and empty if none has one
+    const QVector<double> &zValues() const { return mZ; }
+    //! Returns the m values of the vertices, NaN for vertices without m value and empty if none has one
+    const QVector<double> &mValues() const { return mM; }
+
     /**
      * The target CRS into which points should be reprojected.
      * To retrieve unprojected points pass an invalid QgsCoordinateReferenceSystem object.
@@ -142,7 +159,19 @@ class RubberbandModel : public QObject
     void measureValueChanged();
 
   private:
-    QVector<QgsPoint> mPointList;
+    //! Stores \a point at \a index, returns FALSE if the vertex is unchanged
+    bool storeVertex( int index, const QgsPoint &point );
+    //! Inserts \a count copies of \a point at \a index
+    void insertStoredVertices( int index, int count, const QgsPoint &point );
+    void clearStoredVertices();
+
+    //! Returns the transform from the crs of the model to \a crs, shared through the CoordinateTransformCache
+    QgsCoordinateTransform transformTo( const QgsCoordinateReferenceSystem &crs ) const;
+
+    QVector<double> mX;
+    QVector<double> mY;
+    QVector<double> mZ;
+    QVector<double> mM;
     int mCurrentCoordinateIndex;
     QDateTime mCurrentPositionTimestamp;
     QgsWkbTypes::GeometryType mGeometryType;
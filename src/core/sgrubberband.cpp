@@ -13,16 +13,39 @@
  *                                                                         *
  ***************************************************************************/
 #include "sgrubberband.h"
-extern "C" {
-#include "tessellate.h"
-}
+#include "polygontriangulator.h"
+
+#include <algorithm>
 
 SGRubberband::SGRubberband( const QVector<QgsPoint> &points, QgsWkbTypes::GeometryType type, const QColor &color, qreal width )
   : QSGNode()
 {
   mMaterial.setColor( color );
 
-  if ( points.isEmpty() )
+  QVector<double> x;
+  QVector<double> y;
+  x.reserve( points.size() );
+  y.reserve( points.size() );
+  for ( const QgsPoint &pt : points )
+  {
+    x << pt.x();
+    y << pt.y();
+  }
+
+  init( x, y, type, width );
+}
+
+SGRubberband::SGRubberband( const QVector<double> &x, const QVector<double> &y, QgsWkbTypes::GeometryType type, const QColor &color, qreal width )
+  : QSGNode()
+{
+  mMaterial.setColor( color );
+
+  init( x, y, type, width );
+}
+
+void SGRubberband::init( const QVector<double> &x, const QVector<double> &y, QgsWkbTypes::GeometryType type, qreal width )
+{
+  if ( x.isEmpty() )
     return;
 
   switch ( type )
@@ -33,14 +56,14 @@ SGRubberband::SGRubberband( const QVector<QgsPoint> &points, QgsWkbTypes::Geomet
 
     case QgsWkbTypes::LineGeometry:
     {
-      appendChildNode( createLineGeometry( points, width ) );
+      appendChildNode( createLineGeometry( x, y, width ) );
       break;
     }
 
     case QgsWkbTypes::PolygonGeometry:
     {
-      appendChildNode( createLineGeometry( points, width ) );
-      appendChildNode( createPolygonGeometry( points ) );
+      appendChildNode( createLineGeometry( x, y, width ) );
+      appendChildNode( createPolygonGeometry( x, y ) );
       break;
     }
 
@@ -50,16 +73,15 @@ SGRubberband::SGRubberband( const QVector<QgsPoint> &points, QgsWkbTypes::Geomet
   }
 }
 
-QSGGeometryNode *SGRubberband::createLineGeometry( const QVector<QgsPoint> &points, qreal width )
+QSGGeometryNode *SGRubberband::createLineGeometry( const QVector<double> &x, const QVector<double> &y, qreal width )
 {
   QSGGeometryNode *node = new QSGGeometryNode;
-  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), points.count() );
+  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), x.count() );
   QSGGeometry::Point2D *vertices = sgGeom->vertexDataAsPoint2D();
 
-  int i = 0;
-  for ( const QgsPoint &pt : points )
+  for ( int i = 0; i < x.count(); ++i )
   {
-    vertices[i++].set( static_cast<float>( pt.x() ), static_cast<float>( pt.y() ) );
+    vertices[i].set( static_cast<float>( x.at( i ) ), static_cast<float>( y.at( i ) ) );
   }
 
   sgGeom->setLineWidth( static_cast<float>( width ) );
@@ -71,40 +93,13 @@ QSGGeometryNode *SGRubberband::createLineGeometry( const QVector<QgsPoint> &poin
   return node;
 }
 
-QSGGeometryNode *SGRubberband::createPolygonGeometry( const QVector<QgsPoint> &points )
+QSGGeometryNode *SGRubberband::createPolygonGeometry( const QVector<double> &x, const QVector<double> &y )
 {
-  double *coordinates_out;
-  int *tris_out;
-  int nverts, ntris;
-
-  double *vertices_in = ( double * )malloc( points.size() * 2 * sizeof( double ) );
-  const double *contours_array[] = { vertices_in, vertices_in + points.size() * 2 };
-  int i = 0;
-
-  for ( const QgsPoint &pt : points )
-  {
-    vertices_in[i++] = pt.x();
-    vertices_in[i++] = pt.y();
-  }
-
-  tessellate( &coordinates_out, &nverts,
-              &tris_out, &ntris,
-              contours_array, contours_array + 2 );
+  const QVector<QSGGeometry::Point2D> triangles = PolygonTriangulator::triangulate( x, y );
 
   QSGGeometryNode *node = new QSGGeometryNode;
-  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), ntris * 3 );
-
-  QSGGeometry::Point2D *vertices = sgGeom->vertexDataAsPoint2D();
-
-  for ( int j = 0; j < ntris * 3; j++ )
-  {
-    vertices[j].x = coordinates_out[tris_out[j] * 2];
-    vertices[j].y = coordinates_out[tris_out[j] * 2 + 1];
-  }
-
-  free( vertices_in );
-  free( coordinates_out );
-  free( tris_out );
+  QSGGeometry *sgGeom = new QSGGeometry( QSGGeometry::defaultAttributes_Point2D(), triangles.size() );
+  std::copy( triangles.constBegin(), triangles.constEnd(), sgGeom->vertexDataAsPoint2D() );
 
   sgGeom->setDrawingMode( GL_TRIANGLES );
   node->setGeometry( sgGeom );
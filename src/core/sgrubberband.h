@@ -35,9 +35,13 @@ class SGRubberband : public QSGNode
   public:
     SGRubberband( const QVector<QgsPoint> &points, QgsWkbTypes::GeometryType type, const QColor &color, qreal width );
 
+    //! Creates a rubberband from the coordinate arrays \a x and \a y, e.g. the ones of a RubberbandModel
+    SGRubberband( const QVector<double> &x, const QVector<double> &y, QgsWkbTypes::GeometryType type, const QColor &color, qreal width );
+
   private:
-    QSGGeometryNode *createLineGeometry( const QVector<QgsPoint> &points, qreal width );
-    QSGGeometryNode *createPolygonGeometry( const QVector<QgsPoint> &points );
+    void init( const QVector<double> &x, const QVector<double> &y, QgsWkbTypes::GeometryType type, qreal width );
+    QSGGeometryNode *createLineGeometry( const QVector<double> &x, const QVector<double> &y, qreal width );
+    QSGGeometryNode *createPolygonGeometry( const QVector<double> &x, const QVector<double> &y );
 
     QSGFlatColorMaterial mMaterial;
 };
@@ -19,10 +19,24 @@
 #include "qgsvectorlayer.h"
 #include "qgsproject.h"
 
+#include <qgsconfig.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+
 SnappingUtils::SnappingUtils( QObject *parent )
   : QgsSnappingUtils( parent, false /*enableSnappingForInvisibleFeature*/ )
   , mSettings( nullptr )
+  , mGeometryCache( 16 )
 {
+  mSnapTimer.setSingleShot( true );
+  mSnapTimer.setInterval( 0 );
+  connect( &mSnapTimer, &QTimer::timeout, this, &SnappingUtils::snap );
+
+  connect( this, &QgsSnappingUtils::configChanged, this, &SnappingUtils::requestSnap );
   connect( QgsProject::instance(), static_cast<void ( QgsProject::* )( const QStringList & )>( &QgsProject::layersWillBeRemoved ), this, &SnappingUtils::removeOutdatedLocators );
 }
 
@@ -30,13 +44,179 @@ void SnappingUtils::onMapSettingsUpdated()
 {
   QgsSnappingUtils::setMapSettings( mSettings->mapSettings() );
 
-  snap();
+  requestSnap();
 }
 
-void SnappingUtils::removeOutdatedLocators()
+void SnappingUtils::removeOutdatedLocators( const QStringList &layerIds )
 {
+  for ( const QString &layerId : layerIds )
+  {
+    if ( mCurrentLayer && mCurrentLayer->id() == layerId )
+      setCurrentLayer( nullptr );
+  }
+
+  clearCachedGeometries();
 
+  bool snappedLayerRemoved = false;
+  for ( const QString &layerId : layerIds )
+    snappedLayerRemoved |= mSnappedLayerIds.contains( layerId );
+
+  if ( !snappedLayerRemoved )
+    return;
+
+  // the locators of the remaining layers are initialized again on the next snap
   clearAllLocators();
+  mSnappedLayerIds.clear();
+  mLargeLayers.clear();
+
+  if ( !mIndexingLocators.isEmpty() )
+  {
+    mIndexingLocators.clear();
+    emit indexingFinished();
+  }
+}
+
+void SnappingUtils::onLocatorInitFinished( bool ok )
+{
+  QgsPointLocator *locator = qobject_cast<QgsPointLocator *>( sender() );
+  if ( !mIndexingLocators.remove( locator ) )
+    return;
+
+  // the hybrid strategy only fails to initialize the locators of layers exceeding its feature limit
+  if ( indexingStrategy() == IndexHybrid )
+    setLargeLayer( locator->layer(), !ok );
+
+  mIndexedLocatorCount++;
+  if ( mIndexingLocators.isEmpty() )
+    emit indexingFinished();
+  else
+    emit indexingProgress( mIndexedLocatorCount );
+
+  // the layer is only snapped to once its index is ready
+  requestSnap();
+}
+
+bool SnappingUtils::isLargeLayer( QgsVectorLayer *layer )
+{
+  auto it = mLargeLayers.constFind( layer->id() );
+  if ( it != mLargeLayers.constEnd() )
+    return it.value();
+
+  bool large = false;
+  qint64 modified = 0;
+  const QString key = indexCacheKey( layer, modified );
+  if ( !key.isEmpty() )
+  {
+    const QSettings cache( indexCachePath(), QSettings::IniFormat );
+    if ( cache.value( QStringLiteral( "%1/modified" ).arg( key ) ).toLongLong() == modified )
+      large = cache.value( QStringLiteral( "%1/large" ).arg( key ) ).toBool();
+  }
+
+  mLargeLayers.insert( layer->id(), large );
+  return large;
+}
+
+void SnappingUtils::setLargeLayer( QgsVectorLayer *layer, bool large )
+{
+  if ( !layer )
+    return;
+
+  mLargeLayers.insert( layer->id(), large );
+
+  qint64 modified = 0;
+  const QString key = indexCacheKey( layer, modified );
+  if ( key.isEmpty() )
+    return;
+
+  QSettings cache( indexCachePath(), QSettings::IniFormat );
+  cache.setValue( QStringLiteral( "%1/modified" ).arg( key ), modified );
+  cache.setValue( QStringLiteral( "%1/large" ).arg( key ), large );
+}
+
+QString SnappingUtils::indexCachePath()
+{
+  return QDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) ).filePath( QStringLiteral( "snapping_indexes.ini" ) );
+}
+
+QString SnappingUtils::indexCacheKey( QgsVectorLayer *layer, qint64 &modified )
+{
+  if ( !layer->dataProvider() )
+    return QString();
+
+  const QString source = layer->dataProvider()->dataSourceUri();
+  const QFileInfo fi( source.left( source.indexOf( '|' ) ) );
+  if ( !fi.isFile() )
+    return QString();
+
+  modified = fi.lastModified().toMSecsSinceEpoch();
+  return QString::fromLatin1( QCryptographicHash::hash( source.toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
+
+void SnappingUtils::watchIndexingLocators( const QList<QgsVectorLayer *> &layers )
+{
+#if VERSION_INT >= 31000
+  const int count = mIndexingLocators.count();
+  for ( QgsVectorLayer *layer : layers )
+  {
+    QgsPointLocator *locator = locatorForLayer( layer );
+    if ( !locator->isIndexing() || mIndexingLocators.contains( locator ) )
+      continue;
+
+    if ( mIndexingLocators.isEmpty() )
+      mIndexedLocatorCount = 0;
+
+    mIndexingLocators.insert( locator );
+    connect( locator, &QgsPointLocator::initFinished, this, &SnappingUtils::onLocatorInitFinished, Qt::UniqueConnection );
+  }
+
+  if ( mIndexingLocators.count() != count )
+    emit indexingStarted( mIndexedLocatorCount + mIndexingLocators.count() );
+#else
+  Q_UNUSED( layers )
+#endif
+}
+
+QList<QgsVectorLayer *> SnappingUtils::snappingLayers() const
+{
+  QList<QgsVectorLayer *> layers;
+  const QgsSnappingConfig snappingConfig = config();
+  switch ( snappingConfig.mode() )
+  {
+    case QgsSnappingConfig::ActiveLayer:
+      if ( currentLayer() )
+        layers << currentLayer();
+      break;
+
+    case QgsSnappingConfig::AllLayers:
+      for ( QgsMapLayer *layer : QgsSnappingUtils::mapSettings().layers() )
+      {
+        if ( QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( layer ) )
+          layers << vl;
+      }
+      break;
+
+    case QgsSnappingConfig::AdvancedConfiguration:
+    {
+      const QHash<QgsVectorLayer *, QgsSnappingConfig::IndividualLayerSettings> settings = snappingConfig.individualLayerSettings();
+      for ( auto it = settings.constBegin(); it != settings.constEnd(); ++it )
+      {
+        if ( it.value().enabled() )
+          layers << it.key();
+      }
+      break;
+    }
+  }
+  return layers;
+}
+
+void SnappingUtils::removeCachedGeometry( QgsFeatureId fid )
+{
+  mGeometryCache.remove( qMakePair( qobject_cast<QgsVectorLayer *>( sender() ), fid ) );
+}
+
+void SnappingUtils::clearCachedGeometries()
+{
+  mGeometryCache.clear();
 }
 
 QgsPoint SnappingUtils::newPoint( const QgsPoint &snappedPoint, const QgsWkbTypes::Type wkbType )
@@ -72,24 +252,80 @@ QgsPoint SnappingUtils::newPoint( const QgsPoint &snappedPoint, const QgsWkbType
   return newPoint;
 }
 
+void SnappingUtils::requestSnap()
+{
+  // coalesce the requests of the current event loop pass, only the latest input is snapped
+  if ( mSettings )
+    mSnapTimer.start();
+}
+
 void SnappingUtils::snap()
 {
-  QgsPointXY point = mapSettings()->screenToCoordinate( mInputCoordinate );
-  QgsPointLocator::Match match = snapToMap( point );
+  QgsPointLocator::Match match;
+  if ( config().enabled() )
+  {
+    const QList<QgsVectorLayer *> layers = snappingLayers();
+    bool hasLargeLayer = false;
+    for ( QgsVectorLayer *layer : layers )
+    {
+      mSnappedLayerIds.insert( layer->id() );
+      hasLargeLayer |= isLargeLayer( layer );
+    }
+
+    setIndexingStrategy( hasLargeLayer ? IndexExtent : IndexHybrid );
+
+    const QgsPointXY point = mSettings->screenToCoordinate( mInputCoordinate );
+#if VERSION_INT >= 31000
+    match = snapToMap( point, nullptr, true /*relaxed*/ );
+    watchIndexingLocators( layers );
+#else
+    match = snapToMap( point );
+
+    if ( indexingStrategy() == IndexHybrid )
+    {
+      // the hybrid strategy falls back to extent limited indexes for layers it could not fully index
+      for ( QgsVectorLayer *layer : layers )
+      {
+        if ( !mLargeLayers.value( layer->id() ) && !locatorForLayer( layer )->hasIndex() )
+          setLargeLayer( layer, true );
+      }
+    }
+#endif
+  }
+
   mSnappingResult = SnappingResult( match );
+  mSnappingResultInputCoordinate = mInputCoordinate;
 
   //set point containing ZM if existing
   QgsVectorLayer *vlayer = qobject_cast<QgsVectorLayer *>( currentLayer() );
   if ( vlayer && match.layer()
        && ( QgsWkbTypes::hasZ( vlayer->wkbType() ) || QgsWkbTypes::hasM( vlayer->wkbType() ) ) )
   {
-    const QgsFeature ft = match.layer()->getFeature( match.featureId() );
-    mSnappingResult.setPoint( newPoint( ft.geometry().vertexAt( match.vertexIndex() ), vlayer->wkbType() ) );
+    mSnappingResult.setPoint( newPoint( matchedVertex( match ), vlayer->wkbType() ) );
   }
 
   emit snappingResultChanged();
 }
 
+QgsPoint SnappingUtils::matchedVertex( const QgsPointLocator::Match &match )
+{
+  const QPair<QgsVectorLayer *, QgsFeatureId> key = qMakePair( match.layer(), match.featureId() );
+  QgsGeometry *geometry = mGeometryCache.object( key );
+  if ( !geometry )
+  {
+    QgsFeature feature;
+    match.layer()->getFeatures( QgsFeatureRequest( match.featureId() ).setNoAttributes() ).nextFeature( feature );
+    geometry = new QgsGeometry( feature.geometry() );
+    mGeometryCache.insert( key, geometry );
+
+    connect( match.layer(), &QgsVectorLayer::geometryChanged, this, &SnappingUtils::removeCachedGeometry, Qt::UniqueConnection );
+    connect( match.layer(), &QgsVectorLayer::featureDeleted, this, &SnappingUtils::removeCachedGeometry, Qt::UniqueConnection );
+    connect( match.layer(), &QgsVectorLayer::afterRollBack, this, &SnappingUtils::clearCachedGeometries, Qt::UniqueConnection );
+  }
+
+  return geometry->vertexAt( match.vertexIndex() );
+}
+
 QPointF SnappingUtils::inputCoordinate() const
 {
   return mInputCoordinate;
@@ -102,7 +338,7 @@ void SnappingUtils::setInputCoordinate( const QPointF &inputCoordinate )
 
   mInputCoordinate = inputCoordinate;
 
-  snap();
+  requestSnap();
 
   emit inputCoordinateChanged();
 }
@@ -126,6 +362,11 @@ void SnappingUtils::prepareIndexProgress( int index )
     emit indexingProgress( index );
 }
 
+QPointF SnappingUtils::snappingResultInputCoordinate() const
+{
+  return mSnappingResultInputCoordinate;
+}
+
 QgsVectorLayer *SnappingUtils::currentLayer() const
 {
   return mCurrentLayer;
@@ -157,5 +398,10 @@ void SnappingUtils::setMapSettings( QgsQuickMapSettings *settings )
   connect( settings, &QgsQuickMapSettings::layersChanged, this, &SnappingUtils::onMapSettingsUpdated );
 
   mSettings = settings;
+
+  if ( mSettings )
+    onMapSettingsUpdated();
+
   emit mapSettingsChanged();
 }
+
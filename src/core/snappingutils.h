@@ -19,10 +19,29 @@
 
 class QgsQuickMapSettings;
 
+#include <QCache>
+#include <QSet>
+#include <QTimer>
 #include <qgssnappingutils.h>
 
 #include "snappingresult.h"
 
+/**
+ * Snaps the input coordinate to the layers configured in the snapping config.
+ *
+ * The point locators of the snapping layers are initialized in relaxed mode: each locator takes a
+ * feature source and renderer snapshot of its layer and builds its index on a background task,
+ * layers are skipped until their index is ready. Once built, the locators follow the edits of their
+ * layer feature by feature.
+ *
+ * Layers which turned out too large for a full index are remembered on disk, keyed by their source
+ * and modification time, so that reopening a project goes straight to extent limited indexes instead
+ * of trying to index all of their features again.
+ *
+ * Input coordinates and extent changes are coalesced so that only the latest one is snapped. The
+ * results are delivered through snappingResultChanged together with the input coordinate they have
+ * been computed for.
+ */
 class SnappingUtils : public QgsSnappingUtils
 {
     Q_OBJECT
@@ -31,6 +50,8 @@ class SnappingUtils : public QgsSnappingUtils
     Q_PROPERTY( QgsVectorLayer *currentLayer READ currentLayer WRITE setCurrentLayer NOTIFY currentLayerChanged )
     Q_PROPERTY( SnappingResult snappingResult READ snappingResult NOTIFY snappingResultChanged )
     Q_PROPERTY( QPointF inputCoordinate READ inputCoordinate WRITE setInputCoordinate NOTIFY inputCoordinateChanged )
+    //! the input coordinate the current snapping result has been computed for
+    Q_PROPERTY( QPointF snappingResultInputCoordinate READ snappingResultInputCoordinate NOTIFY snappingResultChanged )
 
   public:
     explicit SnappingUtils( QObject *parent = nullptr );
@@ -46,6 +67,9 @@ class SnappingUtils : public QgsSnappingUtils
 
     SnappingResult snappingResult() const;
 
+    //! \copydoc snappingResultInputCoordinate
+    QPointF snappingResultInputCoordinate() const;
+
     static QgsPoint newPoint( const QgsPoint &snappedPoint, const QgsWkbTypes::Type wkbType );
 
   signals:
@@ -64,17 +88,49 @@ class SnappingUtils : public QgsSnappingUtils
 
   private slots:
     void onMapSettingsUpdated();
-    void removeOutdatedLocators();
+    void removeOutdatedLocators( const QStringList &layerIds );
+    void onLocatorInitFinished( bool ok );
+    void removeCachedGeometry( QgsFeatureId fid );
+    void clearCachedGeometries();
+    void snap();
 
   private:
-    void snap();
+    //! Schedules a snap of the latest input coordinate
+    void requestSnap();
+    //! Returns the layers to snap to according to the snapping config
+    QList<QgsVectorLayer *> snappingLayers() const;
+    //! Reports the locators of the snapping layers which are building their index in the background
+    void watchIndexingLocators( const QList<QgsVectorLayer *> &layers );
+    //! Returns TRUE if \a layer is remembered as too large for a full index, the record is read once per layer
+    bool isLargeLayer( QgsVectorLayer *layer );
+    //! Remembers on disk whether \a layer is too large for a full index
+    void setLargeLayer( QgsVectorLayer *layer, bool large );
+    //! Returns the path of the file remembering the layers too large for a full index
+    static QString indexCachePath();
+    //! Returns the key of \a layer in the index cache, or an empty string if its source is not a file
+    static QString indexCacheKey( QgsVectorLayer *layer, qint64 &modified );
+    //! Returns the matched vertex with its Z and M values, geometries are kept in a small cache
+    QgsPoint matchedVertex( const QgsPointLocator::Match &match );
 
     QgsQuickMapSettings *mSettings = nullptr;
     QgsVectorLayer *mCurrentLayer = nullptr;
 
-    int mIndexLayerCount;
+    int mIndexLayerCount = 0;
     SnappingResult mSnappingResult;
     QPointF mInputCoordinate;
+    QPointF mSnappingResultInputCoordinate;
+
+    QTimer mSnapTimer;
+    //! the ids of the layers whose locators have been used since they have last been cleared
+    QSet<QString> mSnappedLayerIds;
+    QSet<QgsPointLocator *> mIndexingLocators;
+    int mIndexedLocatorCount = 0;
+    //! whether the layers with these ids are too large for a full index, as read from the index cache
+    QHash<QString, bool> mLargeLayers;
+
+    QCache<QPair<QgsVectorLayer *, QgsFeatureId>, QgsGeometry> mGeometryCache;
+
+    friend class TestSnappingUtils;
 };
 
 
@@ -18,12 +18,40 @@
 #include "tracker.h"
 
 #include "rubberbandmodel.h"
+#include "snappingutils.h"
+#include "geometryutils.h"
+#include "coordinatetransformcache.h"
+#include "featurecommitqueue.h"
 #include "qgsproject.h"
+#include "qgslinestring.h"
+#include "qgsmessagelog.h"
+#include "qgspolygon.h"
+#include "qgsvectorlayerutils.h"
+
+#include <QDir>
+
+//! the time interval in milliseconds after which the tracked vertices are stored in the feature
+static const int FLUSH_INTERVAL = 30000;
+//! the number of tracked vertices after which they are stored in the feature regardless of the interval
+static const int FLUSH_VERTEX_COUNT = 100;
+//! the number of vertices kept in the rubberband once they are stored in the feature
+static const int RUBBERBAND_TAIL_SIZE = 500;
+//! the maximum number of positions a trackpoint can be simplified over
+static const int SIMPLIFICATION_WINDOW_SIZE = 200;
 
 Tracker::Tracker( QgsVectorLayer *layer, bool visible )
   : mLayer( layer ),
     mVisible( visible )
 {
+  connect( &mFlushTimer, &QTimer::timeout, this, &Tracker::flush );
+}
+
+void Tracker::setFeature( const QgsFeature &feature )
+{
+  mFeature = feature;
+
+  if ( mJournal.isOpen() && mFeature.isValid() && !FID_IS_NEW( mFeature.id() ) )
+    mJournal.setFeatureId( mFeature.id() );
 }
 
 RubberbandModel *Tracker::model() const
@@ -68,6 +96,16 @@ void Tracker::setStartPositionTimestamp(const QDateTime &startPositionTimestamp)
   mStartPositionTimestamp = startPositionTimestamp;
 }
 
+double Tracker::simplificationTolerance() const
+{
+  return mSimplificationTolerance;
+}
+
+void Tracker::setSimplificationTolerance( const double simplificationTolerance )
+{
+  mSimplificationTolerance = simplificationTolerance;
+}
+
 bool Tracker::conjunction() const
 {
   return mConjunction;
@@ -78,6 +116,33 @@ void Tracker::setMinimumDistance( const int minimumDistance )
   mMinimumDistance = minimumDistance;
 }
 
+double Tracker::totalLength() const
+{
+  return mTotalLength;
+}
+
+void Tracker::updateDistanceArea()
+{
+  const QgsCoordinateReferenceSystem crs = QgsProject::instance()->crs();
+  mTransform = CoordinateTransformCache::instance()->transform( mRubberbandModel->crs(), crs );
+  mDistanceArea.setEllipsoid( QgsProject::instance()->ellipsoid() );
+  mDistanceArea.setSourceCrs( crs, QgsProject::instance()->transformContext() );
+
+  // the latest tracked vertex is still in the rubberband, just before the current position
+  const int vertexIndex = mRubberbandModel->currentCoordinateIndex() - 1;
+  mHasLastTrackedPoint = vertexIndex >= 0;
+  if ( mHasLastTrackedPoint )
+  {
+    mLastTrackedPoint = mTransform.transform( mRubberbandModel->xValues().at( vertexIndex ), mRubberbandModel->yValues().at( vertexIndex ) );
+  }
+}
+
+QgsPointXY Tracker::currentProjectPoint() const
+{
+  const QgsPoint currentCoordinate = mRubberbandModel->currentCoordinate();
+  return mTransform.transform( currentCoordinate.x(), currentCoordinate.y() );
+}
+
 void Tracker::trackPosition()
 {
   if ( std::isnan( model()->currentCoordinate().x() ) || std::isnan( model()->currentCoordinate().y() ) )
@@ -85,29 +150,105 @@ void Tracker::trackPosition()
     return;
   }
 
-  model()->addVertex();
+  if ( trackVertex( model()->currentCoordinate(), currentProjectPoint() ) )
+  {
+    model()->addVertex();
+  }
+  else
+  {
+    // the latest trackpoint lies on the simplified track, move it to the current position
+    model()->setVertex( model()->currentCoordinateIndex() - 1, model()->currentCoordinate() );
+  }
+
+  if ( mJournal.revision() - mFlushedRevision >= FLUSH_VERTEX_COUNT )
+    flush();
+}
+
+bool Tracker::trackVertex( const QgsPoint &vertex, const QgsPointXY &point )
+{
+  if ( mHasLastTrackedPoint )
+  {
+    mTotalLength += mDistanceArea.measureLine( mLastTrackedPoint, point );
+    emit totalLengthChanged();
+  }
+  mLastTrackedPoint = point;
+  mHasLastTrackedPoint = true;
+
   mTimeIntervalFulfilled = false;
   mMinimumDistanceFulfilled = false;
+
+  if ( canSimplify( point ) )
+  {
+    replaceLastTrackVertex( vertex );
+    mSimplificationWindow << point;
+    return false;
+  }
+
+  appendTrackVertex( vertex );
+
+  // the previous trackpoint is kept for good and becomes the anchor of the next simplification
+  if ( !mSimplificationWindow.isEmpty() )
+    mSimplificationAnchor = mSimplificationWindow.last();
+
+  mSimplificationWindow.clear();
+  if ( mHasSimplificationAnchor )
+  {
+    mSimplificationWindow << point;
+  }
+  else
+  {
+    mSimplificationAnchor = point;
+    mHasSimplificationAnchor = true;
+  }
+
+  return true;
 }
 
-void Tracker::positionReceived()
+void Tracker::appendTrackVertex( const QgsPoint &vertex )
+{
+  mJournal.appendVertex( vertex );
+  if ( storesSegments() )
+    mPendingVertices << vertex;
+}
+
+void Tracker::replaceLastTrackVertex( const QgsPoint &vertex )
 {
+  // the last stored vertex is never replaced, the simplification restarts from it after a flush
+  mJournal.replaceLastVertex( vertex );
+  if ( !mPendingVertices.isEmpty() )
+    mPendingVertices.last() = vertex;
+}
 
-  QVector<QgsPointXY> points = mRubberbandModel->flatPointSequence( QgsProject::instance()->crs() );
+bool Tracker::storesSegments() const
+{
+  return QgsWkbTypes::geometryType( mLayer->wkbType() ) != QgsWkbTypes::PolygonGeometry;
+}
 
-  auto pointIt = points.constEnd() - 1;
+bool Tracker::canSimplify( const QgsPointXY &point ) const
+{
+  if ( mSimplificationTolerance <= 0 || !mHasSimplificationAnchor || mSimplificationWindow.isEmpty()
+       || mSimplificationWindow.count() >= SIMPLIFICATION_WINDOW_SIZE )
+    return false;
 
-  QVector<QgsPointXY> flatPoints;
+  // all the positions since the anchor must stay within the tolerance of the new segment
+  for ( const QgsPointXY &position : mSimplificationWindow )
+  {
+    QgsPointXY closestPoint;
+    position.sqrDistToSegment( mSimplificationAnchor.x(), mSimplificationAnchor.y(), point.x(), point.y(), closestPoint );
+    if ( mDistanceArea.measureLine( position, closestPoint ) > mSimplificationTolerance )
+      return false;
+  }
 
-  flatPoints << *pointIt;
-  pointIt--;
-  flatPoints << *pointIt;
+  return true;
+}
 
-  QgsDistanceArea distanceArea;
-  distanceArea.setEllipsoid( QgsProject::instance()->ellipsoid() );
-  distanceArea.setSourceCrs( QgsProject::instance()->crs(), QgsProject::instance()->transformContext() );
+void Tracker::positionReceived()
+{
+  // the samples of a batch have been tracked before they are applied to the rubberband
+  if ( mApplyingSamples || !mHasLastTrackedPoint )
+    return;
 
-  if ( distanceArea.measureLine( flatPoints ) > mMinimumDistance )
+  if ( mDistanceArea.measureLine( mLastTrackedPoint, currentProjectPoint() ) > mMinimumDistance )
   {
     mMinimumDistanceFulfilled = true;
     if ( !mConjunction || mTimeIntervalFulfilled )
@@ -115,6 +256,74 @@ void Tracker::positionReceived()
   }
 }
 
+void Tracker::processPositionSamples( const QList<PositionSample> &samples )
+{
+  if ( !mRubberbandModel || samples.isEmpty() )
+    return;
+
+  const bool hasM = mLayer && QgsWkbTypes::hasM( mLayer->wkbType() );
+  QgsPointSequence appendedVertices;
+  QgsPoint movedVertex;
+  bool hasMovedVertex = false;
+  QgsPoint point;
+  for ( const PositionSample &sample : samples )
+  {
+    const QDateTime timestamp = sample.info.timestamp();
+    point = sample.projectedPosition;
+    if ( hasM && mStartPositionTimestamp.isValid() && timestamp.isValid() )
+      point.addMValue( mStartPositionTimestamp.msecsTo( timestamp ) / 1000.0 );
+
+    if ( !mJournal.isOpen() || std::isnan( point.x() ) || std::isnan( point.y() ) )
+      continue;
+
+    const QgsPointXY projectPoint = mTransform.transform( point.x(), point.y() );
+    bool track = false;
+    if ( !mHasLastTrackedPoint )
+    {
+      // the track has been started before the first position was received
+      track = true;
+    }
+    else if ( mMinimumDistance > 0 && mDistanceArea.measureLine( mLastTrackedPoint, projectPoint ) > mMinimumDistance )
+    {
+      mMinimumDistanceFulfilled = true;
+      track = !mConjunction || mTimeIntervalFulfilled;
+    }
+
+    if ( !track )
+      continue;
+
+    if ( trackVertex( point, projectPoint ) )
+      appendedVertices << point;
+    else if ( !appendedVertices.isEmpty() )
+      appendedVertices.last() = point;
+    else
+    {
+      // the latest trackpoint in the rubberband lies on the simplified track
+      movedVertex = point;
+      hasMovedVertex = true;
+    }
+  }
+
+  mApplyingSamples = true;
+  mRubberbandModel->setCurrentPositionTimestamp( samples.last().info.timestamp() );
+  const int currentIndex = mRubberbandModel->currentCoordinateIndex();
+  if ( hasMovedVertex )
+    mRubberbandModel->setVertex( currentIndex - 1, movedVertex );
+  if ( !appendedVertices.isEmpty() )
+  {
+    // the tracked vertices are inserted before the current coordinate
+    mRubberbandModel->insertVertices( currentIndex, appendedVertices.count() );
+    for ( int i = 0; i < appendedVertices.count(); ++i )
+      mRubberbandModel->setVertex( currentIndex + i, appendedVertices.at( i ) );
+    mRubberbandModel->setCurrentCoordinateIndex( currentIndex + appendedVertices.count() );
+  }
+  mRubberbandModel->setCurrentCoordinate( point );
+  mApplyingSamples = false;
+
+  if ( mJournal.isOpen() && mJournal.revision() - mFlushedRevision >= FLUSH_VERTEX_COUNT )
+    flush();
+}
+
 void Tracker::timeReceived()
 {
   mTimeIntervalFulfilled = true;
@@ -134,16 +343,43 @@ void Tracker::start()
     connect( mRubberbandModel, &RubberbandModel::currentCoordinateChanged, this, &Tracker::positionReceived );
   }
 
+  // the transform and the ellipsoid are only set up again when the crs changes
+  connect( QgsProject::instance(), &QgsProject::crsChanged, this, &Tracker::updateDistanceArea );
+  connect( QgsProject::instance(), &QgsProject::ellipsoidChanged, this, &Tracker::updateDistanceArea );
+  connect( mRubberbandModel, &RubberbandModel::crsChanged, this, &Tracker::updateDistanceArea );
+  updateDistanceArea();
+  mTotalLength = 0.0;
+  emit totalLengthChanged();
+
   //set the start time
   setStartPositionTimestamp( QDateTime::currentDateTime() );
   model()->setMeasureValue(0);
 
+  const QString journalName = QStringLiteral( "%1_%2.journal" ).arg( mLayer->id() ).arg( mStartPositionTimestamp.toMSecsSinceEpoch() );
+  mTrackCrs = mRubberbandModel->crs();
+  mJournal.create( QDir( TrackJournal::journalDirectory() ).filePath( journalName ), mLayer->id(), mTrackCrs );
+  mFlushedRevision = 0;
+  mStoredFeatureId = FID_NULL;
+  mPendingVertices.clear();
+  mFlushTimer.start( FLUSH_INTERVAL );
+  mHasSimplificationAnchor = false;
+  mSimplificationWindow.clear();
+
   //track first position
   trackPosition();
 }
 
 void Tracker::stop()
 {
+  mFlushTimer.stop();
+  if ( mJournal.isOpen() )
+  {
+    // keep the journal of a track which could not be stored, it is recovered with the next project load
+    const bool stored = storesSegments() ? flush() : storeTrack();
+    if ( stored || mJournal.vertexCount() == 0 )
+      mJournal.remove();
+  }
+
   if ( mTimeInterval > 0 )
   {
     mTimer.stop();
@@ -153,4 +389,188 @@ void Tracker::stop()
   {
     disconnect( mRubberbandModel,  &RubberbandModel::currentCoordinateChanged, this, &Tracker::positionReceived );
   }
+
+  disconnect( QgsProject::instance(), &QgsProject::crsChanged, this, &Tracker::updateDistanceArea );
+  disconnect( QgsProject::instance(), &QgsProject::ellipsoidChanged, this, &Tracker::updateDistanceArea );
+  disconnect( mRubberbandModel, &RubberbandModel::crsChanged, this, &Tracker::updateDistanceArea );
+}
+
+bool Tracker::flush()
+{
+  if ( !mJournal.isOpen() || !mLayer || !mFeature.isValid() || FID_IS_NEW( mFeature.id() ) )
+    return false;
+
+  const int revision = mJournal.revision();
+  if ( revision == mFlushedRevision || !storesSegments() )
+    return true;
+
+  TrackJournal::Track segment;
+  segment.crs = mTrackCrs;
+  segment.vertices = mPendingVertices;
+  const QgsGeometry geometry = trackGeometry( mLayer, segment );
+  if ( geometry.isNull() )
+    return false;
+
+  // the first segment goes to the feature, the next ones are appended as new features
+  QgsFeatureId featureId = mStoredFeatureId == FID_NULL ? mFeature.id() : FID_NULL;
+  if ( !storeGeometry( mLayer, featureId, geometry, mCommitQueue, mFeature.attributes() ) )
+    return false;
+
+  mJournal.setStoredFeatureId( featureId );
+  mStoredFeatureId = featureId;
+  if ( featureId == mFeature.id() )
+    mFeature.setGeometry( geometry );
+
+  // the next segment starts at the last stored vertex, which the simplification must not move anymore
+  const QgsPoint lastStoredVertex = mPendingVertices.last();
+  mPendingVertices.clear();
+  mPendingVertices << lastStoredVertex;
+  mSimplificationAnchor = mLastTrackedPoint;
+  mHasSimplificationAnchor = mHasLastTrackedPoint;
+  mSimplificationWindow.clear();
+  mFlushedRevision = mJournal.revision();
+
+  // the stored vertices are drawn with the layer, only keep the latest ones in the rubberband
+  const int excessCount = mRubberbandModel->vertexCount() - RUBBERBAND_TAIL_SIZE;
+  if ( excessCount > 0 )
+  {
+    const int currentIndex = mRubberbandModel->currentCoordinateIndex();
+    mRubberbandModel->removeVertices( 0, excessCount );
+    // the current position follows the tail
+    if ( currentIndex >= excessCount )
+      mRubberbandModel->setCurrentCoordinateIndex( currentIndex - excessCount );
+  }
+
+  return true;
+}
+
+bool Tracker::storeTrack()
+{
+  if ( !mJournal.isOpen() || !mLayer || !mFeature.isValid() || FID_IS_NEW( mFeature.id() ) )
+    return false;
+
+  // the vertices of a polygon track are not kept in memory, the journal holds all of them
+  TrackJournal::Track track;
+  if ( !TrackJournal::read( mJournal.path(), track ) )
+    return false;
+
+  const QgsGeometry geometry = trackGeometry( mLayer, track );
+  if ( geometry.isNull() )
+    return false;
+
+  QgsFeatureId featureId = mFeature.id();
+  if ( !storeGeometry( mLayer, featureId, geometry, mCommitQueue ) )
+    return false;
+
+  mFeature.setGeometry( geometry );
+  mFlushedRevision = mJournal.revision();
+  return true;
+}
+
+QgsGeometry Tracker::trackGeometry( QgsVectorLayer *layer, const TrackJournal::Track &track )
+{
+  const QgsWkbTypes::Type wkbType = layer->wkbType();
+  const QgsWkbTypes::GeometryType geometryType = QgsWkbTypes::geometryType( wkbType );
+  if ( ( geometryType == QgsWkbTypes::LineGeometry && track.vertices.count() < 2 )
+       || ( geometryType == QgsWkbTypes::PolygonGeometry && track.vertices.count() < 3 )
+       || ( geometryType != QgsWkbTypes::LineGeometry && geometryType != QgsWkbTypes::PolygonGeometry ) )
+    return QgsGeometry();
+
+  const QgsCoordinateTransform transform = CoordinateTransformCache::instance()->transform( track.crs, layer->crs() );
+
+  QVector<double> x;
+  QVector<double> y;
+  x.reserve( track.vertices.count() );
+  y.reserve( track.vertices.count() );
+  for ( const QgsPoint &vertex : track.vertices )
+  {
+    x << vertex.x();
+    y << vertex.y();
+  }
+  if ( !GeometryUtils::transformCoordinates( transform, x, y ) )
+    return QgsGeometry();
+
+  QgsPointSequence points;
+  points.reserve( track.vertices.count() + 1 );
+  for ( int i = 0; i < track.vertices.count(); ++i )
+  {
+    QgsPoint point = SnappingUtils::newPoint( track.vertices.at( i ), wkbType );
+    point.setX( x.at( i ) );
+    point.setY( y.at( i ) );
+    points << point;
+  }
+
+  QgsGeometry geometry;
+  if ( geometryType == QgsWkbTypes::LineGeometry )
+  {
+    geometry = QgsGeometry( new QgsLineString( points ) );
+  }
+  else
+  {
+    points << points.at( 0 );
+    QgsPolygon *polygon = new QgsPolygon();
+    polygon->setExteriorRing( new QgsLineString( points ) );
+    geometry = QgsGeometry( polygon );
+  }
+
+  if ( QgsWkbTypes::isMultiType( wkbType ) )
+    geometry.convertToMultiType();
+
+  return geometry;
+}
+
+bool Tracker::storeGeometry( QgsVectorLayer *layer, QgsFeatureId &featureId, const QgsGeometry &geometry, FeatureCommitQueue *commitQueue, const QgsAttributes &attributes )
+{
+  if ( commitQueue )
+    commitQueue->flush( layer );
+
+  if ( layer->isModified() )
+  {
+    // the track is kept in its journal and stored once the other changes are saved
+    QgsMessageLog::logMessage( tr( "Layer \"%1\" has unsaved changes, the track is not stored yet" ).arg( layer->name() ), QStringLiteral( "QField" ), Qgis::Info );
+    return false;
+  }
+
+  if ( !layer->editBuffer() && !layer->startEditing() )
+  {
+    QgsMessageLog::logMessage( tr( "Cannot start editing on layer \"%1\" to store the track" ).arg( layer->name() ), QStringLiteral( "QField" ), Qgis::Warning );
+    return false;
+  }
+
+  bool stored = false;
+  if ( featureId == FID_NULL )
+  {
+    QgsAttributeMap attributeMap;
+    const QgsAttributeList primaryKeyAttributes = layer->primaryKeyAttributes();
+    for ( int i = 0; i < attributes.count(); ++i )
+    {
+      if ( !primaryKeyAttributes.contains( i ) )
+        attributeMap.insert( i, attributes.at( i ) );
+    }
+
+    QgsFeature feature = QgsVectorLayerUtils::createFeature( layer, geometry, attributeMap );
+    stored = layer->addFeature( feature );
+  }
+  else
+  {
+    stored = layer->changeGeometry( featureId, geometry );
+  }
+
+  // the id of an added feature is only known once it has been committed
+  const QMetaObject::Connection connection = connect( layer, &QgsVectorLayer::committedFeaturesAdded, layer, [&featureId]( const QString &, const QgsFeatureList & addedFeatures )
+  {
+    if ( !addedFeatures.isEmpty() )
+      featureId = addedFeatures.last().id();
+  } );
+  const bool committed = stored && layer->commitChanges();
+  disconnect( connection );
+
+  if ( !committed )
+  {
+    QgsMessageLog::logMessage( tr( "Could not store the track on layer \"%1\". Rolling back." ).arg( layer->name() ), QStringLiteral( "QField" ), Qgis::Critical );
+    layer->rollBack();
+    return false;
+  }
+
+  return true;
 }
@@ -16,16 +16,24 @@
 #ifndef TRACKER_H
 #define TRACKER_H
 
+#include <QPointer>
 #include <QTimer>
 #include "qgsvectorlayer.h"
+#include "qgscoordinatetransform.h"
+#include "qgsdistancearea.h"
+#include "trackjournal.h"
+#include "gnsspositionpipeline.h"
 
 class RubberbandModel;
+class FeatureCommitQueue;
 
 class Tracker : public QObject
 {
     Q_OBJECT
 
     Q_PROPERTY( QDateTime startPositionTimestamp READ startPositionTimestamp WRITE setStartPositionTimestamp NOTIFY startPositionTimestampChanged )
+    //! the length of the tracked vertices, in the length units of the project distance area
+    Q_PROPERTY( double totalLength READ totalLength NOTIFY totalLengthChanged )
 
   public:
     explicit Tracker( QgsVectorLayer *layer, bool visible );
@@ -43,6 +51,11 @@ class Tracker : public QObject
     //! the minimum distance between setting trackpoints
     void setMinimumDistance( const int minimumDistance );
 
+    //! the maximum distance between the tracked positions and the simplified track, 0 to keep all trackpoints
+    double simplificationTolerance() const;
+    //! the maximum distance between the tracked positions and the simplified track, 0 to keep all trackpoints
+    void setSimplificationTolerance( const double simplificationTolerance );
+
     //! if both, the minimum distance and the time interval, needs to be fulfilled before setting trackpoints
     bool conjunction() const;
     //! if both, the minimum distance and the time interval, needs to be fulfilled before setting trackpoints
@@ -53,6 +66,9 @@ class Tracker : public QObject
     //! the timestamp of the first recorded position
     void setStartPositionTimestamp( const QDateTime &startPositionTimestamp );
 
+    //! \copydoc totalLength
+    double totalLength() const;
+
     //! the current layer
     QgsVectorLayer *layer() const { return mLayer; }
     //! the current layer
@@ -60,7 +76,11 @@ class Tracker : public QObject
     //! the created feature
     QgsFeature feature() const { return mFeature; }
     //! the created feature
-    void setFeature( const QgsFeature& feature ) { mFeature = feature; }
+    void setFeature( const QgsFeature &feature );
+    //! the queue whose pending edits are committed before the track is stored
+    FeatureCommitQueue *commitQueue() const { return mCommitQueue; }
+    //! the queue whose pending edits are committed before the track is stored
+    void setCommitQueue( FeatureCommitQueue *commitQueue ) { mCommitQueue = commitQueue; }
     //! if the layer (and the rubberband ) is visible
     bool visible() const { return mVisible; }
     //! if the layer (and the rubberband ) is visible
@@ -69,12 +89,45 @@ class Tracker : public QObject
     void start();
     void stop();
 
+    /**
+     * Tracks the position \a samples in the order they have been received, so that no position
+     * is skipped when they arrive in batches. The rubberband is only updated once per batch: the
+     * tracked vertices are inserted at once and the current coordinate is set to the latest sample.
+     */
+    void processPositionSamples( const QList<PositionSample> &samples );
+
+    /**
+     * Stores the vertices tracked since the last flush as a new segment of the track. The first
+     * segment is stored in the feature, the following ones in new features with the same attributes,
+     * each of them starting at the last vertex of the previous one, so that the stored geometries are
+     * never rewritten. The rubberband is then trimmed to the latest vertices.
+     * A polygon cannot be split into segments, tracks on polygon layers are only kept in the journal
+     * and stored with stop(). Nothing is stored until the feature has been created.
+     */
+    bool flush();
+
+    //! Returns the geometry of the \a track converted to the type and crs of \a layer
+    static QgsGeometry trackGeometry( QgsVectorLayer *layer, const TrackJournal::Track &track );
+
+    /**
+     * Stores \a geometry in the feature with \a featureId on \a layer, or in a new feature with the
+     * \a attributes if \a featureId is FID_NULL, in which case \a featureId is set to the id of the
+     * created feature. The primary key attributes are left to the layer.
+     * The edits of \a layer pending in \a commitQueue are committed first, so that rolling back
+     * a failed store does not discard them. Nothing is stored if \a layer has other uncommitted
+     * changes, which would be committed or rolled back together with the geometry.
+     */
+    static bool storeGeometry( QgsVectorLayer *layer, QgsFeatureId &featureId, const QgsGeometry &geometry, FeatureCommitQueue *commitQueue = nullptr, const QgsAttributes &attributes = QgsAttributes() );
+
   signals:
     void startPositionTimestampChanged();
+    void totalLengthChanged();
 
   private slots:
     void positionReceived();
     void timeReceived();
+    //! Sets up the transform and ellipsoid used to measure the distances between the tracked positions
+    void updateDistanceArea();
 
   private:
     RubberbandModel *mRubberbandModel = nullptr;
@@ -85,16 +138,64 @@ class Tracker : public QObject
     bool mConjunction = true;
     bool mTimeIntervalFulfilled = false;
     bool mMinimumDistanceFulfilled = false;
+    //! if the rubberband is being updated with a batch of samples which have already been tracked
+    bool mApplyingSamples = false;
 
     QgsVectorLayer *mLayer = nullptr;
     QgsFeature mFeature;
+    QPointer<FeatureCommitQueue> mCommitQueue;
 
     bool mVisible = true;
 
     QDateTime mStartPositionTimestamp;
 
-    void trackPosition();
+    //! transforms the rubberband coordinates into the project crs the distances are measured in
+    QgsCoordinateTransform mTransform;
+    QgsDistanceArea mDistanceArea;
+    //! the latest tracked vertex in the project crs
+    QgsPointXY mLastTrackedPoint;
+    bool mHasLastTrackedPoint = false;
+    double mTotalLength = 0.0;
+
+    //! the tracked vertices, written as they are tracked and stored in the feature on flush
+    TrackJournal mJournal;
+    QTimer mFlushTimer;
+    int mFlushedRevision = 0;
+    //! the crs of the tracked vertices
+    QgsCoordinateReferenceSystem mTrackCrs;
+    //! the id of the feature holding the latest stored segment, FID_NULL until the first flush
+    QgsFeatureId mStoredFeatureId = FID_NULL;
+    //! the tracked vertices not stored yet, preceded by the last stored vertex once a segment has been stored
+    QgsPointSequence mPendingVertices;
+
+    double mSimplificationTolerance = 0.0;
+    //! the latest trackpoint kept by the simplification, in the project crs
+    QgsPointXY mSimplificationAnchor;
+    bool mHasSimplificationAnchor = false;
+    //! the positions tracked since the anchor, the last one is the latest trackpoint
+    QVector<QgsPointXY> mSimplificationWindow;
+
+    //! Returns if the latest trackpoint can be dropped in favor of \a point without exceeding the tolerance
+    bool canSimplify( const QgsPointXY &point ) const;
 
+    void trackPosition();
+    /**
+     * Tracks \a vertex, at \a point in the project crs, in the journal without updating the rubberband.
+     * Returns TRUE if the vertex has been appended, FALSE if it replaced the latest trackpoint.
+     */
+    bool trackVertex( const QgsPoint &vertex, const QgsPointXY &point );
+    //! Appends \a vertex to the journal and to the pending vertices
+    void appendTrackVertex( const QgsPoint &vertex );
+    //! Replaces the last tracked vertex with \a vertex in the journal and in the pending vertices
+    void replaceLastTrackVertex( const QgsPoint &vertex );
+    //! Returns if the track is stored in segments, i.e. if it is not a polygon
+    bool storesSegments() const;
+    //! Stores the whole track, read back from the journal, in the feature
+    bool storeTrack();
+    //! Returns the current position of the rubberband in the project crs
+    QgsPointXY currentProjectPoint() const;
+
+    friend class TestTracker;
 };
 
 #endif // TRACKER_H
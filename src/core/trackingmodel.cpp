@@ -15,6 +15,13 @@
  ***************************************************************************/
 
 #include "trackingmodel.h"
+#include "trackjournal.h"
+#include "gnsspositionpipeline.h"
+#include "featurecommitqueue.h"
+
+#include <QFile>
+#include <qgsmessagelog.h>
+#include <qgsproject.h>
 
 TrackingModel::TrackingModel( QObject *parent )
   : QAbstractItemModel( parent )
@@ -34,11 +41,13 @@ QHash<int, QByteArray> TrackingModel::roleNames() const
   roles[VectorLayer] = "vectorLayer";
   roles[TimeInterval] = "timeInterval";
   roles[MinimumDistance] = "minimumDistance";
+  roles[SimplificationTolerance] = "simplificationTolerance";
   roles[Conjunction] = "conjunction";
   roles[Feature] = "feature";
   roles[RubberModel] = "rubberModel";
   roles[Visible] = "visible";
   roles[StartPositionTimestamp] = "startPositionTimestamp";
+  roles[TotalLength] = "totalLength";
 
   return roles;
 }
@@ -82,6 +91,8 @@ QVariant TrackingModel::data( const QModelIndex &index, int role ) const
       return mTrackers.at( index.row() )->visible();
     case StartPositionTimestamp:
       return mTrackers.at( index.row() )->startPositionTimestamp();
+    case TotalLength:
+      return mTrackers.at( index.row() )->totalLength();
     default:
       return QVariant();
   }
@@ -98,6 +109,9 @@ bool TrackingModel::setData( const QModelIndex &index, const QVariant &value, in
     case MinimumDistance:
       currentTracker->setMinimumDistance( value.toInt() );
       break;
+    case SimplificationTolerance:
+      currentTracker->setSimplificationTolerance( value.toDouble() );
+      break;
     case Conjunction:
       currentTracker->setConjunction( value.toBool() );
       break;
@@ -155,16 +169,113 @@ void TrackingModel::reset()
   endResetModel();
 }
 
+GnssPositionPipeline *TrackingModel::positionPipeline() const
+{
+  return mPositionPipeline;
+}
+
+void TrackingModel::setPositionPipeline( GnssPositionPipeline *positionPipeline )
+{
+  if ( mPositionPipeline == positionPipeline )
+    return;
+
+  if ( mPositionPipeline )
+    disconnect( mPositionPipeline, &GnssPositionPipeline::samplesReceived, this, &TrackingModel::processPositionSamples );
+
+  mPositionPipeline = positionPipeline;
+
+  if ( mPositionPipeline )
+    connect( mPositionPipeline, &GnssPositionPipeline::samplesReceived, this, &TrackingModel::processPositionSamples );
+
+  emit positionPipelineChanged();
+}
+
+FeatureCommitQueue *TrackingModel::commitQueue() const
+{
+  return mCommitQueue;
+}
+
+void TrackingModel::setCommitQueue( FeatureCommitQueue *commitQueue )
+{
+  mCommitQueue = commitQueue;
+  for ( Tracker *tracker : qgis::as_const( mTrackers ) )
+    tracker->setCommitQueue( commitQueue );
+}
+
+void TrackingModel::processPositionSamples( const QList<PositionSample> &samples )
+{
+  for ( Tracker *tracker : qgis::as_const( mTrackers ) )
+    tracker->processPositionSamples( samples );
+}
+
+int TrackingModel::recoverTracks()
+{
+  int recoveredCount = 0;
+  const QStringList journals = TrackJournal::journals();
+  for ( const QString &path : journals )
+  {
+    TrackJournal::Track track;
+    if ( !TrackJournal::read( path, track ) )
+      continue;
+
+    // the journal might belong to another project
+    QgsVectorLayer *layer = QgsProject::instance()->mapLayer<QgsVectorLayer *>( track.layerId );
+    if ( !layer )
+      continue;
+
+    const QgsGeometry geometry = Tracker::trackGeometry( layer, track );
+    if ( !geometry.isNull() )
+    {
+      QgsFeatureId featureId = track.featureId;
+      QgsAttributes attributes;
+      if ( track.storedFeatureId != FID_NULL )
+      {
+        // the stored segments are kept, the rest of the track goes to a new segment with the same attributes
+        QgsFeature storedFeature;
+        if ( layer->getFeatures( QgsFeatureRequest( track.storedFeatureId ).setFlags( QgsFeatureRequest::NoGeometry ) ).nextFeature( storedFeature ) )
+          attributes = storedFeature.attributes();
+        featureId = FID_NULL;
+      }
+
+      // the feature might have been deleted in the meantime
+      QgsFeature feature;
+      if ( featureId != FID_NULL && !layer->getFeatures( QgsFeatureRequest( featureId ).setNoAttributes().setFlags( QgsFeatureRequest::NoGeometry ) ).nextFeature( feature ) )
+        featureId = FID_NULL;
+
+      if ( !Tracker::storeGeometry( layer, featureId, geometry, mCommitQueue, attributes ) )
+        continue;
+
+      QgsMessageLog::logMessage( tr( "Recovered an unfinished track with %1 vertices on layer \"%2\"" ).arg( track.vertices.count() ).arg( layer->name() ), QStringLiteral( "QField" ), Qgis::Info );
+      recoveredCount++;
+    }
+
+    QFile::remove( path );
+  }
+  return recoveredCount;
+}
+
 void TrackingModel::createTracker( QgsVectorLayer *layer, bool visible )
 {
   beginInsertRows( QModelIndex(), mTrackers.count(), mTrackers.count() );
-  mTrackers.append( new Tracker( layer, visible ) );
+  Tracker *tracker = new Tracker( layer, visible );
+  tracker->setCommitQueue( mCommitQueue );
+  connect( tracker, &Tracker::totalLengthChanged, this, [this, tracker]
+  {
+    const QModelIndex trackerIndex = index( mTrackers.indexOf( tracker ), 0 );
+    emit dataChanged( trackerIndex, trackerIndex, QVector<int>() << TotalLength );
+  } );
+  mTrackers.append( tracker );
   endInsertRows();
 }
 
 void TrackingModel::startTracker( QgsVectorLayer *layer )
 {
   int listIndex = trackerIterator( layer ) - mTrackers.constBegin();
+
+  // start from the latest position, the next ones are delivered by the pipeline
+  if ( mPositionPipeline && mPositionPipeline->position().latitudeValid() )
+    mTrackers[ listIndex ]->processPositionSamples( { PositionSample { mPositionPipeline->position().info(), mPositionPipeline->projectedPosition() } } );
+
   mTrackers[ listIndex ]->start();
   emit layerInTrackingChanged( layer, true );
 }
@@ -17,17 +17,23 @@
 #define TRACKINGMODEL_H
 
 #include <QAbstractItemModel>
+#include <QPointer>
 
 #include "rubberbandmodel.h"
 #include "tracker.h"
 
 class RubberbandModel;
 class Track;
+class GnssPositionPipeline;
+class FeatureCommitQueue;
 
 class TrackingModel : public QAbstractItemModel
 {
     Q_OBJECT
 
+    //! the position pipeline delivering the positions to the trackers
+    Q_PROPERTY( GnssPositionPipeline *positionPipeline READ positionPipeline WRITE setPositionPipeline NOTIFY positionPipelineChanged )
+
   public:
     explicit TrackingModel( QObject *parent = nullptr );
     ~TrackingModel() override;
@@ -39,10 +45,12 @@ class TrackingModel : public QAbstractItemModel
       RubberModel,        //! the rubberbandmodel used in the current tracking session
       TimeInterval,       //! the (minimum) time interval between setting trackpoints
       MinimumDistance,    //! the minimum distance between setting trackpoints
+      SimplificationTolerance, //! the maximum distance between the tracked positions and the simplified track, 0 to keep all trackpoints
       Conjunction,        //! if both, the minimum distance and the time interval, needs to be fulfilled before setting trackpoints
       Visible,            //! if the layer and so the tracking components like rubberband is visible
       Feature,            //! the feature in the current tracking session
-      StartPositionTimestamp             //!
+      StartPositionTimestamp,            //!
+      TotalLength         //! the length of the track in the length units of the project distance area
     };
 
     QHash<int, QByteArray> roleNames() const override;
@@ -70,10 +78,32 @@ class TrackingModel : public QAbstractItemModel
 
     void reset();
 
+    //! \copydoc positionPipeline
+    GnssPositionPipeline *positionPipeline() const;
+    //! \copydoc positionPipeline
+    void setPositionPipeline( GnssPositionPipeline *positionPipeline );
+
+    //! Returns the queue whose pending edits are committed before the tracks are stored
+    FeatureCommitQueue *commitQueue() const;
+    //! Sets the queue whose pending edits are committed before the tracks are stored
+    void setCommitQueue( FeatureCommitQueue *commitQueue );
+
+    /**
+     * Stores the tracks left unfinished in journals, e.g. because the application was killed
+     * while tracking, in the layers of the current project they belong to.
+     * \returns the number of recovered tracks
+     */
+    int recoverTracks();
+
   signals:
     void layerInTrackingChanged( QgsVectorLayer *layer, bool tracking );
+    void positionPipelineChanged();
 
   private:
+    void processPositionSamples( const QList<PositionSample> &samples );
+
+    QPointer<GnssPositionPipeline> mPositionPipeline;
+    QPointer<FeatureCommitQueue> mCommitQueue;
     QList<Tracker *> mTrackers;
     QList<Tracker *>::const_iterator trackerIterator( QgsVectorLayer *layer )
     {
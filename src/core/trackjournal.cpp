@@ -0,0 +1,226 @@
+/***************************************************************************
+  trackjournal.cpp - TrackJournal
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "trackjournal.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <qgsmessagelog.h>
+
+#include <limits>
+
+static const quint32 JOURNAL_MAGIC = 0x51465452; // QFTR
+static const quint32 JOURNAL_VERSION = 1;
+
+TrackJournal::~TrackJournal()
+{
+  mFile.close();
+}
+
+bool TrackJournal::create( const QString &path, const QString &layerId, const QgsCoordinateReferenceSystem &crs )
+{
+  mFile.close();
+  mFile.setFileName( path );
+  if ( !QDir().mkpath( QFileInfo( path ).absolutePath() ) || !mFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Could not create the track journal %1: %2" ).arg( path, mFile.errorString() ), QStringLiteral( "QField" ), Qgis::Warning );
+    return false;
+  }
+
+  mStream.setDevice( &mFile );
+  mStream.setVersion( QDataStream::Qt_5_12 );
+  mStream << JOURNAL_MAGIC << JOURNAL_VERSION << layerId << crs.toWkt();
+  mVertexCount = 0;
+  mRevision = 0;
+
+  return flush();
+}
+
+bool TrackJournal::isOpen() const
+{
+  return mFile.isOpen();
+}
+
+QString TrackJournal::path() const
+{
+  return mFile.fileName();
+}
+
+int TrackJournal::vertexCount() const
+{
+  return mVertexCount;
+}
+
+int TrackJournal::revision() const
+{
+  return mRevision;
+}
+
+bool TrackJournal::appendVertex( const QgsPoint &vertex )
+{
+  if ( !writeVertex( VertexRecord, vertex ) )
+    return false;
+
+  mVertexCount++;
+  return true;
+}
+
+bool TrackJournal::replaceLastVertex( const QgsPoint &vertex )
+{
+  if ( mVertexCount == 0 )
+    return appendVertex( vertex );
+
+  return writeVertex( ReplaceLastVertexRecord, vertex );
+}
+
+bool TrackJournal::writeVertex( RecordType type, const QgsPoint &vertex )
+{
+  if ( !mFile.isOpen() )
+    return false;
+
+  const double z = vertex.is3D() ? vertex.z() : std::numeric_limits<double>::quiet_NaN();
+  const double m = vertex.isMeasure() ? vertex.m() : std::numeric_limits<double>::quiet_NaN();
+  mStream << static_cast<quint8>( type ) << vertex.x() << vertex.y() << z << m;
+
+  return flush();
+}
+
+bool TrackJournal::setFeatureId( QgsFeatureId featureId )
+{
+  if ( !mFile.isOpen() )
+    return false;
+
+  mStream << static_cast<quint8>( FeatureIdRecord ) << static_cast<qint64>( featureId );
+
+  return flush();
+}
+
+bool TrackJournal::setStoredFeatureId( QgsFeatureId featureId )
+{
+  if ( !mFile.isOpen() )
+    return false;
+
+  mStream << static_cast<quint8>( StoredFeatureIdRecord ) << static_cast<qint64>( featureId );
+
+  return flush();
+}
+
+void TrackJournal::remove()
+{
+  mFile.close();
+  mFile.remove();
+  mVertexCount = 0;
+  mRevision = 0;
+}
+
+bool TrackJournal::flush()
+{
+  mRevision++;
+
+  // hand the record over to the system right away, it is not lost if the application gets killed
+  if ( mStream.status() != QDataStream::Ok || !mFile.flush() )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Could not write to the track journal %1: %2" ).arg( mFile.fileName(), mFile.errorString() ), QStringLiteral( "QField" ), Qgis::Warning );
+    return false;
+  }
+  return true;
+}
+
+bool TrackJournal::read( const QString &path, Track &track )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_12 );
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  QString crsWkt;
+  stream >> magic >> version >> track.layerId >> crsWkt;
+  if ( stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION )
+    return false;
+
+  track.path = path;
+  track.crs = QgsCoordinateReferenceSystem::fromWkt( crsWkt );
+  track.featureId = FID_NULL;
+  track.storedFeatureId = FID_NULL;
+  track.vertices.clear();
+
+  while ( !stream.atEnd() )
+  {
+    quint8 type = 0;
+    stream >> type;
+
+    if ( type == VertexRecord || type == ReplaceLastVertexRecord )
+    {
+      double x, y, z, m;
+      stream >> x >> y >> z >> m;
+      if ( stream.status() != QDataStream::Ok )
+        break;
+
+      if ( type == ReplaceLastVertexRecord && !track.vertices.isEmpty() )
+        track.vertices.last() = QgsPoint( x, y, z, m );
+      else
+        track.vertices << QgsPoint( x, y, z, m );
+    }
+    else if ( type == FeatureIdRecord )
+    {
+      qint64 featureId;
+      stream >> featureId;
+      if ( stream.status() != QDataStream::Ok )
+        break;
+
+      track.featureId = featureId;
+    }
+    else if ( type == StoredFeatureIdRecord )
+    {
+      qint64 featureId;
+      stream >> featureId;
+      if ( stream.status() != QDataStream::Ok )
+        break;
+
+      // only the last stored vertex is kept, the next segment starts there
+      track.storedFeatureId = featureId;
+      if ( !track.vertices.isEmpty() )
+        track.vertices.erase( track.vertices.begin(), track.vertices.end() - 1 );
+    }
+    else
+    {
+      // the rest of the journal is unreadable, keep what could be recovered
+      break;
+    }
+  }
+
+  return true;
+}
+
+QString TrackJournal::journalDirectory()
+{
+  return QDir( QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) ).filePath( QStringLiteral( "tracks" ) );
+}
+
+QStringList TrackJournal::journals()
+{
+  const QDir dir( journalDirectory() );
+  QStringList paths;
+  const QStringList fileNames = dir.entryList( QStringList() << QStringLiteral( "*.journal" ), QDir::Files, QDir::Time | QDir::Reversed );
+  for ( const QString &fileName : fileNames )
+    paths << dir.filePath( fileName );
+  return paths;
+}
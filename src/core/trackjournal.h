@@ -0,0 +1,119 @@
+/***************************************************************************
+  trackjournal.h - TrackJournal
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef TRACKJOURNAL_H
+#define TRACKJOURNAL_H
+
+#include <QDataStream>
+#include <QFile>
+#include <QVector>
+
+#include <qgscoordinatereferencesystem.h>
+#include <qgsfeatureid.h>
+#include <qgspoint.h>
+
+/**
+ * An append-only file recording the vertices of a track while it is being tracked.
+ *
+ * Every vertex is written to the file as soon as it is tracked, so that the track survives
+ * the application being killed. The journal is removed once the track has been stopped and
+ * stored in its feature, remaining journals belong to unfinished tracks and can be read back
+ * with TrackJournal::read() to recover them.
+ *
+ * A journal starts with a header holding the layer id and the crs of the vertices, followed
+ * by vertex, replaced vertex, feature id and stored segment records. A record cut short by a crash is
+ * ignored when reading.
+ */
+class TrackJournal
+{
+  public:
+    //! The content of a journal
+    struct Track
+    {
+      QString path;
+      QString layerId;
+      QgsCoordinateReferenceSystem crs;
+      //! the id of the feature the track is stored in, FID_NULL if it has not been created yet
+      QgsFeatureId featureId = FID_NULL;
+      //! the id of the feature the latest segment is stored in, FID_NULL if no segment has been stored
+      QgsFeatureId storedFeatureId = FID_NULL;
+      //! the vertices not stored yet, preceded by the last stored vertex if a segment has been stored
+      QVector<QgsPoint> vertices;
+    };
+
+    TrackJournal() = default;
+    ~TrackJournal();
+
+    /**
+     * Creates a new journal at \a path for a track on the layer with \a layerId,
+     * with vertices in \a crs.
+     */
+    bool create( const QString &path, const QString &layerId, const QgsCoordinateReferenceSystem &crs );
+
+    //! Returns if the journal is open for appending
+    bool isOpen() const;
+
+    //! Returns the path of the journal
+    QString path() const;
+
+    //! Returns the number of vertices appended to the journal
+    int vertexCount() const;
+
+    //! Returns the number of records written to the journal, i.e. a revision of its content
+    int revision() const;
+
+    //! Appends a \a vertex and pushes it to the file
+    bool appendVertex( const QgsPoint &vertex );
+
+    //! Replaces the last appended vertex with \a vertex, e.g. when a simplification dropped it
+    bool replaceLastVertex( const QgsPoint &vertex );
+
+    //! Records the id of the feature the track is stored in
+    bool setFeatureId( QgsFeatureId featureId );
+
+    //! Records that the vertices appended so far are stored in a segment feature with \a featureId
+    bool setStoredFeatureId( QgsFeatureId featureId );
+
+    //! Closes and deletes the journal file
+    void remove();
+
+    //! Reads the journal at \a path, returns FALSE if it is not a track journal
+    static bool read( const QString &path, Track &track );
+
+    //! Returns the directory in which the journals of the tracks are kept
+    static QString journalDirectory();
+
+    //! Returns the paths of the journals left in the journal directory
+    static QStringList journals();
+
+  private:
+    enum RecordType : quint8
+    {
+      VertexRecord = 1,
+      FeatureIdRecord = 2,
+      ReplaceLastVertexRecord = 3,
+      StoredFeatureIdRecord = 4,
+    };
+
+    bool writeVertex( RecordType type, const QgsPoint &vertex );
+    bool flush();
+
+    QFile mFile;
+    QDataStream mStream;
+    int mVertexCount = 0;
+    int mRevision = 0;
+};
+
+#endif // TRACKJOURNAL_H
@@ -16,10 +16,13 @@
 
 #include "featureutils.h"
 
+#include <qgsexpression.h>
 #include <qgsexpressioncontextutils.h>
 #include <qgsproject.h>
 #include <qgsvectorlayer.h>
 
+#include <algorithm>
+
 
 FeatureUtils::FeatureUtils(QObject *parent) : QObject(parent)
 {
@@ -50,3 +53,36 @@ QString FeatureUtils::displayName( QgsVectorLayer *layer, const QgsFeature &feat
 
   return name;
 }
+
+QString FeatureUtils::attributeValuesFilter( const QStringList &fieldNames, const QList<QgsAttributes> &values )
+{
+  if ( fieldNames.isEmpty() )
+    return QString();
+
+  QStringList conditions;
+  for ( const QgsAttributes &attributes : values )
+  {
+    if ( attributes.size() != fieldNames.size() || std::any_of( attributes.constBegin(), attributes.constEnd(), []( const QVariant & value ) { return value.isNull(); } ) )
+      continue;
+
+    if ( fieldNames.size() == 1 )
+    {
+      conditions << QgsExpression::quotedValue( attributes.at( 0 ) );
+    }
+    else
+    {
+      QStringList equalities;
+      for ( int i = 0; i < fieldNames.size(); i++ )
+        equalities << QgsExpression::createFieldEqualityExpression( fieldNames.at( i ), attributes.at( i ) );
+      conditions << QStringLiteral( "(%1)" ).arg( equalities.join( QStringLiteral( " AND " ) ) );
+    }
+  }
+
+  if ( conditions.isEmpty() )
+    return QString();
+
+  if ( fieldNames.size() == 1 )
+    return QStringLiteral( "%1 IN (%2)" ).arg( QgsExpression::quotedColumnRef( fieldNames.at( 0 ) ), conditions.join( ',' ) );
+
+  return conditions.join( QStringLiteral( " OR " ) );
+}
@@ -38,6 +38,13 @@ public:
    * \param feature the feature to be named
    */
   static Q_INVOKABLE QString displayName( QgsVectorLayer *layer, const QgsFeature &feature );
+
+  /**
+   * Returns a filter expression matching the features whose \a fieldNames have any of the given \a values.
+   * With a single field an IN (...) expression is built, tuples containing NULL values are skipped.
+   * Returns an empty string if there is no value to match.
+   */
+  static QString attributeValuesFilter( const QStringList &fieldNames, const QList<QgsAttributes> &values );
 };
 
 #endif // FEATUREUTILS_H
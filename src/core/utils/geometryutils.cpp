@@ -16,7 +16,10 @@
 
 #include "geometryutils.h"
 
+#include <qgsexception.h>
+#include <qgsfeedback.h>
 #include <qgslinestring.h>
+#include <qgsmessagelog.h>
 #include <qgspolygon.h>
 #include <qgsvectorlayer.h>
 
@@ -50,3 +53,84 @@ QgsGeometry::OperationResult GeometryUtils::splitFeatureFromRubberband( QgsVecto
   return layer->splitFeatures( line, true );
 }
 
+
+QgsGeometry GeometryUtils::unaryUnion( const QVector<QgsGeometry> &geometries, QgsFeedback *feedback )
+{
+  const int groupSize = 16;
+
+  QVector<QgsGeometry> current;
+  current.reserve( geometries.size() );
+  for ( const QgsGeometry &geometry : geometries )
+  {
+    if ( !geometry.isNull() )
+      current << geometry;
+  }
+
+  // the number of unions needed to reduce all the geometries to a single one
+  int operationCount = 0;
+  for ( int count = current.size(); count > 1; count = ( count + groupSize - 1 ) / groupSize )
+    operationCount += ( count + groupSize - 1 ) / groupSize;
+
+  int operationDone = 0;
+  while ( current.size() > 1 )
+  {
+    QVector<QgsGeometry> next;
+    next.reserve( ( current.size() + groupSize - 1 ) / groupSize );
+    for ( int i = 0; i < current.size(); i += groupSize )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return QgsGeometry();
+
+      const QgsGeometry geometry = QgsGeometry::unaryUnion( current.mid( i, groupSize ) );
+      if ( geometry.isNull() )
+        return QgsGeometry();
+
+      next << geometry;
+
+      if ( feedback )
+        feedback->setProgress( 100.0 * ++operationDone / operationCount );
+    }
+    current = next;
+  }
+
+  return current.isEmpty() ? QgsGeometry() : current.at( 0 );
+}
+
+bool GeometryUtils::transformCoordinates( const QgsCoordinateTransform &transform, QVector<double> &x, QVector<double> &y, QVector<double> &z, QgsCoordinateTransform::TransformDirection direction )
+{
+  Q_ASSERT( x.size() == y.size() );
+
+  if ( x.isEmpty() || transform.isShortCircuited() )
+    return true;
+
+  // the projection library expects a z value per coordinate
+  QVector<double> zeroZ;
+  double *zData = nullptr;
+  if ( z.size() == x.size() )
+  {
+    zData = z.data();
+  }
+  else
+  {
+    zeroZ.fill( 0.0, x.size() );
+    zData = zeroZ.data();
+  }
+
+  try
+  {
+    transform.transformCoords( x.size(), x.data(), y.data(), zData, direction );
+  }
+  catch ( const QgsCsException &exp )
+  {
+    QgsMessageLog::logMessage( QStringLiteral( "Transformation error occurred: %1" ).arg( exp.what() ), QStringLiteral( "QField" ) );
+    return false;
+  }
+
+  return true;
+}
+
+bool GeometryUtils::transformCoordinates( const QgsCoordinateTransform &transform, QVector<double> &x, QVector<double> &y, QgsCoordinateTransform::TransformDirection direction )
+{
+  QVector<double> z;
+  return transformCoordinates( transform, x, y, z, direction );
+}
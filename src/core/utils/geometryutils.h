@@ -20,7 +20,9 @@
 
 #include <qgsgeometry.h>
 #include <qgsfeature.h>
+#include <qgscoordinatetransform.h>
 
+class QgsFeedback;
 class QgsVectorLayer;
 class RubberbandModel;
 
@@ -40,6 +42,26 @@ class GeometryUtils : public QObject
     //! This will perform a split using the line in the rubberband model. It works with the layer selection if some features are selected.
     static Q_INVOKABLE QgsGeometry::OperationResult splitFeatureFromRubberband( QgsVectorLayer *layer, RubberbandModel *rubberBandModel );
 
+    /**
+     * Returns the union of all the \a geometries.
+     * The geometries are unioned in small groups whose results are unioned again (cascaded union),
+     * which avoids growing a single geometry vertex by vertex.
+     * The progress is reported to the optional \a feedback, a null geometry is returned if it gets canceled.
+     */
+    static QgsGeometry unaryUnion( const QVector<QgsGeometry> &geometries, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Transforms the coordinates \a x and \a y in place with \a transform.
+     * All the coordinates are handed over to the projection library in a single call rather
+     * than point by point. The \a z values are transformed as well if there is one per coordinate,
+     * otherwise the coordinates are transformed at a height of 0.
+     * Returns FALSE if the transformation failed.
+     */
+    static bool transformCoordinates( const QgsCoordinateTransform &transform, QVector<double> &x, QVector<double> &y, QVector<double> &z, QgsCoordinateTransform::TransformDirection direction = QgsCoordinateTransform::ForwardTransform );
+
+    //! \copydoc transformCoordinates
+    static bool transformCoordinates( const QgsCoordinateTransform &transform, QVector<double> &x, QVector<double> &y, QgsCoordinateTransform::TransformDirection direction = QgsCoordinateTransform::ForwardTransform );
+
 };
 
 #endif // GEOMETRYUTILS_H
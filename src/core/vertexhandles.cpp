@@ -0,0 +1,316 @@
+/***************************************************************************
+  vertexhandles.cpp - VertexHandles
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "vertexhandles.h"
+#include "vertexmodel.h"
+#include "qgsquickmapsettings.h"
+
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+
+#include <cmath>
+
+namespace
+{
+  const int CIRCLE_SEGMENTS = 16;
+  //! the diameter of the handles of existing vertices, in pixels
+  const double EXISTING_VERTEX_SIZE = 20;
+  //! the width of the handles of the candidates of new vertices, in pixels
+  const double NEW_VERTEX_SIZE = 10;
+  const double BORDER_WIDTH = 2;
+
+  //! A premultiplied color, as expected by QSGVertexColorMaterial
+  struct VertexColor
+  {
+    explicit VertexColor( const QColor &color )
+      : r( static_cast<uchar>( color.red() * color.alphaF() ) )
+      , g( static_cast<uchar>( color.green() * color.alphaF() ) )
+      , b( static_cast<uchar>( color.blue() * color.alphaF() ) )
+      , a( static_cast<uchar>( color.alpha() ) )
+    {}
+
+    uchar r, g, b, a;
+  };
+
+  //! Returns the corners of a handle shape, around the origin with a radius of 1
+  QVector<QPointF> unitCircle()
+  {
+    QVector<QPointF> corners;
+    corners.reserve( CIRCLE_SEGMENTS );
+    for ( int i = 0; i < CIRCLE_SEGMENTS; ++i )
+    {
+      const double angle = 2 * M_PI * i / CIRCLE_SEGMENTS;
+      corners << QPointF( std::cos( angle ), std::sin( angle ) );
+    }
+    return corners;
+  }
+
+  const QVector<QPointF> CIRCLE_CORNERS = unitCircle();
+  const QVector<QPointF> SQUARE_CORNERS { QPointF( -1, -1 ), QPointF( 1, -1 ), QPointF( 1, 1 ), QPointF( -1, 1 ) };
+
+  //! Returns the number of vertices of the triangles of a handle with \a cornerCount corners
+  int handleVertexCount( int cornerCount )
+  {
+    // a fill triangle and a border quad per corner
+    return cornerCount * 9;
+  }
+
+  void appendVertex( QSGGeometry::ColoredPoint2D *&vertex, const QPointF &point, const VertexColor &color )
+  {
+    vertex->set( static_cast<float>( point.x() ), static_cast<float>( point.y() ), color.r, color.g, color.b, color.a );
+    ++vertex;
+  }
+
+  //! Appends the triangles of a handle filled with \a fillColor and outlined with \a borderColor
+  void appendHandle( QSGGeometry::ColoredPoint2D *&vertex, const QPointF &center, const QVector<QPointF> &corners, double size, const VertexColor &fillColor, const VertexColor &borderColor )
+  {
+    const double outerRadius = size / 2;
+    const double innerRadius = outerRadius - BORDER_WIDTH;
+    const int cornerCount = corners.size();
+    for ( int i = 0; i < cornerCount; ++i )
+    {
+      const QPointF &corner = corners.at( i );
+      const QPointF &nextCorner = corners.at( ( i + 1 ) % cornerCount );
+      const QPointF inner = center + corner * innerRadius;
+      const QPointF nextInner = center + nextCorner * innerRadius;
+      const QPointF outer = center + corner * outerRadius;
+      const QPointF nextOuter = center + nextCorner * outerRadius;
+
+      appendVertex( vertex, center, fillColor );
+      appendVertex( vertex, inner, fillColor );
+      appendVertex( vertex, nextInner, fillColor );
+
+      appendVertex( vertex, inner, borderColor );
+      appendVertex( vertex, outer, borderColor );
+      appendVertex( vertex, nextOuter, borderColor );
+      appendVertex( vertex, inner, borderColor );
+      appendVertex( vertex, nextOuter, borderColor );
+      appendVertex( vertex, nextInner, borderColor );
+    }
+  }
+}
+
+VertexHandles::VertexHandles( QQuickItem *parent )
+  : QQuickItem( parent )
+{
+  setFlags( QQuickItem::ItemHasContents );
+}
+
+VertexModel *VertexHandles::vertexModel() const
+{
+  return mVertexModel;
+}
+
+void VertexHandles::setVertexModel( VertexModel *vertexModel )
+{
+  if ( mVertexModel == vertexModel )
+    return;
+
+  if ( mVertexModel )
+    disconnect( mVertexModel, nullptr, this, nullptr );
+
+  mVertexModel = vertexModel;
+
+  if ( mVertexModel )
+  {
+    connect( mVertexModel, &VertexModel::dataChanged, this, &VertexHandles::markDirty );
+    connect( mVertexModel, &VertexModel::rowsInserted, this, &VertexHandles::markDirty );
+    connect( mVertexModel, &VertexModel::rowsRemoved, this, &VertexHandles::markDirty );
+    connect( mVertexModel, &VertexModel::modelReset, this, &VertexHandles::markDirty );
+  }
+
+  markDirty();
+
+  emit vertexModelChanged();
+}
+
+QgsQuickMapSettings *VertexHandles::mapSettings() const
+{
+  return mMapSettings;
+}
+
+void VertexHandles::setMapSettings( QgsQuickMapSettings *mapSettings )
+{
+  if ( mMapSettings == mapSettings )
+    return;
+
+  if ( mMapSettings )
+    disconnect( mMapSettings, &QgsQuickMapSettings::visibleExtentChanged, this, &VertexHandles::markDirty );
+
+  mMapSettings = mapSettings;
+
+  // the handles move with the extent, which is notified once per frame while panning
+  if ( mMapSettings )
+    connect( mMapSettings, &QgsQuickMapSettings::visibleExtentChanged, this, &VertexHandles::markDirty );
+
+  markDirty();
+
+  emit mapSettingsChanged();
+}
+
+QColor VertexHandles::color() const
+{
+  return mColor;
+}
+
+void VertexHandles::setColor( const QColor &color )
+{
+  if ( mColor == color )
+    return;
+
+  mColor = color;
+  markDirty();
+
+  emit colorChanged();
+}
+
+QColor VertexHandles::currentColor() const
+{
+  return mCurrentColor;
+}
+
+void VertexHandles::setCurrentColor( const QColor &color )
+{
+  if ( mCurrentColor == color )
+    return;
+
+  mCurrentColor = color;
+  markDirty();
+
+  emit currentColorChanged();
+}
+
+QColor VertexHandles::fillColor() const
+{
+  return mFillColor;
+}
+
+void VertexHandles::setFillColor( const QColor &color )
+{
+  if ( mFillColor == color )
+    return;
+
+  mFillColor = color;
+  markDirty();
+
+  emit fillColorChanged();
+}
+
+int VertexHandles::maximumVertexCount() const
+{
+  return mMaximumVertexCount;
+}
+
+void VertexHandles::setMaximumVertexCount( int maximumVertexCount )
+{
+  if ( mMaximumVertexCount == maximumVertexCount )
+    return;
+
+  mMaximumVertexCount = maximumVertexCount;
+  markDirty();
+
+  emit maximumVertexCountChanged();
+}
+
+void VertexHandles::markDirty()
+{
+  mDirty = true;
+  update();
+}
+
+QVector<int> VertexHandles::visibleRows() const
+{
+  if ( !mVertexModel || !mMapSettings )
+    return QVector<int>();
+
+  QVector<int> rows = mVertexModel->verticesInRectangle( mMapSettings->visibleExtent() );
+  if ( rows.size() > mMaximumVertexCount )
+  {
+    const int currentRow = mVertexModel->currentVertexIndex();
+    rows.clear();
+    if ( currentRow >= 0 )
+      rows << currentRow;
+  }
+
+  return rows;
+}
+
+void VertexHandles::updateGeometry( QSGGeometry *geometry ) const
+{
+  const QVector<int> rows = visibleRows();
+
+  int vertexCount = 0;
+  for ( int row : rows )
+  {
+    const VertexModel::Vertex vertex = mVertexModel->vertex( row );
+    vertexCount += handleVertexCount( vertex.type == VertexModel::ExistingVertex ? CIRCLE_CORNERS.size() : SQUARE_CORNERS.size() );
+  }
+
+  geometry->allocate( vertexCount );
+
+  const VertexColor fillColor( mFillColor );
+  const VertexColor borderColor( mColor );
+  const VertexColor currentBorderColor( mCurrentColor );
+
+  QSGGeometry::ColoredPoint2D *vertex = geometry->vertexDataAsColoredPoint2D();
+  int currentRow = -1;
+  for ( int row : rows )
+  {
+    const VertexModel::Vertex modelVertex = mVertexModel->vertex( row );
+    if ( modelVertex.currentVertex )
+    {
+      // drawn last, on top of the others
+      currentRow = row;
+      continue;
+    }
+
+    const bool existing = modelVertex.type == VertexModel::ExistingVertex;
+    appendHandle( vertex, mMapSettings->coordinateToScreen( modelVertex.point ), existing ? CIRCLE_CORNERS : SQUARE_CORNERS,
+                  existing ? EXISTING_VERTEX_SIZE : NEW_VERTEX_SIZE, fillColor, borderColor );
+  }
+
+  if ( currentRow >= 0 )
+  {
+    const VertexModel::Vertex modelVertex = mVertexModel->vertex( currentRow );
+    const bool existing = modelVertex.type == VertexModel::ExistingVertex;
+    appendHandle( vertex, mMapSettings->coordinateToScreen( modelVertex.point ), existing ? CIRCLE_CORNERS : SQUARE_CORNERS,
+                  existing ? EXISTING_VERTEX_SIZE : NEW_VERTEX_SIZE, fillColor, currentBorderColor );
+  }
+}
+
+QSGNode *VertexHandles::updatePaintNode( QSGNode *n, QQuickItem::UpdatePaintNodeData * )
+{
+  if ( !mDirty )
+    return n;
+
+  mDirty = false;
+
+  QSGGeometryNode *node = static_cast<QSGGeometryNode *>( n );
+  if ( !node )
+  {
+    node = new QSGGeometryNode;
+    QSGGeometry *geometry = new QSGGeometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+    geometry->setDrawingMode( QSGGeometry::DrawTriangles );
+    node->setGeometry( geometry );
+    node->setFlag( QSGNode::OwnsGeometry );
+    node->setMaterial( new QSGVertexColorMaterial );
+    node->setFlag( QSGNode::OwnsMaterial );
+  }
+
+  updateGeometry( node->geometry() );
+  node->markDirty( QSGNode::DirtyGeometry );
+
+  return node;
+}
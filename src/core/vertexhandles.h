@@ -0,0 +1,121 @@
+/***************************************************************************
+  vertexhandles.h - VertexHandles
+
+ ---------------------
+ begin                : October 2020
+ copyright            : (C) 2020 by OPENGIS.ch
+ email                : info (at) opengis.ch
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef VERTEXHANDLES_H
+#define VERTEXHANDLES_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+
+class QSGGeometry;
+class QgsQuickMapSettings;
+class VertexModel;
+
+/**
+ * The VertexHandles item draws the handles of all the vertices of a VertexModel
+ * located within the visible extent in a single scene graph node.
+ *
+ * Existing vertices are drawn as circles and the candidates of new vertices as squares,
+ * the current vertex with its own color. The positions are computed once per change of
+ * the map settings or of the vertices, rather than by one QML delegate per vertex.
+ *
+ * If more than \a maximumVertexCount vertices are visible, only the current vertex is drawn.
+ *
+ * The item is expected to cover the map canvas.
+ */
+class VertexHandles : public QQuickItem
+{
+    Q_OBJECT
+
+    //! the vertex model to draw the handles of
+    Q_PROPERTY( VertexModel *vertexModel READ vertexModel WRITE setVertexModel NOTIFY vertexModelChanged )
+    //! Map settings is used to get the visible extent and to transform the vertices to screen coordinates
+    Q_PROPERTY( QgsQuickMapSettings *mapSettings READ mapSettings WRITE setMapSettings NOTIFY mapSettingsChanged )
+    //! the border color of the handles
+    Q_PROPERTY( QColor color READ color WRITE setColor NOTIFY colorChanged )
+    //! the border color of the handle of the current vertex
+    Q_PROPERTY( QColor currentColor READ currentColor WRITE setCurrentColor NOTIFY currentColorChanged )
+    //! the fill color of the handles
+    Q_PROPERTY( QColor fillColor READ fillColor WRITE setFillColor NOTIFY fillColorChanged )
+    //! the maximum number of handles drawn at once
+    Q_PROPERTY( int maximumVertexCount READ maximumVertexCount WRITE setMaximumVertexCount NOTIFY maximumVertexCountChanged )
+
+  public:
+    explicit VertexHandles( QQuickItem *parent = nullptr );
+
+    //! \copydoc vertexModel
+    VertexModel *vertexModel() const;
+    //! \copydoc vertexModel
+    void setVertexModel( VertexModel *vertexModel );
+
+    //! \copydoc mapSettings
+    QgsQuickMapSettings *mapSettings() const;
+    //! \copydoc mapSettings
+    void setMapSettings( QgsQuickMapSettings *mapSettings );
+
+    //! \copydoc color
+    QColor color() const;
+    //! \copydoc color
+    void setColor( const QColor &color );
+
+    //! \copydoc currentColor
+    QColor currentColor() const;
+    //! \copydoc currentColor
+    void setCurrentColor( const QColor &color );
+
+    //! \copydoc fillColor
+    QColor fillColor() const;
+    //! \copydoc fillColor
+    void setFillColor( const QColor &color );
+
+    //! \copydoc maximumVertexCount
+    int maximumVertexCount() const;
+    //! \copydoc maximumVertexCount
+    void setMaximumVertexCount( int maximumVertexCount );
+
+    /**
+     * Fills \a geometry, with the ColoredPoint2D attributes, with the triangles of the handles
+     * of the visible vertices, the handle of the current vertex last.
+     */
+    void updateGeometry( QSGGeometry *geometry ) const;
+
+  signals:
+    void vertexModelChanged();
+    void mapSettingsChanged();
+    void colorChanged();
+    void currentColorChanged();
+    void fillColorChanged();
+    void maximumVertexCountChanged();
+
+  private slots:
+    void markDirty();
+
+  private:
+    QSGNode *updatePaintNode( QSGNode *n, QQuickItem::UpdatePaintNodeData * ) override;
+
+    //! Returns the rows of the vertices to draw
+    QVector<int> visibleRows() const;
+
+    QPointer<VertexModel> mVertexModel;
+    QPointer<QgsQuickMapSettings> mMapSettings;
+    QColor mColor = Qt::blue;
+    QColor mCurrentColor = Qt::red;
+    QColor mFillColor = Qt::white;
+    int mMaximumVertexCount = 1000;
+    bool mDirty = false;
+};
+
+#endif // VERTEXHANDLES_H
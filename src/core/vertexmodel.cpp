@@ -24,7 +24,19 @@
 
 #include "vertexmodel.h"
 #include "qgsquickmapsettings.h"
+#include "coordinatetransformcache.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  QgsPoint segmentCenter( const QgsPoint &point1, const QgsPoint &point2 )
+  {
+    return QgsPoint( ( point1.x() + point2.x() ) / 2, ( point1.y() + point2.y() ) / 2 );
+  }
+}
 
 VertexModel::VertexModel( QObject *parent )
   : QAbstractListModel( parent )
@@ -75,14 +87,12 @@ QgsCoordinateReferenceSystem VertexModel::crs() const
 
 void VertexModel::setGeometry( const QgsGeometry &geometry )
 {
-  beginResetModel();
   mVerticesDeleted.clear();
   mOriginalGeometry = geometry;
   mGeometryType = geometry.type();
   mRingCount = 0;
   refreshGeometry();
   setCurrentVertex( -1 );
-  endResetModel();
   emit geometryChanged();
 }
 
@@ -95,7 +105,8 @@ void VertexModel::refreshGeometry()
   {
     try
     {
-      mTransform = QgsCoordinateTransform( mCrs, mMapSettings->destinationCrs(), mMapSettings->transformContext() );
+      mTransform = CoordinateTransformCache::instance()->transform( mCrs, mMapSettings->destinationCrs(), mMapSettings->transformContext() );
+      // the copy detaches, the cached transform is left untouched
       mTransform.setAllowFallbackTransforms( true );
       if ( mTransform.isValid() )
         geom.transform( mTransform );
@@ -105,6 +116,11 @@ void VertexModel::refreshGeometry()
       QgsMessageLog::logMessage( QStringLiteral( "Transformation error occurred: %1" ).arg( cs.what() ) );
     }
   }
+  else
+  {
+    // the vertices are in layer coordinates, do not transform them back with a stale transform
+    mTransform = QgsCoordinateTransform();
+  }
 
   const QgsAbstractGeometry *abstractGeom = geom.constGet();
   if ( !abstractGeom )
@@ -115,7 +131,10 @@ void VertexModel::refreshGeometry()
   QgsVertexId vertexId;
   QgsPoint pt;
 
-  mVertices.clear();
+  QList<Vertex> vertices;
+  vertices.reserve( abstractGeom->nCoordinates() );
+  mOriginalPoints.clear();
+  mOriginalPoints.reserve( abstractGeom->nCoordinates() );
 
   while ( abstractGeom->nextVertex( vertexId, pt ) )
   {
@@ -129,19 +148,31 @@ void VertexModel::refreshGeometry()
 
     Vertex vertex;
     vertex.point = pt;
-    vertex.originalPoint = pt;
+    vertex.originalVertex = mOriginalPoints.count();
+    mOriginalPoints << pt;
     vertex.currentVertex = false;
     vertex.type = ExistingVertex;
+    vertex.part = vertexId.part;
     vertex.ring = vertexId.ring;
 
-    mVertices << vertex;
+    vertices << vertex;
 
     mRingCount = vertexId.ring;
   }
 
-  createCandidates();
+  beginResetModel();
+  mVertices = addCandidates( vertices );
+  mRingStartRows.clear();
+  for ( int row = 0; row < mVertices.count(); row++ )
+  {
+    if ( mVertices.at( row ).ring == mRingStartRows.count() )
+      mRingStartRows << row;
+  }
+  mSpatialIndex.valid = false;
+  mMaterializedGeometryValid = false;
+  endResetModel();
 
-  setDirty( false );
+  clearJournal();
 
   emit ringCountChanged();
   emit currentVertexIndexChanged();
@@ -156,110 +187,384 @@ void VertexModel::refreshGeometry()
   updateCanPreviousNextVertex();
 }
 
-void VertexModel::createCandidates()
+QList<VertexModel::Vertex> VertexModel::addCandidates( const QList<Vertex> &vertices ) const
 {
-  // remove non existing vertices
-  mVertices.erase( std::remove_if( mVertices.begin(),
-                                   mVertices.end(),
-  []( const Vertex & vertex ) { return vertex.type != ExistingVertex; } ),
-  mVertices.end() );
-
-  int r = 0;
+  // the list is rebuilt in a single pass, inserting into it would be quadratic on large geometries
+  QList<Vertex> existingVertices;
+  existingVertices.reserve( vertices.count() );
+  for ( const Vertex &vertex : vertices )
+  {
+    // remove non existing vertices
+    if ( vertex.type == ExistingVertex )
+      existingVertices << vertex;
+  }
 
-  while ( r < mVertices.count() )
+  auto createCandidate = []( const QgsPoint & point, PointType type, const Vertex & vertex )
   {
-    Vertex vertex = mVertices.at( r );
-    int verticesAdded = 0;
-    Q_ASSERT( vertex.type == ExistingVertex );
+    Vertex newVertex;
+    newVertex.point = point;
+    newVertex.currentVertex = false;
+    newVertex.type = type;
+    newVertex.part = vertex.part;
+    newVertex.ring = vertex.ring;
+    return newVertex;
+  };
 
-    // adding new vertices
-    if ( r < mVertices.count() - 1 && mVertices.at( r + 1 ).ring == vertex.ring && mGeometryType != QgsWkbTypes::PointGeometry )
-    {
-      QVector<QgsPoint> points = {mVertices.at( r + 1 ).point, vertex.point};
-      QgsPoint centroid = QgsLineString( points ).centroid();
-
-      Vertex newVertex;
-      newVertex.point = centroid;
-      newVertex.originalPoint = QgsPoint();
-      newVertex.currentVertex = false;
-      newVertex.type = NewVertexSegment;
-      newVertex.ring = vertex.ring;
-      mVertices.insert( r + 1, newVertex );
-      verticesAdded++;
-    }
+  QList<Vertex> result;
+  result.reserve( existingVertices.count() * 2 + 2 );
 
-    // if line, adding start extending point
-    // TODO multipart: check that we are at the beginning of a part (replace r by indexInPart)
-    if ( r == 0 && mGeometryType == QgsWkbTypes::LineGeometry )
-    {
-      // last point is an existing vertex, the next one is a candidate (created just before)
-      QgsPoint extendingPoint = mVertices.at( r ).point - ( mVertices.at( 1 ).point - mVertices.at( r ).point ) / 2;
-
-      Vertex newVertex;
-      newVertex.point = extendingPoint;
-      newVertex.originalPoint = QgsPoint();
-      newVertex.currentVertex = false;
-      newVertex.type = NewVertexExtending;
-      newVertex.ring = vertex.ring;
-      mVertices.insert( 0, newVertex );
-      verticesAdded++;
-
-      // last point of previous part
-      // TODO when adding support for multi part
-    }
+  for ( int r = 0; r < existingVertices.count(); r++ )
+  {
+    const Vertex &vertex = existingVertices.at( r );
 
     // if polygon, create candidate to the last vertex of the ring
-    if ( ( r == 0 || mVertices.at( r - 1 ).ring != vertex.ring ) && mGeometryType == QgsWkbTypes::PolygonGeometry )
+    if ( mGeometryType == QgsWkbTypes::PolygonGeometry && ( r == 0 || existingVertices.at( r - 1 ).ring != vertex.ring ) )
     {
-      Vertex lastVertex;
-      for ( int i = r + 1; i < mVertices.count(); i++ )
-      {
-        if ( mVertices.at( i ).ring != vertex.ring )
-          break;
-        // TODO multipart
-        lastVertex = mVertices.at( i );
-      }
-      QVector<QgsPoint> points = {lastVertex.point, vertex.point};
-      QgsPoint centroid = QgsLineString( points ).centroid();
-
-      Vertex newVertex;
-      newVertex.point = centroid;
-      newVertex.originalPoint = QgsPoint();
-      newVertex.currentVertex = false;
-      newVertex.type = NewVertexSegment;
-      newVertex.ring = vertex.ring;
-      mVertices.insert( r, newVertex );
-      verticesAdded++;
+      int last = r;
+      // TODO multipart
+      while ( last + 1 < existingVertices.count() && existingVertices.at( last + 1 ).ring == vertex.ring )
+        last++;
+
+      result << createCandidate( segmentCenter( existingVertices.at( last ).point, vertex.point ), NewVertexSegment, vertex );
     }
 
-    r += 1 + verticesAdded;
+    result << vertex;
+
+    // adding new vertices
+    if ( r < existingVertices.count() - 1 && existingVertices.at( r + 1 ).ring == vertex.ring && mGeometryType != QgsWkbTypes::PointGeometry )
+      result << createCandidate( segmentCenter( existingVertices.at( r + 1 ).point, vertex.point ), NewVertexSegment, vertex );
   }
 
-  // if line, adding ending extending vertex
-  r = mVertices.count() - 1;
-  if ( mGeometryType == QgsWkbTypes::LineGeometry )
+  // if line, adding the starting and ending extending vertices
+  // TODO multipart: also extend the other parts
+  if ( mGeometryType == QgsWkbTypes::LineGeometry && result.count() >= 3 )
   {
-    // last point is an existing vertex, the previous one is a candidate
-    QgsPoint extendingPoint = mVertices.at( r ).point - ( mVertices.at( r - 1 ).point - mVertices.at( r ).point ) / 2;
+    // first and last points are existing vertices, their neighbours are candidates
+    const int last = result.count() - 1;
+    const QgsPoint startPoint = result.at( 0 ).point - ( result.at( 1 ).point - result.at( 0 ).point ) / 2;
+    const QgsPoint endPoint = result.at( last ).point - ( result.at( last - 1 ).point - result.at( last ).point ) / 2;
 
-    Vertex newVertex;
-    newVertex.point = extendingPoint;
-    newVertex.originalPoint = QgsPoint();
-    newVertex.currentVertex = false;
+    result.prepend( createCandidate( startPoint, NewVertexExtending, result.at( 0 ) ) );
+    result << createCandidate( endPoint, NewVertexExtending, result.at( last + 1 ) );
+  }
+
+  return result;
+}
+
+int VertexModel::ringStartRow( int ring ) const
+{
+  return mRingStartRows.value( ring, mVertices.count() );
+}
+
+int VertexModel::ringEndRow( int ring ) const
+{
+  return ring + 1 < mRingStartRows.count() ? mRingStartRows.at( ring + 1 ) : mVertices.count();
+}
+
+int VertexModel::vertexRow( int ring, int index ) const
+{
+  // the candidates alternate with the existing vertices, lines and polygons start with a candidate
+  if ( mGeometryType == QgsWkbTypes::PointGeometry )
+    return ringStartRow( ring ) + index;
+
+  return ringStartRow( ring ) + 1 + 2 * index;
+}
+
+int VertexModel::existingVertexIndex( int row ) const
+{
+  const int start = ringStartRow( mVertices.at( row ).ring );
+  if ( mGeometryType == QgsWkbTypes::PointGeometry )
+    return row - start;
+
+  // a candidate precedes the vertex it becomes once inserted
+  return mVertices.at( row ).type == ExistingVertex ? ( row - start - 1 ) / 2 : ( row - start ) / 2;
+}
+
+VertexModel::Vertex VertexModel::candidate( int row ) const
+{
+  const Vertex &current = mVertices.at( row );
+  const int start = ringStartRow( current.ring );
+  const int end = ringEndRow( current.ring );
+
+  Vertex newVertex = current;
+  newVertex.originalVertex = -1;
+
+  if ( mGeometryType == QgsWkbTypes::LineGeometry && ( row == start || row == end - 1 ) )
+  {
+    // extend the line from its first or last segment
+    const QgsPoint &vertex = mVertices.at( row == start ? start + 1 : end - 2 ).point;
+    const QgsPoint &neighbour = mVertices.at( row == start ? start + 3 : end - 4 ).point;
     newVertex.type = NewVertexExtending;
-    newVertex.ring = mVertices.at( r ).ring;
-    mVertices.insert( r + 1, newVertex );
+    newVertex.point = vertex - ( segmentCenter( neighbour, vertex ) - vertex ) / 2;
+  }
+  else
+  {
+    // the first candidate of a polygon ring is on its closing segment
+    const QgsPoint &previous = mVertices.at( row == start ? end - 1 : row - 1 ).point;
+    newVertex.type = NewVertexSegment;
+    newVertex.point = segmentCenter( mVertices.at( row + 1 ).point, previous );
+  }
+
+  return newVertex;
+}
+
+void VertexModel::updateCandidates( int ring, int firstRow, int lastRow )
+{
+  if ( mGeometryType == QgsWkbTypes::PointGeometry )
+    return;
+
+  const int start = ringStartRow( ring );
+  const int end = ringEndRow( ring );
+  if ( start >= end )
+    return;
+
+  QVector<int> rows;
+  for ( int row = std::max( firstRow, start ); row <= std::min( lastRow, end - 1 ); row++ )
+    rows << row;
+  rows << start;
+  if ( mGeometryType == QgsWkbTypes::LineGeometry )
+    rows << end - 1;
+
+  for ( int row : qgis::as_const( rows ) )
+  {
+    if ( mVertices.at( row ).type == ExistingVertex )
+      continue;
+
+    const Vertex newVertex = candidate( row );
+    Vertex &vertex = mVertices[row];
+    if ( vertex.type == newVertex.type && vertex.point == newVertex.point )
+      continue;
+
+    const QgsPoint oldPoint = vertex.point;
+    vertex.type = newVertex.type;
+    vertex.point = newVertex.point;
+    updateSpatialIndex( row, oldPoint );
+    emit dataChanged( index( row, 0, QModelIndex() ), index( row, 0, QModelIndex() ) );
+  }
+}
+
+void VertexModel::moveVertex( int row, const QgsPoint &point )
+{
+  Vertex &vertex = mVertices[row];
+  const QgsPoint oldPoint = vertex.point;
+  vertex.point = point;
+  updateSpatialIndex( row, oldPoint );
+  emit dataChanged( index( row, 0, QModelIndex() ), index( row, 0, QModelIndex() ) );
+
+  if ( mMaterializedGeometryValid )
+    moveMaterializedVertex( vertex.part, vertex.ring, existingVertexIndex( row ), point );
+
+  updateCandidates( vertex.ring, row - 1, row + 1 );
+}
+
+int VertexModel::insertVertex( int ring, int index, const QgsPoint &point, int originalVertex )
+{
+  const int start = ringStartRow( ring );
+  const int end = ringEndRow( ring );
+
+  Vertex vertex;
+  vertex.point = point;
+  vertex.originalVertex = originalVertex;
+  vertex.currentVertex = false;
+  vertex.type = ExistingVertex;
+  vertex.part = mVertices.value( start ).part;
+  vertex.ring = ring;
+
+  // the candidate of the new vertex is computed once it is inserted
+  Vertex newCandidate = vertex;
+  newCandidate.originalVertex = -1;
+  newCandidate.type = NewVertexSegment;
+
+  QList<Vertex> rows;
+  int row = 0;
+  if ( mGeometryType == QgsWkbTypes::PointGeometry )
+  {
+    row = start + index;
+    rows << vertex;
+  }
+  else if ( vertexRow( ring, index ) < ( mGeometryType == QgsWkbTypes::LineGeometry ? end - 1 : end ) )
+  {
+    // insert before an existing vertex, followed by its candidate
+    row = vertexRow( ring, index );
+    rows << vertex << newCandidate;
+  }
+  else
+  {
+    // append to the ring, after the candidate between the last vertex and the new one
+    row = mGeometryType == QgsWkbTypes::LineGeometry ? end - 1 : end;
+    rows << newCandidate << vertex;
+  }
+
+  beginInsertRows( QModelIndex(), row, row + rows.count() - 1 );
+  for ( int i = 0; i < rows.count(); i++ )
+    mVertices.insert( row + i, rows.at( i ) );
+  for ( int r = ring + 1; r < mRingStartRows.count(); r++ )
+    mRingStartRows[r] += rows.count();
+  if ( mCurrentIndex >= row )
+    mCurrentIndex += rows.count();
+  mSpatialIndex.valid = false;
+  endInsertRows();
+
+  const int insertedRow = rows.first().type == ExistingVertex ? row : row + 1;
+
+  if ( mMaterializedGeometryValid )
+  {
+    QgsPoint layerPoint;
+    QgsAbstractGeometry *geometry = mMaterializedGeometry.get();
+    // curve polygons keep the rings closed when inserting their first vertex
+    if ( !toLayerPoint( point, layerPoint ) || !geometry || !geometry->insertVertex( QgsVertexId( vertex.part, ring, index ), layerPoint ) )
+      mMaterializedGeometryValid = false;
   }
 
-  // re-calculate the current index
-  for ( int i = 0; i < mVertices.count(); i++ )
+  updateCandidates( ring, insertedRow - 1, insertedRow + 1 );
+
+  return insertedRow;
+}
+
+void VertexModel::removeVertex( int row )
+{
+  const Vertex &vertex = mVertices.at( row );
+  const int part = vertex.part;
+  const int ring = vertex.ring;
+  const int index = existingVertexIndex( row );
+  const int end = ringEndRow( ring );
+
+  // remove the candidate following the vertex, the last vertex of a ring takes the preceding one
+  int first = row;
+  int last = row;
+  if ( mGeometryType != QgsWkbTypes::PointGeometry )
+  {
+    const bool lastVertex = row == ( mGeometryType == QgsWkbTypes::LineGeometry ? end - 2 : end - 1 );
+    if ( lastVertex )
+      first = row - 1;
+    else
+      last = row + 1;
+  }
+  const int count = last - first + 1;
+
+  beginRemoveRows( QModelIndex(), first, last );
+  for ( int i = 0; i < count; i++ )
+    mVertices.removeAt( first );
+  for ( int r = ring + 1; r < mRingStartRows.count(); r++ )
+    mRingStartRows[r] -= count;
+  if ( mCurrentIndex > last )
+    mCurrentIndex -= count;
+  else if ( mCurrentIndex >= first )
+    mCurrentIndex = -1;
+  mSpatialIndex.valid = false;
+  endRemoveRows();
+
+  if ( mMaterializedGeometryValid )
+  {
+    QgsAbstractGeometry *geometry = mMaterializedGeometry.get();
+    // curve polygons keep the rings closed when deleting their first vertex
+    if ( !geometry || !geometry->deleteVertex( QgsVertexId( part, ring, index ) ) )
+      mMaterializedGeometryValid = false;
+  }
+
+  updateCandidates( ring, first - 1, first );
+}
+
+void VertexModel::updateSpatialIndex( int row, const QgsPoint &oldPoint )
+{
+  if ( !mSpatialIndex.valid )
+    return;
+
+  const quint64 oldKey = spatialIndexKey( oldPoint );
+  const quint64 newKey = spatialIndexKey( mVertices.at( row ).point );
+  if ( oldKey == newKey )
+    return;
+
+  QVector<int> &oldCell = mSpatialIndex.cells[oldKey];
+  oldCell.removeOne( row );
+  if ( oldCell.isEmpty() )
+    mSpatialIndex.cells.remove( oldKey );
+  mSpatialIndex.cells[newKey] << row;
+}
+
+void VertexModel::buildSpatialIndex() const
+{
+  mSpatialIndex.cells.clear();
+  mSpatialIndex.valid = true;
+
+  if ( mVertices.isEmpty() )
+    return;
+
+  double xMin = std::numeric_limits<double>::max();
+  double yMin = std::numeric_limits<double>::max();
+  double xMax = std::numeric_limits<double>::lowest();
+  double yMax = std::numeric_limits<double>::lowest();
+  for ( const Vertex &vertex : qgis::as_const( mVertices ) )
+  {
+    xMin = std::min( xMin, vertex.point.x() );
+    yMin = std::min( yMin, vertex.point.y() );
+    xMax = std::max( xMax, vertex.point.x() );
+    yMax = std::max( yMax, vertex.point.y() );
+  }
+
+  // aim at a few vertices per cell
+  const double cellsPerSide = std::ceil( std::sqrt( mVertices.count() / 4.0 ) );
+  mSpatialIndex.originX = xMin;
+  mSpatialIndex.originY = yMin;
+  mSpatialIndex.cellSize = std::max( xMax - xMin, yMax - yMin ) / cellsPerSide;
+  if ( !( mSpatialIndex.cellSize > 0 ) )
+    mSpatialIndex.cellSize = 1;
+
+  for ( int row = 0; row < mVertices.count(); row++ )
+    mSpatialIndex.cells[spatialIndexKey( mVertices.at( row ).point )] << row;
+}
+
+quint64 VertexModel::spatialIndexKey( const QgsPoint &point ) const
+{
+  const qint32 column = static_cast<qint32>( std::floor( ( point.x() - mSpatialIndex.originX ) / mSpatialIndex.cellSize ) );
+  const qint32 row = static_cast<qint32>( std::floor( ( point.y() - mSpatialIndex.originY ) / mSpatialIndex.cellSize ) );
+  return ( static_cast<quint64>( static_cast<quint32>( column ) ) << 32 ) | static_cast<quint32>( row );
+}
+
+QVector<int> VertexModel::verticesInRectangle( const QgsRectangle &rectangle ) const
+{
+  if ( !mSpatialIndex.valid )
+    buildSpatialIndex();
+
+  QVector<int> rows;
+
+  auto collect = [this, &rectangle, &rows]( const QVector<int> &cellRows )
   {
-    if ( mVertices.at( i ).currentVertex )
+    for ( int row : cellRows )
     {
-      setCurrentVertex( i, true );
-      break;
+      const QgsPoint &point = mVertices.at( row ).point;
+      if ( rectangle.contains( QgsPointXY( point.x(), point.y() ) ) )
+        rows << row;
     }
+  };
+
+  const double columnMin = std::floor( ( rectangle.xMinimum() - mSpatialIndex.originX ) / mSpatialIndex.cellSize );
+  const double columnMax = std::floor( ( rectangle.xMaximum() - mSpatialIndex.originX ) / mSpatialIndex.cellSize );
+  const double rowMin = std::floor( ( rectangle.yMinimum() - mSpatialIndex.originY ) / mSpatialIndex.cellSize );
+  const double rowMax = std::floor( ( rectangle.yMaximum() - mSpatialIndex.originY ) / mSpatialIndex.cellSize );
+
+  if ( ( columnMax - columnMin + 1 ) * ( rowMax - rowMin + 1 ) > mSpatialIndex.cells.count() )
+  {
+    // the rectangle spans more cells than there are occupied ones
+    for ( auto it = mSpatialIndex.cells.constBegin(); it != mSpatialIndex.cells.constEnd(); ++it )
+      collect( it.value() );
   }
+  else
+  {
+    for ( qint32 column = static_cast<qint32>( columnMin ); column <= static_cast<qint32>( columnMax ); column++ )
+    {
+      for ( qint32 row = static_cast<qint32>( rowMin ); row <= static_cast<qint32>( rowMax ); row++ )
+      {
+        const quint64 key = ( static_cast<quint64>( static_cast<quint32>( column ) ) << 32 ) | static_cast<quint32>( row );
+        auto it = mSpatialIndex.cells.constFind( key );
+        if ( it != mSpatialIndex.cells.constEnd() )
+          collect( it.value() );
+      }
+    }
+  }
+
+  std::sort( rows.begin(), rows.end() );
+  return rows;
 }
 
 QModelIndex VertexModel::index( int row, int column, const QModelIndex &parent ) const
@@ -316,7 +621,7 @@ QVariant VertexModel::data( const QModelIndex &index, int role ) const
       return vertex.currentVertex;
 
     case OriginalPointRole:
-      return QVariant::fromValue( vertex.originalPoint );
+      return QVariant::fromValue( originalPoint( vertex.originalVertex ) );
 
     case ExistingVertexRole:
       return vertex.type == ExistingVertex;
@@ -337,6 +642,9 @@ QgsGeometry VertexModel::geometry() const
     return mOriginalGeometry;
   }
 
+  if ( mMaterializedGeometryValid )
+    return mMaterializedGeometry;
+
   QVector<QgsPoint> vertices = flatVertices( 0 );
   QgsGeometry geometry;
 
@@ -373,6 +681,9 @@ QgsGeometry VertexModel::geometry() const
   if ( mTransform.isValid() )
     geometry.transform( mTransform, QgsCoordinateTransform::ReverseTransform );
 
+  mMaterializedGeometry = geometry;
+  mMaterializedGeometryValid = true;
+
   return geometry;
 }
 
@@ -381,11 +692,15 @@ void VertexModel::clear()
   beginResetModel();
   setEditingMode( NoEditing );
   mVertices.clear();
+  mRingStartRows.clear();
+  mSpatialIndex.valid = false;
+  mMaterializedGeometryValid = false;
   mVerticesDeleted.clear();
+  mOriginalPoints.clear();
   updateCanRemoveVertex();
   updateCanAddVertex();
   emit vertexCountChanged();
-  setDirty( false );
+  clearJournal();
   endResetModel();
 }
 
@@ -399,6 +714,8 @@ void VertexModel::previous()
   if ( !mCanPreviousVertex )
     return;
 
+  mEditMergeable = false;
+
   if ( mCurrentIndex < 2 )
   {
     if ( mGeometryType == QgsWkbTypes::PointGeometry )
@@ -439,6 +756,8 @@ void VertexModel::next()
   if ( !mCanNextVertex )
     return;
 
+  mEditMergeable = false;
+
   if ( mCurrentIndex == -1 || mCurrentIndex >= mVertices.count() - 2 )
   {
     if ( mMode == AddVertex )
@@ -464,11 +783,16 @@ void VertexModel::selectVertexAtPosition( const QPointF &point, double threshold
 
 void VertexModel::selectVertexAtPosition( const QgsPoint &mapPoint, double threshold )
 {
+  mEditMergeable = false;
+
   double closestDistance = std::numeric_limits<double>::max();
 
   int closestRow = -1;
 
-  for ( int r = 0; r < mVertices.count(); r++ )
+  const double mapUnitsPerPixel = mapSettings()->mapSettings().mapUnitsPerPixel();
+  const double searchRadius = threshold * mapUnitsPerPixel;
+  const QVector<int> rows = verticesInRectangle( QgsRectangle( mapPoint.x() - searchRadius, mapPoint.y() - searchRadius, mapPoint.x() + searchRadius, mapPoint.y() + searchRadius ) );
+  for ( int r : rows )
   {
     double dist = mVertices.at( r ).point.distance( mapPoint );
     if ( dist < closestDistance )
@@ -478,17 +802,24 @@ void VertexModel::selectVertexAtPosition( const QgsPoint &mapPoint, double thres
     }
   }
 
-  if ( closestRow >= 0 && closestDistance / mapSettings()->mapSettings().mapUnitsPerPixel() < threshold )
+  if ( closestRow >= 0 && closestDistance / mapUnitsPerPixel < threshold )
   {
     if ( mVertices.at( closestRow ).type != ExistingVertex )
     {
       // makes a new vertex as an existing vertex
-      beginResetModel();
-      mVertices[closestRow].type = ExistingVertex;
-      setCurrentVertex( closestRow );
-      createCandidates();
+      const Vertex &closestVertex = mVertices.at( closestRow );
+
+      Edit edit;
+      edit.type = Edit::Insert;
+      edit.ring = closestVertex.ring;
+      edit.index = existingVertexIndex( closestRow );
+      edit.after = closestVertex.point;
+
+      setCurrentVertex( insertVertex( edit.ring, edit.index, edit.after, -1 ), true );
       setEditingMode( EditVertex );
-      endResetModel();
+      recordEdit( edit );
+      emit vertexCountChanged();
+      emit geometryChanged();
     }
     else
     {
@@ -508,23 +839,227 @@ void VertexModel::removeCurrentVertex()
   if ( mVertices.at( mCurrentIndex ).type != ExistingVertex )
     return;
 
-  if ( !mVertices.at( mCurrentIndex ).originalPoint.isEmpty() )
-    mVerticesDeleted << mVertices.at( mCurrentIndex ).originalPoint;
+  const Vertex &removedVertex = mVertices.at( mCurrentIndex );
+  if ( removedVertex.originalVertex >= 0 )
+    mVerticesDeleted << originalPoint( removedVertex.originalVertex );
 
-  beginResetModel();
-  mVertices.removeAt( mCurrentIndex );
-  createCandidates();
-  endResetModel();
+  Edit edit;
+  edit.type = Edit::Remove;
+  edit.ring = removedVertex.ring;
+  edit.index = existingVertexIndex( mCurrentIndex );
+  edit.before = removedVertex.point;
+  edit.originalVertex = removedVertex.originalVertex;
 
-  setDirty( true );
+  const int row = mCurrentIndex;
+  removeVertex( row );
+
+  recordEdit( edit );
 
   emit vertexCountChanged();
 
-  setCurrentVertex( mCurrentIndex < mVertices.count() - 1 ? mCurrentIndex : mCurrentIndex - 2, true );
+  setCurrentVertex( row < mVertices.count() - 1 ? row : row - 2, true );
+}
+
+void VertexModel::undo()
+{
+  if ( mJournalPosition <= 0 )
+    return;
+
+  mJournalPosition--;
+  applyEdit( mJournal.at( mJournalPosition ), true );
+}
+
+void VertexModel::redo()
+{
+  if ( mJournalPosition >= mJournal.count() )
+    return;
+
+  applyEdit( mJournal.at( mJournalPosition ), false );
+  mJournalPosition++;
+  updateJournalState();
+}
+
+bool VertexModel::canUndo() const
+{
+  return mCanUndo;
+}
+
+bool VertexModel::canRedo() const
+{
+  return mCanRedo;
+}
+
+void VertexModel::recordEdit( const Edit &edit, bool mergeable )
+{
+  if ( mJournalPosition < mJournal.count() )
+  {
+    // a new edit discards the undone ones
+    mJournal.resize( mJournalPosition );
+    if ( mCleanJournalPosition > mJournalPosition )
+      mCleanJournalPosition = -1;
+  }
+
+  bool merged = false;
+  if ( mergeable && mEditMergeable && !mJournal.isEmpty() && mJournal.count() != mCleanJournalPosition )
+  {
+    // a vertex being dragged around is a single operation
+    Edit &last = mJournal.last();
+    if ( edit.type == Edit::Move && ( last.type == Edit::Move || last.type == Edit::Insert ) && last.ring == edit.ring && last.index == edit.index )
+    {
+      last.after = edit.after;
+      merged = true;
+    }
+  }
+
+  if ( !merged )
+    mJournal << edit;
+
+  mJournalPosition = mJournal.count();
+  mEditMergeable = mergeable;
+  updateJournalState();
+}
+
+void VertexModel::applyEdit( const Edit &edit, bool revert )
+{
+  mEditMergeable = false;
+
+  Edit::Type type = edit.type;
+  if ( revert && type == Edit::Insert )
+    type = Edit::Remove;
+  else if ( revert && type == Edit::Remove )
+    type = Edit::Insert;
+
+  int currentVertex = -1;
+  switch ( type )
+  {
+    case Edit::Move:
+      currentVertex = vertexRow( edit.ring, edit.index );
+      moveVertex( currentVertex, revert ? edit.before : edit.after );
+      break;
+
+    case Edit::Insert:
+    {
+      const int originalVertex = revert ? edit.originalVertex : -1;
+      currentVertex = insertVertex( edit.ring, edit.index, revert ? edit.before : edit.after, originalVertex );
+      if ( originalVertex >= 0 )
+        mVerticesDeleted.removeOne( originalPoint( originalVertex ) );
+      break;
+    }
+
+    case Edit::Remove:
+    {
+      const int row = vertexRow( edit.ring, edit.index );
+      if ( mVertices.at( row ).originalVertex >= 0 )
+        mVerticesDeleted << originalPoint( mVertices.at( row ).originalVertex );
+      removeVertex( row );
+      break;
+    }
+  }
+
+  if ( currentVertex < 0 )
+  {
+    setCurrentVertex( -1 );
+  }
+  else
+  {
+    setCurrentVertex( currentVertex, true );
+    if ( mMode == AddVertex )
+      setEditingMode( EditVertex );
+  }
+
+  if ( type != Edit::Move )
+    emit vertexCountChanged();
+
+  updateJournalState();
+  emit geometryChanged();
+}
+
+void VertexModel::clearJournal()
+{
+  mJournal.clear();
+  mJournalPosition = 0;
+  mCleanJournalPosition = 0;
+  mEditMergeable = false;
+  updateJournalState();
+}
+
+void VertexModel::updateJournalState()
+{
+  const bool canUndo = mJournalPosition > 0;
+  if ( mCanUndo != canUndo )
+  {
+    mCanUndo = canUndo;
+    emit canUndoChanged();
+  }
+
+  const bool canRedo = mJournalPosition < mJournal.count();
+  if ( mCanRedo != canRedo )
+  {
+    mCanRedo = canRedo;
+    emit canRedoChanged();
+  }
+
+  setDirty( mJournalPosition != mCleanJournalPosition );
+}
+
+bool VertexModel::toLayerPoint( const QgsPoint &point, QgsPoint &layerPoint ) const
+{
+  layerPoint = point;
+  if ( !mTransform.isValid() )
+    return true;
+
+  try
+  {
+    const QgsPointXY transformed = mTransform.transform( QgsPointXY( point.x(), point.y() ), QgsCoordinateTransform::ReverseTransform );
+    layerPoint.setX( transformed.x() );
+    layerPoint.setY( transformed.y() );
+  }
+  catch ( QgsCsException & )
+  {
+    return false;
+  }
+  return true;
+}
+
+void VertexModel::moveMaterializedVertex( int part, int ring, int index, const QgsPoint &point ) const
+{
+  QgsPoint layerPoint;
+  QgsAbstractGeometry *geometry = mMaterializedGeometry.get();
+  // curve polygons keep the rings closed when moving their first vertex
+  if ( !toLayerPoint( point, layerPoint ) || !geometry || !geometry->moveVertex( QgsVertexId( part, ring, index ), layerPoint ) )
+    mMaterializedGeometryValid = false;
 }
 
 void VertexModel::updateGeometry( const QgsGeometry &geometry )
 {
+  const QgsGeometry currentGeometry = editingAllowed() ? this->geometry() : QgsGeometry();
+  if ( !currentGeometry.isNull() && !geometry.isNull() && *currentGeometry.constGet() == *geometry.constGet() )
+  {
+    // the edited geometry has been saved, it becomes the original one without reloading the vertices
+    mOriginalGeometry = geometry;
+    mVerticesDeleted.clear();
+
+    mOriginalPoints.clear();
+    for ( Vertex &vertex : mVertices )
+    {
+      if ( vertex.type == ExistingVertex )
+      {
+        vertex.originalVertex = mOriginalPoints.count();
+        mOriginalPoints << vertex.point;
+      }
+    }
+    if ( !mVertices.isEmpty() )
+      emit dataChanged( index( 0, 0, QModelIndex() ), index( mVertices.count() - 1, 0, QModelIndex() ) );
+
+    for ( Edit &edit : mJournal )
+      edit.originalVertex = -1;
+    mCleanJournalPosition = mJournalPosition;
+    updateJournalState();
+
+    emit geometryChanged();
+    return;
+  }
+
   int preservedIndex = mCurrentIndex;
   setGeometry( geometry );
   //since the index is shifted after reload, we decrement
@@ -549,26 +1084,34 @@ void VertexModel::setCurrentPoint( const QgsPoint &point )
   if ( mMode == NoEditing )
     return;
 
-  Vertex &vertex = mVertices[mCurrentIndex];
+  const Vertex &vertex = mVertices.at( mCurrentIndex );
 
   if ( mMapSettings && vertex.point.distance( point ) / mMapSettings->mapSettings().mapUnitsPerPixel() < 1 )
     return;
 
-  setDirty( true );
-  beginResetModel();
-
-  vertex.point = point;
+  Edit edit;
+  edit.type = Edit::Move;
+  edit.ring = vertex.ring;
+  edit.index = existingVertexIndex( mCurrentIndex );
+  edit.before = vertex.point;
+  edit.after = point;
 
-  if ( mMode == AddVertex )
+  if ( vertex.type != ExistingVertex )
   {
     // we move a candidate, make it an existing vertex
-    Q_ASSERT( vertex.type != ExistingVertex );
-    vertex.type = ExistingVertex;
+    edit.type = Edit::Insert;
+    edit.before = QgsPoint();
+
+    setCurrentVertex( insertVertex( edit.ring, edit.index, point, -1 ), true );
     setEditingMode( EditVertex );
+    emit vertexCountChanged();
+  }
+  else
+  {
+    moveVertex( mCurrentIndex, point );
   }
 
-  createCandidates();
-  endResetModel();
+  recordEdit( edit, true );
 
   emit geometryChanged();
 }
@@ -614,6 +1157,8 @@ void VertexModel::setCurrentVertexIndex( int currentIndex )
   if ( currentIndex == mCurrentIndex )
     return;
 
+  mEditMergeable = false;
+
   if ( currentIndex < 0 || currentIndex >= mVertices.count() )
     currentIndex = -1;
 
@@ -682,6 +1227,11 @@ QVector<QgsPoint> VertexModel::flatVertices( int ringId ) const
   return vertices;
 }
 
+QgsPoint VertexModel::originalPoint( int originalVertex ) const
+{
+  return originalVertex >= 0 ? mOriginalPoints.at( originalVertex ) : QgsPoint();
+}
+
 QVector<QPair<QgsPoint, QgsPoint>> VertexModel::verticesMoved() const
 {
   QVector<QPair<QgsPoint, QgsPoint>> vertices;
@@ -689,10 +1239,11 @@ QVector<QPair<QgsPoint, QgsPoint>> VertexModel::verticesMoved() const
   {
     if ( vertex.type != ExistingVertex )
       continue;
-    if ( vertex.originalPoint.isEmpty() )
+    if ( vertex.originalVertex < 0 )
       continue;
-    if ( vertex.point != vertex.originalPoint )
-      vertices << qMakePair( vertex.originalPoint, vertex.point );
+    const QgsPoint &original = mOriginalPoints.at( vertex.originalVertex );
+    if ( vertex.point != original )
+      vertices << qMakePair( original, vertex.point );
   }
   return vertices;
 }
@@ -835,6 +1386,7 @@ void VertexModel::setEditingMode( VertexModel::EditingMode mode )
     return;
 
   mMode = mode;
+  mEditMergeable = false;
 
   if ( mode == AddVertex )
   {
@@ -30,6 +30,12 @@ class QgsQuickMapSettings;
  * There are different modes: no editing, edit (move/remove) nodes, add nodes (to be implemented)
  *
  * The model holds all vertices and the candidates for new vertices. If you need the existing nodes, use flatVertices().
+ *
+ * Vertex operations (move, insert, remove) are recorded in an edit journal which allows to undo and
+ * redo them one by one. The geometry is materialized once and moved vertices are applied to it in place.
+ *
+ * Edits are applied in place on the vertex and its neighbouring candidates, and only emit the row
+ * signals for these rows. The vertices are kept in a grid index, see verticesInRectangle().
  */
 class VertexModel : public QAbstractListModel
 {
@@ -58,6 +64,10 @@ class VertexModel : public QAbstractListModel
     Q_PROPERTY( bool canNextVertex READ canNextVertex NOTIFY canNextVertexChanged )
     //! geometry type
     Q_PROPERTY( QgsWkbTypes::GeometryType geometryType READ geometryType NOTIFY geometryTypeChanged )
+    //! determines if the last vertex operation can be undone
+    Q_PROPERTY( bool canUndo READ canUndo NOTIFY canUndoChanged )
+    //! determines if the last undone vertex operation can be redone
+    Q_PROPERTY( bool canRedo READ canRedo NOTIFY canRedoChanged )
     //! determines if the map is currently being hovered (then when moving the map, it will not move directly a vertex if the mode is AddVertex)
     Q_PROPERTY( bool isHovering MEMBER mIsHovering )
 
@@ -106,10 +116,12 @@ class VertexModel : public QAbstractListModel
     struct Vertex
     {
       QgsPoint point;
-      QgsPoint originalPoint;
       bool currentVertex;
       PointType type;
+      int part;
       int ring;
+      //! the index of the vertex among the original points, -1 if the vertex has been added
+      int originalVertex = -1;
     };
 
     explicit VertexModel( QObject *parent = nullptr );
@@ -165,6 +177,12 @@ class VertexModel : public QAbstractListModel
 
     Q_INVOKABLE void removeCurrentVertex();
 
+    //! Reverts the last vertex operation of the edit journal
+    Q_INVOKABLE void undo();
+
+    //! Applies again the last vertex operation reverted with undo()
+    Q_INVOKABLE void redo();
+
 
     /**
      * sets the geometry to the given \a geometry but preserves the index of the current vertex
@@ -199,6 +217,10 @@ class VertexModel : public QAbstractListModel
     bool canPreviousVertex();
     //! \copydoc canNextVertex
     bool canNextVertex();
+    //! \copydoc canUndo
+    bool canUndo() const;
+    //! \copydoc canRedo
+    bool canRedo() const;
 
     //! Returns the geometry type
     QgsWkbTypes::GeometryType geometryType() const;
@@ -221,6 +243,12 @@ class VertexModel : public QAbstractListModel
 
     Vertex vertex( int row ) const;
 
+    /**
+     * Returns the rows of the vertices and candidates located within \a rectangle, in ascending order.
+     * The rectangle is expected in map canvas CRS.
+     */
+    QVector<int> verticesInRectangle( const QgsRectangle &rectangle ) const;
+
   signals:
     //! \copydoc editingMode
     void editingModeChanged();
@@ -242,6 +270,10 @@ class VertexModel : public QAbstractListModel
     void canPreviousVertexChanged();
     //! \copydoc canNextVertex
     void canNextVertexChanged();
+    //! \copydoc canUndo
+    void canUndoChanged();
+    //! \copydoc canRedo
+    void canRedoChanged();
 
     void currentVertexIndexChanged();
 
@@ -259,10 +291,106 @@ class VertexModel : public QAbstractListModel
     void geometryTypeChanged();
 
   private:
+    //! Grid of the rows of mVertices by location
+    struct SpatialIndex
+    {
+      bool valid = false;
+      double originX = 0;
+      double originY = 0;
+      double cellSize = 1;
+      QHash<quint64, QVector<int>> cells;
+    };
+
+    //! A vertex operation of the edit journal
+    struct Edit
+    {
+      enum Type
+      {
+        Move,
+        Insert,
+        Remove,
+      };
+
+      Type type = Move;
+      int ring = 0;
+      //! the index of the vertex among the existing vertices of the ring
+      int index = 0;
+      //! the position before the operation (move and remove)
+      QgsPoint before;
+      //! the position after the operation (move and insert)
+      QgsPoint after;
+      //! the index among the original points of a removed vertex, -1 if it has been added
+      int originalVertex = -1;
+    };
+
     void refreshGeometry();
-    //! Add the candidates of new vertices (extending or segment)
-    //! This will not emit the reset signals, it's up to the caller to do so
-    void createCandidates();
+
+    //! Adds \a edit to the journal, consecutive moves of the same vertex are merged if \a mergeable
+    void recordEdit( const Edit &edit, bool mergeable = false );
+
+    //! Applies \a edit on the vertices, or reverts it if \a revert is true
+    void applyEdit( const Edit &edit, bool revert );
+
+    void clearJournal();
+    void updateJournalState();
+
+    //! Moves the vertex \a index of \a ring of \a part to \a point (map CRS) in the materialized geometry
+    void moveMaterializedVertex( int part, int ring, int index, const QgsPoint &point ) const;
+
+    //! Returns \a vertices with the candidates of new vertices (extending or segment) added
+    QList<Vertex> addCandidates( const QList<Vertex> &vertices ) const;
+
+    //! Returns the row of the first vertex or candidate of \a ring
+    int ringStartRow( int ring ) const;
+
+    //! Returns the row following the last vertex or candidate of \a ring
+    int ringEndRow( int ring ) const;
+
+    //! Returns the row of the existing vertex \a index of \a ring
+    int vertexRow( int ring, int index ) const;
+
+    /**
+     * Returns the index of the vertex at \a row among the existing vertices of its ring.
+     * For a candidate, returns the index the vertex would get once inserted.
+     */
+    int existingVertexIndex( int row ) const;
+
+    //! Returns the candidate at \a row computed from its neighbouring vertices
+    Vertex candidate( int row ) const;
+
+    /**
+     * Updates the candidates of \a ring between \a firstRow and \a lastRow, as well as
+     * the candidates closing a polygon ring and extending a line.
+     */
+    void updateCandidates( int ring, int firstRow, int lastRow );
+
+    //! Moves the existing vertex at \a row to \a point and updates its neighbouring candidates
+    void moveVertex( int row, const QgsPoint &point );
+
+    /**
+     * Inserts a vertex at \a point with its candidate as vertex \a index of \a ring.
+     * Returns the row of the inserted vertex.
+     */
+    int insertVertex( int ring, int index, const QgsPoint &point, int originalVertex );
+
+    //! Returns the original position of the vertex with \a originalVertex, an empty point if it is -1
+    QgsPoint originalPoint( int originalVertex ) const;
+
+    //! Removes the existing vertex at \a row with one of its neighbouring candidates
+    void removeVertex( int row );
+
+    //! Moves \a row from the cell of \a oldPoint to the one of its current point in the spatial index
+    void updateSpatialIndex( int row, const QgsPoint &oldPoint );
+
+    /**
+     * Transforms \a point from the map CRS to the layer CRS.
+     * Returns FALSE if the transformation failed.
+     */
+    bool toLayerPoint( const QgsPoint &point, QgsPoint &layerPoint ) const;
+
+    void buildSpatialIndex() const;
+    quint64 spatialIndexKey( const QgsPoint &point ) const;
+
     void setDirty( bool dirty );
     void updateCanRemoveVertex();
     void updateCanAddVertex();
@@ -271,9 +399,27 @@ class VertexModel : public QAbstractListModel
     void selectVertexAtPosition( const QgsPoint &mapPoint, double threshold );
 
     QList<Vertex> mVertices;
+    //! the row of the first vertex or candidate of each ring
+    QVector<int> mRingStartRows;
+    mutable SpatialIndex mSpatialIndex;
+
+    QVector<Edit> mJournal;
+    //! the number of journal edits currently applied
+    int mJournalPosition = 0;
+    //! the journal position matching the original geometry, -1 if it cannot be reached anymore
+    int mCleanJournalPosition = 0;
+    bool mEditMergeable = false;
+    bool mCanUndo = false;
+    bool mCanRedo = false;
+
+    //! the geometry materialized from the vertices, in layer CRS
+    mutable QgsGeometry mMaterializedGeometry;
+    mutable bool mMaterializedGeometryValid = false;
 
     //! copy of the initial geometry, in destination (layer) CRS
     QgsGeometry mOriginalGeometry;
+    //! the original positions of the existing vertices in map CRS, only the rows of existing vertices refer to them
+    QVector<QgsPoint> mOriginalPoints;
     QgsCoordinateReferenceSystem mCrs;
 
     //! CRS of the geometry, will be used to transform to map canvas coordinates
@@ -39,6 +39,7 @@ QgsQuickMapCanvasMap::QgsQuickMapCanvasMap( QQuickItem *parent )
 
   connect( mMapSettings.get(), &QgsQuickMapSettings::extentChanged, this, &QgsQuickMapCanvasMap::onExtentChanged );
   connect( mMapSettings.get(), &QgsQuickMapSettings::layersChanged, this, &QgsQuickMapCanvasMap::onLayersChanged );
+  connect( mMapSettings.get(), &QgsQuickMapSettings::changesPending, this, &QgsQuickMapCanvasMap::onMapSettingsChangesPending );
 
   connect( this, &QgsQuickMapCanvasMap::renderStarting, this, &QgsQuickMapCanvasMap::isRenderingChanged );
   connect( this, &QgsQuickMapCanvasMap::mapCanvasRefreshed, this, &QgsQuickMapCanvasMap::isRenderingChanged );
@@ -177,15 +178,34 @@ void QgsQuickMapCanvasMap::onWindowChanged( QQuickWindow *window )
     return;
 
   if ( mWindow )
+  {
     disconnect( mWindow, &QQuickWindow::screenChanged, this, &QgsQuickMapCanvasMap::onScreenChanged );
+    disconnect( mWindow, &QQuickWindow::afterAnimating, mMapSettings.get(), &QgsQuickMapSettings::flushChanges );
+  }
 
   if ( window )
   {
     connect( window, &QQuickWindow::screenChanged, this, &QgsQuickMapCanvasMap::onScreenChanged );
+    // afterAnimating is emitted on the gui thread once per frame, before the items are polished and synchronized
+    connect( window, &QQuickWindow::afterAnimating, mMapSettings.get(), &QgsQuickMapSettings::flushChanges );
     onScreenChanged( window->screen() );
   }
 
   mWindow = window;
+
+  onMapSettingsChangesPending();
+}
+
+void QgsQuickMapCanvasMap::onMapSettingsChangesPending()
+{
+  if ( !mMapSettings->hasPendingChanges() )
+    return;
+
+  // without a window no frame is coming to flush the changes
+  if ( mWindow )
+    mWindow->update();
+  else
+    mMapSettings->flushChanges();
 }
 
 void QgsQuickMapCanvasMap::onScreenChanged( QScreen *screen )
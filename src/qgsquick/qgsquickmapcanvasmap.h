@@ -171,6 +171,8 @@ class QgsQuickMapCanvasMap : public QQuickItem
     void onScreenChanged( QScreen *screen );
     void onExtentChanged();
     void onLayersChanged();
+    //! Schedules a frame to flush the coalesced changes of the map settings
+    void onMapSettingsChangesPending();
 
   private:
 
@@ -25,13 +25,6 @@
 QgsQuickMapSettings::QgsQuickMapSettings( QObject *parent )
   : QObject( parent )
 {
-  // Connect signals for derived values
-  connect( this, &QgsQuickMapSettings::destinationCrsChanged, this, &QgsQuickMapSettings::mapUnitsPerPointChanged );
-  connect( this, &QgsQuickMapSettings::extentChanged, this, &QgsQuickMapSettings::mapUnitsPerPointChanged );
-  connect( this, &QgsQuickMapSettings::outputSizeChanged, this, &QgsQuickMapSettings::mapUnitsPerPointChanged );
-  connect( this, &QgsQuickMapSettings::extentChanged, this, &QgsQuickMapSettings::visibleExtentChanged );
-  connect( this, &QgsQuickMapSettings::rotationChanged, this, &QgsQuickMapSettings::visibleExtentChanged );
-  connect( this, &QgsQuickMapSettings::outputSizeChanged, this, &QgsQuickMapSettings::visibleExtentChanged );
 }
 
 void QgsQuickMapSettings::setProject( QgsProject *project )
@@ -83,7 +76,7 @@ void QgsQuickMapSettings::setExtent( const QgsRectangle &extent )
     return;
 
   mMapSettings.setExtent( extent );
-  emit extentChanged();
+  queueChanges( ExtentChange );
 }
 
 void QgsQuickMapSettings::setCenter( const QgsPoint &center )
@@ -152,7 +145,7 @@ void QgsQuickMapSettings::setOutputSize( QSize outputSize )
     return;
 
   mMapSettings.setOutputSize( outputSize );
-  emit outputSizeChanged();
+  queueChanges( OutputSizeChange );
 }
 
 double QgsQuickMapSettings::outputDpi() const
@@ -167,7 +160,7 @@ void QgsQuickMapSettings::setOutputDpi( double outputDpi )
     return;
 
   mMapSettings.setOutputDpi( outputDpi );
-  emit outputDpiChanged();
+  queueChanges( OutputDpiChange );
 }
 
 QgsCoordinateReferenceSystem QgsQuickMapSettings::destinationCrs() const
@@ -182,6 +175,7 @@ void QgsQuickMapSettings::setDestinationCrs( const QgsCoordinateReferenceSystem
 
   mMapSettings.setDestinationCrs( destinationCrs );
   emit destinationCrsChanged();
+  queueChanges( MapUnitsPerPointChange );
 }
 
 QList<QgsMapLayer *> QgsQuickMapSettings::layers() const
@@ -238,11 +232,9 @@ void QgsQuickMapSettings::onReadProject( const QDomDocument &doc )
 
     mMapSettings.setRotation( 0 );
 
-    emit extentChanged();
     emit destinationCrsChanged();
-    emit outputSizeChanged();
-    emit outputDpiChanged();
     emit layersChanged();
+    queueChanges( ExtentChange | OutputSizeChange | OutputDpiChange );
   }
 }
 
@@ -270,3 +262,65 @@ void QgsQuickMapSettings::setBackgroundColor( const QColor &color )
   mMapSettings.setBackgroundColor( color );
   emit backgroundColorChanged();
 }
+
+bool QgsQuickMapSettings::coalesceChanges() const
+{
+  return mCoalesceChanges;
+}
+
+void QgsQuickMapSettings::setCoalesceChanges( bool coalesceChanges )
+{
+  if ( mCoalesceChanges == coalesceChanges )
+    return;
+
+  mCoalesceChanges = coalesceChanges;
+
+  // nobody would flush the changes collected so far
+  if ( !mCoalesceChanges )
+    flushChanges();
+
+  emit coalesceChangesChanged();
+}
+
+bool QgsQuickMapSettings::hasPendingChanges() const
+{
+  return mPendingChanges != 0;
+}
+
+void QgsQuickMapSettings::queueChanges( int changes )
+{
+  // derived values
+  if ( changes & ( ExtentChange | OutputSizeChange ) )
+    changes |= VisibleExtentChange | MapUnitsPerPointChange;
+
+  const bool wasPending = hasPendingChanges();
+  mPendingChanges |= changes;
+
+  if ( !mCoalesceChanges )
+    flushChanges();
+  else if ( !wasPending )
+    emit changesPending();
+}
+
+void QgsQuickMapSettings::flushChanges()
+{
+  if ( !hasPendingChanges() )
+    return;
+
+  // listeners may change the view again, these changes are collected for the next flush
+  const int changes = mPendingChanges;
+  mPendingChanges = 0;
+
+  if ( changes & ExtentChange )
+    emit extentChanged();
+  if ( changes & OutputSizeChange )
+    emit outputSizeChanged();
+  if ( changes & OutputDpiChange )
+    emit outputDpiChanged();
+  if ( changes & VisibleExtentChange )
+    emit visibleExtentChanged();
+  if ( changes & MapUnitsPerPointChange )
+    emit mapUnitsPerPointChanged();
+
+  emit viewChanged();
+}
@@ -112,6 +112,18 @@ class QgsQuickMapSettings : public QObject
      */
     Q_PROPERTY( QList<QgsMapLayer *> layers READ layers WRITE setLayers NOTIFY layersChanged )
 
+    /**
+     * If TRUE, the notifications of view changes (extent, visible extent, map units per point,
+     * output size and output dpi) are not emitted right away but collected until flushChanges()
+     * is called, e.g. once per rendered frame by the map canvas. Each notification is then
+     * emitted at most once, however many changes have been made in between.
+     *
+     * The values returned by the getters are always up to date.
+     *
+     * Disabled by default.
+     */
+    Q_PROPERTY( bool coalesceChanges READ coalesceChanges WRITE setCoalesceChanges NOTIFY coalesceChangesChanged )
+
   public:
     //! Create new map settings
     explicit QgsQuickMapSettings( QObject *parent = nullptr );
@@ -208,6 +220,21 @@ class QgsQuickMapSettings : public QObject
 
     void setDevicePixelRatio( const qreal ratio ) { mDevicePixelRatio = ratio; }
 
+    //! \copydoc QgsQuickMapSettings::coalesceChanges
+    bool coalesceChanges() const;
+
+    //! \copydoc QgsQuickMapSettings::coalesceChanges
+    void setCoalesceChanges( bool coalesceChanges );
+
+    //! Returns TRUE if view changes are waiting for flushChanges()
+    bool hasPendingChanges() const;
+
+    /**
+     * Emits the notifications of the view changes collected since the previous call, followed by viewChanged().
+     * Does nothing if there are no pending changes.
+     */
+    void flushChanges();
+
   signals:
     //! \copydoc QgsQuickMapSettings::project
     void projectChanged();
@@ -239,6 +266,21 @@ class QgsQuickMapSettings : public QObject
     //! \copydoc QgsQuickMapSettings::layers
     void layersChanged();
 
+    //! \copydoc QgsQuickMapSettings::coalesceChanges
+    void coalesceChangesChanged();
+
+    /**
+     * Emitted once after the notifications of a set of view changes, for listeners which
+     * only need to know that the view has changed.
+     */
+    void viewChanged();
+
+    /**
+     * Emitted when a view change is collected while no other change is pending, to let
+     * the owner of the map settings schedule a call to flushChanges().
+     */
+    void changesPending();
+
   private slots:
 
     /**
@@ -249,9 +291,24 @@ class QgsQuickMapSettings : public QObject
     void onReadProject( const QDomDocument &doc );
 
   private:
+    enum ViewChange
+    {
+      ExtentChange = 1 << 0,
+      VisibleExtentChange = 1 << 1,
+      MapUnitsPerPointChange = 1 << 2,
+      OutputSizeChange = 1 << 3,
+      OutputDpiChange = 1 << 4,
+    };
+
+    //! Collects the ViewChange flags \a changes together with the changes of the derived values and flushes them unless coalescing
+    void queueChanges( int changes );
+
     QgsProject *mProject = nullptr;
     QgsMapSettings mMapSettings;
     qreal mDevicePixelRatio = 1.0;
+    bool mCoalesceChanges = false;
+    //! the ViewChange flags collected since the last flush
+    int mPendingChanges = 0;
 
 };
 
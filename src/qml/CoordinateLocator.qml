@@ -51,7 +51,16 @@ Item {
     property variant snappedCoordinate
     property point snappedPoint
 
+    //! Returns whether the snapping result has been computed for the current input coordinate
+    function isCurrentResult() {
+      return snappingResultInputCoordinate.x === inputCoordinate.x && snappingResultInputCoordinate.y === inputCoordinate.y
+    }
+
     onSnappingResultChanged: {
+      // a result computed for a previous input coordinate is superseded by the next one
+      if ( !isCurrentResult() )
+        return
+
       if ( snappingResult.isValid )
       {
         snappedCoordinate = snappingResult.point
@@ -118,6 +127,9 @@ Item {
       target: snappingUtils
 
       function onSnappingResultChanged() {
+        if ( !snappingUtils.isCurrentResult() )
+          return
+
         crosshairCircle.border.color = overrideLocation == undefined ? ( snappingUtils.snappingResult.isValid ? "#9b59b6" : locator.color ) : "#AD1457"
         crosshairCircle.width = snappingUtils.snappingResult.isValid ? 32: 48
       }
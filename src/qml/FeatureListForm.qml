@@ -285,6 +285,7 @@ Rectangle {
     model: AttributeFormModel {
       featureModel: FeatureModel {
         currentLayer: featureForm.selection.focusedLayer
+        commitQueue: featureCommitQueue
         feature: featureForm.selection.focusedFeature
         features: featureForm.selection.model.selectedFeatures
       }
@@ -506,13 +507,15 @@ Rectangle {
       isMerged = featureForm.model.mergeSelection()
 
       if ( isMerged ) {
-        displayToast( qsTr( "Successfully merged %n feature(s)", "", selectedCount ) );
+        mergeProgressDialog.selectedCount = selectedCount
+        mergeProgressDialog.isCanceled = false
+        mergeProgressDialog.open()
       } else {
         displayToast( qsTr( "Failed to merge %n feature(s)", "", selectedCount ) );
+        featureForm.focus = true;
       }
 
       visible = false
-      featureForm.focus = true;
     }
     onRejected: {
       visible = false
@@ -527,6 +530,50 @@ Rectangle {
     }
   }
 
+  Dialog {
+    id: mergeProgressDialog
+    parent: mainWindow.contentItem
+
+    property int selectedCount: 0
+    property bool isCanceled: false
+
+    visible: false
+    modal: true
+    closePolicy: Popup.NoAutoClose
+
+    x: ( mainWindow.width - width ) / 2
+    y: ( mainWindow.height - height ) / 2
+
+    title: qsTr( "Merging %n feature(s)", "", mergeProgressDialog.selectedCount )
+    ProgressBar {
+      width: parent.width
+      from: 0
+      to: 100
+      value: featureForm.model.mergeProgress
+    }
+
+    standardButtons: Dialog.Cancel
+    onRejected: {
+      isCanceled = true
+      featureForm.model.cancelMerge()
+    }
+
+    Connections {
+      target: featureForm.model
+
+      function onMergeSelectionFinished(success) {
+        if ( success ) {
+          displayToast( qsTr( "Successfully merged %n feature(s)", "", mergeProgressDialog.selectedCount ) );
+        } else if ( !mergeProgressDialog.isCanceled ) {
+          displayToast( qsTr( "Failed to merge %n feature(s)", "", mergeProgressDialog.selectedCount ) );
+        }
+
+        mergeProgressDialog.visible = false
+        featureForm.focus = true;
+      }
+    }
+  }
+
   Dialog {
     id: deleteDialog
     parent: mainWindow.contentItem
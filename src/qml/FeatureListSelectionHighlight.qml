@@ -3,7 +3,7 @@ import QtQuick 2.12
 import org.qgis 1.0
 import org.qfield 1.0
 
-Repeater {
+Item {
   id: featureListSelectionHighlight
   property FeatureListModelSelection selectionModel
   property MapSettings mapSettings
@@ -11,14 +11,19 @@ Repeater {
   property color focusedColor: "red"
   property color selectedColor: "green"
 
-  model: selectionModel.model
-
-  delegate: GeometryRenderer {
+  // the geometries of all the features, in a single scene graph node
+  MultiFeatureHighlight {
+    model: selectionModel.model
     mapSettings: featureListSelectionHighlight.mapSettings
-    geometryWrapper.qgsGeometry: model.geometry
-    geometryWrapper.crs: model.crs
 
-    color: model.featureSelected ? featureListSelectionHighlight.selectedColor : selectionModel.model.selectedCount === 0 && selectionModel && model.index === selectionModel.focusedItem ? featureListSelectionHighlight.focusedColor : featureListSelectionHighlight.color
-    borderColor: "white"
+    transform: MapTransform {
+      mapSettings: featureListSelectionHighlight.mapSettings
+    }
+
+    color: featureListSelectionHighlight.color
+    focusedColor: featureListSelectionHighlight.focusedColor
+    selectedColor: featureListSelectionHighlight.selectedColor
+    focusedRow: selectionModel && selectionModel.model.selectedCount === 0 ? selectionModel.focusedItem : -1
+    pointBorderColor: "white"
   }
 }
@@ -76,6 +76,9 @@ Item {
     property var __freezecount: ({})
 
     freeze: false
+
+    // pan and pinch events are delivered to the listeners once per frame
+    mapSettings.coalesceChanges: true
   }
 
 //    TapHandler {
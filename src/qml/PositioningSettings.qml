@@ -8,4 +8,6 @@ LabSettings.Settings {
   property real antennaHeight: 0.0
   property bool antennaHeightActivated: false
   property bool skipAltitudeCorrection: false
+
+  property string replayFile: ""
 }
@@ -138,6 +138,48 @@ Popup {
           wrapMode: Text.WordWrap
           Layout.fillWidth: true
         }
+
+        Item {
+          // empty cell in grid layout
+          width: 1
+        }
+
+        Label {
+          text: qsTr( "NMEA replay file" )
+          font: Theme.defaultFont
+          wrapMode: Text.WordWrap
+          Layout.fillWidth: true
+          Layout.columnSpan: 2
+        }
+
+        TextField {
+          id: replayFileInput
+          font: Theme.defaultFont
+          Layout.fillWidth: true
+          Layout.columnSpan: 2
+          Layout.preferredHeight: font.height + 20
+
+          inputMethodHints: Qt.ImhNoAutoUppercase | Qt.ImhNoPredictiveText
+
+          Component.onCompleted: {
+              text = positioningSettings.replayFile
+          }
+
+          onEditingFinished: {
+              positioningSettings.replayFile = text.trim()
+          }
+        }
+
+        Label {
+          padding: 8
+          topPadding: 0
+          text: qsTr( "Path of a recorded NMEA log which is replayed instead of receiving positions from the positioning interface. Leave empty to use the positioning interface." )
+          font: Theme.tipFont
+
+          wrapMode: Text.WordWrap
+          Layout.fillWidth: true
+          Layout.columnSpan: 2
+        }
       }
     }
   }
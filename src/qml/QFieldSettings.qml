@@ -17,6 +17,7 @@ Page {
   property alias nativeCamera: registry.nativeCamera
   property alias autoSave: registry.autoSave
   property alias mouseAsTouchScreen: registry.mouseAsTouchScreen
+  property alias asynchronousProjectLoading: registry.asynchronousProjectLoading
 
   Settings {
     id: registry
@@ -28,6 +29,7 @@ Page {
     property bool nativeCamera: true
     property bool autoSave
     property bool mouseAsTouchScreen
+    property bool asynchronousProjectLoading
   }
 
   ListModel {
@@ -70,6 +72,11 @@ Page {
           description: qsTr( "If disabled, the mouse will act as a stylus pen." )
           settingAlias: "mouseAsTouchScreen"
       }
+      ListElement {
+          title: qsTr( "Load projects in the background" )
+          description: qsTr( "If enabled, the layers of a project are opened in parallel and the map can be used as soon as the visible layers are available." )
+          settingAlias: "asynchronousProjectLoading"
+      }
   }
 
   Rectangle {
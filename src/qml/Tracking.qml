@@ -24,31 +24,25 @@ Item{
         id: rubberbandModel
         frozen: false
         vectorLayer: mainModel.vectorLayer
-        currentCoordinate: positionSource.projectedPosition
-        measureValue: ( positionSource.position.timestamp - mainModel.startPositionTimestamp ) / 1000
-        currentPositionTimestamp: positionSource.position.timestamp
+        // the current coordinate is moved through all the received positions by the tracker
         crs: mapCanvas.mapSettings.destinationCrs
 
         onVertexCountChanged: {
-          if( ( geometryType === QgsWkbTypes.LineGeometry && vertexCount > 2 ) ||
-              ( geometryType === QgsWkbTypes.PolygonGeometry &&vertexCount > 3 ) )
+          // the feature is created once there are enough vertices, the tracker then stores
+          // the tracked vertices in it and trims the rubberband to the latest ones
+          if( !featureCreated &&
+              ( ( geometryType === QgsWkbTypes.LineGeometry && vertexCount > 2 ) ||
+                ( geometryType === QgsWkbTypes.PolygonGeometry && vertexCount > 3 ) ) )
           {
               featureModel.applyGeometry()
 
-              if( ( geometryType === QgsWkbTypes.LineGeometry && vertexCount == 3 ) ||
-                  ( geometryType === QgsWkbTypes.PolygonGeometry && vertexCount == 4 ) )
-              {
-                  // indirect action, no need to check for success and display a toast, the log is enough
-                  featureModel.create()
-                  mainModel.feature = featureModel.feature
-              }
-              else
-              {
-                  // indirect action, no need to check for success and display a toast, the log is enough
-                  featureModel.save()
-              }
+              // indirect action, no need to check for success and display a toast, the log is enough
+              featureCreated = featureModel.create()
+              mainModel.feature = featureModel.feature
           }
         }
+
+        property bool featureCreated: false
     }
 
     Rubberband {
@@ -65,6 +59,32 @@ Item{
         visible: mainModel.visible
     }
 
+    DistanceArea {
+      id: trackDistanceArea
+      project: qgisProject
+      crs: qgisProject.crs
+    }
+
+    MapToScreen {
+      id: trackPositionToScreen
+      mapSettings: mapCanvas.mapSettings
+      mapPoint: rubberbandModel.currentCoordinate
+    }
+
+    // the length of the track next to the latest position
+    Text {
+        id: totalLengthLabel
+        visible: mainModel.visible && rubberbandModel.vertexCount > 1
+        x: trackPositionToScreen.screenPoint.x + 10
+        y: trackPositionToScreen.screenPoint.y + 10
+
+        text: UnitTypes.formatDistance( mainModel.totalLength, 3, trackDistanceArea.lengthUnits )
+
+        font: Theme.strongTipFont
+        style: Text.Outline
+        styleColor: Theme.light
+    }
+
     FeatureModel {
         id: featureModel
         currentLayer: mainModel.vectorLayer
@@ -188,6 +208,7 @@ Item{
                         mainModel.timeInterval = timeIntervalText.text.length == 0 || !timeIntervalCheck.checked ? 0 : timeIntervalText.text
                         mainModel.minimumDistance = distanceText.text.length == 0 || !distanceCheck.checked ? 0 : distanceText.text
                         mainModel.conjunction = conjunction.checked
+                        mainModel.simplificationTolerance = simplificationText.text.length == 0 || !simplificationCheck.checked ? 0 : simplificationText.text
                         mainModel.rubberModel = rubberbandModel
 
                         trackInformationDialog.active = false
@@ -308,6 +329,47 @@ Item{
                     indicator.implicitWidth: 24
                 }
 
+                Item {
+                    // spacer item
+                    height: 12
+                }
+
+                CheckBox {
+                    id: simplificationCheck
+                    text: qsTr( 'Simplify track with a tolerance of (%1)' ).arg( UnitTypes.toAbbreviatedString( infoDistanceArea.lengthUnits ) )
+                    font: Theme.defaultFont
+
+                    Layout.fillWidth: true
+                    indicator.height: 16
+                    indicator.width: 16
+                    indicator.implicitHeight: 24
+                    indicator.implicitWidth: 24
+                }
+
+                TextField {
+                    id: simplificationText
+                    enabled: simplificationCheck.checked
+                    height: fontMetrics.height + 20
+                    topPadding: 10
+                    bottomPadding: 10
+                    Layout.fillWidth: true
+                    font: Theme.defaultFont
+                    text: '2'
+
+                    inputMethodHints: Qt.ImhFormattedNumbersOnly
+
+                    validator: DoubleValidator {
+                      bottom: 0
+                    }
+
+                    background: Rectangle {
+                    y: simplificationText.height - height - simplificationText.bottomPadding / 2
+                    implicitWidth: 120
+                    height: simplificationText.activeFocus ? 2: 1
+                    color: simplificationText.activeFocus ? "#4CAF50" : "#C8E6C9"
+                    }
+                }
+
                 Item {
                     // spacer item
                     Layout.fillWidth: true
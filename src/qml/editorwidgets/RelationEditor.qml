@@ -25,6 +25,8 @@ Rectangle{
         relation: qgisProject.relationManager.relation(relationId)
         nmRelation: qgisProject.relationManager.relation(nmRelationId)
         feature: currentFeature
+        // children beyond the first page are loaded while scrolling
+        pageSize: 50
     }
 
     //the list
@@ -45,6 +45,8 @@ VisibilityFadingRow {
 
     onConfirm: {
       rubberbandModel.frozen = true
+      // the edits waiting in the commit queue must not be discarded by a roll back
+      featureCommitQueue.flush(featureModel.currentLayer)
       if (!featureModel.currentLayer.editBuffer())
         featureModel.currentLayer.startEditing()
       var result = GeometryUtils.addRingFromRubberband(featureModel.currentLayer, featureModel.feature.id, rubberbandModel)
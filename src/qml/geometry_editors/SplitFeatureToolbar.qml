@@ -42,6 +42,8 @@ VisibilityFadingRow {
     onConfirm: {
       // TODO: featureModel.currentLayer.selectByIds([featureModel.feature.id], VectorLayerStatic.SetSelection)
       Utils.selectFeaturesInLayer(featureModel.currentLayer, [featureModel.feature.id], VectorLayerStatic.SetSelection)
+      // the edits waiting in the commit queue must not be discarded by a roll back
+      featureCommitQueue.flush(featureModel.currentLayer)
       if (!featureModel.currentLayer.editBuffer())
         featureModel.currentLayer.startEditing()
 
@@ -136,6 +136,13 @@ ApplicationWindow {
     destinationCrs: mapCanvas.mapSettings.destinationCrs
     deltaZ: positioningSettings.antennaHeightActivated ? positioningSettings.antennaHeight * -1 : 0
     skipAltitudeTransformation: positioningSettings.skipAltitudeCorrection
+    replayFile: positioningSettings.replayFile
+  }
+
+  Binding {
+    target: trackingModel
+    property: "positionPipeline"
+    value: positionSource
   }
 
   Item {
@@ -434,7 +441,8 @@ ApplicationWindow {
       // highlighting vertices
       VertexRubberband {
         id: vertexRubberband
-        model: geometryEditingFeature.vertexModel
+        // all the handles within the visible extent are drawn by a single item
+        vertexModel: geometryEditingFeature.vertexModel
         mapSettings: mapCanvas.mapSettings
       }
 
@@ -834,6 +842,7 @@ ApplicationWindow {
       FeatureModel {
         id: digitizingFeature
         currentLayer: dashBoard.currentLayer
+        commitQueue: featureCommitQueue
         positionSourceName: positionSource.name
         topSnappingResult: coordinateLocator.topSnappingResult
         geometry: Geometry {
@@ -1228,7 +1237,9 @@ ApplicationWindow {
     allowEdit: stateMachine.state === "digitize"
     allowDelete: stateMachine.state === "digitize"
 
-    model: MultiFeatureListModel {}
+    model: MultiFeatureListModel {
+      commitQueue: featureCommitQueue
+    }
 
     selection: FeatureListModelSelection {
       id: featureListModelSelection
@@ -1291,6 +1302,14 @@ ApplicationWindow {
       toast.show(message)
   }
 
+  Connections {
+    target: featureCommitQueue
+
+    function onCommitFailed(layer, errors) {
+      displayToast( qsTr( "Changes in layer \"%1\" could not be saved and have been discarded" ).arg( layer.name ) )
+    }
+  }
+
   Rectangle {
     id: busyMessage
     anchors.fill: parent
@@ -1310,20 +1329,31 @@ ApplicationWindow {
       id: busyMessageText
       anchors.top: busyMessageIndicator.bottom
       anchors.horizontalCenter: parent.horizontalCenter
+      horizontalAlignment: Text.AlignHCenter
       text: qsTr( "Loading Project" )
     }
 
     Connections {
       target: iface
 
+      property string projectPath
+
       function onLoadProjectStarted(path) {
+        projectPath = path
         busyMessageText.text = qsTr( "Loading Project: %1" ).arg( path )
         busyMessage.visible = true
+        // no refreshes while the layers are added
+        mapCanvasMap.freeze('projectload')
       }
 
-      function onLoadProjectEnded() {
+      function onLoadProjectProgress(resolvedCount, layerCount) {
+        busyMessageText.text = qsTr( "Loading Project: %1" ).arg( projectPath ) + "\n" + qsTr( "%1 / %2 layers" ).arg( resolvedCount ).arg( layerCount )
+      }
+
+      function onProjectLayersReady() {
         busyMessage.visible = false
         mapCanvasBackground.color = mapCanvas.mapSettings.backgroundColor
+        mapCanvasMap.unfreeze('projectload')
       }
     }
   }
@@ -1731,6 +1761,7 @@ ApplicationWindow {
   FeatureModel {
     id: geometryEditingFeature
     currentLayer: null
+    commitQueue: featureCommitQueue
     positionSourceName: positionSource.name
     vertexModel: vertexModel
   }
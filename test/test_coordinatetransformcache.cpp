@@ -0,0 +1,119 @@
+/***************************************************************************
+                        test_coordinatetransformcache.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QThread>
+
+#include "qfield_testbase.h"
+
+#include "coordinatetransformcache.h"
+
+#include <qgsproject.h>
+
+
+class TestCoordinateTransformCache: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void init()
+    {
+      CoordinateTransformCache::instance()->clear();
+      CoordinateTransformCache::instance()->resetStatistics();
+    }
+
+    void testHitsAndMisses()
+    {
+      CoordinateTransformCache *cache = CoordinateTransformCache::instance();
+      const QgsCoordinateReferenceSystem wgs84 = QgsCoordinateReferenceSystem::fromEpsgId( 4326 );
+      const QgsCoordinateReferenceSystem lv95 = QgsCoordinateReferenceSystem::fromEpsgId( 2056 );
+
+      const QgsCoordinateTransform transform = cache->transform( wgs84, lv95 );
+      QVERIFY( transform.isValid() );
+      QCOMPARE( transform.sourceCrs(), wgs84 );
+      QCOMPARE( transform.destinationCrs(), lv95 );
+      QCOMPARE( cache->misses(), 1 );
+      QCOMPARE( cache->hits(), 0 );
+
+      cache->transform( wgs84, lv95 );
+      QCOMPARE( cache->misses(), 1 );
+      QCOMPARE( cache->hits(), 1 );
+
+      // the opposite direction is another transform
+      cache->transform( lv95, wgs84 );
+      QCOMPARE( cache->misses(), 2 );
+
+      // so is another context
+      cache->transform( wgs84, lv95, QgsCoordinateTransformContext() );
+      QCOMPARE( cache->misses(), 3 );
+    }
+
+    void testTransformContextChanged()
+    {
+      CoordinateTransformCache *cache = CoordinateTransformCache::instance();
+      const QgsCoordinateReferenceSystem wgs84 = QgsCoordinateReferenceSystem::fromEpsgId( 4326 );
+      const QgsCoordinateReferenceSystem lv95 = QgsCoordinateReferenceSystem::fromEpsgId( 2056 );
+
+      const QgsCoordinateTransformContext context;
+
+      cache->transform( wgs84, lv95, context );
+      QgsCoordinateTransformContext projectContext;
+      projectContext.addCoordinateOperation( wgs84, lv95, QStringLiteral( "+proj=pipeline +step +proj=noop" ) );
+      QgsProject::instance()->setTransformContext( projectContext );
+
+      // all the transforms are dropped, not only the ones using the project context
+      cache->transform( wgs84, lv95, context );
+      QCOMPARE( cache->misses(), 2 );
+      QCOMPARE( cache->hits(), 0 );
+    }
+
+    void testThreads()
+    {
+      CoordinateTransformCache *cache = CoordinateTransformCache::instance();
+      const QgsCoordinateReferenceSystem wgs84 = QgsCoordinateReferenceSystem::fromEpsgId( 4326 );
+      const QgsCoordinateReferenceSystem lv95 = QgsCoordinateReferenceSystem::fromEpsgId( 2056 );
+      const QgsCoordinateTransformContext context;
+
+      cache->transform( wgs84, lv95, context );
+
+      // each thread creates its own transform
+      QThread *thread = QThread::create( [ = ] {
+        cache->transform( wgs84, lv95, context );
+        cache->transform( wgs84, lv95, context );
+      } );
+      thread->start();
+      QVERIFY( thread->wait( 5000 ) );
+      delete thread;
+
+      QCOMPARE( cache->misses(), 2 );
+      QCOMPARE( cache->hits(), 1 );
+    }
+
+    void benchmarkTransform()
+    {
+      CoordinateTransformCache *cache = CoordinateTransformCache::instance();
+      const QgsCoordinateReferenceSystem wgs84 = QgsCoordinateReferenceSystem::fromEpsgId( 4326 );
+      const QgsCoordinateReferenceSystem lv95 = QgsCoordinateReferenceSystem::fromEpsgId( 2056 );
+
+      QBENCHMARK
+      {
+        cache->transform( wgs84, lv95 ).transform( QgsPointXY( 7.44225, 46.9483 ) );
+      }
+    }
+};
+
+QFIELDTEST_MAIN( TestCoordinateTransformCache )
+#include "test_coordinatetransformcache.moc"
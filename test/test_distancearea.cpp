@@ -0,0 +1,158 @@
+/***************************************************************************
+                        test_distancearea.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "distancearea.h"
+#include "rubberbandmodel.h"
+
+#include <qgscoordinatetransform.h>
+#include <qgsdistancearea.h>
+#include <qgsproject.h>
+
+#include <cmath>
+
+
+class TestDistanceArea: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase()
+    {
+      QgsProject::instance()->setCrs( QgsCoordinateReferenceSystem::fromEpsgId( 2056 ) );
+      QgsProject::instance()->setEllipsoid( QStringLiteral( "EPSG:7030" ) );
+    }
+
+    void init()
+    {
+      mDistanceArea.reset();
+      mModel.reset( new RubberbandModel() );
+      mModel->setGeometryType( QgsWkbTypes::PolygonGeometry );
+      mModel->setCrs( QgsCoordinateReferenceSystem::fromEpsgId( 4326 ) );
+
+      mDistanceArea.reset( new DistanceArea() );
+      mDistanceArea->setRubberbandModel( mModel.get() );
+      mDistanceArea->setCrs( QgsProject::instance()->crs() );
+      mDistanceArea->setProject( QgsProject::instance() );
+
+      // the last vertex is the current coordinate
+      const QList<QgsPoint> points { QgsPoint( 7.44, 46.95 ), QgsPoint( 7.46, 46.95 ), QgsPoint( 7.46, 46.96 ), QgsPoint( 7.44, 46.96 ) };
+      for ( int i = 0; i < points.count(); ++i )
+      {
+        mModel->setCurrentCoordinate( points.at( i ) );
+        if ( i < points.count() - 1 )
+          mModel->addVertex();
+      }
+      QCOMPARE( mModel->vertexCount(), 4 );
+    }
+
+    void testBuild()
+    {
+      compareMeasurements();
+    }
+
+    void testInsert()
+    {
+      mModel->insertVertices( 1, 1 );
+      compareMeasurements();
+      mModel->setVertex( 1, QgsPoint( 7.45, 46.94 ) );
+      compareMeasurements();
+
+      // appending moves the current coordinate to the new vertex
+      mModel->addVertex();
+      mModel->setCurrentCoordinate( QgsPoint( 7.43, 46.955 ) );
+      QCOMPARE( mModel->vertexCount(), 6 );
+      compareMeasurements();
+    }
+
+    void testRemove()
+    {
+      mModel->removeVertices( 1, 1 );
+      compareMeasurements();
+
+      mModel->removeVertices( 0, 1 );
+      QCOMPARE( mModel->vertexCount(), 2 );
+      compareMeasurements();
+    }
+
+    void testMove()
+    {
+      mModel->setVertex( 0, QgsPoint( 7.43, 46.945 ) );
+      compareMeasurements();
+      mModel->setVertex( 2, QgsPoint( 7.47, 46.965 ) );
+      compareMeasurements();
+      mModel->setCurrentCoordinate( QgsPoint( 7.445, 46.97 ) );
+      compareMeasurements();
+    }
+
+    void testTransformFailure()
+    {
+      // a latitude out of range cannot be projected
+      mModel->setVertex( 1, QgsPoint( 7.46, 100 ) );
+      QVERIFY( !mDistanceArea->lengthValid() );
+      QVERIFY( !mDistanceArea->areaValid() );
+      QVERIFY( std::isnan( mDistanceArea->length() ) );
+      QVERIFY( std::isnan( mDistanceArea->area() ) );
+
+      // the measurements are valid again once the vertex can be transformed
+      mModel->setVertex( 1, QgsPoint( 7.46, 46.95 ) );
+      QVERIFY( mDistanceArea->lengthValid() );
+      QVERIFY( mDistanceArea->areaValid() );
+      compareMeasurements();
+
+      // a failure when all the vertices are measured again, e.g. after the crs changed
+      mModel->setVertex( 2, QgsPoint( 7.46, 100 ) );
+      emit mModel->crsChanged();
+      QVERIFY( !mDistanceArea->lengthValid() );
+      mModel->removeVertices( 2, 1 );
+      QVERIFY( mDistanceArea->lengthValid() );
+      compareMeasurements();
+    }
+
+  private:
+    //! Compares the cached measurements with the ones of QgsDistanceArea on the whole geometry
+    void compareMeasurements()
+    {
+      QgsDistanceArea distanceArea;
+      distanceArea.setSourceCrs( QgsProject::instance()->crs(), QgsProject::instance()->transformContext() );
+      distanceArea.setEllipsoid( QgsProject::instance()->ellipsoid() );
+
+      const QgsCoordinateTransform transform( mModel->crs(), QgsProject::instance()->crs(), QgsProject::instance() );
+      QVector<QgsPointXY> points;
+      const QVector<QgsPoint> vertices = mModel->vertices();
+      for ( const QgsPoint &vertex : vertices )
+        points << transform.transform( vertex.x(), vertex.y() );
+
+      const double length = distanceArea.measureLine( points );
+      QVERIFY2( qgsDoubleNear( mDistanceArea->length(), length, length * 1e-9 ), QStringLiteral( "%1 != %2" ).arg( mDistanceArea->length(), 0, 'f', 6 ).arg( length, 0, 'f', 6 ).toUtf8().constData() );
+
+      if ( points.count() < 3 )
+        return;
+
+      points << points.first();
+      const double area = distanceArea.measurePolygon( points );
+      QVERIFY2( qgsDoubleNear( mDistanceArea->area(), area, area * 1e-9 ), QStringLiteral( "%1 != %2" ).arg( mDistanceArea->area(), 0, 'f', 6 ).arg( area, 0, 'f', 6 ).toUtf8().constData() );
+    }
+
+    std::unique_ptr<RubberbandModel> mModel;
+    std::unique_ptr<DistanceArea> mDistanceArea;
+};
+
+QFIELDTEST_MAIN( TestDistanceArea )
+#include "test_distancearea.moc"
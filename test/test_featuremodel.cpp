@@ -0,0 +1,121 @@
+/***************************************************************************
+                        test_featuremodel.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "featurecommitqueue.h"
+#include "featuremodel.h"
+
+#include <qgsproject.h>
+#include <qgsrelationmanager.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+
+
+class TestFeatureModel: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void init()
+    {
+      mLayer = new QgsVectorLayer( QStringLiteral( "Point?field=id:integer" ), QStringLiteral( "parent" ), QStringLiteral( "memory" ) );
+      mChild = new QgsVectorLayer( QStringLiteral( "None?field=parent_id:integer" ), QStringLiteral( "child" ), QStringLiteral( "memory" ) );
+      QVERIFY( mLayer->isValid() );
+      QgsProject::instance()->addMapLayers( QList<QgsMapLayer *>() << mLayer << mChild );
+
+      mQueue.reset( new FeatureCommitQueue() );
+      // only explicit flushes commit in these tests
+      mQueue->setInterval( 60000 );
+
+      mModel.reset( new FeatureModel() );
+      mModel->setCurrentLayer( mLayer );
+      mModel->setCommitQueue( mQueue.get() );
+    }
+
+    void cleanup()
+    {
+      mModel.reset();
+      mQueue.reset();
+      QgsProject::instance()->relationManager()->clear();
+      QgsProject::instance()->removeAllMapLayers();
+    }
+
+    void testCreateQueued()
+    {
+      mModel->setFeature( newFeature( 1 ) );
+      QVERIFY( mModel->create() );
+
+      // the new feature waits in the edit buffer with a temporary id
+      QCOMPARE( mQueue->pendingEdits(), 1 );
+      QVERIFY( mLayer->isEditable() );
+      QVERIFY( FID_IS_NEW( mModel->feature().id() ) );
+      QCOMPARE( mLayer->dataProvider()->featureCount(), 0L );
+
+      // the model follows the permanent id assigned by the commit
+      QSignalSpy featureChangedSpy( mModel.get(), &FeatureModel::featureChanged );
+      QVERIFY( mQueue->flush() );
+      QVERIFY( !mLayer->isEditable() );
+      QCOMPARE( mLayer->dataProvider()->featureCount(), 1L );
+      QVERIFY( !FID_IS_NEW( mModel->feature().id() ) );
+      QVERIFY( featureChangedSpy.count() > 0 );
+      QCOMPARE( mLayer->getFeature( mModel->feature().id() ).attribute( QStringLiteral( "id" ) ).toInt(), 1 );
+    }
+
+    void testCreateReferencedFlushesQueue()
+    {
+      mModel->setFeature( newFeature( 1 ) );
+      QVERIFY( mModel->create() );
+      QCOMPARE( mQueue->pendingEdits(), 1 );
+
+      // a parent of a relation is committed right away, after the edits waiting in the queue
+      QgsRelation relation;
+      relation.setId( QStringLiteral( "child.parent" ) );
+      relation.setName( QStringLiteral( "child.parent" ) );
+      relation.setReferencingLayer( mChild->id() );
+      relation.setReferencedLayer( mLayer->id() );
+      relation.addFieldPair( QStringLiteral( "parent_id" ), QStringLiteral( "id" ) );
+      QVERIFY( relation.isValid() );
+      QgsProject::instance()->relationManager()->addRelation( relation );
+
+      mModel->setFeature( newFeature( 2 ) );
+      QVERIFY( mModel->create() );
+      QCOMPARE( mQueue->pendingEdits(), 0 );
+      QVERIFY( !mLayer->isEditable() );
+      QCOMPARE( mLayer->dataProvider()->featureCount(), 2L );
+      QVERIFY( !FID_IS_NEW( mModel->feature().id() ) );
+      QCOMPARE( mLayer->getFeature( mModel->feature().id() ).attribute( QStringLiteral( "id" ) ).toInt(), 2 );
+    }
+
+  private:
+    QgsFeature newFeature( int id ) const
+    {
+      QgsFeature feature( mLayer->fields() );
+      feature.setAttribute( QStringLiteral( "id" ), id );
+      feature.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "Point (7.4 46.9)" ) ) );
+      return feature;
+    }
+
+    QgsVectorLayer *mLayer = nullptr;
+    QgsVectorLayer *mChild = nullptr;
+    std::unique_ptr<FeatureCommitQueue> mQueue;
+    std::unique_ptr<FeatureModel> mModel;
+};
+
+QFIELDTEST_MAIN( TestFeatureModel )
+#include "test_featuremodel.moc"
@@ -42,6 +42,21 @@ class TestFeatureUtils: public QObject
       QVERIFY( f.geometry().equals( geometry ) );
     }
 
+    void testAttributeValuesFilter()
+    {
+      QCOMPARE( FeatureUtils::attributeValuesFilter( QStringList() << QStringLiteral( "fk" ), QList<QgsAttributes>() ), QString() );
+      QCOMPARE( FeatureUtils::attributeValuesFilter( QStringList() << QStringLiteral( "fk" ), QList<QgsAttributes>() << ( QgsAttributes() << QVariant() ) ), QString() );
+
+      QList<QgsAttributes> values;
+      values << ( QgsAttributes() << 1 ) << ( QgsAttributes() << QVariant() ) << ( QgsAttributes() << 3 );
+      QCOMPARE( FeatureUtils::attributeValuesFilter( QStringList() << QStringLiteral( "fk" ), values ), QStringLiteral( "\"fk\" IN (1,3)" ) );
+
+      values.clear();
+      values << ( QgsAttributes() << 1 << QStringLiteral( "a" ) ) << ( QgsAttributes() << 2 << QStringLiteral( "b" ) );
+      QCOMPARE( FeatureUtils::attributeValuesFilter( QStringList() << QStringLiteral( "id" ) << QStringLiteral( "name" ), values ),
+                QStringLiteral( "(\"id\" = 1 AND \"name\" = 'a') OR (\"id\" = 2 AND \"name\" = 'b')" ) );
+    }
+
 };
 
 QFIELDTEST_MAIN( TestFeatureUtils )
@@ -23,6 +23,7 @@
 #include "rubberbandmodel.h"
 
 #include "qgsvectorlayer.h"
+#include "qgsfeedback.h"
 
 
 class TestGeometryUtils: public QObject
@@ -94,6 +95,56 @@ class TestGeometryUtils: public QObject
     }
 
 
+    void testUnaryUnion()
+    {
+      QVector<QgsGeometry> geometries;
+      for ( int i = 0; i < 100; i++ )
+        geometries << QgsGeometry::fromRect( QgsRectangle( i, 0, i + 1, 1 ) );
+
+      QgsFeedback feedback;
+      QgsGeometry geom = GeometryUtils::unaryUnion( geometries, &feedback );
+
+      QCOMPARE( geom.type(), QgsWkbTypes::PolygonGeometry );
+      QVERIFY( !geom.isMultipart() );
+      QVERIFY( qgsDoubleNear( geom.area(), 100.0, 0.0001 ) );
+      QVERIFY( qgsDoubleNear( feedback.progress(), 100.0, 0.0001 ) );
+
+      QCOMPARE( GeometryUtils::unaryUnion( QVector<QgsGeometry>() << geometries.at( 0 ) ).asWkt(), geometries.at( 0 ).asWkt() );
+      QVERIFY( GeometryUtils::unaryUnion( QVector<QgsGeometry>() ).isNull() );
+
+      feedback.cancel();
+      QVERIFY( GeometryUtils::unaryUnion( geometries, &feedback ).isNull() );
+    }
+
+
+    void testTransformCoordinates()
+    {
+      const QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromEpsgId( 4326 ), QgsCoordinateReferenceSystem::fromEpsgId( 3857 ), QgsCoordinateTransformContext() );
+
+      const QVector<double> originalX { 0, 7.44225, 179 };
+      const QVector<double> originalY { 0, 46.9483, 0 };
+      QVector<double> x = originalX;
+      QVector<double> y = originalY;
+      QVERIFY( GeometryUtils::transformCoordinates( transform, x, y ) );
+
+      for ( int i = 0; i < x.size(); ++i )
+      {
+        const QgsPointXY expected = transform.transform( QgsPointXY( originalX.at( i ), originalY.at( i ) ) );
+        QVERIFY( qgsDoubleNear( x.at( i ), expected.x(), 1e-6 ) );
+        QVERIFY( qgsDoubleNear( y.at( i ), expected.y(), 1e-6 ) );
+      }
+
+      // the reverse transform gives the original coordinates back
+      QVERIFY( GeometryUtils::transformCoordinates( transform, x, y, QgsCoordinateTransform::ReverseTransform ) );
+      QVERIFY( qgsDoubleNear( x.at( 1 ), 7.44225, 1e-9 ) );
+      QVERIFY( qgsDoubleNear( y.at( 1 ), 46.9483, 1e-9 ) );
+
+      // an invalid transform leaves the coordinates as they are
+      QVERIFY( GeometryUtils::transformCoordinates( QgsCoordinateTransform(), x, y ) );
+      QVERIFY( qgsDoubleNear( x.at( 1 ), 7.44225, 1e-9 ) );
+    }
+
+
   private:
     std::unique_ptr<RubberbandModel> mModel;
     std::unique_ptr<QgsVectorLayer> mLayer;
@@ -0,0 +1,102 @@
+/***************************************************************************
+                        test_gpkgflusher.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "qgsgpkgflusher.h"
+
+#include <qgsproject.h>
+#include <qgssqliteutils.h>
+#include <sqlite3.h>
+
+#include <QTemporaryDir>
+
+
+class TestGpkgFlusher: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase()
+    {
+      qRegisterMetaType<QgsGpkgFlusher::CheckpointStatistics>();
+    }
+
+    void testCheckpointMode()
+    {
+      QgsGpkgFlusher::CheckpointPolicy policy;
+      policy.restartWalSize = 100;
+      policy.truncateWalSize = 1000;
+
+      // an empty wal file needs no checkpoint, even when the database is idle
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 0, false ), QgsGpkgFlusher::CheckpointMode::None );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 0, true ), QgsGpkgFlusher::CheckpointMode::None );
+
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 1, false ), QgsGpkgFlusher::CheckpointMode::Passive );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 99, false ), QgsGpkgFlusher::CheckpointMode::Passive );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 100, false ), QgsGpkgFlusher::CheckpointMode::Restart );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 999, false ), QgsGpkgFlusher::CheckpointMode::Restart );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 1000, false ), QgsGpkgFlusher::CheckpointMode::Truncate );
+
+      // an idle database gets its wal file truncated whatever its size
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 1, true ), QgsGpkgFlusher::CheckpointMode::Truncate );
+      QCOMPARE( QgsGpkgFlusher::checkpointMode( policy, 100, true ), QgsGpkgFlusher::CheckpointMode::Truncate );
+    }
+
+    void testStopsWhenIdle()
+    {
+      QTemporaryDir dir;
+      const QString filename = dir.filePath( QStringLiteral( "data.gpkg" ) );
+
+      // the connection is kept open, closing it would checkpoint and remove the wal file
+      sqlite3_database_unique_ptr database;
+      QCOMPARE( database.open( filename ), SQLITE_OK );
+      QString errorMessage;
+      QCOMPARE( database.exec( QStringLiteral( "PRAGMA journal_mode=WAL; CREATE TABLE points (id INTEGER); INSERT INTO points VALUES (1);" ), errorMessage ), SQLITE_OK );
+      QVERIFY( QgsGpkgFlusher::walSize( filename ) > 0 );
+
+      QgsProject project;
+      QgsGpkgFlusher flusher( &project );
+      QgsGpkgFlusher::CheckpointPolicy policy;
+      policy.flushDelay = 10;
+      policy.idleTimeout = 200;
+      flusher.setCheckpointPolicy( policy );
+
+      QSignalSpy spy( &flusher, &QgsGpkgFlusher::checkpointed );
+      emit flusher.requestFlush( filename );
+
+      // a passive checkpoint after the flush delay, then a truncation once idle
+      QVERIFY( spy.wait( 5000 ) );
+      QVERIFY( flusher.statistics( filename ).walSizeAfter > 0 );
+      QVERIFY( spy.wait( 5000 ) );
+      QCOMPARE( flusher.statistics( filename ).walSizeAfter, Q_INT64_C( 0 ) );
+      QCOMPARE( QgsGpkgFlusher::walSize( filename ), Q_INT64_C( 0 ) );
+
+      // nothing is run anymore until the database changes again
+      QVERIFY( !spy.wait( 1000 ) );
+      QCOMPARE( flusher.statistics( filename ).count, 2 );
+
+      QCOMPARE( database.exec( QStringLiteral( "INSERT INTO points VALUES (2);" ), errorMessage ), SQLITE_OK );
+      emit flusher.requestFlush( filename );
+      QVERIFY( spy.wait( 5000 ) );
+      QCOMPARE( flusher.statistics( filename ).count, 3 );
+    }
+};
+
+QFIELDTEST_MAIN( TestGpkgFlusher )
+#include "test_gpkgflusher.moc"
@@ -0,0 +1,143 @@
+/***************************************************************************
+                        test_layerresolver.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "qfield_testbase.h"
+
+#include "badlayerhandler.h"
+#include "layerresolver.h"
+
+#include <qgsconfig.h>
+#include <qgslayertree.h>
+#include <qgsproject.h>
+#include <qgsvectorlayer.h>
+
+
+class TestLayerResolver: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void testResolve()
+    {
+#if VERSION_INT < 31000
+      QSKIP( "Reading projects without resolving the layers requires QGIS 3.10" );
+#else
+      QTemporaryDir dir;
+      QVERIFY( dir.isValid() );
+
+      // a project with a hidden layer, a visible layer and a hidden layer with a missing data source
+      QgsProject project;
+      QStringList layerIds;
+      for ( int i = 0; i < 3; ++i )
+      {
+        const QString path = dir.filePath( QStringLiteral( "layer%1.geojson" ).arg( i ) );
+        if ( i < 2 )
+        {
+          QFile file( path );
+          QVERIFY( file.open( QIODevice::WriteOnly ) );
+          file.write( "{\"type\": \"FeatureCollection\", \"features\": [{\"type\": \"Feature\", \"properties\": {}, \"geometry\": {\"type\": \"Point\", \"coordinates\": [7.4, 46.9]}}]}" );
+        }
+
+        QgsVectorLayer *layer = new QgsVectorLayer( path, QStringLiteral( "layer%1" ).arg( i ), QStringLiteral( "ogr" ) );
+        project.addMapLayer( layer );
+        layerIds << layer->id();
+        if ( i != 1 )
+          project.layerTreeRoot()->findLayer( layer->id() )->setItemVisibilityChecked( false );
+      }
+      QVERIFY( project.write( dir.filePath( QStringLiteral( "project.qgs" ) ) ) );
+
+      QgsProject readProject;
+      BadLayerHandler badLayerHandler;
+      badLayerHandler.setProject( &readProject );
+      QVERIFY( readProject.read( dir.filePath( QStringLiteral( "project.qgs" ) ), QgsProject::FlagDontResolveLayers ) );
+      QCOMPARE( readProject.mapLayers().count(), 3 );
+      QVERIFY( !readProject.mapLayer( layerIds.at( 0 ) )->isValid() );
+      // the project does not report the layers it has not resolved
+      QCOMPARE( badLayerHandler.rowCount(), 0 );
+
+      // the visible layers are taken from the layer tree
+      const QList<QgsMapLayer *> visibleLayers = LayerResolver::visibleLayers( &readProject );
+      QCOMPARE( visibleLayers.count(), 1 );
+      QCOMPARE( visibleLayers.first()->id(), layerIds.at( 1 ) );
+
+      LayerResolver resolver( &readProject );
+      QSignalSpy finishedSpy( &resolver, &LayerResolver::finished );
+      QSignalSpy progressSpy( &resolver, &LayerResolver::progress );
+
+      // the visible layer is resolved before the first one of the project
+      bool visibleLayerValid = false;
+      bool firstLayerValid = true;
+      connect( &resolver, &LayerResolver::visibleLayersResolved, this, [&]
+      {
+        visibleLayerValid = readProject.mapLayer( layerIds.at( 1 ) )->isValid();
+        firstLayerValid = readProject.mapLayer( layerIds.at( 0 ) )->isValid();
+      } );
+
+      resolver.resolve( visibleLayers );
+      QVERIFY( resolver.isRunning() );
+      QCOMPARE( resolver.layerCount(), 3 );
+
+      QVERIFY( finishedSpy.wait( 5000 ) );
+      QVERIFY( visibleLayerValid );
+      QVERIFY( !firstLayerValid );
+      QCOMPARE( progressSpy.count(), 3 );
+      QCOMPARE( progressSpy.last().at( 0 ).toInt(), 3 );
+      QCOMPARE( progressSpy.last().at( 1 ).toInt(), 3 );
+      QCOMPARE( resolver.resolvedCount(), 3 );
+      QVERIFY( !resolver.isRunning() );
+
+      QVERIFY( readProject.mapLayer( layerIds.at( 0 ) )->isValid() );
+      QVERIFY( readProject.mapLayer( layerIds.at( 1 ) )->isValid() );
+      QVERIFY( qobject_cast<QgsVectorLayer *>( readProject.mapLayer( layerIds.at( 1 ) ) )->featureCount() == 1 );
+
+      // the missing data source stays invalid and reaches the bad layer handler
+      QVERIFY( !readProject.mapLayer( layerIds.at( 2 ) )->isValid() );
+      const QList<QgsMapLayer *> invalidLayers = resolver.invalidLayers();
+      QCOMPARE( invalidLayers.count(), 1 );
+      QCOMPARE( invalidLayers.first()->id(), layerIds.at( 2 ) );
+
+      QSignalSpy badLayersSpy( &badLayerHandler, &BadLayerHandler::badLayersFound );
+      badLayerHandler.handleInvalidLayers( invalidLayers );
+      QCOMPARE( badLayersSpy.count(), 1 );
+      QCOMPARE( badLayerHandler.rowCount(), 1 );
+      QCOMPARE( badLayerHandler.index( 0, 0 ).data( BadLayerHandler::LayerNameRole ).toString(), QStringLiteral( "layer2" ) );
+      QCOMPARE( badLayerHandler.index( 0, 0 ).data( BadLayerHandler::DataSourceRole ).toString(), dir.filePath( QStringLiteral( "layer2.geojson" ) ) );
+#endif
+    }
+
+    void testCancel()
+    {
+      QgsProject project;
+      project.addMapLayer( new QgsVectorLayer( QStringLiteral( "/nonexistent/layer.geojson" ), QStringLiteral( "layer" ), QStringLiteral( "ogr" ) ) );
+
+      LayerResolver resolver( &project );
+      QSignalSpy finishedSpy( &resolver, &LayerResolver::finished );
+
+      resolver.resolve( QList<QgsMapLayer *>() );
+      QCOMPARE( resolver.layerCount(), 1 );
+      resolver.cancel();
+      QVERIFY( !resolver.isRunning() );
+      QCOMPARE( resolver.resolvedCount(), 0 );
+      QCOMPARE( resolver.layerCount(), 0 );
+      QVERIFY( !finishedSpy.wait( 500 ) );
+    }
+};
+
+QFIELDTEST_MAIN( TestLayerResolver )
+#include "test_layerresolver.moc"
@@ -0,0 +1,183 @@
+/***************************************************************************
+                        test_multifeaturehighlight.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QSGGeometryNode>
+#include <QStandardItemModel>
+
+#include "qfield_testbase.h"
+
+#include "coordinatetransformcache.h"
+#include "multifeaturehighlight.h"
+#include "polygontriangulator.h"
+#include "qgsquickmapsettings.h"
+
+#include <qgsgeometry.h>
+
+static const int GEOMETRY_ROLE = Qt::UserRole + 1;
+static const int CRS_ROLE = Qt::UserRole + 2;
+static const int SELECTED_ROLE = Qt::UserRole + 3;
+
+//! the vertices of a point marker, a fill triangle and a border quad per segment
+static const int MARKER_VERTEX_COUNT = 16 * 9;
+
+
+class TestMultiFeatureHighlight: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void init()
+    {
+      mCrs = QgsCoordinateReferenceSystem::fromEpsgId( 2056 );
+
+      mMapSettings.reset( new QgsQuickMapSettings() );
+      mMapSettings->setDestinationCrs( mCrs );
+      mMapSettings->setOutputSize( QSize( 100, 100 ) );
+      mMapSettings->setExtent( QgsRectangle( 2600000, 1200000, 2600100, 1200100 ) );
+
+      mModel.reset( new QStandardItemModel() );
+      mModel->setItemRoleNames( { { GEOMETRY_ROLE, QByteArrayLiteral( "geometry" ) }, { CRS_ROLE, QByteArrayLiteral( "crs" ) }, { SELECTED_ROLE, QByteArrayLiteral( "featureSelected" ) } } );
+      appendRow( QStringLiteral( "Polygon ((2600010 1200010, 2600020 1200010, 2600020 1200020, 2600010 1200020, 2600010 1200010))" ) );
+      appendRow( QStringLiteral( "LineString (2600030 1200030, 2600040 1200040, 2600050 1200030)" ) );
+      appendRow( QStringLiteral( "Point (2600060 1200060)" ) );
+
+      mHighlight.reset( new MultiFeatureHighlight() );
+      mHighlight->setModel( mModel.get() );
+      mHighlight->setMapSettings( mMapSettings.get() );
+      mHighlight->setColor( QColor( 255, 255, 0 ) );
+      mHighlight->setSelectedColor( QColor( 0, 255, 0 ) );
+      mHighlight->setFocusedColor( QColor( 255, 0, 0 ) );
+    }
+
+    void testBuffers()
+    {
+      mHighlight->updatePolish();
+
+      // the two triangles of the square, its four sides and the two segments of the line
+      QCOMPARE( mHighlight->mFillVertices.size(), 6 );
+      QCOMPARE( mHighlight->mLineVertices.size(), 8 + 4 );
+      QCOMPARE( mHighlight->mMarkerVertices.size(), MARKER_VERTEX_COUNT );
+
+      // the fills are translucent
+      const QSGGeometry::ColoredPoint2D &fill = mHighlight->mFillVertices.at( 0 );
+      QCOMPARE( fill.a, static_cast<uchar>( 127 ) );
+      const QSGGeometry::ColoredPoint2D &line = mHighlight->mLineVertices.at( 0 );
+      QCOMPARE( line.r, static_cast<uchar>( 255 ) );
+      QCOMPARE( line.g, static_cast<uchar>( 255 ) );
+      QCOMPARE( line.a, static_cast<uchar>( 255 ) );
+    }
+
+    void testPointMarker()
+    {
+      mHighlight->setPointSize( 20 );
+      mHighlight->setPointBorderColor( QColor( 255, 255, 255 ) );
+      mHighlight->updatePolish();
+
+      // the marker is centered on the point, the border is drawn within its diameter
+      const double mapUnitsPerPoint = mMapSettings->mapUnitsPerPoint();
+      const QSGGeometry::ColoredPoint2D *marker = mHighlight->mMarkerVertices.constData();
+      QCOMPARE( marker[0].x, 2600060.0f );
+      QCOMPARE( marker[0].y, 1200060.0f );
+      QCOMPARE( marker[1].x, static_cast<float>( 2600060 + 8 * mapUnitsPerPoint ) );
+      QCOMPARE( marker[4].x, static_cast<float>( 2600060 + 10 * mapUnitsPerPoint ) );
+      QCOMPARE( marker[0].b, static_cast<uchar>( 0 ) );
+      QCOMPARE( marker[4].b, static_cast<uchar>( 255 ) );
+
+      // the size of the markers follows the scale
+      mMapSettings->setExtent( QgsRectangle( 2600000, 1200000, 2600200, 1200200 ) );
+      mHighlight->updatePolish();
+      QCOMPARE( mHighlight->mMarkerVertices.at( 4 ).x, static_cast<float>( 2600060 + 10 * mMapSettings->mapUnitsPerPoint() ) );
+    }
+
+    void testColors()
+    {
+      mModel->item( 1 )->setData( true, SELECTED_ROLE );
+      mHighlight->setFocusedRow( 2 );
+      mHighlight->updatePolish();
+
+      // the line is selected, the point is focused
+      const QSGGeometry::ColoredPoint2D &square = mHighlight->mLineVertices.at( 0 );
+      QCOMPARE( square.r, static_cast<uchar>( 255 ) );
+      QCOMPARE( square.g, static_cast<uchar>( 255 ) );
+      const QSGGeometry::ColoredPoint2D &line = mHighlight->mLineVertices.at( 8 );
+      QCOMPARE( line.r, static_cast<uchar>( 0 ) );
+      QCOMPARE( line.g, static_cast<uchar>( 255 ) );
+      const QSGGeometry::ColoredPoint2D &point = mHighlight->mMarkerVertices.at( 0 );
+      QCOMPARE( point.r, static_cast<uchar>( 255 ) );
+      QCOMPARE( point.g, static_cast<uchar>( 0 ) );
+    }
+
+    void testRowsChanged()
+    {
+      mHighlight->updatePolish();
+
+      mModel->removeRow( 1 );
+      mHighlight->updatePolish();
+      QCOMPARE( mHighlight->mLineVertices.size(), 8 );
+
+      appendRow( QStringLiteral( "MultiPoint ((2600070 1200070), (2600080 1200080))" ) );
+      mHighlight->updatePolish();
+      QCOMPARE( mHighlight->mMarkerVertices.size(), 3 * MARKER_VERTEX_COUNT );
+
+      mModel->item( 0 )->setData( QVariant::fromValue( QgsGeometry::fromWkt( QStringLiteral( "LineString (2600010 1200010, 2600020 1200010)" ) ) ), GEOMETRY_ROLE );
+      mHighlight->updatePolish();
+      QCOMPARE( mHighlight->mFillVertices.size(), 0 );
+      QCOMPARE( mHighlight->mLineVertices.size(), 2 );
+    }
+
+    void testTriangulationCache()
+    {
+      mHighlight->updatePolish();
+
+      // the triangles are shared with the cache of the triangulator instead of being computed again
+      const QgsGeometry geometry = mModel->item( 0 )->data( GEOMETRY_ROLE ).value<QgsGeometry>();
+      const QgsCoordinateTransform transform = CoordinateTransformCache::instance()->transform( mCrs, mCrs );
+      const PolygonTriangulator::Triangulation triangulation = PolygonTriangulator::instance()->triangulation( geometry, transform );
+      QCOMPARE( mHighlight->mRows.at( 0 ).triangles.constData(), triangulation.triangles.constData() );
+    }
+
+    void testPaintNode()
+    {
+      mHighlight->updatePolish();
+
+      // the render thread only copies the merged buffers
+      std::unique_ptr<QSGNode> node( mHighlight->updatePaintNode( nullptr, nullptr ) );
+      QCOMPARE( node->childCount(), 3 );
+      QCOMPARE( static_cast<QSGGeometryNode *>( node->childAtIndex( 0 ) )->geometry()->vertexCount(), 6 );
+      QCOMPARE( static_cast<QSGGeometryNode *>( node->childAtIndex( 1 ) )->geometry()->vertexCount(), 12 );
+      QCOMPARE( static_cast<QSGGeometryNode *>( node->childAtIndex( 2 ) )->geometry()->vertexCount(), MARKER_VERTEX_COUNT );
+      QVERIFY( !mHighlight->mBuffersChanged );
+    }
+
+  private:
+    void appendRow( const QString &wkt )
+    {
+      QStandardItem *item = new QStandardItem();
+      item->setData( QVariant::fromValue( QgsGeometry::fromWkt( wkt ) ), GEOMETRY_ROLE );
+      item->setData( QVariant::fromValue( mCrs ), CRS_ROLE );
+      item->setData( false, SELECTED_ROLE );
+      mModel->appendRow( item );
+    }
+
+    QgsCoordinateReferenceSystem mCrs;
+    std::unique_ptr<QgsQuickMapSettings> mMapSettings;
+    std::unique_ptr<QStandardItemModel> mModel;
+    std::unique_ptr<MultiFeatureHighlight> mHighlight;
+};
+
+QFIELDTEST_MAIN( TestMultiFeatureHighlight )
+#include "test_multifeaturehighlight.moc"
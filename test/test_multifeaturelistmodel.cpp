@@ -0,0 +1,185 @@
+/***************************************************************************
+                        test_multifeaturelistmodel.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "qfield_testbase.h"
+
+#include "multifeaturelistmodelbase.h"
+
+#include <qgsconfig.h>
+#include <qgsproject.h>
+#include <qgsrelationmanager.h>
+#include <qgsvectorlayer.h>
+#if VERSION_INT >= 31000
+#include <qgsabstractdatabaseproviderconnection.h>
+#include <qgsproviderregistry.h>
+#include <qgsprovidermetadata.h>
+#include <qgsvectorfilewriter.h>
+#endif
+
+
+class TestMultiFeatureListModel: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void init()
+    {
+      /* TEST LAYERS
+      *
+      * parent (id)
+      * - 1
+      * - 2
+      *
+      * child (id, parent_id)
+      * - 1 1
+      * - 2 1
+      * - 3 2
+      *
+      * RELATIONS
+      * - child.parent (child m--1 parent), a composition
+      */
+      mParent = new QgsVectorLayer( QStringLiteral( "None?field=id:integer" ), QStringLiteral( "parent" ), QStringLiteral( "memory" ) );
+      mChild = new QgsVectorLayer( QStringLiteral( "None?field=id:integer&field=parent_id:integer" ), QStringLiteral( "child" ), QStringLiteral( "memory" ) );
+      QVERIFY( mParent->isValid() );
+      QVERIFY( mChild->isValid() );
+      populate( mParent, mChild );
+      addLayers( mParent, mChild );
+    }
+
+    void cleanup()
+    {
+      QgsProject::instance()->relationManager()->clear();
+      QgsProject::instance()->removeAllMapLayers();
+    }
+
+    void testDeleteFeatures()
+    {
+      MultiFeatureListModelBase model;
+      QVERIFY( model.deleteFeature( mParent, featureId( mParent, 1 ) ) );
+
+      QCOMPARE( mParent->featureCount(), 1L );
+      QCOMPARE( mChild->featureCount(), 1L );
+      QVERIFY( !mParent->isEditable() );
+      QVERIFY( !mChild->isEditable() );
+    }
+
+    void testDeleteFeaturesFailure()
+    {
+      // deleting the second, not existing, feature fails after the children have been deleted in the edit buffer
+      MultiFeatureListModelBase model;
+      QVERIFY( !model.deleteFeatures( mParent, QgsFeatureIds() << featureId( mParent, 1 ) << -42 ) );
+
+      // the children must not have been committed
+      QCOMPARE( mParent->featureCount(), 2L );
+      QCOMPARE( mChild->featureCount(), 3L );
+      QVERIFY( !mParent->isEditable() );
+      QVERIFY( !mChild->isEditable() );
+    }
+
+    void testDeleteFeaturesTransactionFailure()
+    {
+#if VERSION_INT < 31000
+      QSKIP( "Executing SQL on a GeoPackage requires QGIS 3.10" );
+#else
+      QTemporaryDir dir;
+      QVERIFY( dir.isValid() );
+      const QString path = dir.filePath( QStringLiteral( "data.gpkg" ) );
+
+      QgsVectorFileWriter::SaveVectorOptions options;
+      options.driverName = QStringLiteral( "GPKG" );
+      options.layerName = QStringLiteral( "parent" );
+      QCOMPARE( QgsVectorFileWriter::writeAsVectorFormatV2( mParent, path, QgsProject::instance()->transformContext(), options ), QgsVectorFileWriter::NoError );
+      options.layerName = QStringLiteral( "child" );
+      options.actionOnExistingFile = QgsVectorFileWriter::CreateOrOverwriteLayer;
+      QCOMPARE( QgsVectorFileWriter::writeAsVectorFormatV2( mChild, path, QgsProject::instance()->transformContext(), options ), QgsVectorFileWriter::NoError );
+
+      // the parents cannot be deleted, which is only noticed after the children have been deleted
+      std::unique_ptr<QgsAbstractDatabaseProviderConnection> connection( static_cast<QgsAbstractDatabaseProviderConnection *>( QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "ogr" ) )->createConnection( path, QVariantMap() ) ) );
+      connection->executeSql( QStringLiteral( "CREATE TRIGGER parent_locked BEFORE DELETE ON parent BEGIN SELECT RAISE(ABORT, 'locked'); END" ) );
+
+      cleanup();
+      QgsVectorLayer *parent = new QgsVectorLayer( QStringLiteral( "%1|layername=parent" ).arg( path ), QStringLiteral( "parent" ), QStringLiteral( "ogr" ) );
+      QgsVectorLayer *child = new QgsVectorLayer( QStringLiteral( "%1|layername=child" ).arg( path ), QStringLiteral( "child" ), QStringLiteral( "ogr" ) );
+      QVERIFY( parent->isValid() );
+      QVERIFY( child->isValid() );
+      addLayers( parent, child );
+
+      MultiFeatureListModelBase model;
+      QVERIFY( !model.deleteFeature( parent, featureId( parent, 1 ) ) );
+
+      // the shared transaction has brought back the deleted children
+      QCOMPARE( parent->featureCount(), 2L );
+      QCOMPARE( child->featureCount(), 3L );
+      QVERIFY( !parent->isEditable() );
+      QVERIFY( !child->isEditable() );
+#endif
+    }
+
+  private:
+    void populate( QgsVectorLayer *parent, QgsVectorLayer *child )
+    {
+      parent->startEditing();
+      for ( int id : { 1, 2 } )
+      {
+        QgsFeature feature( parent->fields() );
+        feature.setAttribute( QStringLiteral( "id" ), id );
+        parent->addFeature( feature );
+      }
+      QVERIFY( parent->commitChanges() );
+
+      child->startEditing();
+      const QList<QPair<int, int>> children { { 1, 1 }, { 2, 1 }, { 3, 2 } };
+      for ( const auto &pair : children )
+      {
+        QgsFeature feature( child->fields() );
+        feature.setAttribute( QStringLiteral( "id" ), pair.first );
+        feature.setAttribute( QStringLiteral( "parent_id" ), pair.second );
+        child->addFeature( feature );
+      }
+      QVERIFY( child->commitChanges() );
+    }
+
+    void addLayers( QgsVectorLayer *parent, QgsVectorLayer *child )
+    {
+      QgsProject::instance()->addMapLayers( QList<QgsMapLayer *>() << parent << child );
+
+      QgsRelation relation;
+      relation.setId( QStringLiteral( "child.parent" ) );
+      relation.setName( QStringLiteral( "child.parent" ) );
+      relation.setReferencingLayer( child->id() );
+      relation.setReferencedLayer( parent->id() );
+      relation.addFieldPair( QStringLiteral( "parent_id" ), QStringLiteral( "id" ) );
+      relation.setStrength( QgsRelation::Composition );
+      QVERIFY( relation.isValid() );
+      QgsProject::instance()->relationManager()->addRelation( relation );
+    }
+
+    QgsFeatureId featureId( QgsVectorLayer *layer, int id )
+    {
+      QgsFeature feature;
+      layer->getFeatures( QgsFeatureRequest().setFilterExpression( QStringLiteral( "id = %1" ).arg( id ) ) ).nextFeature( feature );
+      return feature.id();
+    }
+
+    QgsVectorLayer *mParent = nullptr;
+    QgsVectorLayer *mChild = nullptr;
+};
+
+QFIELDTEST_MAIN( TestMultiFeatureListModel )
+#include "test_multifeaturelistmodel.moc"
@@ -0,0 +1,183 @@
+/***************************************************************************
+                        test_nmeareplaypositionsource.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "qfield_testbase.h"
+
+#include "nmeareplaypositionsource.h"
+#include "gnsspositionpipeline.h"
+
+
+class TestNmeaReplayPositionSource: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void testParseGga()
+    {
+      QGeoPositionInfo info;
+      QVERIFY( NmeaReplayPositionSource::parseSentence( "$GPGGA,123519.00,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,*69", info ) );
+      QCOMPARE( info.coordinate().latitude(), 48.1173 );
+      QCOMPARE( info.coordinate().longitude(), 11.0 + 31.0 / 60 );
+      QCOMPARE( info.coordinate().altitude(), 545.4 );
+      QCOMPARE( info.timestamp().time(), QTime( 12, 35, 19 ) );
+    }
+
+    void testParseRmc()
+    {
+      QGeoPositionInfo info;
+      QVERIFY( NmeaReplayPositionSource::parseSentence( "$GPRMC,123519.00,A,4807.0380,N,01131.0000,E,022.4,084.4,230394,003.1,W*44", info ) );
+      QCOMPARE( info.timestamp(), QDateTime( QDate( 1994, 3, 23 ), QTime( 12, 35, 19 ), Qt::UTC ) );
+      QVERIFY( info.hasAttribute( QGeoPositionInfo::GroundSpeed ) );
+      QVERIFY( qgsDoubleNear( info.attribute( QGeoPositionInfo::GroundSpeed ), 22.4 * 0.514444, 1e-6 ) );
+      QCOMPARE( info.attribute( QGeoPositionInfo::Direction ), 84.4 );
+    }
+
+    void testParseGst()
+    {
+      QGeoPositionInfo info;
+      QVERIFY( NmeaReplayPositionSource::parseSentence( "$GPGST,123519.00,0.8,1.2,0.9,12.0,0.3,0.4,0.5*69", info ) );
+      QCOMPARE( info.attribute( QGeoPositionInfo::HorizontalAccuracy ), 0.5 );
+      QCOMPARE( info.attribute( QGeoPositionInfo::VerticalAccuracy ), 0.5 );
+    }
+
+    void testParseInvalid()
+    {
+      QGeoPositionInfo info;
+      // wrong checksum
+      QVERIFY( !NmeaReplayPositionSource::parseSentence( "$GPGGA,123519.00,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,*68", info ) );
+      // no fix
+      QVERIFY( !NmeaReplayPositionSource::parseSentence( "$GPGGA,123519.00,4807.0380,N,01131.0000,E,0,00,,,M,,M,,*7C", info ) );
+      QVERIFY( !NmeaReplayPositionSource::parseSentence( "garbage", info ) );
+      QVERIFY( !info.isValid() );
+    }
+
+    void testReplay()
+    {
+      const int epochCount = 500;
+      const QTime startTime( 10, 0 );
+      QTemporaryFile file;
+      writeLog( file, epochCount );
+
+      NmeaReplayPositionSource source( file.fileName() );
+      source.setReplaySpeed( 0 );
+      source.setStopAtEnd( true );
+
+      QList<QGeoPositionInfo> positions;
+      connect( &source, &QGeoPositionInfoSource::positionUpdated, this, [&positions]( const QGeoPositionInfo & info ) { positions << info; } );
+      QSignalSpy finishedSpy( &source, &NmeaReplayPositionSource::replayFinished );
+
+      source.startUpdates();
+      // 50 seconds of 10 Hz positions are not replayed in real time
+      QVERIFY( finishedSpy.wait( 5000 ) );
+
+      // the GGA and RMC sentences of an epoch are merged into one position, in the order of the log
+      QCOMPARE( positions.count(), epochCount );
+      for ( int i = 1; i < positions.count(); ++i )
+        QVERIFY( positions.at( i - 1 ).timestamp() < positions.at( i ).timestamp() );
+      QCOMPARE( positions.first().timestamp(), QDateTime( QDate( 2020, 10, 19 ), startTime, Qt::UTC ) );
+      QCOMPARE( positions.last().timestamp(), QDateTime( QDate( 2020, 10, 19 ), startTime.addMSecs( ( epochCount - 1 ) * 100 ), Qt::UTC ) );
+      QCOMPARE( positions.last().coordinate().altitude(), 545.4 );
+      QVERIFY( positions.last().hasAttribute( QGeoPositionInfo::GroundSpeed ) );
+    }
+
+    void testPipelineBatches()
+    {
+      const int epochCount = 500;
+      QTemporaryFile file;
+      writeLog( file, epochCount );
+
+      GnssPositionPipeline pipeline;
+      pipeline.setDestinationCrs( QgsCoordinateReferenceSystem::fromEpsgId( 3857 ) );
+      pipeline.setReplaySpeed( 0 );
+      pipeline.setReplayFile( file.fileName() );
+
+      QList<QDateTime> timestamps;
+      int deliveryCount = 0;
+      connect( &pipeline, &GnssPositionPipeline::samplesReceived, this, [&timestamps, &deliveryCount]( const QList<PositionSample> &samples ) {
+        for ( const PositionSample &sample : samples )
+          timestamps << sample.info.timestamp();
+        deliveryCount++;
+      } );
+
+      pipeline.setActive( true );
+      QTRY_VERIFY_WITH_TIMEOUT( timestamps.count() >= epochCount, 5000 );
+      pipeline.setActive( false );
+
+      // all the samples reach the UI thread once and in order, the burst in far fewer deliveries
+      const int sampleCount = timestamps.count();
+      QCOMPARE( sampleCount, epochCount );
+      for ( int i = 1; i < sampleCount; ++i )
+        QVERIFY( timestamps.at( i - 1 ) < timestamps.at( i ) );
+      QVERIFY( deliveryCount < sampleCount / 10 );
+      QCOMPARE( pipeline.deliveryInterval(), 16 );
+      QCOMPARE( pipeline.sampleCount(), sampleCount );
+      QVERIFY( pipeline.projectedPosition().x() > 1280000 );
+    }
+
+    void testTransformPosition()
+    {
+      QGeoPositionInfo info;
+      info.setCoordinate( QGeoCoordinate( 46.9483, 7.44225 ) );
+      const QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromEpsgId( 4326 ), QgsCoordinateReferenceSystem::fromEpsgId( 4326 ), QgsCoordinateTransformContext() );
+
+      // a missing altitude must not turn the position into NaN
+      const QgsPoint point = GnssPositionPipeline::transformPosition( info, transform, 1.5, false );
+      QCOMPARE( point.x(), 7.44225 );
+      QCOMPARE( point.y(), 46.9483 );
+      QCOMPARE( point.z(), 1.5 );
+    }
+
+    void benchmarkParseSentence()
+    {
+      QBENCHMARK
+      {
+        QGeoPositionInfo info;
+        NmeaReplayPositionSource::parseSentence( "$GPGGA,123519.00,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,*69", info );
+        NmeaReplayPositionSource::parseSentence( "$GPRMC,123519.00,A,4807.0380,N,01131.0000,E,022.4,084.4,230394,003.1,W*44", info );
+      }
+    }
+
+  private:
+    //! Writes a 10 Hz NMEA log with \a epochCount epochs to \a file
+    void writeLog( QTemporaryFile &file, int epochCount ) const
+    {
+      QVERIFY( file.open() );
+      const QTime startTime( 10, 0 );
+      for ( int i = 0; i < epochCount; ++i )
+      {
+        const QByteArray time = startTime.addMSecs( i * 100 ).toString( QStringLiteral( "hhmmss.zzz" ) ).left( 9 ).toLatin1();
+        file.write( sentence( "GPGGA," + time + ",4807.0380,N,01131." + QByteArray::number( 1000 + i ) + ",E,1,08,0.9,545.4,M,46.9,M,," ) + "\r\n" );
+        file.write( sentence( "GPRMC," + time + ",A,4807.0380,N,01131." + QByteArray::number( 1000 + i ) + ",E,022.4,084.4,191020,003.1,W" ) + "\r\n" );
+      }
+      file.close();
+    }
+
+    //! Returns the NMEA sentence with the given \a body and its checksum
+    QByteArray sentence( const QByteArray &body ) const
+    {
+      quint8 checksum = 0;
+      for ( const char c : body )
+        checksum ^= static_cast<quint8>( c );
+
+      return '$' + body + '*' + QByteArray::number( checksum, 16 ).rightJustified( 2, '0' ).toUpper();
+    }
+};
+
+QFIELDTEST_MAIN( TestNmeaReplayPositionSource )
+#include "test_nmeareplaypositionsource.moc"
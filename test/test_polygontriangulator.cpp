@@ -0,0 +1,287 @@
+/***************************************************************************
+                        test_polygontriangulator.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "polygontriangulator.h"
+
+#include <qgsconfig.h>
+#include <qgsfeatureiterator.h>
+#include <qgslinestring.h>
+#include <qgspolygon.h>
+#include <qgsvectorlayer.h>
+
+#include <cmath>
+
+
+class TestPolygonTriangulator: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void testHoles()
+    {
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 4 2, 4 4, 2 4, 2 2), (6 6, 8 6, 8 8, 6 8, 6 6))" ) );
+      const QVector<QSGGeometry::Point2D> triangles = PolygonTriangulator::triangulate( polygon.constGet() );
+
+      QCOMPARE( triangles.size() % 3, 0 );
+      // the holes are left empty
+      QVERIFY( qgsDoubleNear( trianglesArea( triangles ), 92.0, 1e-6 ) );
+      for ( int i = 0; i < triangles.size(); i += 3 )
+      {
+        const QgsPointXY centroid( ( triangles.at( i ).x + triangles.at( i + 1 ).x + triangles.at( i + 2 ).x ) / 3.0,
+                                   ( triangles.at( i ).y + triangles.at( i + 1 ).y + triangles.at( i + 2 ).y ) / 3.0 );
+        QVERIFY( polygon.contains( &centroid ) );
+      }
+    }
+
+    void testMultiPolygon()
+    {
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "MultiPolygon (((0 0, 2 0, 2 2, 0 2, 0 0)),((5 5, 8 5, 8 8, 5 5)))" ) );
+      QVERIFY( qgsDoubleNear( trianglesArea( PolygonTriangulator::triangulate( polygon.constGet() ) ), 8.5, 1e-6 ) );
+    }
+
+    void testRing()
+    {
+      const QVector<double> x { 0, 4, 4, 0, 0 };
+      const QVector<double> y { 0, 0, 3, 3, 0 };
+      QVERIFY( qgsDoubleNear( trianglesArea( PolygonTriangulator::triangulate( x, y ) ), 12.0, 1e-6 ) );
+    }
+
+    void testCache()
+    {
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((2600000 1200000, 2600100 1200000, 2600100 1200100, 2600000 1200000))" ) );
+      const QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateTransformContext() );
+
+      PolygonTriangulator::instance()->clear();
+      const PolygonTriangulator::Triangulation triangulation = PolygonTriangulator::instance()->triangulation( polygon, transform );
+      QCOMPARE( triangulation.triangles.size(), 3 );
+
+      // the same geometry gets the same triangles, without copying them
+      const PolygonTriangulator::Triangulation cached = PolygonTriangulator::instance()->triangulation( QgsGeometry( polygon ), transform );
+      QCOMPARE( cached.triangles.constData(), triangulation.triangles.constData() );
+
+      // another geometry with the same content is triangulated again
+      const QgsGeometry other = QgsGeometry::fromWkt( polygon.asWkt() );
+      QVERIFY( PolygonTriangulator::instance()->triangulation( other, transform ).triangles.constData() != triangulation.triangles.constData() );
+    }
+
+    void testCacheCoordinateOperation()
+    {
+#if VERSION_INT < 30800
+      QSKIP( "Coordinate operations require QGIS 3.8" );
+#else
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((2600000 1200000, 2600100 1200000, 2600100 1200100, 2600000 1200000))" ) );
+      const QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateTransformContext() );
+
+      PolygonTriangulator::instance()->clear();
+      const PolygonTriangulator::Triangulation triangulation = PolygonTriangulator::instance()->triangulation( polygon, transform );
+
+      // a transform context choosing another operation between the same crs is not served from the cache
+      QgsCoordinateTransform otherTransform = transform;
+      otherTransform.setCoordinateOperation( QStringLiteral( "+proj=noop" ) );
+      QVERIFY( PolygonTriangulator::instance()->triangulation( polygon, otherTransform ).triangles.constData() != triangulation.triangles.constData() );
+      QCOMPARE( PolygonTriangulator::instance()->triangulation( polygon, transform ).triangles.constData(), triangulation.triangles.constData() );
+#endif
+    }
+
+    void testLevelsOfDetail()
+    {
+      QgsPolygon *polygon = new QgsPolygon();
+      polygon->setExteriorRing( ring( 2600000, 1200000, 1000, 10000 ) );
+      const QgsGeometry geometry( polygon );
+      const QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateReferenceSystem::fromEpsgId( 2056 ), QgsCoordinateTransformContext() );
+
+      PolygonTriangulator::instance()->clear();
+      const PolygonTriangulator::Triangulation full = PolygonTriangulator::instance()->triangulation( geometry, transform );
+      const PolygonTriangulator::Triangulation coarse = PolygonTriangulator::instance()->triangulation( geometry, transform, 64 );
+
+      // fewer vertices, but the same shape within the tolerance
+      QVERIFY( coarse.geometry.constGet()->nCoordinates() < full.geometry.constGet()->nCoordinates() / 10 );
+      QVERIFY( coarse.triangles.size() < full.triangles.size() / 10 );
+      QVERIFY( qgsDoubleNear( trianglesArea( coarse.triangles ), geometry.area(), geometry.area() * 0.01 ) );
+
+      // each level of detail is cached
+      QCOMPARE( PolygonTriangulator::instance()->triangulation( geometry, transform, 64 ).triangles.constData(), coarse.triangles.constData() );
+      QCOMPARE( PolygonTriangulator::instance()->triangulation( geometry, transform ).triangles.constData(), full.triangles.constData() );
+    }
+
+    void testEngines_data()
+    {
+      QTest::addColumn<int>( "engine" );
+
+      QTest::newRow( "tessellate" ) << static_cast<int>( PolygonTriangulator::Tessellate );
+      QTest::newRow( "earcut" ) << static_cast<int>( PolygonTriangulator::Earcut );
+    }
+
+    void testEngines()
+    {
+      QFETCH( int, engine );
+      EngineScope scope( static_cast<PolygonTriangulator::Engine>( engine ) );
+
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "MultiPolygon (((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 4 2, 4 4, 2 4, 2 2), (6 6, 8 6, 8 8, 6 8, 6 6)),((20 0, 23 0, 23 3, 20 0)))" ) );
+      QVERIFY( qgsDoubleNear( trianglesArea( PolygonTriangulator::triangulate( polygon.constGet() ) ), 96.5, 1e-6 ) );
+
+      // a hole touching the exterior ring
+      const QgsGeometry touching = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0), (0 5, 3 4, 3 6, 0 5))" ) );
+      QVERIFY( qgsDoubleNear( trianglesArea( PolygonTriangulator::triangulate( touching.constGet() ) ), 97.0, 1e-6 ) );
+
+      // a large ring, triangulated along the z-order curve by earcut
+      QgsPolygon *circle = new QgsPolygon();
+      circle->setExteriorRing( ring( 0, 0, 100, 500 ) );
+      circle->addInteriorRing( ring( 0, 0, 50, 500 ) );
+      const QgsGeometry annulus( circle );
+      QVERIFY( qgsDoubleNear( trianglesArea( PolygonTriangulator::triangulate( annulus.constGet() ) ), annulus.area(), annulus.area() * 1e-5 ) );
+    }
+
+    void testSetEngine()
+    {
+      const QgsGeometry polygon = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((0 0, 1 0, 1 1, 0 0))" ) );
+      const QgsCoordinateTransform transform;
+
+      EngineScope scope( PolygonTriangulator::Tessellate );
+      const PolygonTriangulator::Triangulation triangulation = PolygonTriangulator::instance()->triangulation( polygon, transform );
+
+      // switching the engine drops the cached triangulations
+      PolygonTriangulator::setEngine( PolygonTriangulator::Earcut );
+      QCOMPARE( PolygonTriangulator::engine(), PolygonTriangulator::Earcut );
+      QVERIFY( PolygonTriangulator::instance()->triangulation( polygon, transform ).triangles.constData() != triangulation.triangles.constData() );
+    }
+
+    void benchmarkTriangulate_data()
+    {
+      QTest::addColumn<int>( "engine" );
+      QTest::addColumn<int>( "ringPointCount" );
+      QTest::addColumn<int>( "holeCount" );
+
+      const QList<QPair<int, int>> sizes { { 5, 0 }, { 50, 0 }, { 500, 0 }, { 5000, 0 }, { 200, 4 }, { 2000, 100 } };
+      for ( const QPair<int, int> &size : sizes )
+      {
+        QTest::addRow( "tessellate %d points %d holes", size.first, size.second ) << static_cast<int>( PolygonTriangulator::Tessellate ) << size.first << size.second;
+        QTest::addRow( "earcut %d points %d holes", size.first, size.second ) << static_cast<int>( PolygonTriangulator::Earcut ) << size.first << size.second;
+      }
+    }
+
+    void benchmarkTriangulate()
+    {
+      QFETCH( int, engine );
+      QFETCH( int, ringPointCount );
+      QFETCH( int, holeCount );
+      EngineScope scope( static_cast<PolygonTriangulator::Engine>( engine ) );
+
+      // a circle with a grid of holes
+      QgsPolygon *polygon = new QgsPolygon();
+      polygon->setExteriorRing( ring( 0, 0, 1000, ringPointCount ) );
+      const int columns = static_cast<int>( std::ceil( std::sqrt( holeCount ) ) );
+      for ( int i = 0; i < holeCount; ++i )
+        polygon->addInteriorRing( ring( -450 + ( i % columns ) * 900.0 / columns, -450 + ( i / columns ) * 900.0 / columns, 300.0 / columns, 32 ) );
+      const QgsGeometry geometry( polygon );
+
+      QBENCHMARK
+      {
+        PolygonTriangulator::triangulate( geometry.constGet() );
+      }
+    }
+
+    void benchmarkParcels_data()
+    {
+      QTest::addColumn<int>( "engine" );
+
+      QTest::newRow( "tessellate" ) << static_cast<int>( PolygonTriangulator::Tessellate );
+      QTest::newRow( "earcut" ) << static_cast<int>( PolygonTriangulator::Earcut );
+    }
+
+    /**
+     * Triangulates the polygons of a real cadastral layer. The layer is not part of the
+     * repository, set QFIELD_BENCHMARK_PARCELS to the path of a polygon layer to run it.
+     */
+    void benchmarkParcels()
+    {
+      const QString path = qEnvironmentVariable( "QFIELD_BENCHMARK_PARCELS" );
+      if ( path.isEmpty() )
+        QSKIP( "QFIELD_BENCHMARK_PARCELS is not set" );
+
+      QFETCH( int, engine );
+      EngineScope scope( static_cast<PolygonTriangulator::Engine>( engine ) );
+
+      QgsVectorLayer layer( path, QStringLiteral( "parcels" ), QStringLiteral( "ogr" ) );
+      QVERIFY( layer.isValid() );
+      QCOMPARE( layer.geometryType(), QgsWkbTypes::PolygonGeometry );
+
+      QVector<QgsGeometry> geometries;
+      QgsFeature feature;
+      QgsFeatureIterator it = layer.getFeatures( QgsFeatureRequest().setNoAttributes() );
+      while ( it.nextFeature( feature ) )
+        geometries << feature.geometry();
+
+      QBENCHMARK
+      {
+        for ( const QgsGeometry &geometry : qgis::as_const( geometries ) )
+          PolygonTriangulator::triangulate( geometry.constGet() );
+      }
+    }
+
+  private:
+    //! Sets the engine of the triangulator for the lifetime of the scope
+    class EngineScope
+    {
+      public:
+        explicit EngineScope( PolygonTriangulator::Engine engine )
+          : mPreviousEngine( PolygonTriangulator::engine() )
+        {
+          PolygonTriangulator::setEngine( engine );
+        }
+
+        ~EngineScope()
+        {
+          PolygonTriangulator::setEngine( mPreviousEngine );
+        }
+
+      private:
+        PolygonTriangulator::Engine mPreviousEngine;
+    };
+
+    double trianglesArea( const QVector<QSGGeometry::Point2D> &triangles ) const
+    {
+      double area = 0;
+      for ( int i = 0; i + 2 < triangles.size(); i += 3 )
+      {
+        const QSGGeometry::Point2D &a = triangles.at( i );
+        const QSGGeometry::Point2D &b = triangles.at( i + 1 );
+        const QSGGeometry::Point2D &c = triangles.at( i + 2 );
+        area += std::fabs( ( b.x - a.x ) * ( c.y - a.y ) - ( c.x - a.x ) * ( b.y - a.y ) ) / 2.0;
+      }
+      return area;
+    }
+
+    QgsLineString *ring( double centerX, double centerY, double radius, int pointCount ) const
+    {
+      QVector<double> x;
+      QVector<double> y;
+      for ( int i = 0; i <= pointCount; ++i )
+      {
+        const double angle = 2 * M_PI * ( i % pointCount ) / pointCount;
+        x << centerX + radius * std::cos( angle );
+        y << centerY + radius * std::sin( angle );
+      }
+      return new QgsLineString( x, y );
+    }
+};
+
+QFIELDTEST_MAIN( TestPolygonTriangulator )
+#include "test_polygontriangulator.moc"
@@ -308,6 +308,114 @@ class TestReferencingFeatureListModel: public QObject
       QCOMPARE( mModel->rowCount(), 4 );
     }
 
+    /*
+      testPagedReferencingFeatures
+      - create model (set relation, set page size and order, set feature)
+      - check the total count and the first page
+      - fetch the next page
+      - count list / compare list
+    */
+    void testPagedReferencingFeatures()
+    {
+      ReferencingFeatureListModel model;
+      model.setPageSize( 2 );
+      model.setOrderBy( QStringLiteral( "name" ) );
+      model.setRelation( mR_Landhasoneking );
+
+      //check out Frodo
+      model.setFeature( mL_King->getFeature( 1 ) );
+      QVERIFY( QSignalSpy( &model, &ReferencingFeatureListModel::modelUpdated ).wait( 1000 ) );
+      //Frodo rules 3 lands, the first page contains 2 of them (Eriador, Gondor)
+      QCOMPARE( model.totalCount(), 3 );
+      QCOMPARE( model.rowCount(), 2 );
+      QCOMPARE( model.data( model.index( 0, 0 ), ReferencingFeatureListModel::DisplayString ).toString(), QStringLiteral( "Eriador" ) );
+      QVERIFY( model.canFetchMore( QModelIndex() ) );
+
+      //the referencing feature comes with all its attributes
+      QgsFeature feature = qvariant_cast<QgsFeature>( model.data( model.index( 1, 0 ), ReferencingFeatureListModel::ReferencingFeature ) );
+      QCOMPARE( feature.attribute( QStringLiteral( "name" ) ).toString(), QStringLiteral( "Gondor" ) );
+
+      model.fetchMore( QModelIndex() );
+      QVERIFY( QSignalSpy( &model, &ReferencingFeatureListModel::modelUpdated ).wait( 1000 ) );
+      QCOMPARE( model.rowCount(), 3 );
+      QCOMPARE( model.data( model.index( 2, 0 ), ReferencingFeatureListModel::DisplayString ).toString(), QStringLiteral( "Rohan" ) );
+      QVERIFY( !model.canFetchMore( QModelIndex() ) );
+    }
+
+    /*
+      testManyToManyTypedKeys
+      - create layers with string keys (tag) and links of which one has a NULL key
+      - create model (set relation, set nmrelation, set feature)
+      - the NULL key must not be joined with the empty string key
+    */
+    void testManyToManyTypedKeys()
+    {
+      QgsVectorLayer *item = new QgsVectorLayer( QStringLiteral( "None?field=id:integer" ), QStringLiteral( "item" ), QStringLiteral( "memory" ) );
+      QgsVectorLayer *tag = new QgsVectorLayer( QStringLiteral( "None?field=code:string&field=name:string" ), QStringLiteral( "tag" ), QStringLiteral( "memory" ) );
+      QgsVectorLayer *link = new QgsVectorLayer( QStringLiteral( "None?field=item_id:long&field=tag_code:string" ), QStringLiteral( "link" ), QStringLiteral( "memory" ) );
+      tag->setDisplayExpression( QStringLiteral( "name" ) );
+      QgsProject::instance()->addMapLayers( QList<QgsMapLayer *>() << item << tag << link, false );
+
+      QgsFeature itemFeature( item->fields() );
+      itemFeature.setAttribute( QStringLiteral( "id" ), 1 );
+      item->startEditing();
+      item->addFeature( itemFeature );
+      QVERIFY( item->commitChanges() );
+
+      tag->startEditing();
+      const QList<QPair<QString, QString>> tags { { QString( "" ), QStringLiteral( "empty" ) }, { QStringLiteral( "a" ), QStringLiteral( "alpha" ) } };
+      for ( const auto &pair : tags )
+      {
+        QgsFeature feature( tag->fields() );
+        feature.setAttribute( QStringLiteral( "code" ), pair.first );
+        feature.setAttribute( QStringLiteral( "name" ), pair.second );
+        tag->addFeature( feature );
+      }
+      QVERIFY( tag->commitChanges() );
+
+      // the item id is an integer and the referencing item_id a long long
+      link->startEditing();
+      for ( const QVariant &code : { QVariant( QVariant::String ), QVariant( QStringLiteral( "a" ) ) } )
+      {
+        QgsFeature feature( link->fields() );
+        feature.setAttribute( QStringLiteral( "item_id" ), 1 );
+        feature.setAttribute( QStringLiteral( "tag_code" ), code );
+        link->addFeature( feature );
+      }
+      QVERIFY( link->commitChanges() );
+
+      QgsRelation linkItem;
+      linkItem.setId( QStringLiteral( "link.item" ) );
+      linkItem.setName( QStringLiteral( "link.item" ) );
+      linkItem.setReferencingLayer( link->id() );
+      linkItem.setReferencedLayer( item->id() );
+      linkItem.addFieldPair( QStringLiteral( "item_id" ), QStringLiteral( "id" ) );
+      QVERIFY( linkItem.isValid() );
+
+      QgsRelation linkTag;
+      linkTag.setId( QStringLiteral( "link.tag" ) );
+      linkTag.setName( QStringLiteral( "link.tag" ) );
+      linkTag.setReferencingLayer( link->id() );
+      linkTag.setReferencedLayer( tag->id() );
+      linkTag.addFieldPair( QStringLiteral( "tag_code" ), QStringLiteral( "code" ) );
+      QVERIFY( linkTag.isValid() );
+
+      ReferencingFeatureListModel model;
+      model.setRelation( linkItem );
+      model.setNmRelation( linkTag );
+      model.setFeature( item->getFeature( 1 ) );
+      QVERIFY( QSignalSpy( &model, &ReferencingFeatureListModel::modelUpdated ).wait( 1000 ) );
+      QCOMPARE( model.rowCount(), 2 );
+
+      QStringList nmDisplayStrings;
+      for ( int row = 0; row < model.rowCount(); ++row )
+        nmDisplayStrings << model.data( model.index( row, 0 ), ReferencingFeatureListModel::NmDisplayString ).toString();
+      QVERIFY( nmDisplayStrings.contains( QStringLiteral( "alpha" ) ) );
+      QVERIFY( !nmDisplayStrings.contains( QStringLiteral( "empty" ) ) );
+
+      QgsProject::instance()->removeMapLayers( QList<QgsMapLayer *>() << item << tag << link );
+    }
+
     void cleanupTestCase()
     {
       delete mModel;
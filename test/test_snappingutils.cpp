@@ -0,0 +1,214 @@
+/***************************************************************************
+                        test_snappingutils.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "qgsquickmapsettings.h"
+#include "snappingutils.h"
+
+#include <qgsconfig.h>
+#include <qgsproject.h>
+#include <qgsvectorlayer.h>
+
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+
+class TestSnappingUtils: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase()
+    {
+      QStandardPaths::setTestModeEnabled( true );
+    }
+
+    void init()
+    {
+      mLayer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:3857" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+      QVERIFY( mLayer->isValid() );
+      QgsFeature feature( mLayer->fields() );
+      feature.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 10, 10 ) ) );
+      mLayer->dataProvider()->addFeature( feature );
+      QgsProject::instance()->addMapLayer( mLayer );
+
+      // one map unit per pixel
+      mMapSettings = new QgsQuickMapSettings();
+      mMapSettings->setDestinationCrs( QgsCoordinateReferenceSystem::fromEpsgId( 3857 ) );
+      mMapSettings->setOutputSize( QSize( 100, 100 ) );
+      mMapSettings->setExtent( QgsRectangle( 0, 0, 100, 100 ) );
+      mMapSettings->setLayers( QList<QgsMapLayer *>() << mLayer );
+
+      mSnappingUtils = new SnappingUtils();
+      mSnappingUtils->setMapSettings( mMapSettings );
+      QgsSnappingConfig config = mSnappingUtils->config();
+      config.setEnabled( true );
+      config.setMode( QgsSnappingConfig::AllLayers );
+#if VERSION_INT >= 31200
+      config.setTypeFlag( QgsSnappingConfig::VertexFlag );
+#else
+      config.setType( QgsSnappingConfig::Vertex );
+#endif
+      config.setTolerance( 5 );
+      config.setUnits( QgsTolerance::Pixels );
+      mSnappingUtils->setConfig( config );
+    }
+
+    void cleanup()
+    {
+      delete mSnappingUtils;
+      delete mMapSettings;
+      QgsProject::instance()->removeAllMapLayers();
+    }
+
+    void testSnapToVertex()
+    {
+      QVERIFY( snap( QgsPoint( 12, 12 ) ) );
+      QVERIFY( mSnappingUtils->snappingResult().isValid() );
+      QCOMPARE( mSnappingUtils->snappingResult().point(), QgsPoint( 10, 10 ) );
+      QCOMPARE( mSnappingUtils->snappingResult().layer(), mLayer );
+
+      QVERIFY( snap( QgsPoint( 30, 30 ) ) );
+      QVERIFY( !mSnappingUtils->snappingResult().isValid() );
+    }
+
+    void testEditedFeatures()
+    {
+      QVERIFY( snap( QgsPoint( 12, 12 ) ) );
+      QVERIFY( mSnappingUtils->snappingResult().isValid() );
+
+      // the features in the edit buffer are snapped to once the layer has changed
+      QVERIFY( mLayer->startEditing() );
+      QgsFeature feature( mLayer->fields() );
+      feature.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 50, 50 ) ) );
+      QVERIFY( mLayer->addFeature( feature ) );
+
+      QVERIFY( snap( QgsPoint( 51, 51 ) ) );
+      QVERIFY( mSnappingUtils->snappingResult().isValid() );
+      QCOMPARE( mSnappingUtils->snappingResult().point(), QgsPoint( 50, 50 ) );
+      mLayer->rollBack();
+    }
+
+    void testChangedGeometry()
+    {
+      QVERIFY( snap( QgsPoint( 12, 12 ) ) );
+      QVERIFY( mSnappingUtils->snappingResult().isValid() );
+
+      // the index follows the geometry changes without being built again
+      QSignalSpy startedSpy( mSnappingUtils, &SnappingUtils::indexingStarted );
+      QVERIFY( mLayer->startEditing() );
+      QgsFeature feature;
+      QVERIFY( mLayer->getFeatures().nextFeature( feature ) );
+      QVERIFY( mLayer->changeGeometry( feature.id(), QgsGeometry::fromPointXY( QgsPointXY( 70, 70 ) ) ) );
+
+      QVERIFY( snap( QgsPoint( 11, 11 ) ) );
+      QVERIFY( !mSnappingUtils->snappingResult().isValid() );
+      QVERIFY( snap( QgsPoint( 71, 71 ) ) );
+      QCOMPARE( mSnappingUtils->snappingResult().point(), QgsPoint( 70, 70 ) );
+      QCOMPARE( startedSpy.count(), 0 );
+      mLayer->rollBack();
+    }
+
+    void testRemovedLayer()
+    {
+      QVERIFY( snap( QgsPoint( 12, 12 ) ) );
+      QVERIFY( mSnappingUtils->snappingResult().isValid() );
+
+      mMapSettings->setLayers( QList<QgsMapLayer *>() );
+      QgsProject::instance()->removeMapLayer( mLayer );
+
+      QVERIFY( snap( QgsPoint( 11, 11 ) ) );
+      QVERIFY( !mSnappingUtils->snappingResult().isValid() );
+    }
+
+    void testIndexCache()
+    {
+      QFile::remove( SnappingUtils::indexCachePath() );
+
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "points.geojson" ) );
+      writeGeoJson( path );
+      QgsVectorLayer *layer = new QgsVectorLayer( path, QStringLiteral( "file points" ), QStringLiteral( "ogr" ) );
+      QVERIFY( layer->isValid() );
+      QgsProject::instance()->addMapLayer( layer );
+
+      // memory layers have no file to be remembered by
+      qint64 modified = 0;
+      QVERIFY( SnappingUtils::indexCacheKey( mLayer, modified ).isEmpty() );
+      QVERIFY( !SnappingUtils::indexCacheKey( layer, modified ).isEmpty() );
+
+      QVERIFY( !mSnappingUtils->isLargeLayer( layer ) );
+      mSnappingUtils->setLargeLayer( layer, true );
+
+      // the record outlives the snapping utils and selects extent limited indexes right away
+      SnappingUtils snappingUtils;
+      QVERIFY( snappingUtils.isLargeLayer( layer ) );
+      mMapSettings->setLayers( QList<QgsMapLayer *>() << mLayer << layer );
+      QVERIFY( snap( QgsPoint( 12, 12 ) ) );
+      QCOMPARE( mSnappingUtils->indexingStrategy(), QgsSnappingUtils::IndexExtent );
+
+      // a modified file is indexed in full again
+      QTest::qWait( 1100 );
+      writeGeoJson( path );
+      SnappingUtils modifiedSnappingUtils;
+      QVERIFY( !modifiedSnappingUtils.isLargeLayer( layer ) );
+    }
+
+  private:
+    static void writeGeoJson( const QString &path )
+    {
+      QFile file( path );
+      QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+      file.write( R"({"type": "FeatureCollection", "features": [{"type": "Feature", "properties": {}, "geometry": {"type": "Point", "coordinates": [0.0001, 0.0001]}}]})" );
+    }
+
+    //! Snaps \a point and waits for the result, including the indexes built in the background
+    bool snap( const QgsPoint &point )
+    {
+      const QPointF inputCoordinate = mMapSettings->coordinateToScreen( point );
+      QSignalSpy spy( mSnappingUtils, &SnappingUtils::snappingResultChanged );
+      QSignalSpy startedSpy( mSnappingUtils, &SnappingUtils::indexingStarted );
+      QSignalSpy finishedSpy( mSnappingUtils, &SnappingUtils::indexingFinished );
+      mSnappingUtils->setInputCoordinate( inputCoordinate );
+      while ( mSnappingUtils->snappingResultInputCoordinate() != inputCoordinate )
+      {
+        if ( !spy.wait( 5000 ) )
+          return false;
+      }
+
+      // the layers are snapped to again once their index is ready
+      if ( startedSpy.count() > finishedSpy.count() )
+      {
+        spy.clear();
+        if ( !finishedSpy.wait( 5000 ) )
+          return false;
+        if ( spy.isEmpty() && !spy.wait( 5000 ) )
+          return false;
+      }
+      return true;
+    }
+
+    QgsVectorLayer *mLayer = nullptr;
+    QgsQuickMapSettings *mMapSettings = nullptr;
+    SnappingUtils *mSnappingUtils = nullptr;
+};
+
+QFIELDTEST_MAIN( TestSnappingUtils )
+#include "test_snappingutils.moc"
@@ -0,0 +1,356 @@
+/***************************************************************************
+                        test_tracker.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "qfield_testbase.h"
+
+#include "rubberbandmodel.h"
+#include "tracker.h"
+#include "trackingmodel.h"
+#include "trackjournal.h"
+
+#include <qgsdistancearea.h>
+#include <qgsproject.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+
+class TestTracker: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase()
+    {
+      QStandardPaths::setTestModeEnabled( true );
+    }
+
+    void init()
+    {
+      QDir( TrackJournal::journalDirectory() ).removeRecursively();
+
+      mCrs = QgsCoordinateReferenceSystem::fromEpsgId( 3857 );
+      QgsProject::instance()->setCrs( mCrs );
+      // planar distances in meters
+      QgsProject::instance()->setEllipsoid( QStringLiteral( "NONE" ) );
+
+      mLayer = new QgsVectorLayer( QStringLiteral( "LineString?crs=EPSG:3857&field=name:string" ), QStringLiteral( "tracks" ), QStringLiteral( "memory" ) );
+      QVERIFY( mLayer->isValid() );
+      QgsProject::instance()->addMapLayer( mLayer );
+    }
+
+    void cleanup()
+    {
+      QgsProject::instance()->removeAllMapLayers();
+      QDir( TrackJournal::journalDirectory() ).removeRecursively();
+    }
+
+    void testJournalReplaceLastVertex()
+    {
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "track.journal" ) );
+      {
+        TrackJournal journal;
+        QVERIFY( journal.create( path, mLayer->id(), mCrs ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 0, 0 ) ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 1, 1 ) ) );
+        QVERIFY( journal.replaceLastVertex( QgsPoint( 2, 2 ) ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 3, 3 ) ) );
+        QCOMPARE( journal.vertexCount(), 3 );
+        QCOMPARE( journal.revision(), 5 );
+      }
+
+      TrackJournal::Track track;
+      QVERIFY( TrackJournal::read( path, track ) );
+      QCOMPARE( track.layerId, mLayer->id() );
+      QCOMPARE( track.crs, mCrs );
+      QCOMPARE( track.vertices.count(), 3 );
+      QCOMPARE( track.vertices.at( 1 ).x(), 2.0 );
+      QCOMPARE( track.vertices.at( 2 ).x(), 3.0 );
+    }
+
+    void testJournalTruncatedRecord()
+    {
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "track.journal" ) );
+      {
+        TrackJournal journal;
+        QVERIFY( journal.create( path, mLayer->id(), mCrs ) );
+        QVERIFY( journal.setFeatureId( 42 ) );
+        for ( int i = 0; i < 3; ++i )
+          QVERIFY( journal.appendVertex( QgsPoint( i, i ) ) );
+      }
+
+      // the application got killed while the last record was written
+      QFile file( path );
+      QVERIFY( file.resize( file.size() - 5 ) );
+
+      TrackJournal::Track track;
+      QVERIFY( TrackJournal::read( path, track ) );
+      QCOMPARE( track.featureId, QgsFeatureId( 42 ) );
+      QCOMPARE( track.vertices.count(), 2 );
+      QCOMPARE( track.vertices.at( 1 ).x(), 1.0 );
+    }
+
+    void testJournalStoredSegment()
+    {
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "track.journal" ) );
+      {
+        TrackJournal journal;
+        QVERIFY( journal.create( path, mLayer->id(), mCrs ) );
+        for ( int i = 0; i < 3; ++i )
+          QVERIFY( journal.appendVertex( QgsPoint( i, i ) ) );
+        QVERIFY( journal.setStoredFeatureId( 7 ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 3, 3 ) ) );
+      }
+
+      // only the vertices not stored yet are read back, after the last stored one
+      TrackJournal::Track track;
+      QVERIFY( TrackJournal::read( path, track ) );
+      QCOMPARE( track.storedFeatureId, QgsFeatureId( 7 ) );
+      QCOMPARE( track.vertices.count(), 2 );
+      QCOMPARE( track.vertices.at( 0 ).x(), 2.0 );
+      QCOMPARE( track.vertices.at( 1 ).x(), 3.0 );
+    }
+
+    void testRecoverTracks()
+    {
+      {
+        TrackJournal journal;
+        QVERIFY( journal.create( QDir( TrackJournal::journalDirectory() ).filePath( QStringLiteral( "unfinished.journal" ) ), mLayer->id(), mCrs ) );
+        for ( int i = 0; i < 3; ++i )
+          QVERIFY( journal.appendVertex( QgsPoint( i * 10, 0 ) ) );
+      }
+
+      TrackingModel model;
+      QCOMPARE( model.recoverTracks(), 1 );
+      QCOMPARE( mLayer->featureCount(), 1L );
+      QgsFeature feature;
+      QVERIFY( mLayer->getFeatures().nextFeature( feature ) );
+      QCOMPARE( feature.geometry().constGet()->nCoordinates(), 3 );
+      QVERIFY( TrackJournal::journals().isEmpty() );
+    }
+
+    void testRecoverStoredSegment()
+    {
+      const QgsFeatureId featureId = addTrackFeature();
+
+      {
+        TrackJournal journal;
+        QVERIFY( journal.create( QDir( TrackJournal::journalDirectory() ).filePath( QStringLiteral( "unfinished.journal" ) ), mLayer->id(), mCrs ) );
+        QVERIFY( journal.setFeatureId( featureId ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 0, 0 ) ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 10, 0 ) ) );
+        QVERIFY( journal.setStoredFeatureId( featureId ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 20, 0 ) ) );
+        QVERIFY( journal.appendVertex( QgsPoint( 30, 0 ) ) );
+      }
+
+      // the stored segment is left as it is, the rest goes to a new feature with the same attributes
+      TrackingModel model;
+      QCOMPARE( model.recoverTracks(), 1 );
+      QCOMPARE( mLayer->featureCount(), 2L );
+      QgsFeatureIterator it = mLayer->getFeatures( QgsFeatureRequest().setFilterExpression( QStringLiteral( "$id <> %1" ).arg( featureId ) ) );
+      QgsFeature feature;
+      QVERIFY( it.nextFeature( feature ) );
+      QCOMPARE( feature.attribute( QStringLiteral( "name" ) ).toString(), QStringLiteral( "walk" ) );
+      const QgsPointSequence points = pointSequence( feature.geometry() );
+      QCOMPARE( points.count(), 3 );
+      QCOMPARE( points.first().x(), 10.0 );
+      QCOMPARE( points.last().x(), 30.0 );
+    }
+
+    void testPeriodicFlush()
+    {
+      const QgsFeatureId featureId = addTrackFeature();
+
+      RubberbandModel rubberband;
+      rubberband.setCrs( mCrs );
+      Tracker tracker( mLayer, true );
+      tracker.setModel( &rubberband );
+      tracker.setMinimumDistance( 1 );
+      tracker.setConjunction( false );
+      tracker.setFeature( mLayer->getFeature( featureId ) );
+      tracker.start();
+
+      // a batch of more than 100 vertices is stored in the feature right away
+      tracker.processPositionSamples( samples( 1, 150 ) );
+      QgsPointSequence points = pointSequence( mLayer->getFeature( featureId ).geometry() );
+      QCOMPARE( points.count(), 150 );
+      QCOMPARE( points.last().x(), 1500.0 );
+
+      // the next segment is a new feature starting at the last stored vertex, the first one is not rewritten
+      tracker.processPositionSamples( samples( 151, 150 ) );
+      QCOMPARE( mLayer->featureCount(), 2L );
+      QCOMPARE( pointSequence( mLayer->getFeature( featureId ).geometry() ).count(), 150 );
+
+      QgsFeatureIterator it = mLayer->getFeatures( QgsFeatureRequest().setFilterExpression( QStringLiteral( "$id <> %1" ).arg( featureId ) ) );
+      QgsFeature segment;
+      QVERIFY( it.nextFeature( segment ) );
+      QCOMPARE( segment.attribute( QStringLiteral( "name" ) ).toString(), QStringLiteral( "walk" ) );
+      points = pointSequence( segment.geometry() );
+      QCOMPARE( points.count(), 151 );
+      QCOMPARE( points.first().x(), 1500.0 );
+      QCOMPARE( points.last().x(), 3000.0 );
+
+      // nothing is left to store, the journal is removed with the stopped track
+      tracker.stop();
+      QCOMPARE( mLayer->featureCount(), 2L );
+      QVERIFY( TrackJournal::journals().isEmpty() );
+    }
+
+    void testTotalLength()
+    {
+      // the lengths are measured on the ellipsoid, as for the project measurements
+      QgsProject::instance()->setEllipsoid( QStringLiteral( "EPSG:7030" ) );
+      const QgsFeatureId featureId = addTrackFeature();
+
+      RubberbandModel rubberband;
+      rubberband.setCrs( mCrs );
+      Tracker tracker( mLayer, true );
+      tracker.setModel( &rubberband );
+      tracker.setMinimumDistance( 1 );
+      tracker.setConjunction( false );
+      tracker.setFeature( mLayer->getFeature( featureId ) );
+      tracker.start();
+      QCOMPARE( tracker.totalLength(), 0.0 );
+
+      // a zigzag walk, received in two batches
+      QList<PositionSample> track;
+      for ( int i = 0; i < 40; ++i )
+      {
+        QGeoPositionInfo info( QGeoCoordinate(), QDateTime::currentDateTime() );
+        track << PositionSample { info, QgsPoint( 1000000 + i * 25, 5000000 + ( i % 2 ) * 40 + i * 3 ) };
+      }
+      QSignalSpy spy( &tracker, &Tracker::totalLengthChanged );
+      tracker.processPositionSamples( track.mid( 0, 15 ) );
+      tracker.processPositionSamples( track.mid( 15 ) );
+      QCOMPARE( spy.count(), 39 );
+      tracker.stop();
+
+      const QgsGeometry geometry = mLayer->getFeature( featureId ).geometry();
+      QCOMPARE( geometry.constGet()->nCoordinates(), 40 );
+
+      QgsDistanceArea distanceArea;
+      distanceArea.setEllipsoid( QgsProject::instance()->ellipsoid() );
+      distanceArea.setSourceCrs( mCrs, QgsProject::instance()->transformContext() );
+      const double length = distanceArea.measureLength( geometry );
+      QVERIFY( length > 0 );
+      QVERIFY( qgsDoubleNear( tracker.totalLength(), length, 1e-6 ) );
+    }
+
+    void testSimplification()
+    {
+      const QgsFeatureId featureId = addTrackFeature();
+
+      RubberbandModel rubberband;
+      rubberband.setCrs( mCrs );
+      Tracker tracker( mLayer, true );
+      tracker.setModel( &rubberband );
+      tracker.setMinimumDistance( 1 );
+      tracker.setConjunction( false );
+      tracker.setSimplificationTolerance( 2 );
+      tracker.setFeature( mLayer->getFeature( featureId ) );
+      tracker.start();
+
+      tracker.processPositionSamples( samples( { QgsPoint( 0, 0 ), QgsPoint( 10, 2 ) } ) );
+
+      // the latest trackpoint can be dropped as long as it stays within the tolerance of the new segment
+      QVERIFY( tracker.canSimplify( QgsPointXY( 20, 0.1 ) ) );
+      QVERIFY( tracker.canSimplify( QgsPointXY( 20, 0 ) ) );
+      QVERIFY( !tracker.canSimplify( QgsPointXY( 20, -0.1 ) ) );
+
+      // the intermediate positions are dropped, the latest one is always kept
+      tracker.processPositionSamples( samples( { QgsPoint( 20, 0 ), QgsPoint( 30, 0 ), QgsPoint( 40, 1 ) } ) );
+      QVERIFY( tracker.flush() );
+      QgsPointSequence points = pointSequence( mLayer->getFeature( featureId ).geometry() );
+      QCOMPARE( points.count(), 2 );
+      QCOMPARE( points.at( 0 ), QgsPoint( 0, 0 ) );
+      QCOMPARE( points.at( 1 ), QgsPoint( 40, 1 ) );
+
+      // the last stored vertex is never moved, the simplification restarts from it
+      QVERIFY( !tracker.canSimplify( QgsPointXY( 50, 1 ) ) );
+      tracker.processPositionSamples( samples( { QgsPoint( 50, 1 ), QgsPoint( 60, 1 ) } ) );
+      tracker.stop();
+      QCOMPARE( pointSequence( mLayer->getFeature( featureId ).geometry() ), points );
+
+      QgsFeatureIterator it = mLayer->getFeatures( QgsFeatureRequest().setFilterExpression( QStringLiteral( "$id <> %1" ).arg( featureId ) ) );
+      QgsFeature segment;
+      QVERIFY( it.nextFeature( segment ) );
+      points = pointSequence( segment.geometry() );
+      QCOMPARE( points.count(), 2 );
+      QCOMPARE( points.at( 0 ), QgsPoint( 40, 1 ) );
+      QCOMPARE( points.at( 1 ), QgsPoint( 60, 1 ) );
+
+      // without a tolerance every trackpoint is kept
+      tracker.setSimplificationTolerance( 0 );
+      QVERIFY( !tracker.canSimplify( QgsPointXY( 70, 1 ) ) );
+    }
+
+  private:
+    //! Adds a committed feature to hold the track
+    QgsFeatureId addTrackFeature()
+    {
+      QgsFeature feature( mLayer->fields() );
+      feature.setAttribute( QStringLiteral( "name" ), QStringLiteral( "walk" ) );
+      mLayer->dataProvider()->addFeature( feature );
+      return feature.id();
+    }
+
+    //! Returns \a count samples every 10 meters along the x axis, starting with the \a first multiple of 10
+    static QList<PositionSample> samples( int first, int count )
+    {
+      QList<PositionSample> samples;
+      for ( int i = first; i < first + count; ++i )
+      {
+        QGeoPositionInfo info( QGeoCoordinate(), QDateTime::currentDateTime() );
+        samples << PositionSample { info, QgsPoint( i * 10, 0 ) };
+      }
+      return samples;
+    }
+
+    //! Returns samples at the \a points
+    static QList<PositionSample> samples( const QgsPointSequence &points )
+    {
+      QList<PositionSample> samples;
+      for ( const QgsPoint &point : points )
+      {
+        QGeoPositionInfo info( QGeoCoordinate(), QDateTime::currentDateTime() );
+        samples << PositionSample { info, point };
+      }
+      return samples;
+    }
+
+    static QgsPointSequence pointSequence( const QgsGeometry &geometry )
+    {
+      QgsPointSequence points;
+      for ( auto it = geometry.vertices_begin(); it != geometry.vertices_end(); ++it )
+        points << *it;
+      return points;
+    }
+
+    QgsCoordinateReferenceSystem mCrs;
+    QgsVectorLayer *mLayer = nullptr;
+};
+
+QFIELDTEST_MAIN( TestTracker )
+#include "test_tracker.moc"
@@ -0,0 +1,124 @@
+/***************************************************************************
+                        test_vertexhandles.cpp
+                        --------------------
+  begin                : October 2020
+  copyright            : (C) 2020 by OPENGIS.ch
+  email                : info@opengis.ch
+***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QSGGeometry>
+
+#include "qfield_testbase.h"
+
+#include "qgsquickmapsettings.h"
+#include "vertexhandles.h"
+#include "vertexmodel.h"
+
+#include <qgsgeometry.h>
+
+
+class TestVertexHandles: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void init()
+    {
+      mMapSettings.reset( new QgsQuickMapSettings() );
+      mMapSettings->setOutputSize( QSize( 100, 100 ) );
+      mMapSettings->setExtent( QgsRectangle( 0, 0, 10, 10 ) );
+
+      mModel.reset( new VertexModel() );
+      mModel->setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString (1 1, 5 5, 9 9)" ) ) );
+      // the 3 vertices and their 4 candidates
+      QCOMPARE( mModel->vertexCount(), 7 );
+
+      mHandles.reset( new VertexHandles() );
+      mHandles->setVertexModel( mModel.get() );
+      mHandles->setMapSettings( mMapSettings.get() );
+      mHandles->setColor( QColor( 0, 0, 255 ) );
+      mHandles->setCurrentColor( QColor( 255, 0, 0 ) );
+      mHandles->setFillColor( QColor( 255, 255, 255 ) );
+    }
+
+    void testHandles()
+    {
+      QSGGeometry geometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+      mHandles->updateGeometry( &geometry );
+
+      // a fill triangle and a border quad per corner, 16 corners for a vertex and 4 for a candidate
+      QCOMPARE( geometry.vertexCount(), 3 * 16 * 9 + 4 * 4 * 9 );
+
+      // the handles are centered on the vertices, in screen coordinates
+      const QSGGeometry::ColoredPoint2D *vertices = geometry.vertexDataAsColoredPoint2D();
+      const QPointF firstCenter = mMapSettings->coordinateToScreen( mModel->vertex( 0 ).point );
+      QCOMPARE( vertices[0].x, static_cast<float>( firstCenter.x() ) );
+      QCOMPARE( vertices[0].y, static_cast<float>( firstCenter.y() ) );
+      QCOMPARE( vertices[0].r, static_cast<uchar>( 255 ) );
+      QCOMPARE( vertices[3].b, static_cast<uchar>( 255 ) );
+      QCOMPARE( vertices[3].r, static_cast<uchar>( 0 ) );
+    }
+
+    void testCurrentVertex()
+    {
+      mModel->setCurrentVertexIndex( 3 );
+
+      QSGGeometry geometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+      mHandles->updateGeometry( &geometry );
+
+      // the current vertex is drawn last, on top of the others, with its own border color
+      const int handleVertexCount = 16 * 9;
+      const QSGGeometry::ColoredPoint2D *current = geometry.vertexDataAsColoredPoint2D() + geometry.vertexCount() - handleVertexCount;
+      const QPointF center = mMapSettings->coordinateToScreen( mModel->vertex( 3 ).point );
+      QCOMPARE( current[0].x, static_cast<float>( center.x() ) );
+      QCOMPARE( current[0].y, static_cast<float>( center.y() ) );
+      QCOMPARE( current[3].r, static_cast<uchar>( 255 ) );
+      QCOMPARE( current[3].b, static_cast<uchar>( 0 ) );
+
+      // the border of the first corner goes from the inner to the outer radius
+      QCOMPARE( current[4].x - current[3].x, 2.0f );
+      QCOMPARE( current[4].x - current[0].x, 10.0f );
+    }
+
+    void testMaximumVertexCount()
+    {
+      mModel->setCurrentVertexIndex( 3 );
+      mHandles->setMaximumVertexCount( 5 );
+
+      // only the current vertex is drawn when there are too many
+      QSGGeometry geometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+      mHandles->updateGeometry( &geometry );
+      QCOMPARE( geometry.vertexCount(), 16 * 9 );
+
+      mModel->setCurrentVertexIndex( -1 );
+      mHandles->updateGeometry( &geometry );
+      QCOMPARE( geometry.vertexCount(), 0 );
+    }
+
+    void testVisibleExtent()
+    {
+      // only the first vertex and the candidate extending the line are within the extent
+      mMapSettings->setExtent( QgsRectangle( -1, -1, 2, 2 ) );
+
+      QSGGeometry geometry( QSGGeometry::defaultAttributes_ColoredPoint2D(), 0 );
+      mHandles->updateGeometry( &geometry );
+      QCOMPARE( geometry.vertexCount(), 16 * 9 + 4 * 9 );
+    }
+
+  private:
+    std::unique_ptr<QgsQuickMapSettings> mMapSettings;
+    std::unique_ptr<VertexModel> mModel;
+    std::unique_ptr<VertexHandles> mHandles;
+};
+
+QFIELDTEST_MAIN( TestVertexHandles )
+#include "test_vertexhandles.moc"
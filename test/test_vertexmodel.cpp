@@ -6,6 +6,7 @@
 #include <qgspoint.h>
 #include <qgspointxy.h>
 #include <qgsmessagelog.h>
+#include <QSignalSpy>
 
 #include "qgsquickmapsettings.h"
 #include "vertexmodel.h"
@@ -110,6 +111,30 @@ class TestVertexModel: public QObject
       QCOMPARE( mModel->mVertices.at( 15 ).point, QgsPoint( 1, 1 ) );
     }
 
+    void testOriginalPoints()
+    {
+      mModel->setGeometry( mLineGeometry );
+
+      // the existing vertices refer to their original position, the candidates have none
+      QCOMPARE( mModel->data( mModel->index( 3, 0 ), VertexModel::OriginalPointRole ).value<QgsPoint>(), QgsPoint( 2, 2 ) );
+      QVERIFY( mModel->data( mModel->index( 2, 0 ), VertexModel::OriginalPointRole ).value<QgsPoint>().isEmpty() );
+
+      mModel->setCurrentVertex( 3 );
+      mModel->setCurrentPoint( QgsPoint( 2, 3 ) );
+      QCOMPARE( mModel->verticesMoved().count(), 1 );
+      QCOMPARE( mModel->verticesMoved().at( 0 ).first, QgsPoint( 2, 2 ) );
+      QCOMPARE( mModel->verticesMoved().at( 0 ).second, QgsPoint( 2, 3 ) );
+
+      mModel->setCurrentVertex( 1 );
+      mModel->removeCurrentVertex();
+      QCOMPARE( mModel->verticesDeleted(), QVector<QgsPoint>() << QgsPoint( 0, 0 ) );
+
+      // the restored vertex refers to its original position again
+      mModel->undo();
+      QVERIFY( mModel->verticesDeleted().isEmpty() );
+      QCOMPARE( mModel->data( mModel->index( 1, 0 ), VertexModel::OriginalPointRole ).value<QgsPoint>(), QgsPoint( 0, 0 ) );
+    }
+
     void canRemoveVertexTest()
     {
       // line
@@ -231,12 +256,186 @@ class TestVertexModel: public QObject
       QCOMPARE( mModel->mVertices.count(), 9 );
     }
 
+    void verticesInRectangleTest()
+    {
+      mModel->setMapSettings( nullptr );
+      mModel->setGeometry( mPolygonGeometry );
+
+      // the vertex (2, 2) and the candidates (2, 1) and (1, 2)
+      QCOMPARE( mModel->verticesInRectangle( QgsRectangle( 1, 1, 3, 3 ) ), QVector<int>() << 2 << 3 << 4 );
+      QCOMPARE( mModel->verticesInRectangle( QgsRectangle( 5, 5, 6, 6 ) ), QVector<int>() );
+      QCOMPARE( mModel->verticesInRectangle( QgsRectangle( -10, -10, 10, 10 ) ).count(), 8 );
+    }
+
+    void fineGrainedSignalsTest()
+    {
+      mModel->setMapSettings( nullptr );
+      mModel->setGeometry( mPolygonGeometry );
+
+      QSignalSpy resetSpy( mModel, &VertexModel::modelReset );
+      QSignalSpy insertSpy( mModel, &VertexModel::rowsInserted );
+      QSignalSpy dataSpy( mModel, &VertexModel::dataChanged );
+
+      // moving a vertex only changes it and its neighbouring candidates
+      mModel->setEditingMode( VertexModel::EditVertex );
+      mModel->setCurrentVertex( 3 );
+      dataSpy.clear();
+      mModel->setCurrentPoint( QgsPoint( 4, 4 ) );
+      QCOMPARE( resetSpy.count(), 0 );
+      QCOMPARE( insertSpy.count(), 0 );
+      QVERIFY( dataSpy.count() > 0 );
+      QCOMPARE( mModel->mVertices.at( 2 ).point, QgsPoint( 3, 2 ) );
+      QCOMPARE( mModel->verticesInRectangle( QgsRectangle( 3.5, 3.5, 4.5, 4.5 ) ), QVector<int>() << 3 );
+
+      // adding a vertex inserts two rows
+      mModel->setEditingMode( VertexModel::AddVertex );
+      mModel->setCurrentVertex( 0 );
+      mModel->setCurrentPoint( QgsPoint( 1, -1 ) );
+      QCOMPARE( resetSpy.count(), 0 );
+      QCOMPARE( insertSpy.count(), 1 );
+      QCOMPARE( mModel->vertexCount(), 10 );
+    }
+
+    void incrementalEditsTest()
+    {
+      mModel->setMapSettings( nullptr );
+      mModel->setGeometry( mRingPolygonGeometry );
+      // materialize the geometry, the edits are then applied on it in place
+      mModel->geometry();
+
+      QSignalSpy resetSpy( mModel, &VertexModel::modelReset );
+      QSignalSpy insertSpy( mModel, &VertexModel::rowsInserted );
+      QSignalSpy removeSpy( mModel, &VertexModel::rowsRemoved );
+
+      // removing the last vertex of the interior ring removes it with its preceding candidate
+      mModel->setEditingMode( VertexModel::EditVertex );
+      mModel->setCurrentVertex( 15 );
+      mModel->removeCurrentVertex();
+      QCOMPARE( resetSpy.count(), 0 );
+      QCOMPARE( removeSpy.count(), 1 );
+      QCOMPARE( removeSpy.at( 0 ).at( 1 ).toInt(), 14 );
+      QCOMPARE( removeSpy.at( 0 ).at( 2 ).toInt(), 15 );
+      QCOMPARE( mModel->vertexCount(), 14 );
+      // the candidate closing the ring has been updated
+      QCOMPARE( mModel->mVertices.at( 8 ).point, QgsPoint( 2, 2 ) );
+      QCOMPARE( mModel->geometry().asWkt(), rebuiltGeometry().asWkt() );
+      QCOMPARE( mModel->geometry().constGet()->vertexCount( 0, 1 ), 4 );
+
+      // undoing appends the vertex and its candidate to the interior ring again
+      mModel->undo();
+      QCOMPARE( resetSpy.count(), 0 );
+      QCOMPARE( insertSpy.count(), 1 );
+      QCOMPARE( insertSpy.at( 0 ).at( 1 ).toInt(), 14 );
+      QCOMPARE( insertSpy.at( 0 ).at( 2 ).toInt(), 15 );
+      QCOMPARE( mModel->mCurrentIndex, 15 );
+      QCOMPARE( mModel->mVertices.at( 14 ).point, QgsPoint( 1, 2 ) );
+      QCOMPARE( mModel->mVertices.at( 15 ).point, QgsPoint( 1, 1 ) );
+      QCOMPARE( mModel->mVertices.at( 8 ).point, QgsPoint( 2, 1 ) );
+      QCOMPARE( mModel->geometry().asWkt(), rebuiltGeometry().asWkt() );
+      QCOMPARE( mModel->geometry().constGet()->vertexCount( 0, 1 ), 5 );
+
+      // inserting on the exterior ring shifts the interior ring
+      mModel->setEditingMode( VertexModel::AddVertex );
+      mModel->setCurrentVertex( 2 );
+      mModel->setCurrentPoint( QgsPoint( 5, 2 ) );
+      QCOMPARE( insertSpy.count(), 2 );
+      QCOMPARE( insertSpy.at( 1 ).at( 1 ).toInt(), 3 );
+      QCOMPARE( insertSpy.at( 1 ).at( 2 ).toInt(), 4 );
+      QCOMPARE( mModel->mCurrentIndex, 3 );
+      QCOMPARE( mModel->mVertices.at( 2 ).point, QgsPoint( 4.5, 1 ) );
+      QCOMPARE( mModel->mVertices.at( 4 ).point, QgsPoint( 4.5, 3 ) );
+      QCOMPARE( mModel->mVertices.at( 10 ).ring, 1 );
+      QCOMPARE( mModel->existingVertexIndex( 11 ), 0 );
+      QCOMPARE( mModel->geometry().asWkt(), rebuiltGeometry().asWkt() );
+
+      // moving a vertex of the interior ring updates the materialized geometry
+      mModel->setCurrentVertex( 11 );
+      mModel->setCurrentPoint( QgsPoint( 2, 0.5 ) );
+      QCOMPARE( mModel->mVertices.at( 10 ).point, QgsPoint( 1.5, 0.75 ) );
+      QCOMPARE( mModel->geometry().asWkt(), rebuiltGeometry().asWkt() );
+      QCOMPARE( resetSpy.count(), 0 );
+    }
+
+    void partTest()
+    {
+      mModel->setMapSettings( nullptr );
+      mModel->setGeometry( QgsGeometry::fromWkt( QStringLiteral( "MultiLineString ((0 0, 2 2),(4 4, 6 6))" ) ) );
+      QVERIFY( !mModel->editingAllowed() );
+      QCOMPARE( mModel->mVertices.first().part, 0 );
+      QCOMPARE( mModel->mVertices.at( 1 ).part, 0 );
+      QCOMPARE( mModel->mVertices.last().part, 1 );
+
+      // the vertices of a single part geometry are moved in the materialized geometry
+      mModel->setGeometry( QgsGeometry::fromWkt( QStringLiteral( "MultiLineString ((0 0, 2 2, 4 4))" ) ) );
+      QVERIFY( mModel->editingAllowed() );
+      QCOMPARE( mModel->geometry().asWkt(), QStringLiteral( "LineString (0 0, 2 2, 4 4)" ) );
+      mModel->setEditingMode( VertexModel::EditVertex );
+      mModel->setCurrentVertex( 3 );
+      mModel->setCurrentPoint( QgsPoint( 3, 1 ) );
+      QVERIFY( mModel->mMaterializedGeometryValid );
+      QCOMPARE( mModel->geometry().asWkt(), QStringLiteral( "LineString (0 0, 3 1, 4 4)" ) );
+    }
+
+    void undoRedoTest()
+    {
+      mModel->setMapSettings( nullptr );
+      mModel->setCrs( QgsCoordinateReferenceSystem() );
+      mModel->setGeometry( mPolygonGeometry );
+      QVERIFY( !mModel->canUndo() );
+      QVERIFY( !mModel->dirty() );
+
+      // dragging a vertex is a single operation
+      mModel->setEditingMode( VertexModel::EditVertex );
+      mModel->setCurrentVertex( 3 );
+      mModel->setCurrentPoint( QgsPoint( 3, 3 ) );
+      mModel->setCurrentPoint( QgsPoint( 4, 4 ) );
+      QCOMPARE( mModel->mJournal.count(), 1 );
+      QCOMPARE( mModel->geometry().asWkt(), QStringLiteral( "Polygon ((2 0, 4 4, 0 2, 0 0, 2 0))" ) );
+
+      mModel->setCurrentVertex( 1 );
+      QCOMPARE( mModel->vertexCount(), 8 );
+      mModel->removeCurrentVertex();
+      QCOMPARE( mModel->vertexCount(), 6 );
+      QVERIFY( mModel->canUndo() );
+      QVERIFY( mModel->dirty() );
+
+      mModel->undo();
+      QCOMPARE( mModel->vertexCount(), 8 );
+      QCOMPARE( mModel->mVertices.at( 1 ).point, QgsPoint( 2, 0 ) );
+      QCOMPARE( mModel->geometry().asWkt(), QStringLiteral( "Polygon ((2 0, 4 4, 0 2, 0 0, 2 0))" ) );
+
+      mModel->undo();
+      QVERIFY( !mModel->canUndo() );
+      QVERIFY( mModel->canRedo() );
+      QVERIFY( !mModel->dirty() );
+      QCOMPARE( mModel->mVertices.at( 3 ).point, QgsPoint( 2, 2 ) );
+      QCOMPARE( mModel->geometry().asWkt(), QStringLiteral( "Polygon ((2 0, 2 2, 0 2, 0 0, 2 0))" ) );
+
+      mModel->redo();
+      QCOMPARE( mModel->mVertices.at( 3 ).point, QgsPoint( 4, 4 ) );
+      mModel->redo();
+      QCOMPARE( mModel->vertexCount(), 6 );
+      QVERIFY( !mModel->canRedo() );
+    }
+
     void cleanupTestCase()
     {
       delete mModel;
     }
 
   private:
+    //! Returns the geometry materialized from scratch out of the vertices of the model
+    QgsGeometry rebuiltGeometry()
+    {
+      const QgsGeometry materializedGeometry = mModel->mMaterializedGeometry;
+      const bool materializedGeometryValid = mModel->mMaterializedGeometryValid;
+      mModel->mMaterializedGeometryValid = false;
+      const QgsGeometry geometry = mModel->geometry();
+      mModel->mMaterializedGeometry = materializedGeometry;
+      mModel->mMaterializedGeometryValid = materializedGeometryValid;
+      return geometry;
+    }
+
     VertexModel *mModel;
     QgsGeometry mLineGeometry;
     QgsGeometry mPolygonGeometry;